@@ -0,0 +1,220 @@
+#ifndef SG_CDB_HPP
+#define SG_CDB_HPP
+
+/*
+ * Copyright (c) 2026 Douglas Gilbert.
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the BSD_LICENSE file.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Header only C++ (C++11 or later) builders for commonly used SCSI command
+ * descriptor blocks (CDBs). Each builder returns a std::array whose size is
+ * the CDB length, with every byte placed by a single constexpr expression.
+ * So when the arguments are constants the CDB is built at compile time and
+ * otherwise it compiles to a handful of stores; unlike the usual "memset(),
+ * then sg_put_unaligned_be*()" sequence there is no runtime byte shuffling.
+ * Multi byte fields are big endian as SCSI requires, field layouts follow
+ * SPC-5 and SBC-4. For example:
+ *
+ *     auto cdb = sg_cdb::read16(lba, num_blks, sg_cdb::FUA);
+ *     set_scsi_pt_cdb(ptvp, cdb.data(), cdb.size());
+ *
+ * The C functions in sg_cmds_basic.h and sg_cmds_extra.h remain the way to
+ * build and issue most commands; this header is aimed at code that issues
+ * many READs and WRITEs, such as the C++ test programs in testing/ .
+ */
+
+#include <array>
+#include <stdint.h>
+
+namespace sg_cdb {
+
+typedef std::array<uint8_t, 6> cdb6_t;
+typedef std::array<uint8_t, 10> cdb10_t;
+typedef std::array<uint8_t, 12> cdb12_t;
+typedef std::array<uint8_t, 16> cdb16_t;
+
+/* Byte 1 flags of READ, WRITE and VERIFY (10, 12 and 16 byte variants).
+ * RDPROTECT, WRPROTECT and VRPROTECT (bits 7:5) may be or-ed in as well,
+ * shifted left by 5. */
+constexpr uint8_t FUA = 0x8;
+constexpr uint8_t DPO = 0x10;
+constexpr uint8_t RARC = 0x4;           /* READ only */
+constexpr uint8_t BYTCHK_1 = 0x2;       /* VERIFY only: compare data-out */
+constexpr uint8_t BYTCHK_3 = 0x6;       /* VERIFY: one block, repeated */
+
+namespace detail {
+
+/* Byte 'n' (0 is least significant) of v */
+constexpr uint8_t
+byte(uint64_t v, int n)
+{
+    return static_cast<uint8_t>((v >> (8 * n)) & 0xff);
+}
+
+/* Common layout of READ(10), WRITE(10), VERIFY(10) ... */
+constexpr cdb10_t
+lba32_len16(uint8_t opcode, uint8_t byte1, uint32_t lba, uint16_t num,
+            uint8_t group)
+{
+    return cdb10_t{{opcode, byte1, byte(lba, 3), byte(lba, 2), byte(lba, 1),
+                    byte(lba, 0), static_cast<uint8_t>(group & 0x3f),
+                    byte(num, 1), byte(num, 0), 0}};
+}
+
+/* Common layout of READ(12), WRITE(12), VERIFY(12) */
+constexpr cdb12_t
+lba32_len32(uint8_t opcode, uint8_t byte1, uint32_t lba, uint32_t num,
+            uint8_t group)
+{
+    return cdb12_t{{opcode, byte1, byte(lba, 3), byte(lba, 2), byte(lba, 1),
+                    byte(lba, 0), byte(num, 3), byte(num, 2), byte(num, 1),
+                    byte(num, 0), static_cast<uint8_t>(group & 0x3f), 0}};
+}
+
+/* Common layout of READ(16), WRITE(16), VERIFY(16) ... */
+constexpr cdb16_t
+lba64_len32(uint8_t opcode, uint8_t byte1, uint64_t lba, uint32_t num,
+            uint8_t group)
+{
+    return cdb16_t{{opcode, byte1, byte(lba, 7), byte(lba, 6), byte(lba, 5),
+                    byte(lba, 4), byte(lba, 3), byte(lba, 2), byte(lba, 1),
+                    byte(lba, 0), byte(num, 3), byte(num, 2), byte(num, 1),
+                    byte(num, 0), static_cast<uint8_t>(group & 0x3f), 0}};
+}
+
+}       /* namespace detail */
+
+constexpr cdb6_t
+test_unit_ready()
+{
+    return cdb6_t{{0x0, 0, 0, 0, 0, 0}};
+}
+
+/* Standard INQUIRY response when evpd is false, else the VPD page_code */
+constexpr cdb6_t
+inquiry(uint16_t alloc_len, bool evpd = false, uint8_t page_code = 0)
+{
+    return cdb6_t{{0x12, static_cast<uint8_t>(evpd ? 0x1 : 0x0),
+                   page_code, detail::byte(alloc_len, 1),
+                   detail::byte(alloc_len, 0), 0}};
+}
+
+/* READ CAPACITY(10) has no parameters of interest (PMI and its LBA field
+ * are obsolete) */
+constexpr cdb10_t
+read_capacity10()
+{
+    return cdb10_t{{0x25, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
+}
+
+/* READ CAPACITY(16) is SERVICE ACTION IN(16) with service action 0x10 */
+constexpr cdb16_t
+read_capacity16(uint32_t alloc_len)
+{
+    return cdb16_t{{0x9e, 0x10, 0, 0, 0, 0, 0, 0, 0, 0,
+                    detail::byte(alloc_len, 3), detail::byte(alloc_len, 2),
+                    detail::byte(alloc_len, 1), detail::byte(alloc_len, 0),
+                    0, 0}};
+}
+
+/* 'power_cond' is the 4 bit POWER CONDITION field (0 for START/LOEJ) */
+constexpr cdb6_t
+start_stop_unit(bool start, bool loej = false, bool immed = false,
+                uint8_t power_cond = 0)
+{
+    return cdb6_t{{0x1b, static_cast<uint8_t>(immed ? 0x1 : 0x0), 0, 0,
+                   static_cast<uint8_t>(((power_cond & 0xf) << 4) |
+                                        (loej ? 0x2 : 0x0) |
+                                        (start ? 0x1 : 0x0)), 0}};
+}
+
+constexpr cdb10_t
+read10(uint32_t lba, uint16_t num_blks, uint8_t flags = 0, uint8_t group = 0)
+{
+    return detail::lba32_len16(0x28, flags, lba, num_blks, group);
+}
+
+constexpr cdb10_t
+write10(uint32_t lba, uint16_t num_blks, uint8_t flags = 0, uint8_t group = 0)
+{
+    return detail::lba32_len16(0x2a, flags, lba, num_blks, group);
+}
+
+constexpr cdb10_t
+verify10(uint32_t lba, uint16_t num_blks, uint8_t flags = 0,
+         uint8_t group = 0)
+{
+    return detail::lba32_len16(0x2f, flags, lba, num_blks, group);
+}
+
+/* 'flags' may contain IMMED (0x2) */
+constexpr cdb10_t
+synchronize_cache10(uint32_t lba = 0, uint16_t num_blks = 0,
+                    uint8_t flags = 0, uint8_t group = 0)
+{
+    return detail::lba32_len16(0x35, flags, lba, num_blks, group);
+}
+
+constexpr cdb12_t
+read12(uint32_t lba, uint32_t num_blks, uint8_t flags = 0, uint8_t group = 0)
+{
+    return detail::lba32_len32(0xa8, flags, lba, num_blks, group);
+}
+
+constexpr cdb12_t
+write12(uint32_t lba, uint32_t num_blks, uint8_t flags = 0, uint8_t group = 0)
+{
+    return detail::lba32_len32(0xaa, flags, lba, num_blks, group);
+}
+
+constexpr cdb12_t
+verify12(uint32_t lba, uint32_t num_blks, uint8_t flags = 0,
+         uint8_t group = 0)
+{
+    return detail::lba32_len32(0xaf, flags, lba, num_blks, group);
+}
+
+constexpr cdb16_t
+read16(uint64_t lba, uint32_t num_blks, uint8_t flags = 0, uint8_t group = 0)
+{
+    return detail::lba64_len32(0x88, flags, lba, num_blks, group);
+}
+
+constexpr cdb16_t
+write16(uint64_t lba, uint32_t num_blks, uint8_t flags = 0, uint8_t group = 0)
+{
+    return detail::lba64_len32(0x8a, flags, lba, num_blks, group);
+}
+
+constexpr cdb16_t
+verify16(uint64_t lba, uint32_t num_blks, uint8_t flags = 0,
+         uint8_t group = 0)
+{
+    return detail::lba64_len32(0x8f, flags, lba, num_blks, group);
+}
+
+/* 'flags' may contain IMMED (0x2) */
+constexpr cdb16_t
+synchronize_cache16(uint64_t lba = 0, uint32_t num_blks = 0,
+                    uint8_t flags = 0, uint8_t group = 0)
+{
+    return detail::lba64_len32(0x91, flags, lba, num_blks, group);
+}
+
+/* WRITE SAME(16); 'flags' may contain UNMAP (0x8), ANCHOR (0x10) and
+ * NDOB (0x1) */
+constexpr cdb16_t
+write_same16(uint64_t lba, uint32_t num_blks, uint8_t flags = 0,
+             uint8_t group = 0)
+{
+    return detail::lba64_len32(0x93, flags, lba, num_blks, group);
+}
+
+}       /* namespace sg_cdb */
+
+#endif          /* SG_CDB_HPP */
@@ -74,6 +74,11 @@ int sg_ll_log_select(int sg_fd, bool pcr, bool sp, int pc, int pg_code,
                      int subpg_code, uint8_t * paramp, int param_len,
                      bool noisy, int verbose);
 
+/* Similar to sg_ll_log_select(). See note above about "_pt" suffix. */
+int sg_ll_log_select_pt(struct sg_pt_base * ptp, bool pcr, bool sp, int pc,
+                        int pg_code, int subpg_code, uint8_t * paramp,
+                        int param_len, bool noisy, int verbose);
+
 /* Invokes a SCSI LOG SENSE command. Return of 0 -> success,
  * SG_LIB_CAT_INVALID_OP -> Log Sense not supported,
  * SG_LIB_CAT_ILLEGAL_REQ -> bad field in cdb, SG_LIB_CAT_UNIT_ATTENTION,
@@ -90,6 +95,12 @@ int sg_ll_log_sense_v2(int sg_fd, bool ppc, bool sp, int pc, int pg_code,
                        int mx_resp_len, int timeout_secs, int * residp,
                        bool noisy, int verbose);
 
+/* Similar to sg_ll_log_sense_v2(). See note above about "_pt" suffix. */
+int sg_ll_log_sense_v2_pt(struct sg_pt_base * ptp, bool ppc, bool sp, int pc,
+                          int pg_code, int subpg_code, int paramp,
+                          uint8_t * resp, int mx_resp_len, int timeout_secs,
+                          int * residp, bool noisy, int verbose);
+
 /* Invokes a SCSI MODE SELECT (6) command.  Return of 0 -> success,
  * SG_LIB_CAT_INVALID_OP -> invalid opcode, SG_LIB_CAT_ILLEGAL_REQ ->
  * bad field in cdb, * SG_LIB_CAT_NOT_READY -> device not ready,
@@ -102,6 +113,11 @@ int sg_ll_mode_select6_v2(int sg_fd, bool pf, bool rtd, bool sp,
                           void * paramp, int param_len, bool noisy,
                           int verbose);
 
+/* Similar to sg_ll_mode_select6_v2(). See note above about "_pt" suffix. */
+int sg_ll_mode_select6_v2_pt(struct sg_pt_base * ptp, bool pf, bool rtd,
+                             bool sp, void * paramp, int param_len, bool noisy,
+                             int verbose);
+
 /* Invokes a SCSI MODE SELECT (10) command.  Return of 0 -> success,
  * SG_LIB_CAT_INVALID_OP -> invalid opcode, SG_LIB_CAT_ILLEGAL_REQ ->
  * bad field in cdb, * SG_LIB_CAT_NOT_READY -> device not ready,
@@ -114,6 +130,11 @@ int sg_ll_mode_select10_v2(int sg_fd, bool pf, bool rtd, bool sp,
                            void * paramp, int param_len, bool noisy,
                            int verbose);
 
+/* Similar to sg_ll_mode_select10_v2(). See note above about "_pt" suffix. */
+int sg_ll_mode_select10_v2_pt(struct sg_pt_base * ptp, bool pf, bool rtd,
+                              bool sp, void * paramp, int param_len,
+                              bool noisy, int verbose);
+
 /* Invokes a SCSI MODE SENSE (6) command. Return of 0 -> success,
  * SG_LIB_CAT_INVALID_OP -> invalid opcode, SG_LIB_CAT_ILLEGAL_REQ ->
  * bad field in cdb, * SG_LIB_CAT_NOT_READY -> device not ready,
@@ -123,6 +144,11 @@ int sg_ll_mode_sense6(int sg_fd, bool dbd, int pc, int pg_code,
                       int sub_pg_code, void * resp, int mx_resp_len,
                       bool noisy, int verbose);
 
+/* Similar to sg_ll_mode_sense6(). See note above about "_pt" suffix. */
+int sg_ll_mode_sense6_pt(struct sg_pt_base * ptp, bool dbd, int pc,
+                         int pg_code, int sub_pg_code, void * resp,
+                         int mx_resp_len, bool noisy, int verbose);
+
 /* Invokes a SCSI MODE SENSE (10) command. Return of 0 -> success,
  * SG_LIB_CAT_INVALID_OP -> invalid opcode, SG_LIB_CAT_ILLEGAL_REQ ->
  * bad field in cdb, * SG_LIB_CAT_NOT_READY -> device not ready,
@@ -139,6 +165,12 @@ int sg_ll_mode_sense10_v2(int sg_fd, bool llbaa, bool dbd, int pc,
                           int mx_resp_len, int timeout_secs, int * residp,
                           bool noisy, int verbose);
 
+/* Similar to sg_ll_mode_sense10_v2(). See note above about "_pt" suffix. */
+int sg_ll_mode_sense10_v2_pt(struct sg_pt_base * ptp, bool llbaa, bool dbd,
+                             int pc, int pg_code, int sub_pg_code, void * resp,
+                             int mx_resp_len, int timeout_secs, int * residp,
+                             bool noisy, int verbose);
+
 /* Invokes a SCSI PREVENT ALLOW MEDIUM REMOVAL command (SPC-3)
  * prevent==0 allows removal, prevent==1 prevents removal ...
  * Return of 0 -> success,
@@ -148,6 +180,10 @@ int sg_ll_mode_sense10_v2(int sg_fd, bool llbaa, bool dbd, int pc,
  * -1 -> other failure */
 int sg_ll_prevent_allow(int sg_fd, int prevent, bool noisy, int verbose);
 
+/* Similar to sg_ll_prevent_allow(). See note above about "_pt" suffix. */
+int sg_ll_prevent_allow_pt(struct sg_pt_base * ptp, int prevent, bool noisy,
+                           int verbose);
+
 /* Invokes a SCSI READ CAPACITY (10) command. Return of 0 -> success,
  * SG_LIB_CAT_INVALID_OP -> invalid opcode, SG_LIB_CAT_UNIT_ATTENTION
  * -> perhaps media changed, SG_LIB_CAT_ILLEGAL_REQ -> bad field in cdb,
@@ -156,6 +192,10 @@ int sg_ll_prevent_allow(int sg_fd, int prevent, bool noisy, int verbose);
 int sg_ll_readcap_10(int sg_fd, bool pmi, unsigned int lba, void * resp,
                      int mx_resp_len, bool noisy, int verbose);
 
+/* Similar to sg_ll_readcap_10(). See note above about "_pt" suffix. */
+int sg_ll_readcap_10_pt(struct sg_pt_base * ptp, bool pmi, unsigned int lba,
+                        void * resp, int mx_resp_len, bool noisy, int verbose);
+
 /* Invokes a SCSI READ CAPACITY (16) command. Returns 0 -> success,
  * SG_LIB_CAT_UNIT_ATTENTION -> media changed??, SG_LIB_CAT_INVALID_OP
  *  -> cdb not supported, SG_LIB_CAT_IlLEGAL_REQ -> bad field in cdb
@@ -164,6 +204,10 @@ int sg_ll_readcap_10(int sg_fd, bool pmi, unsigned int lba, void * resp,
 int sg_ll_readcap_16(int sg_fd, bool pmi, uint64_t llba, void * resp,
                      int mx_resp_len, bool noisy, int verbose);
 
+/* Similar to sg_ll_readcap_16(). See note above about "_pt" suffix. */
+int sg_ll_readcap_16_pt(struct sg_pt_base * ptp, bool pmi, uint64_t llba,
+                        void * resp, int mx_resp_len, bool noisy, int verbose);
+
 /* Invokes a SCSI REPORT LUNS command. Return of 0 -> success,
  * SG_LIB_CAT_INVALID_OP -> Report Luns not supported,
  * SG_LIB_CAT_ILLEGAL_REQ -> bad field in cdb, SG_LIB_CAT_ABORTED_COMMAND,
@@ -216,6 +260,11 @@ int sg_ll_sync_cache_10(int sg_fd, bool sync_nv, bool immed, int group,
                         unsigned int lba, unsigned int count, bool noisy,
                         int verbose);
 
+/* Similar to sg_ll_sync_cache_10(). See note above about "_pt" suffix. */
+int sg_ll_sync_cache_10_pt(struct sg_pt_base * ptp, bool sync_nv, bool immed,
+                           int group, unsigned int lba, unsigned int count,
+                           bool noisy, int verbose);
+
 /* Invokes a SCSI TEST UNIT READY command.
  * 'pack_id' is just for diagnostics, safe to set to 0.
  * Return of 0 -> success, SG_LIB_CAT_UNIT_ATTENTION,
@@ -323,9 +372,23 @@ int sg_cmds_open_device(const char * device_name, bool read_only, int verbose);
 int sg_cmds_open_flags(const char * device_name, int flags, int verbose);
 
 /* Returns 0 if successful. If error in Unix returns negated errno.
-   Implementation calls scsi_pt_close_device(). */
+   Implementation calls scsi_pt_close_device() after removing any cached
+   pt object for device_fd (see sg_cmds_get_pt_obj()). */
 int sg_cmds_close_device(int device_fd);
 
+/* The sg_ll_*() functions that take a device file descriptor (rather than
+   a pt object) get one with sg_cmds_get_pt_obj() and give it back with
+   sg_cmds_put_pt_obj(). Given back objects are cached per file descriptor
+   (on Linux) to save a memory allocation and some of the device probing
+   on the next command. sg_cmds_get_pt_obj() returns NULL if out of memory.
+   If a device file descriptor is closed other than by
+   sg_cmds_close_device(), call sg_cmds_pt_obj_cache_flush() on it first (or
+   with -1 to flush all) to release the cached object promptly; the cache
+   re-checks the device type so a re-used file descriptor is still safe. */
+struct sg_pt_base * sg_cmds_get_pt_obj(int sg_fd, int verbose);
+void sg_cmds_put_pt_obj(struct sg_pt_base * ptvp);
+void sg_cmds_pt_obj_cache_flush(int sg_fd);
+
 const char * sg_cmds_version();
 
 #define SG_NO_DATA_IN 0
@@ -183,6 +183,25 @@ int sg_err_category_new(int scsi_status, int host_status, int driver_status,
 /* The following function declaration is for the sg version 3 driver. */
 int sg_err_category3(struct sg_io_hdr * hp);
 
+/* One completion as input to sg_err_category_batch(). With the sg v4
+ * interface scsi_status, host_status and driver_status correspond to
+ * device_status, transport_status and driver_status respectively. */
+struct sg_err_cat_t {
+    int scsi_status;            /* SAM status (i.e. not masked) */
+    int host_status;
+    int driver_status;
+    int sb_len;                 /* bytes of sense data at sbp */
+    const uint8_t * sbp;        /* may be NULL if sb_len is 0 */
+};
+
+/* Batch form of sg_err_category_new() for a burst of num completions,
+ * placing the category of arr[k] in cat_arr[k]. Returns the number of
+ * those categories that are not SG_LIB_CAT_CLEAN, so 0 means every
+ * command completed cleanly; that case takes a fast path with a single
+ * pass over the status fields. */
+int sg_err_category_batch(const struct sg_err_cat_t * arr, int num,
+                          int * cat_arr);
+
 
 /* Note about SCSI status codes found in older versions of Linux.
    Linux has traditionally used a 1 bit right shifted and masked
@@ -196,6 +196,57 @@ struct sg_scsi_sense_hdr {
 bool sg_scsi_normalize_sense(const uint8_t * sensep, int sense_len,
                              struct sg_scsi_sense_hdr * sshp);
 
+/* Location of one sense data descriptor within a descriptor format sense
+ * buffer. 'add_len' is the descriptor's additional length, trimmed to the
+ * sense data available; -1 if only the descriptor type byte is present. */
+struct sg_scsi_sense_desc_t {
+    uint8_t type;         /* descriptor type (byte 0 of descriptor) */
+    uint8_t reserved;
+    int16_t add_len;
+    uint16_t offset;      /* of descriptor, from start of sense buffer */
+};
+
+/* Sense data with an additional length of 255 bytes can hold at most this
+ * many descriptors (all 2 bytes long, except possibly the last) */
+#define SG_SCSI_SENSE_MAX_DESCS 128
+
+/* Decoded sense data, filled by sg_scsi_parse_sense(). No strings; the
+ * sense buffer must be kept if the content of descriptors is needed. */
+struct sg_scsi_sense_t {
+    uint8_t response_code; /* 0x70, 0x71 (fixed), 0x72 or 0x73 (descr) */
+    uint8_t sense_key;
+    uint8_t asc;
+    uint8_t ascq;
+    bool descriptor;      /* descriptor format (response code 0x72, 0x73) */
+    bool deferred;        /* response code 0x71 or 0x73 */
+    bool sdat_ovfl;       /* sense data was truncated by device */
+    bool info_present;    /* fixed format or information descriptor */
+    bool info_valid;      /* VALID bit */
+    bool cmd_spec_present; /* fixed format or command specific descriptor */
+    bool sks_present;     /* sense key specific bytes (sks[]) present */
+    bool sks_valid;       /* SKSV bit, same as (sks[0] & 0x80) */
+    bool progress_valid;  /* from sense key specific or progress descr */
+    bool filemark;        /* FILEMARK, EOM and ILI come from byte 2 of */
+    bool eom;             /* fixed format or stream commands descriptor */
+    bool ili;
+    uint8_t fru_code;     /* field replaceable unit code, 0 if none */
+    uint8_t sks[3];       /* sense key specific bytes */
+    uint16_t progress;    /* out of 65536, valid when progress_valid */
+    uint16_t sense_len;   /* 8 + additional length, trimmed to sb_len */
+    uint64_t info;        /* information field */
+    uint64_t cmd_spec;    /* command specific information field */
+    int num_descs;        /* number of elements in descs[] */
+    struct sg_scsi_sense_desc_t descs[SG_SCSI_SENSE_MAX_DESCS];
+};
+
+/* Parses the sense buffer (fixed or descriptor format) into the structure
+ * pointed to by 'ssp' without building any strings or allocating memory.
+ * Returns true if the response code is 0x70 to 0x73; otherwise returns
+ * false with only ssp->response_code set. The fields up to 'num_descs'
+ * are zeroed, descs[] elements beyond num_descs are not touched. */
+bool sg_scsi_parse_sense(const uint8_t * sensep, int sense_len,
+                         struct sg_scsi_sense_t * ssp);
+
 /* Attempt to find the first SCSI sense data descriptor that matches the
  * given 'desc_type'. If found return pointer to start of sense data
  * descriptor; otherwise (including fixed format sense data) returns NULL. */
@@ -366,6 +417,17 @@ extern FILE * sg_warnings_strm;
 
 void sg_set_warnings_strm(FILE * warnings_strm);
 
+/* Like sg_set_warnings_strm() but only for the calling thread, overriding
+ * sg_warnings_strm. A NULL argument removes the override. */
+void sg_set_thread_warnings_strm(FILE * warnings_strm);
+
+/* Returns the stream that pr2ws() and the "print" functions below write to
+ * for the calling thread: its override, else sg_warnings_strm, else
+ * stderr. Callers building a multi line report from several "print" calls
+ * may flockfile() it so the lines are not interleaved with other threads'
+ * output. */
+FILE * sg_get_warnings_strm(void);
+
 /* The following "print" functions send ASCII to 'sg_warnings_strm' file
  * descriptor (default value is stderr). 'leadin' is string prepended to
  * each line printed out, NULL treated as "". */
@@ -373,7 +435,8 @@ void sg_print_command(const uint8_t * command);
 void sg_print_scsi_status(int scsi_status);
 
 /* DSENSE is 'descriptor sense' as opposed to the older 'fixed sense'. Reads
- * environment variable SG3_UTILS_DSENSE. Only (currently) used in SNTL. */
+ * environment variable SG3_UTILS_DSENSE on the first call and caches it.
+ * Only (currently) used in SNTL. */
 bool sg_get_initial_dsense(void);
 
 /* 'leadin' is string prepended to each line printed out, NULL treated as
@@ -519,7 +582,8 @@ int sg_vpd_dev_id_iter(const uint8_t * initial_desig_desc, int page_len,
 /* <<< General purpose (i.e. not SCSI specific) utility functions >>> */
 
 /* Always returns valid string even if errnum is wild (or library problem).
- * If errnum is negative, flip its sign. */
+ * If errnum is negative, flip its sign. Thread safe: the string is held in
+ * a per thread buffer that is overwritten by that thread's next call. */
 char * safe_strerror(int errnum);
 
 
@@ -557,6 +621,21 @@ void hex2stderr(const uint8_t * b_str, int len, int no_ascii);
 int hex2str(const uint8_t * b_str, int len, const char * leadin, int format,
             int cb_len, char * cbp);
 
+/* Read ASCII hex bytes or binary (when as_binary is true) from fname; a
+ * fname of "-" is taken as stdin. ASCII hex may be one byte per line or a
+ * comma, space or tab separated list of bytes, each byte being 1 or 2 hex
+ * digits. If no_space is true then a string of ASCII hex digits, 2 per
+ * byte, is expected (whitespace between pairs and line breaks are ignored).
+ * Everything from and including a '#' (or a '\r') to the end of that line
+ * is ignored. The input is streamed (regular files are mmap-ed where
+ * possible) so there is no limit on the number or length of lines. Up to
+ * max_arr_len bytes are written to mp_arr and that count is placed in
+ * *mp_arr_len. Returns 0 if ok, SG_LIB_SYNTAX_ERROR for a parse error (or
+ * if more than max_arr_len bytes are decoded from ASCII hex), otherwise
+ * an OS error converted by sg_convert_errno(). */
+int sg_f2hex_arr(const char * fname, bool as_binary, bool no_space,
+                 uint8_t * mp_arr, int * mp_arr_len, int max_arr_len);
+
 /* Returns true when executed on big endian machine; else returns false.
  * Useful for displaying ATA identify words (which need swapping on a
  * big endian machine). */
@@ -568,6 +647,12 @@ bool sg_is_big_endian();
 bool sg_all_zeros(const uint8_t * bp, int b_len);
 bool sg_all_ffs(const uint8_t * bp, int b_len);
 
+/* Returns the offset of the first non-zero byte in the b_len bytes starting
+ * at bp, or b_len if they are all zero. Returns -1 if bp is NULL or
+ * b_len < 0. Like sg_all_zeros() this uses vector instructions where the
+ * CPU supports them; suitable for scanning large data buffers. */
+int sg_first_non_zero(const uint8_t * bp, int b_len);
+
 /* Extract character sequence from ATA words as in the model string
  * in a IDENTIFY DEVICE response. Returns number of characters
  * written to 'ochars' before 0 character is found or 'num' words
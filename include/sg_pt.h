@@ -12,6 +12,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -119,6 +120,26 @@ void set_scsi_pt_data_in(struct sg_pt_base * objp,   /* from device */
 void set_scsi_pt_data_out(struct sg_pt_base * objp,    /* to device */
                           const uint8_t * dxferp, int dxfer_olen);
 
+/* One element of a scatter gather list. Same layout as POSIX's struct
+ * iovec and the Linux sg driver's sg_iovec_t . */
+struct sg_pt_iovec {
+    void * iov_base;
+    size_t iov_len;
+};
+
+/* Alternatives to set_scsi_pt_data_in() and set_scsi_pt_data_out() that
+ * take a list of iov_count buffers, used in order, whose lengths sum to
+ * the transfer length. The list must remain valid until the command
+ * completes. The Linux sg driver and SG_IO on block devices take the list
+ * as is; other Linux pass-throughs copy through a bounce buffer and do not
+ * support it in do_pt_submit(). Other OSes only accept a list with one
+ * element (otherwise the command fails with SCSI_PT_DO_BAD_PARAMS). */
+void set_scsi_pt_data_in_iov(struct sg_pt_base * objp,
+                             const struct sg_pt_iovec * iovp, int iov_count);
+void set_scsi_pt_data_out_iov(struct sg_pt_base * objp,
+                              const struct sg_pt_iovec * iovp,
+                              int iov_count);
+
 /* Set a pointer and length to be used for metadata transferred to
  * (out_true=true) or from (out_true=false) device (NVMe only) */
 void set_pt_metadata_xfer(struct sg_pt_base * objp, uint8_t * mdxferp,
@@ -145,6 +166,7 @@ void set_scsi_pt_flags(struct sg_pt_base * objp, int flags);
 #define SCSI_PT_DO_START_OK 0
 #define SCSI_PT_DO_BAD_PARAMS 1
 #define SCSI_PT_DO_TIMEOUT 2
+#define SCSI_PT_DO_NOT_SUPPORTED 4
 #define SCSI_PT_DO_NVME_STATUS 48       /* == SG_LIB_NVME_STATUS */
 /* If OS error prior to or during command submission then returns negated
  * error value (e.g. Unix '-errno'). This includes interrupted system calls
@@ -157,6 +179,86 @@ void set_scsi_pt_flags(struct sg_pt_base * objp, int flags);
 int do_scsi_pt(struct sg_pt_base * objp, int fd, int timeout_secs,
                int verbose);
 
+/* Following is a guard which is defined when do_pt_submit(),
+ * do_pt_receive(), scsi_pt_async_match() and their batch forms are
+ * present. Older versions of this library may not have these functions. */
+#define SCSI_PT_ASYNC_FUNCTIONS 1
+/* Asynchronous (non-blocking) variant of do_scsi_pt(). The command held in
+ * objp is sent to the device and this function returns without waiting for
+ * it to complete. Its response is fetched later with do_pt_receive(). Until
+ * then objp, and the cdb, sense and data buffers given to it, must not be
+ * freed or re-used. Returns 0 if the command was sent, otherwise the same
+ * values as do_scsi_pt(). If the pass-through (or OS) has no asynchronous
+ * interface then nothing is sent and SCSI_PT_DO_NOT_SUPPORTED is returned;
+ * the caller may then fall back to do_scsi_pt(). In Linux sg driver
+ * device nodes (e.g. /dev/sg1) opened read-write support this, as do NVMe
+ * devices, see scsi_pt_nvme_uring(). */
+int do_pt_submit(struct sg_pt_base * objp, int fd, int timeout_secs,
+                 int verbose);
+
+/* Fetches the response of a command previously sent with do_pt_submit() on
+ * dev_fd. If pack_id is -1 then the oldest completed command is fetched,
+ * otherwise the one whose packet id (see set_scsi_pt_packet_id()) matches
+ * pack_id; the latter needs scsi_pt_async_match(dev_fd, true, ...) to have
+ * been called. Returns 0 on success and, if objpp is non-NULL, places the
+ * object given to do_pt_submit() for that command in *objpp. Its response
+ * may then be examined with get_scsi_pt_result_category() and friends, as
+ * after do_scsi_pt(). If no response is ready and dev_fd is non-blocking
+ * (scsi_pt_open_device() uses O_NONBLOCK) then -EAGAIN is returned. A sg
+ * dev_fd may be given to poll() or select(), it is readable when a
+ * response is waiting. That is not so for NVMe devices (responses arrive on
+ * an io_uring ring, not dev_fd): use a blocking dev_fd or retry after
+ * -EAGAIN. Other OS errors yield negated errno values. */
+int do_pt_receive(int dev_fd, int pack_id, struct sg_pt_base ** objpp,
+                  int verbose);
+
+/* If by_pack_id is true then do_pt_receive() on dev_fd can select which
+ * response it fetches by packet id; otherwise the oldest is always
+ * fetched. Returns 0 on success, SCSI_PT_DO_NOT_SUPPORTED if dev_fd has no
+ * asynchronous interface, else negated errno. */
+int scsi_pt_async_match(int dev_fd, bool by_pack_id, int verbose);
+
+/* Batch forms of do_pt_submit() and do_pt_receive() to cut the per command
+ * overhead when many commands are queued. do_pt_submit_batch() sends the
+ * num_objs objects in objp_arr, in order, and stops at the first error
+ * which is returned; *num_sentp (if non-NULL) is the number sent. Those
+ * not sent may be re-submitted. do_pt_receive_batch() fetches up to
+ * max_objs responses (oldest first) placing their objects in objp_arr and
+ * their count in *num_recvp. It waits only for the first response (if
+ * dev_fd is blocking). Returns 0 if at least one response was fetched,
+ * otherwise as for do_pt_receive(). */
+int do_pt_submit_batch(struct sg_pt_base ** objp_arr, int num_objs, int fd,
+                       int timeout_secs, int * num_sentp, int verbose);
+int do_pt_receive_batch(int dev_fd, struct sg_pt_base ** objp_arr,
+                        int max_objs, int * num_recvp, int verbose);
+
+/* NVMe only (Linux). do_pt_submit() on a NVMe device queues the command on
+ * an io_uring ring (one per thread and device) of q_depth entries. This
+ * needs NVMe generic char devices (e.g. /dev/ng0n1) and lk 5.19 or later;
+ * otherwise, or if q_depth is 0, do_pt_submit() falls back to ioctl()s and
+ * the command has completed when it returns. SCSI commands are translated
+ * (SNTL); READ, WRITE and VERIFY are asynchronous, others are not. The
+ * default q_depth is 128 or the value of the SG3_UTILS_NVME_URING
+ * environment variable. Only affects rings set up after this call. Returns
+ * 0 or, if q_depth > 0 and io_uring support is not built in,
+ * SCSI_PT_DO_NOT_SUPPORTED . */
+int scsi_pt_nvme_uring(int q_depth, int verbose);
+
+/* Pass-through statistics, off by default. When enabled, each command sent
+ * by do_scsi_pt() or do_pt_submit() (Linux only at present) is counted
+ * against its device and opcode (and service action): result categories,
+ * total and maximum latency plus a histogram of latencies in power of 2
+ * microsecond buckets. If file_name is given, the statistics are written
+ * to it as JSON when the program exits ("" or "-" for stderr). Setting the
+ * SG3_UTILS_PT_STATS environment variable to such a file name has the same
+ * effect as calling scsi_pt_stats_enable(true, <its value>) before the
+ * first command. Returns 0 on success. */
+int scsi_pt_stats_enable(bool enable, const char * file_name);
+
+/* Writes the statistics collected so far as JSON to file_name (stderr if
+ * NULL, "" or "-"). Returns 0 or a negated errno. */
+int scsi_pt_stats_dump(const char * file_name);
+
 #define SCSI_PT_RESULT_GOOD 0
 #define SCSI_PT_RESULT_STATUS 1 /* other than GOOD and CHECK CONDITION */
 #define SCSI_PT_RESULT_SENSE 2
@@ -118,6 +118,7 @@ struct sg_pt_linux_scsi {
     bool is_sg;
     bool is_bsg;
     bool is_nvme;       /* OS device type, if false ignore nvme_direct */
+    bool is_mem;        /* memory backed pseudo disk ("mem:" name) */
     bool nvme_direct;   /* false: our SNTL; true: received NVMe command */
     bool nvme_stat_dnr; /* Do No Retry, part of completion status field */
     bool nvme_stat_more; /* More, part of completion status field */
@@ -136,10 +137,18 @@ struct sg_pt_linux_scsi {
                                  * The whole 16 byte completion q entry is
                                  * sent back as sense data */
     uint32_t mdxfer_len;
+    uint64_t dev_rdev;          /* from fstat(dev_fd), to detect if dev_fd */
+    uint64_t dev_ino;           /* has been re-opened on another device */
     struct sg_sntl_dev_state_t dev_stat;
     void * mdxferp;
     uint8_t * nvme_id_ctlp;     /* cached response to controller IDENTIFY */
     uint8_t * free_nvme_id_ctlp;
+    uint8_t * nvme_id_nsp;      /* cached response to namespace IDENTIFY */
+    uint8_t * free_nvme_id_nsp;
+    struct sg_pt_base * nvme_async_next; /* list of async cmds done early,
+                                          * NVMe and mem: */
+    uint32_t nvme_async_len;    /* SNTL data length of async NVMe cmd */
+    uint64_t stats_start_ns;    /* do_pt_submit() time if stats are on */
     uint8_t tmf_request[4];
 };
 
@@ -148,6 +157,17 @@ struct sg_pt_base {
 };
 
 
+/* Linux sg driver v4 asynchronous ioctls (sg version 4.0.0 and later) */
+#ifndef SG_IOCTL_MAGIC_NUM
+#define SG_IOCTL_MAGIC_NUM 0x22
+#endif
+#ifndef SG_IOSUBMIT
+#define SG_IOSUBMIT _IOWR(SG_IOCTL_MAGIC_NUM, 0x41, struct sg_io_v4)
+#endif
+#ifndef SG_IORECEIVE
+#define SG_IORECEIVE _IOWR(SG_IOCTL_MAGIC_NUM, 0x42, struct sg_io_v4)
+#endif
+
 #ifndef sg_nvme_admin_cmd
 #define sg_nvme_admin_cmd sg_nvme_passthru_cmd
 #endif
@@ -175,12 +195,43 @@ struct sg_pt_base {
 extern bool sg_bsg_nvme_char_major_checked;
 extern int sg_bsg_major;
 extern volatile int sg_nvme_char_major;
+extern volatile int sg_nvme_gen_char_major;     /* /dev/ng<c>n<n> devices */
 extern long sg_lin_page_size;
 
 void sg_find_bsg_nvme_char_major(int verbose);
 int sg_do_nvme_pt(struct sg_pt_base * vp, int fd, int time_secs, int vb);
 int sg_linux_get_sg_version(const struct sg_pt_base * vp);
 
+/* Asynchronous NVMe commands, io_uring based (ioctl() fallback). The
+ * submit function queues the command; it is given to the kernel when flush
+ * is true or later by sg_nvme_async_flush(). See sg_pt_linux_nvme.c */
+int sg_nvme_async_submit(struct sg_pt_base * vp, int time_secs, bool flush,
+                         int vb);
+int sg_nvme_async_flush(int vb);
+int sg_nvme_async_receive(int dev_fd, bool wait, struct sg_pt_base ** objpp,
+                          int vb);
+void sg_nvme_async_release(int dev_fd);
+
+/* Memory backed pseudo disks, device names like "mem:size=64g,bs=4096".
+ * sg_mem_open() is given the part of the name after "mem:" and returns a
+ * file descriptor or a negated errno. See sg_pt_linux_mem.c */
+#define SG_MEM_DEV_PREFIX "mem:"
+
+int sg_mem_open(const char * opts, int flags, int vb);
+void sg_mem_close(int dev_fd);
+bool sg_mem_is_mem(int dev_fd);
+int sg_do_mem_pt(struct sg_pt_base * vp, int time_secs, int vb);
+int sg_mem_async_submit(struct sg_pt_base * vp, int time_secs, int vb);
+int sg_mem_async_receive(int dev_fd, struct sg_pt_base ** objpp, int vb);
+
+/* Pass-through statistics, see scsi_pt_stats_enable() in sg_pt.h and
+ * sg_pt_common.c */
+bool sg_pt_stats_on(void);
+uint64_t sg_pt_stats_clock_ns(void);
+void sg_pt_stats_dev_name(int dev_fd, const char * name);
+void sg_pt_stats_record(int dev_fd, const uint8_t * cmdp, bool nvme_cmd,
+                        int res, int category, uint64_t elapsed_ns);
+
 /* This trims given NVMe block device name in Linux (e.g. /dev/nvme0n1p5)
  * to the name of its associated char device (e.g. /dev/nvme0). If this
  * occurs true is returned and the char device name is placed in 'b' (as
@@ -40,7 +40,7 @@
 #endif
 
 
-static const char * const version_str = "1.90 20180712";
+static const char * const version_str = "1.91 20261015";
 
 
 #define SENSE_BUFF_LEN 64       /* Arbitrary, could be larger */
@@ -88,9 +88,82 @@ sg_cmds_open_flags(const char * device_name, int flags, int verbose)
 int
 sg_cmds_close_device(int device_fd)
 {
+    sg_cmds_pt_obj_cache_flush(device_fd);
     return scsi_pt_close_device(device_fd);
 }
 
+/* The sg_ll_*() functions that take a file descriptor rather than a pt
+ * object use a small cache of pt objects, one per slot with the slot chosen
+ * by the file descriptor. A slot is emptied by the user of its object and
+ * refilled when that user is finished, both with an atomic exchange, so no
+ * lock is needed. If the slot is empty (e.g. another thread is using the
+ * same file descriptor) a new object is constructed. */
+#if defined(SG_LIB_LINUX) && defined(__GNUC__)
+#define SG_CMDS_PT_CACHE 1
+#define PT_CACHE_SLOTS 16       /* should be a power of 2 */
+
+static struct sg_pt_base * pt_cache_arr[PT_CACHE_SLOTS];
+#endif
+
+struct sg_pt_base *
+sg_cmds_get_pt_obj(int sg_fd, int verbose)
+{
+#ifdef SG_CMDS_PT_CACHE
+    struct sg_pt_base * ptvp;
+
+    if (sg_fd >= 0) {
+        ptvp = __atomic_exchange_n(pt_cache_arr + (sg_fd % PT_CACHE_SLOTS),
+                                   NULL, __ATOMIC_ACQ_REL);
+        if (ptvp) {
+            if (get_pt_file_handle(ptvp) == sg_fd) {
+                clear_scsi_pt_obj(ptvp);
+                /* sg_fd may have been closed and re-opened on another
+                 * device, so check the device type again */
+                set_pt_file_handle(ptvp, sg_fd, verbose);
+                return ptvp;
+            }
+            destruct_scsi_pt_obj(ptvp);
+        }
+    }
+#endif
+    return construct_scsi_pt_obj_with_fd(sg_fd, verbose);
+}
+
+void
+sg_cmds_put_pt_obj(struct sg_pt_base * ptvp)
+{
+#ifdef SG_CMDS_PT_CACHE
+    int fd;
+
+    if (ptvp && ((fd = get_pt_file_handle(ptvp)) >= 0)) {
+        /* swap it in, destruct whatever was displaced */
+        ptvp = __atomic_exchange_n(pt_cache_arr + (fd % PT_CACHE_SLOTS),
+                                   ptvp, __ATOMIC_ACQ_REL);
+    }
+#endif
+    if (ptvp)
+        destruct_scsi_pt_obj(ptvp);
+}
+
+void
+sg_cmds_pt_obj_cache_flush(int sg_fd)
+{
+#ifdef SG_CMDS_PT_CACHE
+    int k;
+    struct sg_pt_base * ptvp;
+
+    for (k = 0; k < PT_CACHE_SLOTS; ++k) {
+        if ((sg_fd >= 0) && (k != (sg_fd % PT_CACHE_SLOTS)))
+            continue;
+        ptvp = __atomic_exchange_n(pt_cache_arr + k, NULL, __ATOMIC_ACQ_REL);
+        if (ptvp)
+            destruct_scsi_pt_obj(ptvp);
+    }
+#else
+    if (sg_fd) { ; }    /* suppress warning */
+#endif
+}
+
 static const char * const pass_through_s = "pass-through";
 
 static int
@@ -301,15 +374,6 @@ sg_cmds_is_nvme(const struct sg_pt_base * ptvp)
     return pt_device_is_nvme(ptvp);
 }
 
-static struct sg_pt_base *
-create_pt_obj(const char * cname)
-{
-    struct sg_pt_base * ptvp = construct_scsi_pt_obj();
-    if (NULL == ptvp)
-        pr2ws("%s: out of memory\n", cname);
-    return ptvp;
-}
-
 static const char * const inquiry_s = "inquiry";
 
 
@@ -397,12 +461,12 @@ sg_ll_inquiry(int sg_fd, bool cmddt, bool evpd, int pg_op, void * resp,
     int ret;
     struct sg_pt_base * ptvp;
 
-    ptvp = construct_scsi_pt_obj_with_fd(sg_fd, verbose);
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
     if (NULL == ptvp)
         return sg_convert_errno(ENOMEM);
     ret = sg_ll_inquiry_com(ptvp, cmddt, evpd, pg_op, resp, mx_resp_len,
                             0 /* timeout_sec */, NULL, noisy, verbose);
-    destruct_scsi_pt_obj(ptvp);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -425,12 +489,12 @@ sg_ll_inquiry_v2(int sg_fd, bool evpd, int pg_op, void * resp,
     int ret;
     struct sg_pt_base * ptvp;
 
-    ptvp = construct_scsi_pt_obj_with_fd(sg_fd, verbose);
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
     if (NULL == ptvp)
         return sg_convert_errno(ENOMEM);
     ret = sg_ll_inquiry_com(ptvp, false, evpd, pg_op, resp, mx_resp_len,
                             timeout_secs, residp, noisy, verbose);
-    destruct_scsi_pt_obj(ptvp);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -591,12 +655,12 @@ sg_ll_test_unit_ready_progress(int sg_fd, int pack_id, int * progress,
     int ret;
     struct sg_pt_base * ptvp;
 
-    ptvp = construct_scsi_pt_obj_with_fd(sg_fd, verbose);
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
     if (NULL == ptvp)
         return sg_convert_errno(ENOMEM);
     ret = sg_ll_test_unit_ready_progress_pt(ptvp, pack_id, progress, noisy,
                                             verbose);
-    destruct_scsi_pt_obj(ptvp);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -610,12 +674,12 @@ sg_ll_test_unit_ready(int sg_fd, int pack_id, bool noisy, int verbose)
     int ret;
     struct sg_pt_base * ptvp;
 
-    ptvp = construct_scsi_pt_obj_with_fd(sg_fd, verbose);
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
     if (NULL == ptvp)
         return sg_convert_errno(ENOMEM);
     ret = sg_ll_test_unit_ready_progress_pt(ptvp, pack_id, NULL, noisy,
                                             verbose);
-    destruct_scsi_pt_obj(ptvp);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -657,7 +721,7 @@ sg_ll_request_sense_com(struct sg_pt_base * ptvp, int sg_fd, bool desc,
     if (ptvp)
         ptvp_given = true;
     else {
-        ptvp = construct_scsi_pt_obj_with_fd(sg_fd, verbose);
+        ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
         if (NULL == ptvp)
             return sg_convert_errno(ENOMEM);
     }
@@ -689,7 +753,7 @@ sg_ll_request_sense_com(struct sg_pt_base * ptvp, int sg_fd, bool desc,
             ret = 0;
     }
     if ((! ptvp_given) && ptvp)
-        destruct_scsi_pt_obj(ptvp);
+        sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -734,7 +798,7 @@ sg_ll_report_luns_com(struct sg_pt_base * ptvp, int sg_fd, int select_report,
 
     if (ptvp)
         ptvp_given = true;
-    else if (NULL == ((ptvp = create_pt_obj(report_luns_s))))
+    else if (NULL == ((ptvp = sg_cmds_get_pt_obj(sg_fd, verbose))))
         return sg_convert_errno(ENOMEM);
     set_scsi_pt_cdb(ptvp, rl_cdb, sizeof(rl_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
@@ -757,7 +821,7 @@ sg_ll_report_luns_com(struct sg_pt_base * ptvp, int sg_fd, int select_report,
     } else
         ret = 0;
     if ((! ptvp_given) && ptvp)
-        destruct_scsi_pt_obj(ptvp);
+        sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
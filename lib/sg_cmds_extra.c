@@ -106,27 +106,17 @@
 #define EXTENDED_COPY_LID1_SA 0x0
 
 
-static struct sg_pt_base *
-create_pt_obj(const char * cname)
-{
-    struct sg_pt_base * ptvp = construct_scsi_pt_obj();
-    if (NULL == ptvp)
-        pr2ws("%s: out of memory\n", cname);
-    return ptvp;
-}
-
-
 /* Invokes a SCSI GET LBA STATUS(16) command (SBC). Returns 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_get_lba_status16(int sg_fd, uint64_t start_llba, uint8_t rt,
-                      void * resp, int alloc_len, bool noisy, int verbose)
+sg_ll_get_lba_status16_pt(struct sg_pt_base * ptvp, uint64_t start_llba,
+                          uint8_t rt, void * resp, int alloc_len, bool noisy,
+                          int verbose)
 {
     static const char * const cdb_name_s = "Get LBA status(16)";
     int k, res, sense_cat, ret;
     uint8_t getLbaStatCmd[SERVICE_ACTION_IN_16_CMDLEN];
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     memset(getLbaStatCmd, 0, sizeof(getLbaStatCmd));
     getLbaStatCmd[0] = SERVICE_ACTION_IN_16_CMD;
@@ -142,12 +132,11 @@ sg_ll_get_lba_status16(int sg_fd, uint64_t start_llba, uint8_t rt,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, getLbaStatCmd, sizeof(getLbaStatCmd));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, alloc_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, alloc_len, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -176,7 +165,22 @@ sg_ll_get_lba_status16(int sg_fd, uint64_t start_llba, uint8_t rt,
         }
         ret = 0;
     }
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_get_lba_status16(int sg_fd, uint64_t start_llba, uint8_t rt, void * resp,
+                       int alloc_len, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_get_lba_status16_pt(ptvp, start_llba, rt, resp, alloc_len,
+                                    noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -191,16 +195,14 @@ sg_ll_get_lba_status(int sg_fd, uint64_t start_llba, void * resp,
 #define GLS32_CMD_LEN 32
 
 int
-sg_ll_get_lba_status32(int sg_fd, uint64_t start_llba, uint32_t scan_len,
-                       uint32_t element_id, uint8_t rt,
-                       void * resp, int alloc_len, bool noisy,
-                       int verbose)
+sg_ll_get_lba_status32_pt(struct sg_pt_base * ptvp, uint64_t start_llba,
+                          uint32_t scan_len, uint32_t element_id, uint8_t rt,
+                          void * resp, int alloc_len, bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "Get LBA status(32)";
     int k, res, sense_cat, ret;
     uint8_t gls32_cmd[GLS32_CMD_LEN];
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     memset(gls32_cmd, 0, sizeof(gls32_cmd));
     gls32_cmd[0] = SG_VARIABLE_LENGTH_CMD;
@@ -218,12 +220,11 @@ sg_ll_get_lba_status32(int sg_fd, uint64_t start_llba, uint32_t scan_len,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, gls32_cmd, sizeof(gls32_cmd));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, alloc_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, alloc_len, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -252,7 +253,23 @@ sg_ll_get_lba_status32(int sg_fd, uint64_t start_llba, uint32_t scan_len,
         }
         ret = 0;
     }
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_get_lba_status32(int sg_fd, uint64_t start_llba, uint32_t scan_len,
+                       uint32_t element_id, uint8_t rt, void * resp,
+                       int alloc_len, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_get_lba_status32_pt(ptvp, start_llba, scan_len, element_id, rt,
+                                    resp, alloc_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -267,8 +284,9 @@ sg_ll_report_tgt_prt_grp(int sg_fd, void * resp, int mx_resp_len,
 /* Invokes a SCSI REPORT TARGET PORT GROUPS command. Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_report_tgt_prt_grp2(int sg_fd, void * resp, int mx_resp_len,
-                          bool extended, bool noisy, int verbose)
+sg_ll_report_tgt_prt_grp2_pt(struct sg_pt_base * ptvp, void * resp,
+                             int mx_resp_len, bool extended, bool noisy,
+                             int verbose)
 {
     static const char * const cdb_name_s = "Report target port groups";
     int k, res, ret, sense_cat;
@@ -276,7 +294,6 @@ sg_ll_report_tgt_prt_grp2(int sg_fd, void * resp, int mx_resp_len,
                          {MAINTENANCE_IN_CMD, REPORT_TGT_PRT_GRP_SA,
                           0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     if (extended)
         rtpg_cdb[1] |= 0x20;
@@ -288,12 +305,11 @@ sg_ll_report_tgt_prt_grp2(int sg_fd, void * resp, int mx_resp_len,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, rtpg_cdb, sizeof(rtpg_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, mx_resp_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, mx_resp_len, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -322,15 +338,30 @@ sg_ll_report_tgt_prt_grp2(int sg_fd, void * resp, int mx_resp_len,
         }
         ret = 0;
     }
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_report_tgt_prt_grp2(int sg_fd, void * resp, int mx_resp_len,
+                          bool extended, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_report_tgt_prt_grp2_pt(ptvp, resp, mx_resp_len, extended,
+                                       noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
 /* Invokes a SCSI SET TARGET PORT GROUPS command. Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_set_tgt_prt_grp(int sg_fd, void * paramp, int param_len, bool noisy,
-                      int verbose)
+sg_ll_set_tgt_prt_grp_pt(struct sg_pt_base * ptvp, void * paramp,
+                         int param_len, bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "Set target port groups";
     int k, res, ret, sense_cat;
@@ -338,7 +369,6 @@ sg_ll_set_tgt_prt_grp(int sg_fd, void * paramp, int param_len, bool noisy,
                          {MAINTENANCE_OUT_CMD, SET_TGT_PRT_GRP_SA,
                           0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     sg_put_unaligned_be32((uint32_t)param_len, stpg_cdb + 6);
     if (verbose) {
@@ -352,12 +382,11 @@ sg_ll_set_tgt_prt_grp(int sg_fd, void * paramp, int param_len, bool noisy,
         }
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, stpg_cdb, sizeof(stpg_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_out(ptvp, (uint8_t *)paramp, param_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -374,16 +403,30 @@ sg_ll_set_tgt_prt_grp(int sg_fd, void * paramp, int param_len, bool noisy,
         }
     } else
         ret = 0;
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_set_tgt_prt_grp(int sg_fd, void * paramp, int param_len, bool noisy,
+                      int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_set_tgt_prt_grp_pt(ptvp, paramp, param_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
 /* Invokes a SCSI REPORT REFERRALS command. Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_report_referrals(int sg_fd, uint64_t start_llba, bool one_seg,
-                       void * resp, int mx_resp_len, bool noisy,
-                       int verbose)
+sg_ll_report_referrals_pt(struct sg_pt_base * ptvp, uint64_t start_llba,
+                          bool one_seg, void * resp, int mx_resp_len,
+                          bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "Report referrals";
     int k, res, ret, sense_cat;
@@ -391,7 +434,6 @@ sg_ll_report_referrals(int sg_fd, uint64_t start_llba, bool one_seg,
                          {SERVICE_ACTION_IN_16_CMD, REPORT_REFERRALS_SA,
                           0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     sg_put_unaligned_be64(start_llba, repRef_cdb + 2);
     sg_put_unaligned_be32((uint32_t)mx_resp_len, repRef_cdb + 10);
@@ -404,12 +446,11 @@ sg_ll_report_referrals(int sg_fd, uint64_t start_llba, bool one_seg,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, repRef_cdb, sizeof(repRef_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, mx_resp_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, mx_resp_len, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -438,7 +479,22 @@ sg_ll_report_referrals(int sg_fd, uint64_t start_llba, bool one_seg,
         }
         ret = 0;
     }
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_report_referrals(int sg_fd, uint64_t start_llba, bool one_seg,
+                       void * resp, int mx_resp_len, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_report_referrals_pt(ptvp, start_llba, one_seg, resp,
+                                    mx_resp_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -520,13 +576,13 @@ sg_ll_send_diag(int sg_fd, int st_code, bool pf_bit, bool st_bit,
     int ret;
     struct sg_pt_base * ptvp;
 
-    ptvp = construct_scsi_pt_obj_with_fd(sg_fd, verbose);
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
     if (NULL == ptvp)
         return sg_convert_errno(ENOMEM);
     ret = sg_ll_send_diag_pt(ptvp, st_code, pf_bit, st_bit, devofl_bit,
                              unitofl_bit, long_duration, paramp, param_len,
                              noisy, verbose);
-    destruct_scsi_pt_obj(ptvp);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -606,12 +662,12 @@ sg_ll_receive_diag(int sg_fd, bool pcv, int pg_code, void * resp,
     int ret;
     struct sg_pt_base * ptvp;
 
-    ptvp = construct_scsi_pt_obj_with_fd(sg_fd, verbose);
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
     if (NULL == ptvp)
         return sg_convert_errno(ENOMEM);
     ret = sg_ll_receive_diag_pt(ptvp, pcv, pg_code, resp, mx_resp_len, 0,
                                 NULL, noisy, verbose);
-    destruct_scsi_pt_obj(ptvp);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -623,27 +679,27 @@ sg_ll_receive_diag_v2(int sg_fd, bool pcv, int pg_code, void * resp,
     int ret;
     struct sg_pt_base * ptvp;
 
-    ptvp = construct_scsi_pt_obj_with_fd(sg_fd, verbose);
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
     if (NULL == ptvp)
         return sg_convert_errno(ENOMEM);
     ret = sg_ll_receive_diag_pt(ptvp, pcv, pg_code, resp, mx_resp_len,
                                 timeout_secs, residp, noisy, verbose);
-    destruct_scsi_pt_obj(ptvp);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
 /* Invokes a SCSI READ DEFECT DATA (10) command (SBC). Return of 0 -> success
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_read_defect10(int sg_fd, bool req_plist, bool req_glist, int dl_format,
-                    void * resp, int mx_resp_len, bool noisy, int verbose)
+sg_ll_read_defect10_pt(struct sg_pt_base * ptvp, bool req_plist,
+                       bool req_glist, int dl_format, void * resp,
+                       int mx_resp_len, bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "Read defect(10)";
     int res, k, ret, sense_cat;
     uint8_t rdef_cdb[READ_DEFECT10_CMDLEN] =
         {READ_DEFECT10_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     rdef_cdb[2] = (dl_format & 0x7);
     if (req_plist)
@@ -662,12 +718,11 @@ sg_ll_read_defect10(int sg_fd, bool req_plist, bool req_glist, int dl_format,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, rdef_cdb, sizeof(rdef_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, mx_resp_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, mx_resp_len, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -696,15 +751,30 @@ sg_ll_read_defect10(int sg_fd, bool req_plist, bool req_glist, int dl_format,
         }
         ret = 0;
     }
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_read_defect10(int sg_fd, bool req_plist, bool req_glist, int dl_format,
+                    void * resp, int mx_resp_len, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_read_defect10_pt(ptvp, req_plist, req_glist, dl_format, resp,
+                                 mx_resp_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
 /* Invokes a SCSI READ MEDIA SERIAL NUMBER command. Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_read_media_serial_num(int sg_fd, void * resp, int mx_resp_len,
-                            bool noisy, int verbose)
+sg_ll_read_media_serial_num_pt(struct sg_pt_base * ptvp, void * resp,
+                               int mx_resp_len, bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "Read media serial number";
     int k, res, ret, sense_cat;
@@ -712,7 +782,6 @@ sg_ll_read_media_serial_num(int sg_fd, void * resp, int mx_resp_len,
                          {SERVICE_ACTION_IN_12_CMD, READ_MEDIA_SERIAL_NUM_SA,
                           0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     sg_put_unaligned_be32((uint32_t)mx_resp_len, rmsn_cdb + 6);
     if (verbose) {
@@ -722,12 +791,11 @@ sg_ll_read_media_serial_num(int sg_fd, void * resp, int mx_resp_len,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, rmsn_cdb, sizeof(rmsn_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, mx_resp_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, mx_resp_len, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -756,7 +824,22 @@ sg_ll_read_media_serial_num(int sg_fd, void * resp, int mx_resp_len,
         }
         ret = 0;
     }
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_read_media_serial_num(int sg_fd, void * resp, int mx_resp_len,
+                            bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_read_media_serial_num_pt(ptvp, resp, mx_resp_len, noisy,
+                                         verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -764,8 +847,8 @@ sg_ll_read_media_serial_num(int sg_fd, void * resp, int mx_resp_len,
  * called REPORT DEVICE IDENTIFIER prior to spc4r07. Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_report_id_info(int sg_fd, int itype, void * resp, int max_resp_len,
-                     bool noisy, int verbose)
+sg_ll_report_id_info_pt(struct sg_pt_base * ptvp, int itype, void * resp,
+                        int max_resp_len, bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "Report identifying information";
     int k, res, ret, sense_cat;
@@ -773,7 +856,6 @@ sg_ll_report_id_info(int sg_fd, int itype, void * resp, int max_resp_len,
                         REPORT_IDENTIFYING_INFORMATION_SA,
                         0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     sg_put_unaligned_be32((uint32_t)max_resp_len, rii_cdb + 6);
     rii_cdb[10] |= (itype << 1) & 0xfe;
@@ -785,12 +867,11 @@ sg_ll_report_id_info(int sg_fd, int itype, void * resp, int max_resp_len,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, rii_cdb, sizeof(rii_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, max_resp_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, max_resp_len, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -819,7 +900,22 @@ sg_ll_report_id_info(int sg_fd, int itype, void * resp, int max_resp_len,
         }
         ret = 0;
     }
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_report_id_info(int sg_fd, int itype, void * resp, int max_resp_len,
+                     bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_report_id_info_pt(ptvp, itype, resp, max_resp_len, noisy,
+                                  verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -827,8 +923,8 @@ sg_ll_report_id_info(int sg_fd, int itype, void * resp, int max_resp_len,
  * called SET DEVICE IDENTIFIER prior to spc4r07. Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_set_id_info(int sg_fd, int itype, void * paramp, int param_len,
-                  bool noisy, int verbose)
+sg_ll_set_id_info_pt(struct sg_pt_base * ptvp, int itype, void * paramp,
+                     int param_len, bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "Set identifying information";
     int k, res, ret, sense_cat;
@@ -836,7 +932,6 @@ sg_ll_set_id_info(int sg_fd, int itype, void * paramp, int param_len,
                          SET_IDENTIFYING_INFORMATION_SA,
                          0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     sg_put_unaligned_be32((uint32_t)param_len, sii_cdb + 6);
     sii_cdb[10] |= (itype << 1) & 0xfe;
@@ -851,12 +946,11 @@ sg_ll_set_id_info(int sg_fd, int itype, void * paramp, int param_len,
         }
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, sii_cdb, sizeof(sii_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_out(ptvp, (uint8_t *)paramp, param_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -873,8 +967,21 @@ sg_ll_set_id_info(int sg_fd, int itype, void * paramp, int param_len,
         }
     } else
         ret = 0;
+    return ret;
+}
 
-    destruct_scsi_pt_obj(ptvp);
+int
+sg_ll_set_id_info(int sg_fd, int itype, void * paramp, int param_len,
+                  bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_set_id_info_pt(ptvp, itype, paramp, param_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -906,17 +1013,16 @@ sg_ll_format_unit2(int sg_fd, int fmtpinfo, bool longlist, bool fmtdata,
  * various SG_LIB_CAT_* positive values or -1 -> other errors.
  * FFMT field added in sbc4r10 [20160121] */
 int
-sg_ll_format_unit_v2(int sg_fd, int fmtpinfo, bool longlist, bool fmtdata,
-                     bool cmplst, int dlist_format, int ffmt,
-                     int timeout_secs, void * paramp, int param_len,
-                     bool noisy, int verbose)
+sg_ll_format_unit_v2_pt(struct sg_pt_base * ptvp, int fmtpinfo, bool longlist,
+                        bool fmtdata, bool cmplst, int dlist_format, int ffmt,
+                        int timeout_secs, void * paramp, int param_len,
+                        bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "Format unit";
     int k, res, ret, sense_cat, tmout;
     uint8_t fu_cdb[FORMAT_UNIT_CMDLEN] =
                 {FORMAT_UNIT_CMD, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     if (fmtpinfo)
         fu_cdb[1] |= (fmtpinfo << 6);
@@ -945,12 +1051,11 @@ sg_ll_format_unit_v2(int sg_fd, int fmtpinfo, bool longlist, bool fmtdata,
         }
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, fu_cdb, sizeof(fu_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_out(ptvp, (uint8_t *)paramp, param_len);
-    res = do_scsi_pt(ptvp, sg_fd, tmout, verbose);
+    res = do_scsi_pt(ptvp, -1, tmout, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -967,23 +1072,39 @@ sg_ll_format_unit_v2(int sg_fd, int fmtpinfo, bool longlist, bool fmtdata,
         }
     } else
         ret = 0;
+    return ret;
+}
 
-    destruct_scsi_pt_obj(ptvp);
+int
+sg_ll_format_unit_v2(int sg_fd, int fmtpinfo, bool longlist, bool fmtdata,
+                     bool cmplst, int dlist_format, int ffmt, int timeout_secs,
+                     void * paramp, int param_len, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_format_unit_v2_pt(ptvp, fmtpinfo, longlist, fmtdata, cmplst,
+                                  dlist_format, ffmt, timeout_secs, paramp,
+                                  param_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
 /* Invokes a SCSI REASSIGN BLOCKS command.  Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_reassign_blocks(int sg_fd, bool longlba, bool longlist, void * paramp,
-                      int param_len, bool noisy, int verbose)
+sg_ll_reassign_blocks_pt(struct sg_pt_base * ptvp, bool longlba, bool longlist,
+                         void * paramp, int param_len, bool noisy,
+                         int verbose)
 {
     static const char * const cdb_name_s = "Reassign blocks";
     int res, k, ret, sense_cat;
     uint8_t reass_cdb[REASSIGN_BLKS_CMDLEN] =
         {REASSIGN_BLKS_CMD, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     if (longlba)
         reass_cdb[1] = 0x2;
@@ -1000,12 +1121,11 @@ sg_ll_reassign_blocks(int sg_fd, bool longlba, bool longlist, void * paramp,
         hex2stderr((const uint8_t *)paramp, param_len, -1);
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, reass_cdb, sizeof(reass_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_out(ptvp, (uint8_t *)paramp, param_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -1022,8 +1142,22 @@ sg_ll_reassign_blocks(int sg_fd, bool longlba, bool longlist, void * paramp,
         }
     } else
         ret = 0;
+    return ret;
+}
+
+int
+sg_ll_reassign_blocks(int sg_fd, bool longlba, bool longlist, void * paramp,
+                      int param_len, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
 
-    destruct_scsi_pt_obj(ptvp);
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_reassign_blocks_pt(ptvp, longlba, longlist, paramp, param_len,
+                                   noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -1031,15 +1165,15 @@ sg_ll_reassign_blocks(int sg_fd, bool longlba, bool longlist, void * paramp,
  * when successful, various SG_LIB_CAT_* positive values or
  * -1 -> other errors */
 int
-sg_ll_persistent_reserve_in(int sg_fd, int rq_servact, void * resp,
-                            int mx_resp_len, bool noisy, int verbose)
+sg_ll_persistent_reserve_in_pt(struct sg_pt_base * ptvp, int rq_servact,
+                               void * resp, int mx_resp_len, bool noisy,
+                               int verbose)
 {
     static const char * const cdb_name_s = "Persistent reservation in";
     int res, k, ret, sense_cat;
     uint8_t prin_cdb[PERSISTENT_RESERVE_IN_CMDLEN] =
                  {PERSISTENT_RESERVE_IN_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     if (rq_servact > 0)
         prin_cdb[1] = (uint8_t)(rq_servact & 0x1f);
@@ -1052,12 +1186,11 @@ sg_ll_persistent_reserve_in(int sg_fd, int rq_servact, void * resp,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, prin_cdb, sizeof(prin_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, mx_resp_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, mx_resp_len, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -1086,7 +1219,22 @@ sg_ll_persistent_reserve_in(int sg_fd, int rq_servact, void * resp,
         }
         ret = 0;
     }
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_persistent_reserve_in(int sg_fd, int rq_servact, void * resp,
+                            int mx_resp_len, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_persistent_reserve_in_pt(ptvp, rq_servact, resp, mx_resp_len,
+                                         noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -1094,16 +1242,16 @@ sg_ll_persistent_reserve_in(int sg_fd, int rq_servact, void * resp,
  * when successful, various SG_LIB_CAT_* positive values or
  * -1 -> other errors */
 int
-sg_ll_persistent_reserve_out(int sg_fd, int rq_servact, int rq_scope,
-                             unsigned int rq_type, void * paramp,
-                             int param_len, bool noisy, int verbose)
+sg_ll_persistent_reserve_out_pt(struct sg_pt_base * ptvp, int rq_servact,
+                                int rq_scope, unsigned int rq_type,
+                                void * paramp, int param_len, bool noisy,
+                                int verbose)
 {
     static const char * const cdb_name_s = "Persistent reservation out";
     int res, k, ret, sense_cat;
     uint8_t prout_cdb[PERSISTENT_RESERVE_OUT_CMDLEN] =
                  {PERSISTENT_RESERVE_OUT_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     if (rq_servact > 0)
         prout_cdb[1] = (uint8_t)(rq_servact & 0x1f);
@@ -1121,12 +1269,11 @@ sg_ll_persistent_reserve_out(int sg_fd, int rq_servact, int rq_scope,
         }
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, prout_cdb, sizeof(prout_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_out(ptvp, (uint8_t *)paramp, param_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -1143,8 +1290,23 @@ sg_ll_persistent_reserve_out(int sg_fd, int rq_servact, int rq_scope,
         }
     } else
         ret = 0;
+    return ret;
+}
+
+int
+sg_ll_persistent_reserve_out(int sg_fd, int rq_servact, int rq_scope,
+                             unsigned int rq_type, void * paramp,
+                             int param_len, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
 
-    destruct_scsi_pt_obj(ptvp);
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_persistent_reserve_out_pt(ptvp, rq_servact, rq_scope, rq_type,
+                                          paramp, param_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -1170,15 +1332,14 @@ has_blk_ili(uint8_t * sensep, int sb_len)
  * is in bytes. Returns 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_read_long10(int sg_fd, bool pblock, bool correct, unsigned int lba,
-                  void * resp, int xfer_len, int * offsetp, bool noisy,
-                  int verbose)
+sg_ll_read_long10_pt(struct sg_pt_base * ptvp, bool pblock, bool correct,
+                     unsigned int lba, void * resp, int xfer_len,
+                     int * offsetp, bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "read long(10)";
     int k, res, sense_cat, ret;
     uint8_t readLong_cdb[READ_LONG10_CMDLEN];
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     memset(readLong_cdb, 0, READ_LONG10_CMDLEN);
     readLong_cdb[0] = READ_LONG10_CMD;
@@ -1196,12 +1357,11 @@ sg_ll_read_long10(int sg_fd, bool pblock, bool correct, unsigned int lba,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, readLong_cdb, sizeof(readLong_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, xfer_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, xfer_len, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -1251,7 +1411,23 @@ sg_ll_read_long10(int sg_fd, bool pblock, bool correct, unsigned int lba,
         }
         ret = 0;
     }
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_read_long10(int sg_fd, bool pblock, bool correct, unsigned int lba,
+                  void * resp, int xfer_len, int * offsetp, bool noisy,
+                  int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_read_long10_pt(ptvp, pblock, correct, lba, resp, xfer_len,
+                               offsetp, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -1259,15 +1435,14 @@ sg_ll_read_long10(int sg_fd, bool pblock, bool correct, unsigned int lba,
  * is in bytes. Returns 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_read_long16(int sg_fd, bool pblock, bool correct, uint64_t llba,
-                  void * resp, int xfer_len, int * offsetp, bool noisy,
-                  int verbose)
+sg_ll_read_long16_pt(struct sg_pt_base * ptvp, bool pblock, bool correct,
+                     uint64_t llba, void * resp, int xfer_len, int * offsetp,
+                     bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "read long(16)";
     int k, res, sense_cat, ret;
     uint8_t readLong_cdb[SERVICE_ACTION_IN_16_CMDLEN];
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     memset(readLong_cdb, 0, sizeof(readLong_cdb));
     readLong_cdb[0] = SERVICE_ACTION_IN_16_CMD;
@@ -1286,12 +1461,11 @@ sg_ll_read_long16(int sg_fd, bool pblock, bool correct, uint64_t llba,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, readLong_cdb, sizeof(readLong_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, xfer_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, xfer_len, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -1341,7 +1515,23 @@ sg_ll_read_long16(int sg_fd, bool pblock, bool correct, uint64_t llba,
         }
         ret = 0;
     }
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_read_long16(int sg_fd, bool pblock, bool correct, uint64_t llba,
+                  void * resp, int xfer_len, int * offsetp, bool noisy,
+                  int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_read_long16_pt(ptvp, pblock, correct, llba, resp, xfer_len,
+                               offsetp, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -1349,15 +1539,14 @@ sg_ll_read_long16(int sg_fd, bool pblock, bool correct, uint64_t llba,
  * is in bytes. Returns 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_write_long10(int sg_fd, bool cor_dis, bool wr_uncor, bool pblock,
-                   unsigned int lba, void * data_out, int xfer_len,
-                   int * offsetp, bool noisy, int verbose)
+sg_ll_write_long10_pt(struct sg_pt_base * ptvp, bool cor_dis, bool wr_uncor,
+                      bool pblock, unsigned int lba, void * data_out,
+                      int xfer_len, int * offsetp, bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "write long(10)";
     int k, res, sense_cat, ret;
     uint8_t writeLong_cdb[WRITE_LONG10_CMDLEN];
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     memset(writeLong_cdb, 0, WRITE_LONG10_CMDLEN);
     writeLong_cdb[0] = WRITE_LONG10_CMD;
@@ -1377,12 +1566,11 @@ sg_ll_write_long10(int sg_fd, bool cor_dis, bool wr_uncor, bool pblock,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, writeLong_cdb, sizeof(writeLong_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_out(ptvp, (uint8_t *)data_out, xfer_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -1419,8 +1607,23 @@ sg_ll_write_long10(int sg_fd, bool cor_dis, bool wr_uncor, bool pblock,
         }
     } else
         ret = 0;
+    return ret;
+}
+
+int
+sg_ll_write_long10(int sg_fd, bool cor_dis, bool wr_uncor, bool pblock,
+                   unsigned int lba, void * data_out, int xfer_len,
+                   int * offsetp, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
 
-    destruct_scsi_pt_obj(ptvp);
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_write_long10_pt(ptvp, cor_dis, wr_uncor, pblock, lba, data_out,
+                                xfer_len, offsetp, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -1428,15 +1631,14 @@ sg_ll_write_long10(int sg_fd, bool cor_dis, bool wr_uncor, bool pblock,
  * is in bytes. Returns 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_write_long16(int sg_fd, bool cor_dis, bool wr_uncor, bool pblock,
-                   uint64_t llba, void * data_out, int xfer_len,
-                   int * offsetp, bool noisy, int verbose)
+sg_ll_write_long16_pt(struct sg_pt_base * ptvp, bool cor_dis, bool wr_uncor,
+                      bool pblock, uint64_t llba, void * data_out,
+                      int xfer_len, int * offsetp, bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "write long(16)";
     int k, res, sense_cat, ret;
     uint8_t writeLong_cdb[SERVICE_ACTION_OUT_16_CMDLEN];
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     memset(writeLong_cdb, 0, sizeof(writeLong_cdb));
     writeLong_cdb[0] = SERVICE_ACTION_OUT_16_CMD;
@@ -1457,12 +1659,11 @@ sg_ll_write_long16(int sg_fd, bool cor_dis, bool wr_uncor, bool pblock,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, writeLong_cdb, sizeof(writeLong_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_out(ptvp, (uint8_t *)data_out, xfer_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -1500,8 +1701,23 @@ sg_ll_write_long16(int sg_fd, bool cor_dis, bool wr_uncor, bool pblock,
         }
     } else
         ret = 0;
+    return ret;
+}
 
-    destruct_scsi_pt_obj(ptvp);
+int
+sg_ll_write_long16(int sg_fd, bool cor_dis, bool wr_uncor, bool pblock,
+                   uint64_t llba, void * data_out, int xfer_len, int * offsetp,
+                   bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_write_long16_pt(ptvp, cor_dis, wr_uncor, pblock, llba,
+                                data_out, xfer_len, offsetp, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -1510,17 +1726,16 @@ sg_ll_write_long16(int sg_fd, bool cor_dis, bool wr_uncor, bool pblock,
  * Returns of 0 -> success, * various SG_LIB_CAT_* positive values or
  * -1 -> other errors */
 int
-sg_ll_verify10(int sg_fd, int vrprotect, bool dpo, int bytchk,
-               unsigned int lba, int veri_len, void * data_out,
-               int data_out_len, unsigned int * infop, bool noisy,
-               int verbose)
+sg_ll_verify10_pt(struct sg_pt_base * ptvp, int vrprotect, bool dpo,
+                  int bytchk, unsigned int lba, int veri_len, void * data_out,
+                  int data_out_len, unsigned int * infop, bool noisy,
+                  int verbose)
 {
     static const char * const cdb_name_s = "verify(10)";
     int k, res, ret, sense_cat, slen;
     uint8_t v_cdb[VERIFY10_CMDLEN] =
                 {VERIFY10_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     /* N.B. BYTCHK field expanded to 2 bits sbc3r34 */
     v_cdb[1] = (((vrprotect & 0x7) << 5) | ((bytchk & 0x3) << 1)) ;
@@ -1540,13 +1755,12 @@ sg_ll_verify10(int sg_fd, int vrprotect, bool dpo, int bytchk,
             hex2stderr((const uint8_t *)data_out, k, verbose < 5);
         }
     }
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, v_cdb, sizeof(v_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     if (data_out_len > 0)
         set_scsi_pt_data_out(ptvp, (uint8_t *)data_out, data_out_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -1578,8 +1792,24 @@ sg_ll_verify10(int sg_fd, int vrprotect, bool dpo, int bytchk,
         }
     } else
         ret = 0;
+    return ret;
+}
+
+int
+sg_ll_verify10(int sg_fd, int vrprotect, bool dpo, int bytchk,
+               unsigned int lba, int veri_len, void * data_out,
+               int data_out_len, unsigned int * infop, bool noisy,
+               int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
 
-    destruct_scsi_pt_obj(ptvp);
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_verify10_pt(ptvp, vrprotect, dpo, bytchk, lba, veri_len,
+                            data_out, data_out_len, infop, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -1588,16 +1818,16 @@ sg_ll_verify10(int sg_fd, int vrprotect, bool dpo, int bytchk,
  * Returns of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_verify16(int sg_fd, int vrprotect, bool dpo, int bytchk, uint64_t llba,
-               int veri_len, int group_num, void * data_out,
-               int data_out_len, uint64_t * infop, bool noisy, int verbose)
+sg_ll_verify16_pt(struct sg_pt_base * ptvp, int vrprotect, bool dpo,
+                  int bytchk, uint64_t llba, int veri_len, int group_num,
+                  void * data_out, int data_out_len, uint64_t * infop,
+                  bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "verify(16)";
     int k, res, ret, sense_cat, slen;
     uint8_t v_cdb[VERIFY16_CMDLEN] =
                 {VERIFY16_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     /* N.B. BYTCHK field expanded to 2 bits sbc3r34 */
     v_cdb[1] = (((vrprotect & 0x7) << 5) | ((bytchk & 0x3) << 1)) ;
@@ -1618,13 +1848,12 @@ sg_ll_verify16(int sg_fd, int vrprotect, bool dpo, int bytchk, uint64_t llba,
             hex2stderr((const uint8_t *)data_out, k, verbose < 5);
         }
     }
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return sg_convert_errno(ENOMEM);
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, v_cdb, sizeof(v_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     if (data_out_len > 0)
         set_scsi_pt_data_out(ptvp, (uint8_t *)data_out, data_out_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -1656,8 +1885,24 @@ sg_ll_verify16(int sg_fd, int vrprotect, bool dpo, int bytchk, uint64_t llba,
         }
     } else
         ret = 0;
+    return ret;
+}
+
+int
+sg_ll_verify16(int sg_fd, int vrprotect, bool dpo, int bytchk, uint64_t llba,
+               int veri_len, int group_num, void * data_out, int data_out_len,
+               uint64_t * infop, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
 
-    destruct_scsi_pt_obj(ptvp);
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_verify16_pt(ptvp, vrprotect, dpo, bytchk, llba, veri_len,
+                            group_num, data_out, data_out_len, infop, noisy,
+                            verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -1747,7 +1992,7 @@ sg_ll_ata_pt(int sg_fd, const uint8_t * cdbp, int cdb_len,
             hex2stderr(apt_cdb, cdb_len, -1);
         }
     }
-    if (NULL == ((ptvp = create_pt_obj(cnamep))))
+    if (NULL == ((ptvp = sg_cmds_get_pt_obj(sg_fd, verbose))))
         return -1;
     set_scsi_pt_cdb(ptvp, apt_cdb, cdb_len);
     set_scsi_pt_sense(ptvp, sp, slen);
@@ -1831,22 +2076,22 @@ sg_ll_ata_pt(int sg_fd, const uint8_t * cdbp, int cdb_len,
     }
 
 out:
-    destruct_scsi_pt_obj(ptvp);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
 /* Invokes a SCSI READ BUFFER(10) command (SPC). Return of 0 -> success
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_read_buffer(int sg_fd, int mode, int buffer_id, int buffer_offset,
-                  void * resp, int mx_resp_len, bool noisy, int verbose)
+sg_ll_read_buffer_pt(struct sg_pt_base * ptvp, int mode, int buffer_id,
+                     int buffer_offset, void * resp, int mx_resp_len,
+                     bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "read buffer(10)";
     int res, k, ret, sense_cat;
     uint8_t rbuf_cdb[READ_BUFFER_CMDLEN] =
         {READ_BUFFER_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     rbuf_cdb[1] = (uint8_t)(mode & 0x1f);
     rbuf_cdb[2] = (uint8_t)(buffer_id & 0xff);
@@ -1859,12 +2104,11 @@ sg_ll_read_buffer(int sg_fd, int mode, int buffer_id, int buffer_offset,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return -1;
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, rbuf_cdb, sizeof(rbuf_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, mx_resp_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, mx_resp_len, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -1893,22 +2137,37 @@ sg_ll_read_buffer(int sg_fd, int mode, int buffer_id, int buffer_offset,
         }
         ret = 0;
     }
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_read_buffer(int sg_fd, int mode, int buffer_id, int buffer_offset,
+                  void * resp, int mx_resp_len, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_read_buffer_pt(ptvp, mode, buffer_id, buffer_offset, resp,
+                               mx_resp_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
 /* Invokes a SCSI WRITE BUFFER command (SPC). Return of 0 -> success
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_write_buffer(int sg_fd, int mode, int buffer_id, int buffer_offset,
-                   void * paramp, int param_len, bool noisy, int verbose)
+sg_ll_write_buffer_pt(struct sg_pt_base * ptvp, int mode, int buffer_id,
+                      int buffer_offset, void * paramp, int param_len,
+                      bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "write buffer";
     int k, res, ret, sense_cat;
     uint8_t wbuf_cdb[WRITE_BUFFER_CMDLEN] =
         {WRITE_BUFFER_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     wbuf_cdb[1] = (uint8_t)(mode & 0x1f);
     wbuf_cdb[2] = (uint8_t)(buffer_id & 0xff);
@@ -1932,12 +2191,11 @@ sg_ll_write_buffer(int sg_fd, int mode, int buffer_id, int buffer_offset,
         }
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return -1;
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, wbuf_cdb, sizeof(wbuf_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_out(ptvp, (uint8_t *)paramp, param_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -1954,8 +2212,22 @@ sg_ll_write_buffer(int sg_fd, int mode, int buffer_id, int buffer_offset,
         }
     } else
         ret = 0;
+    return ret;
+}
 
-    destruct_scsi_pt_obj(ptvp);
+int
+sg_ll_write_buffer(int sg_fd, int mode, int buffer_id, int buffer_offset,
+                   void * paramp, int param_len, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_write_buffer_pt(ptvp, mode, buffer_id, buffer_offset, paramp,
+                                param_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -1967,16 +2239,15 @@ sg_ll_write_buffer(int sg_fd, int mode, int buffer_id, int buffer_offset,
  *  to command abort to override default of 60 seconds. If timeout_secs is
  *  0 or less then the default timeout is used instead. */
 int
-sg_ll_write_buffer_v2(int sg_fd, int mode, int m_specific, int buffer_id,
-                      uint32_t buffer_offset, void * paramp,
-                      uint32_t param_len, int timeout_secs, bool noisy,
-                      int verbose)
+sg_ll_write_buffer_v2_pt(struct sg_pt_base * ptvp, int mode, int m_specific,
+                         int buffer_id, uint32_t buffer_offset, void * paramp,
+                         uint32_t param_len, int timeout_secs, bool noisy,
+                         int verbose)
 {
     int k, res, ret, sense_cat;
     uint8_t wbuf_cdb[WRITE_BUFFER_CMDLEN] =
         {WRITE_BUFFER_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     if (buffer_offset > 0xffffff) {
         pr2ws("%s: buffer_offset value too large for 24 bits\n", __func__);
@@ -2006,15 +2277,11 @@ sg_ll_write_buffer_v2(int sg_fd, int mode, int m_specific, int buffer_id,
     if (timeout_secs <= 0)
         timeout_secs = DEF_PT_TIMEOUT;
 
-    ptvp = construct_scsi_pt_obj();
-    if (NULL == ptvp) {
-        pr2ws("%s: out of memory\n", __func__);
-        return -1;
-    }
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, wbuf_cdb, sizeof(wbuf_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_out(ptvp, (uint8_t *)paramp, param_len);
-    res = do_scsi_pt(ptvp, sg_fd, timeout_secs, verbose);
+    res = do_scsi_pt(ptvp, -1, timeout_secs, verbose);
     ret = sg_cmds_process_resp(ptvp, "Write buffer", res, SG_NO_DATA_IN,
                                sense_b, noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -2031,8 +2298,25 @@ sg_ll_write_buffer_v2(int sg_fd, int mode, int m_specific, int buffer_id,
         }
     } else
         ret = 0;
+    return ret;
+}
 
-    destruct_scsi_pt_obj(ptvp);
+int
+sg_ll_write_buffer_v2(int sg_fd, int mode, int m_specific, int buffer_id,
+                      uint32_t buffer_offset, void * paramp,
+                      uint32_t param_len, int timeout_secs, bool noisy,
+                      int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_write_buffer_v2_pt(ptvp, mode, m_specific, buffer_id,
+                                   buffer_offset, paramp, param_len,
+                                   timeout_secs, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -2049,15 +2333,15 @@ sg_ll_unmap(int sg_fd, int group_num, int timeout_secs, void * paramp,
 /* Invokes a SCSI UNMAP (SBC-3) command. Version 2 adds anchor field
  * (sbc3r22). Otherwise same as sg_ll_unmap() . */
 int
-sg_ll_unmap_v2(int sg_fd, bool anchor, int group_num, int timeout_secs,
-               void * paramp, int param_len, bool noisy, int verbose)
+sg_ll_unmap_v2_pt(struct sg_pt_base * ptvp, bool anchor, int group_num,
+                  int timeout_secs, void * paramp, int param_len, bool noisy,
+                  int verbose)
 {
     static const char * const cdb_name_s = "unmap";
     int k, res, ret, sense_cat, tmout;
     uint8_t u_cdb[UNMAP_CMDLEN] =
                          {UNMAP_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     if (anchor)
         u_cdb[1] |= 0x1;
@@ -2075,12 +2359,11 @@ sg_ll_unmap_v2(int sg_fd, bool anchor, int group_num, int timeout_secs,
         }
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return -1;
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, u_cdb, sizeof(u_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_out(ptvp, (uint8_t *)paramp, param_len);
-    res = do_scsi_pt(ptvp, sg_fd, tmout, verbose);
+    res = do_scsi_pt(ptvp, -1, tmout, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -2097,22 +2380,36 @@ sg_ll_unmap_v2(int sg_fd, bool anchor, int group_num, int timeout_secs,
         }
     } else
         ret = 0;
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_unmap_v2(int sg_fd, bool anchor, int group_num, int timeout_secs,
+               void * paramp, int param_len, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_unmap_v2_pt(ptvp, anchor, group_num, timeout_secs, paramp,
+                            param_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
 /* Invokes a SCSI READ BLOCK LIMITS command. Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_read_block_limits(int sg_fd, void * resp, int mx_resp_len,
-                        bool noisy, int verbose)
+sg_ll_read_block_limits_pt(struct sg_pt_base * ptvp, void * resp,
+                           int mx_resp_len, bool noisy, int verbose)
 {
     static const char * const cdb_name_s = "read block limits";
     int k, ret, res, sense_cat;
     uint8_t rl_cdb[READ_BLOCK_LIMITS_CMDLEN] =
       {READ_BLOCK_LIMITS_CMD, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     if (verbose) {
         pr2ws("    %s cdb: ", cdb_name_s);
@@ -2121,12 +2418,11 @@ sg_ll_read_block_limits(int sg_fd, void * resp, int mx_resp_len,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return -1;
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, rl_cdb, sizeof(rl_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, mx_resp_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, cdb_name_s, res, mx_resp_len, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -2155,7 +2451,21 @@ sg_ll_read_block_limits(int sg_fd, void * resp, int mx_resp_len,
         }
         ret = 0;
     }
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_read_block_limits(int sg_fd, void * resp, int mx_resp_len, bool noisy,
+                        int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_read_block_limits_pt(ptvp, resp, mx_resp_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -2163,14 +2473,14 @@ sg_ll_read_block_limits(int sg_fd, void * resp, int mx_resp_len,
  * uses of opcode 0x84 (Third-party copy IN). Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_receive_copy_results(int sg_fd, int sa, int list_id, void * resp,
-                           int mx_resp_len, bool noisy, int verbose)
+sg_ll_receive_copy_results_pt(struct sg_pt_base * ptvp, int sa, int list_id,
+                              void * resp, int mx_resp_len, bool noisy,
+                              int verbose)
 {
     int k, res, ret, sense_cat;
     uint8_t rcvcopyres_cdb[THIRD_PARTY_COPY_IN_CMDLEN] =
       {THIRD_PARTY_COPY_IN_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
     char b[64];
 
     sg_get_opcode_sa_name(THIRD_PARTY_COPY_IN_CMD, sa, 0, (int)sizeof(b), b);
@@ -2188,12 +2498,11 @@ sg_ll_receive_copy_results(int sg_fd, int sa, int list_id, void * resp,
         pr2ws("\n");
     }
 
-    if (NULL == ((ptvp = create_pt_obj(b))))
-        return -1;
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, rcvcopyres_cdb, sizeof(rcvcopyres_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_in(ptvp, (uint8_t *)resp, mx_resp_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, b, res, mx_resp_len, sense_b, noisy,
                                verbose, &sense_cat);
     if (-1 == ret)
@@ -2210,7 +2519,22 @@ sg_ll_receive_copy_results(int sg_fd, int sa, int list_id, void * resp,
         }
     } else
         ret = 0;
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_receive_copy_results(int sg_fd, int sa, int list_id, void * resp,
+                           int mx_resp_len, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_receive_copy_results_pt(ptvp, sa, list_id, resp, mx_resp_len,
+                                        noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -2223,14 +2547,13 @@ sg_ll_receive_copy_results(int sg_fd, int sa, int list_id, void * resp,
 /* Invokes a SCSI EXTENDED COPY (LID1) command. Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_extended_copy(int sg_fd, void * paramp, int param_len, bool noisy,
-                    int verbose)
+sg_ll_extended_copy_pt(struct sg_pt_base * ptvp, void * paramp, int param_len,
+                       bool noisy, int verbose)
 {
     int k, res, ret, sense_cat;
     uint8_t xcopy_cdb[THIRD_PARTY_COPY_OUT_CMDLEN] =
       {THIRD_PARTY_COPY_OUT_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
     const char * opcode_name = "Extended copy (LID1)";
 
     xcopy_cdb[1] = (uint8_t)(EXTENDED_COPY_LID1_SA & 0x1f);
@@ -2247,12 +2570,11 @@ sg_ll_extended_copy(int sg_fd, void * paramp, int param_len, bool noisy,
         }
     }
 
-    if (NULL == ((ptvp = create_pt_obj(opcode_name))))
-        return -1;
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, xcopy_cdb, sizeof(xcopy_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_out(ptvp, (uint8_t *)paramp, param_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, verbose);
+    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, verbose);
     ret = sg_cmds_process_resp(ptvp, opcode_name, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -2269,7 +2591,21 @@ sg_ll_extended_copy(int sg_fd, void * paramp, int param_len, bool noisy,
         }
     } else
         ret = 0;
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_extended_copy(int sg_fd, void * paramp, int param_len, bool noisy,
+                    int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_extended_copy_pt(ptvp, paramp, param_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -2279,15 +2615,15 @@ sg_ll_extended_copy(int sg_fd, void * paramp, int param_len, bool noisy,
  * Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
-sg_ll_3party_copy_out(int sg_fd, int sa, unsigned int list_id, int group_num,
-                      int timeout_secs, void * paramp, int param_len,
-                      bool noisy, int verbose)
+sg_ll_3party_copy_out_pt(struct sg_pt_base * ptvp, int sa,
+                         unsigned int list_id, int group_num, int timeout_secs,
+                         void * paramp, int param_len, bool noisy,
+                         int verbose)
 {
     int k, res, ret, sense_cat, tmout;
     uint8_t xcopy_cdb[THIRD_PARTY_COPY_OUT_CMDLEN] =
       {THIRD_PARTY_COPY_OUT_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
     char cname[80];
 
     sg_get_opcode_sa_name(THIRD_PARTY_COPY_OUT_CMD, sa, 0, sizeof(cname),
@@ -2324,12 +2660,11 @@ sg_ll_3party_copy_out(int sg_fd, int sa, unsigned int list_id, int group_num,
         }
     }
 
-    if (NULL == ((ptvp = create_pt_obj(cname))))
-        return -1;
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, xcopy_cdb, sizeof(xcopy_cdb));
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
     set_scsi_pt_data_out(ptvp, (uint8_t *)paramp, param_len);
-    res = do_scsi_pt(ptvp, sg_fd, tmout, verbose);
+    res = do_scsi_pt(ptvp, -1, tmout, verbose);
     ret = sg_cmds_process_resp(ptvp, cname, res, SG_NO_DATA_IN, sense_b,
                                noisy, verbose, &sense_cat);
     if (-1 == ret)
@@ -2346,7 +2681,23 @@ sg_ll_3party_copy_out(int sg_fd, int sa, unsigned int list_id, int group_num,
         }
     } else
         ret = 0;
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_3party_copy_out(int sg_fd, int sa, unsigned int list_id, int group_num,
+                      int timeout_secs, void * paramp, int param_len,
+                      bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_3party_copy_out_pt(ptvp, sa, list_id, group_num, timeout_secs,
+                                   paramp, param_len, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
 
@@ -2360,9 +2711,9 @@ sg_ll_3party_copy_out(int sg_fd, int sa, unsigned int list_id, int group_num,
  * does, assume it is like PRE-FETCH. If timeout_secs is 0 (or less) then
  * use DEF_PT_TIMEOUT (60 seconds) as command timeout. */
 int
-sg_ll_pre_fetch_x(int sg_fd, bool do_seek10, bool cdb16, bool immed,
-                  uint64_t lba, uint32_t num_blocks, int group_num,
-                  int timeout_secs, bool noisy, int verbose)
+sg_ll_pre_fetch_x_pt(struct sg_pt_base * ptvp, bool do_seek10, bool cdb16,
+                     bool immed, uint64_t lba, uint32_t num_blocks,
+                     int group_num, int timeout_secs, bool noisy, int verbose)
 {
     static const char * const cdb10_name_s = "Pre-fetch(10)";
     static const char * const cdb16_name_s = "Pre-fetch(16)";
@@ -2371,7 +2722,6 @@ sg_ll_pre_fetch_x(int sg_fd, bool do_seek10, bool cdb16, bool immed,
     const char *cdb_name_s;
     uint8_t preFetchCdb[PRE_FETCH16_CMDLEN]; /* all use longest cdb */
     uint8_t sense_b[SENSE_BUFF_LEN];
-    struct sg_pt_base * ptvp;
 
     memset(preFetchCdb, 0, sizeof(preFetchCdb));
     if (do_seek10) {
@@ -2420,11 +2770,10 @@ sg_ll_pre_fetch_x(int sg_fd, bool do_seek10, bool cdb16, bool immed,
             pr2ws("%02x ", preFetchCdb[k]);
         pr2ws("\n");
     }
-    if (NULL == ((ptvp = create_pt_obj(cdb_name_s))))
-        return -1;
+    clear_scsi_pt_obj(ptvp);
     set_scsi_pt_cdb(ptvp, preFetchCdb, cdb_len);
     set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
-    res = do_scsi_pt(ptvp, sg_fd, tmout, verbose);
+    res = do_scsi_pt(ptvp, -1, tmout, verbose);
     if (0 == res) {
         int sstat = get_scsi_pt_status_response(ptvp);
 
@@ -2452,6 +2801,22 @@ sg_ll_pre_fetch_x(int sg_fd, bool do_seek10, bool cdb16, bool immed,
     } else
         ret = 0;
 fini:
-    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_pre_fetch_x(int sg_fd, bool do_seek10, bool cdb16, bool immed,
+                  uint64_t lba, uint32_t num_blocks, int group_num,
+                  int timeout_secs, bool noisy, int verbose)
+{
+    int ret;
+    struct sg_pt_base * ptvp;
+
+    ptvp = sg_cmds_get_pt_obj(sg_fd, verbose);
+    if (NULL == ptvp)
+        return sg_convert_errno(ENOMEM);
+    ret = sg_ll_pre_fetch_x_pt(ptvp, do_seek10, cdb16, immed, lba, num_blocks,
+                               group_num, timeout_secs, noisy, verbose);
+    sg_cmds_put_pt_obj(ptvp);
     return ret;
 }
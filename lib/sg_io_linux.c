@@ -24,7 +24,7 @@
 #include "sg_pr2serr.h"
 
 
-/* Version 1.10 20180613 */
+/* Version 1.11 20261016 */
 
 
 void
@@ -97,7 +97,8 @@ sg_print_driver_status(int driver_status)
 
 /* Returns 1 if no errors found and thus nothing printed; otherwise
  * prints error/warning (prefix by 'leadin') to stderr (pr2ws) and
- * returns 0. */
+ * returns 0. The warnings stream is locked for the duration so that
+ * reports from different threads are not interleaved. */
 int
 sg_linux_sense_print(const char * leadin, int scsi_status, int host_status,
                      int driver_status, const uint8_t * sense_buffer,
@@ -105,10 +106,13 @@ sg_linux_sense_print(const char * leadin, int scsi_status, int host_status,
 {
     bool done_leadin = false;
     bool done_sense = false;
+    FILE * fp;
 
     scsi_status &= 0x7e; /*sanity */
     if ((0 == scsi_status) && (0 == host_status) && (0 == driver_status))
         return 1;       /* No problems */
+    fp = sg_get_warnings_strm();
+    flockfile(fp);
     if (0 != scsi_status) {
         if (leadin)
             pr2ws("%s: ", leadin);
@@ -136,7 +140,7 @@ sg_linux_sense_print(const char * leadin, int scsi_status, int host_status,
     if (0 != driver_status) {
         if (done_sense &&
             (SG_LIB_DRIVER_SENSE == (SG_LIB_DRIVER_MASK & driver_status)))
-            return 0;
+            goto fini;
         if (leadin && (! done_leadin))
             pr2ws("%s: ", leadin);
         if (done_leadin)
@@ -147,6 +151,8 @@ sg_linux_sense_print(const char * leadin, int scsi_status, int host_status,
             (SG_LIB_DRIVER_SENSE == (SG_LIB_DRIVER_MASK & driver_status)))
             sg_print_sense(0, sense_buffer, sb_len, raw_sinfo);
     }
+fini:
+    funlockfile(fp);
     return 0;
 }
 
@@ -236,4 +242,41 @@ sg_err_category_new(int scsi_status, int host_status, int driver_status,
     return SG_LIB_CAT_OTHER;
 }
 
+int
+sg_err_category_batch(const struct sg_err_cat_t * arr, int num,
+                      int * cat_arr)
+{
+    int k, cat;
+    int num_bad = 0;
+    unsigned int any = 0;
+    const struct sg_err_cat_t * ecp;
+
+    if ((NULL == arr) || (NULL == cat_arr) || (num <= 0))
+        return 0;
+    /* A burst of GOOD completions is the common case; OR the status
+     * fields of all of them together without branching */
+    for (k = 0; k < num; ++k)
+        any |= (unsigned int)((arr[k].scsi_status & 0x7e) |
+                              arr[k].host_status |
+                              (arr[k].driver_status & SG_LIB_DRIVER_MASK));
+    if (0 == any) {
+        for (k = 0; k < num; ++k)
+            cat_arr[k] = SG_LIB_CAT_CLEAN;
+        return 0;
+    }
+    for (k = 0, ecp = arr; k < num; ++k, ++ecp) {
+        if ((0 == (ecp->scsi_status & 0x7e)) && (0 == ecp->host_status) &&
+            (0 == (ecp->driver_status & SG_LIB_DRIVER_MASK)))
+            cat = SG_LIB_CAT_CLEAN;
+        else
+            cat = sg_err_category_new(ecp->scsi_status, ecp->host_status,
+                                      ecp->driver_status, ecp->sbp,
+                                      ecp->sb_len);
+        cat_arr[k] = cat;
+        if (SG_LIB_CAT_CLEAN != cat)
+            ++num_bad;
+    }
+    return num_bad;
+}
+
 #endif  /* if SG_LIB_LINUX defined */
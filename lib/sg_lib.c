@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
@@ -41,6 +42,9 @@
 #include <inttypes.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -51,14 +55,62 @@
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
 
+/* x86 vector versions of sg_all_zeros() and friends need GCC 4.9 (or
+ * clang) for the target attribute on functions using intrinsics */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && \
+     ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))))
+#define SG_LIB_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#ifndef SG_LIB_WIN32
+#include <sys/mman.h>
+#endif
+
 /* sg_lib_version_str (and datestamp) defined in sg_lib_data.c file */
 
 #define ASCQ_ATA_PT_INFO_AVAILABLE 0x1d  /* corresponding ASC is 0 */
 
 typedef unsigned int my_uint;    /* convenience to save a few line wraps */
 
+/* Lookup indexes over the tables in sg_lib_data.c are built once, on first
+ * use. The thread that claims an index builds it; others fall back to the
+ * linear scans until it is marked ready. */
+#ifdef __GNUC__
+#define SG_IDX_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define SG_IDX_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define SG_IDX_CLAIM(p) __atomic_exchange_n((p), 1, __ATOMIC_ACQ_REL)
+#else
+#define SG_IDX_LOAD(p) (*(p))
+#define SG_IDX_STORE(p, v) (*(p) = (v))
+#define SG_IDX_CLAIM(p) ((*(p))++)
+#endif
+
+/* Thread local storage for per thread state (e.g. warnings stream). Where
+ * the compiler has no support it degrades to process global state. */
+#if defined(__GNUC__) || defined(__clang__)
+#define SG_LIB_TLS __thread
+#elif defined(_MSC_VER)
+#define SG_LIB_TLS __declspec(thread)
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define SG_LIB_TLS _Thread_local
+#else
+#define SG_LIB_TLS
+#endif
+
 FILE * sg_warnings_strm = NULL;        /* would like to default to stderr */
 
+static SG_LIB_TLS FILE * sg_thread_warnings_strm;
+
+
+FILE *
+sg_get_warnings_strm(void)
+{
+    if (sg_thread_warnings_strm)
+        return sg_thread_warnings_strm;
+    return sg_warnings_strm ? sg_warnings_strm : stderr;
+}
 
 int
 pr2ws(const char * fmt, ...)
@@ -67,7 +119,7 @@ pr2ws(const char * fmt, ...)
     int n;
 
     va_start(args, fmt);
-    n = vfprintf(sg_warnings_strm ? sg_warnings_strm : stderr, fmt, args);
+    n = vfprintf(sg_get_warnings_strm(), fmt, args);
     va_end(args);
     return n;
 }
@@ -103,19 +155,40 @@ my_isprint(int ch)
 }
 
 /* DSENSE is 'descriptor sense' as opposed to the older 'fixed sense'.
- * Only (currently) used in SNTL. */
+ * Only (currently) used in SNTL. The environment is only read once; racing
+ * first callers compute the same answer. */
 bool
 sg_get_initial_dsense(void)
 {
-    int k;
+    static int dsense_state;    /* 0: not checked, 1: false, 2: true */
+    int k, state;
     const char * cp;
 
-    cp = getenv("SG3_UTILS_DSENSE");
-    if (cp) {
-        if (1 == sscanf(cp, "%d", &k))
-            return k ? true : false;
+    state = SG_IDX_LOAD(&dsense_state);
+    if (0 == state) {
+        state = 1;
+        cp = getenv("SG3_UTILS_DSENSE");
+        if (cp && (1 == sscanf(cp, "%d", &k)) && k)
+            state = 2;
+        SG_IDX_STORE(&dsense_state, state);
     }
-    return false;
+    return (2 == state);
+}
+
+/* 'vp' points to the first of one or more consecutive entries with the
+ * same value. Returns the one matching 'peri_type', if any, otherwise
+ * 'vp'. */
+static const struct sg_lib_value_name_t *
+get_value_name_run(const struct sg_lib_value_name_t * vp, int peri_type)
+{
+    const struct sg_lib_value_name_t * holdp = vp;
+    int value = vp->value;
+
+    for ( ; vp->name && (value == vp->value); ++vp) {
+        if (peri_type == vp->peri_dev_type)
+            return vp;
+    }
+    return holdp;
 }
 
 /* Searches 'arr' for match on 'value' then 'peri_type'. If matches
@@ -126,22 +199,12 @@ get_value_name(const struct sg_lib_value_name_t * arr, int value,
                int peri_type)
 {
     const struct sg_lib_value_name_t * vp = arr;
-    const struct sg_lib_value_name_t * holdp;
 
     if (peri_type < 0)
         peri_type = 0;
     for (; vp->name; ++vp) {
-        if (value == vp->value) {
-            if (peri_type == vp->peri_dev_type)
-                return vp;
-            holdp = vp;
-            while ((vp + 1)->name && (value == (vp + 1)->value)) {
-                ++vp;
-                if (peri_type == vp->peri_dev_type)
-                    return vp;
-            }
-            return holdp;
-        }
+        if (value == vp->value)
+            return get_value_name_run(vp, peri_type);
     }
     return NULL;
 }
@@ -154,6 +217,12 @@ sg_set_warnings_strm(FILE * warnings_strm)
     sg_warnings_strm = warnings_strm;
 }
 
+void
+sg_set_thread_warnings_strm(FILE * warnings_strm)
+{
+    sg_thread_warnings_strm = warnings_strm;
+}
+
 #define CMD_NAME_LEN 128
 
 void
@@ -257,12 +326,109 @@ sg_get_sense_key_str(int sense_key, int buff_len, char * buff)
     return buff;
 }
 
+/* ASC/ASCQ strings are found via a two level index: asc_l2_off[asc] locates
+ * a block of asc_l2_len[asc] entries in asc_l2_pool[], one for each ASCQ
+ * from 0 to the largest listed for that ASC, holding 1 + the index into
+ * sg_lib_asc_ascq[] (0 -> no entry). The few range entries are reached via
+ * asc_rng_idx[], indexes into sg_lib_asc_ascq_range[] sorted by ASC, with
+ * asc_rng_first[asc] and asc_rng_num[asc] selecting those for an ASC. As
+ * with the linear scans, the last matching entry in either table wins.
+ * The pool is static (about 1350 entries are needed) so nothing is left to
+ * free; should the table outgrow it the linear scans are used. */
+#define SG_ASC_L2_POOL_SZ 2048
+
+static int asc_idx_claimed;
+static int asc_idx_ready;
+static int asc_l2_off[256];
+static uint16_t asc_l2_len[256];
+static uint16_t asc_l2_pool[SG_ASC_L2_POOL_SZ];
+static uint8_t asc_rng_first[256];
+static uint8_t asc_rng_num[256];
+static uint8_t asc_rng_idx[256];
+
+static bool
+asc_idx_build(void)
+{
+    int k, j, n, total;
+    const struct sg_lib_asc_ascq_t * eip;
+    const struct sg_lib_asc_ascq_range_t * ei2p;
+
+    for (n = 0; sg_lib_asc_ascq_range[n].text; ++n)
+        ;
+    if (n > (int)sizeof(asc_rng_idx))
+        return false;
+    for (j = 0, k = 0; k < 256; ++k) {
+        asc_rng_first[k] = j;
+        for (ei2p = sg_lib_asc_ascq_range; ei2p->text; ++ei2p) {
+            if (k == ei2p->asc)
+                asc_rng_idx[j++] = ei2p - sg_lib_asc_ascq_range;
+        }
+        asc_rng_num[k] = j - asc_rng_first[k];
+    }
+    for (eip = sg_lib_asc_ascq; eip->text; ++eip) {
+        if (eip->ascq >= asc_l2_len[eip->asc])
+            asc_l2_len[eip->asc] = eip->ascq + 1;
+    }
+    for (total = 0, k = 0; k < 256; ++k) {
+        asc_l2_off[k] = total;
+        total += asc_l2_len[k];
+    }
+    if (total > SG_ASC_L2_POOL_SZ)
+        return false;
+    for (k = 0, eip = sg_lib_asc_ascq; eip->text; ++eip, ++k)
+        asc_l2_pool[asc_l2_off[eip->asc] + eip->ascq] = k + 1;
+    return true;
+}
+
+/* Places matching range entry in *ei2pp and, failing that, matching entry
+ * in *eipp; either may be set to NULL. */
+static void
+get_asc_ascq_entry(int asc, int ascq, struct sg_lib_asc_ascq_t ** eipp,
+                   struct sg_lib_asc_ascq_range_t ** ei2pp)
+{
+    int k, j;
+    struct sg_lib_asc_ascq_t * eip;
+    struct sg_lib_asc_ascq_range_t * ei2p;
+
+    *eipp = NULL;
+    *ei2pp = NULL;
+    if (! SG_IDX_LOAD(&asc_idx_ready)) {
+        if ((0 == SG_IDX_CLAIM(&asc_idx_claimed)) && asc_idx_build())
+            SG_IDX_STORE(&asc_idx_ready, 1);
+        else {  /* being built by another thread or failed */
+            for (ei2p = sg_lib_asc_ascq_range; ei2p->text; ++ei2p) {
+                if ((ei2p->asc == asc) && (ascq >= ei2p->ascq_min) &&
+                    (ascq <= ei2p->ascq_max))
+                    *ei2pp = ei2p;
+            }
+            if (*ei2pp)
+                return;
+            for (eip = sg_lib_asc_ascq; eip->text; ++eip) {
+                if ((eip->asc == asc) && (eip->ascq == ascq))
+                    *eipp = eip;
+            }
+            return;
+        }
+    }
+    if ((asc < 0) || (asc > 0xff) || (ascq < 0) || (ascq > 0xff))
+        return;
+    for (k = 0; k < asc_rng_num[asc]; ++k) {
+        ei2p = sg_lib_asc_ascq_range + asc_rng_idx[asc_rng_first[asc] + k];
+        if ((ascq >= ei2p->ascq_min) && (ascq <= ei2p->ascq_max))
+            *ei2pp = ei2p;
+    }
+    if (*ei2pp)
+        return;
+    if ((ascq < asc_l2_len[asc]) &&
+        (j = asc_l2_pool[asc_l2_off[asc] + ascq]))
+        *eipp = sg_lib_asc_ascq + (j - 1);
+}
+
 /* Yield string associated with ASC/ASCQ values. Returns 'buff'. */
 char *
 sg_get_asc_ascq_str(int asc, int ascq, int buff_len, char * buff)
 {
-    int k, num, rlen;
-    bool found = false;
+    int num, rlen;
     struct sg_lib_asc_ascq_t * eip;
     struct sg_lib_asc_ascq_range_t * ei2p;
 
@@ -270,29 +436,14 @@ sg_get_asc_ascq_str(int asc, int ascq, int buff_len, char * buff)
         buff[0] = '\0';
         return buff;
     }
-    for (k = 0; sg_lib_asc_ascq_range[k].text; ++k) {
-        ei2p = &sg_lib_asc_ascq_range[k];
-        if ((ei2p->asc == asc) &&
-            (ascq >= ei2p->ascq_min)  &&
-            (ascq <= ei2p->ascq_max)) {
-            found = true;
-            num = sg_scnpr(buff, buff_len, "Additional sense: ");
-            rlen = buff_len - num;
-            sg_scnpr(buff + num, ((rlen > 0) ? rlen : 0), ei2p->text, ascq);
-        }
-    }
-    if (found)
-        return buff;
-
-    for (k = 0; sg_lib_asc_ascq[k].text; ++k) {
-        eip = &sg_lib_asc_ascq[k];
-        if (eip->asc == asc &&
-            eip->ascq == ascq) {
-            found = true;
-            sg_scnpr(buff, buff_len, "Additional sense: %s", eip->text);
-        }
-    }
-    if (! found) {
+    get_asc_ascq_entry(asc, ascq, &eip, &ei2p);
+    if (ei2p) {
+        num = sg_scnpr(buff, buff_len, "Additional sense: ");
+        rlen = buff_len - num;
+        sg_scnpr(buff + num, ((rlen > 0) ? rlen : 0), ei2p->text, ascq);
+    } else if (eip)
+        sg_scnpr(buff, buff_len, "Additional sense: %s", eip->text);
+    else {
         if (asc >= 0x80)
             sg_scnpr(buff, buff_len, "vendor specific ASC=%02x, ASCQ=%02x "
                      "(hex)", asc, ascq);
@@ -501,6 +652,160 @@ sg_get_sense_progress_fld(const uint8_t * sbp, int sb_len,
     }
 }
 
+/* Walks the descriptors of descriptor format sense data placing their
+ * locations in ssp->descs[]. Does not check the response code. */
+static void
+sense_descs_parse(const uint8_t * sbp, int sb_len,
+                  struct sg_scsi_sense_t * ssp)
+{
+    int add_sb_len, add_d_len, desc_len, k, n;
+    struct sg_scsi_sense_desc_t * sdp;
+
+    ssp->num_descs = 0;
+    if ((sb_len < 8) || (0 == (add_sb_len = sbp[7])))
+        return;
+    add_sb_len = (add_sb_len < (sb_len - 8)) ? add_sb_len : (sb_len - 8);
+    for (k = 0, n = 0; (k < add_sb_len) && (n < SG_SCSI_SENSE_MAX_DESCS);
+         k += desc_len, ++n) {
+        add_d_len = (k < (add_sb_len - 1)) ? sbp[8 + k + 1] : -1;
+        if ((k + add_d_len + 2) > add_sb_len)
+            add_d_len = add_sb_len - k - 2;
+        desc_len = add_d_len + 2;
+        sdp = ssp->descs + n;
+        sdp->type = sbp[8 + k];
+        sdp->reserved = 0;
+        sdp->add_len = add_d_len;
+        sdp->offset = 8 + k;
+    }
+    ssp->num_descs = n;
+}
+
+/* See description in sg_lib.h header file */
+bool
+sg_scsi_parse_sense(const uint8_t * sbp, int sb_len,
+                    struct sg_scsi_sense_t * ssp)
+{
+    int k, len, add_d_len;
+    uint32_t seen = 0;
+    const uint8_t * bp;
+
+    memset(ssp, 0, offsetof(struct sg_scsi_sense_t, descs));
+    if ((NULL == sbp) || (sb_len < 1))
+        return false;
+    ssp->response_code = 0x7f & sbp[0];
+    len = sb_len;
+    if (sb_len > 7)
+        len = ((sbp[7] + 8) < sb_len) ? (sbp[7] + 8) : sb_len;
+    ssp->sense_len = len;
+    switch (ssp->response_code) {
+    case 0x70:
+    case 0x71:
+        ssp->deferred = (0x71 == ssp->response_code);
+        if (len > 2) {
+            ssp->sense_key = (0xf & sbp[2]);
+            ssp->filemark = !!(sbp[2] & 0x80);
+            ssp->eom = !!(sbp[2] & 0x40);
+            ssp->ili = !!(sbp[2] & 0x20);
+            ssp->sdat_ovfl = !!(sbp[2] & 0x10);
+        }
+        if (len > 6) {
+            ssp->info_present = true;
+            ssp->info_valid = !!(sbp[0] & 0x80);
+            ssp->info = sg_get_unaligned_be32(sbp + 3);
+        }
+        if (len > 11) {
+            ssp->cmd_spec_present = true;
+            ssp->cmd_spec = sg_get_unaligned_be32(sbp + 8);
+        }
+        if (len > 12)
+            ssp->asc = sbp[12];
+        if (len > 13)
+            ssp->ascq = sbp[13];
+        if (len > 14)
+            ssp->fru_code = sbp[14];
+        if (len > 17) {
+            ssp->sks_present = true;
+            memcpy(ssp->sks, sbp + 15, 3);
+        }
+        break;
+    case 0x72:
+    case 0x73:
+        ssp->descriptor = true;
+        ssp->deferred = (0x73 == ssp->response_code);
+        if (sb_len > 1)
+            ssp->sense_key = (0xf & sbp[1]);
+        if (sb_len > 2)
+            ssp->asc = sbp[2];
+        if (sb_len > 3)
+            ssp->ascq = sbp[3];
+        if (sb_len > 4)
+            ssp->sdat_ovfl = !!(sbp[4] & 0x80);
+        sense_descs_parse(sbp, sb_len, ssp);
+        /* like sg_scsi_sense_desc_find(), only first of each type used */
+        for (k = 0; k < ssp->num_descs; ++k) {
+            bp = sbp + ssp->descs[k].offset;
+            add_d_len = ssp->descs[k].add_len;
+            if (bp[0] < 32) {
+                if (seen & (1 << bp[0]))
+                    continue;
+                seen |= (1 << bp[0]);
+            }
+            switch (bp[0]) {
+            case 0:     /* Information */
+                if ((add_d_len >= 10) && (0xa == bp[1])) {
+                    ssp->info_present = true;
+                    ssp->info_valid = !!(bp[2] & 0x80);
+                    ssp->info = sg_get_unaligned_be64(bp + 4);
+                }
+                break;
+            case 1:     /* Command specific information */
+                if ((add_d_len >= 10) && (0xa == bp[1])) {
+                    ssp->cmd_spec_present = true;
+                    ssp->cmd_spec = sg_get_unaligned_be64(bp + 4);
+                }
+                break;
+            case 2:     /* Sense key specific */
+                if ((add_d_len >= 6) && (0x6 == bp[1])) {
+                    ssp->sks_present = true;
+                    memcpy(ssp->sks, bp + 4, 3);
+                }
+                break;
+            case 3:     /* Field replaceable unit */
+                if (add_d_len >= 2)
+                    ssp->fru_code = bp[3];
+                break;
+            case 4:     /* Stream commands */
+                if (add_d_len >= 2) {
+                    ssp->filemark = !!(bp[3] & 0x80);
+                    ssp->eom = !!(bp[3] & 0x40);
+                    ssp->ili = !!(bp[3] & 0x20);
+                }
+                break;
+            case 0xa:   /* Progress indication */
+                if ((add_d_len >= 6) && (0x6 == bp[1])) {
+                    ssp->progress_valid = true;
+                    ssp->progress = sg_get_unaligned_be16(bp + 6);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        break;
+    default:
+        ssp->sense_len = 0;
+        return false;
+    }
+    ssp->sks_valid = ssp->sks_present && (ssp->sks[0] & 0x80);
+    /* progress in sense key specific bytes takes precedence */
+    if (ssp->sks_valid && ((SPC_SK_NO_SENSE == ssp->sense_key) ||
+                           (SPC_SK_NOT_READY == ssp->sense_key))) {
+        ssp->progress_valid = true;
+        ssp->progress = sg_get_unaligned_be16(ssp->sks + 1);
+    }
+    return true;
+}
+
 char *
 sg_get_pdt_str(int pdt, int buff_len, char * buff)
 {
@@ -1302,11 +1607,12 @@ int
 sg_get_sense_descriptors_str(const char * lip, const uint8_t * sbp,
                              int sb_len, int blen, char * b)
 {
-    int add_sb_len, add_d_len, desc_len, k, j, sense_key;
+    int add_d_len, k, j, sense_key;
     int n, progress, pr, rem;
     uint16_t sct_sc;
     bool processed;
     const uint8_t * descp;
+    struct sg_scsi_sense_t ss;
     const char * dtsp = "   >> descriptor too short";
     const char * eccp = "Extended copy command";
     const char * ddp = "destination device";
@@ -1319,18 +1625,14 @@ sg_get_sense_descriptors_str(const char * lip, const uint8_t * sbp,
         sg_scnpr(z, sizeof(z), "%.60s  ", lip);
     else
         sg_scnpr(z, sizeof(z), "  ");
-    if ((sb_len < 8) || (0 == (add_sb_len = sbp[7])))
+    sense_descs_parse(sbp, sb_len, &ss);
+    if (0 == ss.num_descs)
         return 0;
-    add_sb_len = (add_sb_len < (sb_len - 8)) ? add_sb_len : (sb_len - 8);
     sense_key = (sbp[1] & 0xf);
 
-    for (descp = (sbp + 8), k = 0, n = 0;
-         (k < add_sb_len) && (n < blen);
-         k += desc_len, descp += desc_len) {
-        add_d_len = (k < (add_sb_len - 1)) ? descp[1] : -1;
-        if ((k + add_d_len + 2) > add_sb_len)
-            add_d_len = add_sb_len - k - 2;
-        desc_len = add_d_len + 2;
+    for (k = 0, n = 0; (k < ss.num_descs) && (n < blen); ++k) {
+        descp = sbp + ss.descs[k].offset;
+        add_d_len = ss.descs[k].add_len;
         n += sg_scnpr(b + n, blen - n, "%s  Descriptor type: ", lip);
         processed = true;
         switch (descp[0]) {
@@ -1652,16 +1954,13 @@ int
 sg_get_sense_str(const char * lip, const uint8_t * sbp, int sb_len,
                  bool raw_sinfo, int cblen, char * cbp)
 {
-    bool descriptor_format = false;
-    bool sdat_ovfl = false;
     bool valid;
     int len, progress, n, r, pr, rem, blen;
     unsigned int info;
     uint8_t resp_code;
     const char * ebp = NULL;
-    char ebuff[64];
     char b[256];
-    struct sg_scsi_sense_hdr ssh;
+    struct sg_scsi_sense_t ss;
 
     if ((NULL == cbp) || (cblen <= 0))
         return 0;
@@ -1680,66 +1979,41 @@ sg_get_sense_str(const char * lip, const uint8_t * sbp, int sb_len,
     resp_code = 0x7f & sbp[0];
     valid = !!(sbp[0] & 0x80);
     len = sb_len;
-    if (sg_scsi_normalize_sense(sbp, sb_len, &ssh)) {
-        switch (ssh.response_code) {
-        case 0x70:      /* fixed, current */
-            ebp = "Fixed format, current";
-            len = (sb_len > 7) ? (sbp[7] + 8) : sb_len;
-            len = (len > sb_len) ? sb_len : len;
-            sdat_ovfl = (len > 2) ? !!(sbp[2] & 0x10) : false;
-            break;
-        case 0x71:      /* fixed, deferred */
-            /* error related to a previous command */
-            ebp = "Fixed format, <<<deferred>>>";
-            len = (sb_len > 7) ? (sbp[7] + 8) : sb_len;
-            len = (len > sb_len) ? sb_len : len;
-            sdat_ovfl = (len > 2) ? !!(sbp[2] & 0x10) : false;
-            break;
-        case 0x72:      /* descriptor, current */
-            descriptor_format = true;
-            ebp = "Descriptor format, current";
-            sdat_ovfl = (sb_len > 4) ? !!(sbp[4] & 0x80) : false;
-            break;
-        case 0x73:      /* descriptor, deferred */
-            descriptor_format = true;
-            ebp = "Descriptor format, <<<deferred>>>";
-            sdat_ovfl = (sb_len > 4) ? !!(sbp[4] & 0x80) : false;
-            break;
-        case 0x0:
-            ebp = "Response code: 0x0 (?)";
-            break;
-        default:
-            sg_scnpr(ebuff, sizeof(ebuff), "Unknown response code: 0x%x",
-                     ssh.response_code);
-            ebp = ebuff;
-            break;
-        }
+    if (sg_scsi_parse_sense(sbp, sb_len, &ss)) {
+        if (ss.descriptor)
+            ebp = ss.deferred ? "Descriptor format, <<<deferred>>>" :
+                                "Descriptor format, current";
+        else    /* deferred: error related to a previous command */
+            ebp = ss.deferred ? "Fixed format, <<<deferred>>>" :
+                                "Fixed format, current";
+        if (! ss.descriptor)
+            len = ss.sense_len;
         n += sg_scnpr(cbp + n, cblen - n, "%s%s; Sense key: %s\n", lip, ebp,
-                      sg_lib_sense_key_desc[ssh.sense_key]);
-        if (sdat_ovfl)
+                      sg_lib_sense_key_desc[ss.sense_key]);
+        if (ss.sdat_ovfl)
             n += sg_scnpr(cbp + n, cblen - n, "%s<<<Sense data overflow "
                           "(SDAT_OVFL)>>>\n", lip);
-        if (descriptor_format) {
+        if (ss.descriptor) {
             n += sg_scnpr(cbp + n, cblen - n, "%s%s\n", lip,
-                          sg_get_asc_ascq_str(ssh.asc, ssh.ascq, blen, b));
+                          sg_get_asc_ascq_str(ss.asc, ss.ascq, blen, b));
             n += sg_get_sense_descriptors_str(lip, sbp, len,
                                               cblen - n, cbp + n);
-        } else if ((len > 12) && (0 == ssh.asc) &&
-                   (ASCQ_ATA_PT_INFO_AVAILABLE == ssh.ascq)) {
+        } else if ((len > 12) && (0 == ss.asc) &&
+                   (ASCQ_ATA_PT_INFO_AVAILABLE == ss.ascq)) {
             /* SAT ATA PASS-THROUGH fixed format */
             n += sg_scnpr(cbp + n, cblen - n, "%s%s\n", lip,
-                          sg_get_asc_ascq_str(ssh.asc, ssh.ascq, blen, b));
+                          sg_get_asc_ascq_str(ss.asc, ss.ascq, blen, b));
             n += sg_get_sense_sat_pt_fixed_str(lip, sbp, len,
                                                cblen - n, cbp + n);
         } else if (len > 2) {   /* fixed format */
             if (len > 12)
                 n += sg_scnpr(cbp + n, cblen - n, "%s%s\n", lip,
-                         sg_get_asc_ascq_str(ssh.asc, ssh.ascq, blen, b));
+                         sg_get_asc_ascq_str(ss.asc, ss.ascq, blen, b));
             r = 0;
             if (strlen(lip) > 0)
                 r += sg_scnpr(b + r, blen - r, "%s", lip);
-            if (len > 6) {
-                info = sg_get_unaligned_be32(sbp + 3);
+            if (ss.info_present) {
+                info = (unsigned int)ss.info;
                 if (valid)
                     r += sg_scnpr(b + r, blen - r, "  Info fld=0x%x [%u] ",
                                   info, info);
@@ -1748,40 +2022,40 @@ sg_get_sense_str(const char * lip, const uint8_t * sbp, int sb_len,
                                   "[%u] ", info, info);
             } else
                 info = 0;
-            if (sbp[2] & 0xe0) {
-                if (sbp[2] & 0x80)
+            if (ss.filemark || ss.eom || ss.ili) {
+                if (ss.filemark)
                    r += sg_scnpr(b + r, blen - r, " FMK");
                             /* current command has read a filemark */
-                if (sbp[2] & 0x40)
+                if (ss.eom)
                    r += sg_scnpr(b + r, blen - r, " EOM");
                             /* end-of-medium condition exists */
-                if (sbp[2] & 0x20)
+                if (ss.ili)
                    r += sg_scnpr(b + r, blen - r, " ILI");
                             /* incorrect block length requested */
                 r += sg_scnpr(b + r, blen - r, "\n");
             } else if (valid || (info > 0))
                 r += sg_scnpr(b + r, blen - r, "\n");
-            if ((len >= 14) && sbp[14])
+            if (ss.fru_code)
                 r += sg_scnpr(b + r, blen - r, "%s  Field replaceable unit "
-                              "code: %d\n", lip, sbp[14]);
-            if ((len >= 18) && (sbp[15] & 0x80)) {
+                              "code: %d\n", lip, ss.fru_code);
+            if (ss.sks_valid) {
                 /* sense key specific decoding */
-                switch (ssh.sense_key) {
+                switch (ss.sense_key) {
                 case SPC_SK_ILLEGAL_REQUEST:
                     r += sg_scnpr(b + r, blen - r, "%s  Sense Key Specific: "
                                   "Error in %s: byte %d", lip,
-                                  ((sbp[15] & 0x40) ?
+                                  ((ss.sks[0] & 0x40) ?
                                          "Command" : "Data parameters"),
-                                  sg_get_unaligned_be16(sbp + 16));
-                    if (sbp[15] & 0x08)
+                                  sg_get_unaligned_be16(ss.sks + 1));
+                    if (ss.sks[0] & 0x08)
                         r += sg_scnpr(b + r, blen - r, " bit %d\n",
-                                      sbp[15] & 0x07);
+                                      ss.sks[0] & 0x07);
                     else
                         r += sg_scnpr(b + r, blen - r, "\n");
                     break;
                 case SPC_SK_NO_SENSE:
                 case SPC_SK_NOT_READY:
-                    progress = sg_get_unaligned_be16(sbp + 16);
+                    progress = ss.progress;
                     pr = (progress * 100) / 65536;
                     rem = ((progress * 100) % 65536) / 656;
                     r += sg_scnpr(b + r, blen - r, "%s  Progress indication: "
@@ -1791,18 +2065,18 @@ sg_get_sense_str(const char * lip, const uint8_t * sbp, int sb_len,
                 case SPC_SK_MEDIUM_ERROR:
                 case SPC_SK_RECOVERED_ERROR:
                     r += sg_scnpr(b + r, blen - r, "%s  Actual retry count: "
-                                  "0x%02x%02x\n", lip, sbp[16], sbp[17]);
+                                  "0x%02x%02x\n", lip, ss.sks[1], ss.sks[2]);
                     break;
                 case SPC_SK_COPY_ABORTED:
                     r += sg_scnpr(b + r, blen - r, "%s  Segment pointer: ",
                                   lip);
                     r += sg_scnpr(b + r, blen - r, "Relative to start of %s, "
-                                  "byte %d", ((sbp[15] & 0x20) ?
+                                  "byte %d", ((ss.sks[0] & 0x20) ?
                                      "segment descriptor" : "parameter list"),
-                                  sg_get_unaligned_be16(sbp + 16));
-                    if (sbp[15] & 0x08)
+                                  sg_get_unaligned_be16(ss.sks + 1));
+                    if (ss.sks[0] & 0x08)
                         r += sg_scnpr(b + r, blen - r, " bit %d\n",
-                                      sbp[15] & 0x07);
+                                      ss.sks[0] & 0x07);
                     else
                         r += sg_scnpr(b + r, blen - r, "\n");
                     break;
@@ -1810,11 +2084,11 @@ sg_get_sense_str(const char * lip, const uint8_t * sbp, int sb_len,
                     r += sg_scnpr(b + r, blen - r, "%s  Unit attention "
                                   "condition queue: ", lip);
                     r += sg_scnpr(b + r, blen - r, "overflow flag is %d\n",
-                                  !!(sbp[15] & 0x1));
+                                  !!(ss.sks[0] & 0x1));
                     break;
                 default:
                     r += sg_scnpr(b + r, blen - r, "%s  Sense_key: 0x%x "
-                                  "unexpected\n", lip, ssh.sense_key);
+                                  "unexpected\n", lip, ss.sense_key);
                     break;
                 }
             }
@@ -1980,8 +2254,7 @@ sg_if_can2stdout(const char * leadin, int exit_status)
 bool
 sg_if_can2stderr(const char * leadin, int exit_status)
 {
-    return sg_if_can2fp(leadin, exit_status,
-                        sg_warnings_strm ? sg_warnings_strm : stderr);
+    return sg_if_can2fp(leadin, exit_status, sg_get_warnings_strm());
 }
 
 /* If os_err_num is within bounds then the returned value is 'os_err_num +
@@ -2190,10 +2463,134 @@ static struct op_code2sa_t op_code2sa_arr[] = {
     {0xffff, -1, NULL, NULL},
 };
 
+/* Opcode and service action names are found via indexes that are built
+ * once, on first use, from the tables in sg_lib_data.c . Opcodes index
+ * sg_lib_normal_opcodes[] and op_code2sa_arr[] directly; each service
+ * action array gets a small open addressed hash table since variable
+ * length command service actions are 16 bits wide. Each index entry
+ * refers to the first of (possibly several, differing by peripheral
+ * device type) consecutive entries with that value, so lookups give the
+ * same results as get_value_name(). Until the indexes are ready (or if
+ * another thread is building them) the linear scan is used. */
+
+#define SG_NAME_IDX_NUM_SA (SG_ARRAY_SIZE(op_code2sa_arr) - 1)
+#define SG_NAME_HASH_SZ 256     /* power of 2, > twice longest SA array */
+
+static int name_idx_claimed;
+static int name_idx_ready;
+static int16_t normal_op_idx[256];      /* -> sg_lib_normal_opcodes[] */
+static int8_t op2sa_idx[256];           /* -> op_code2sa_arr[] */
+static int16_t sa_hash[SG_NAME_IDX_NUM_SA][SG_NAME_HASH_SZ];
+
+static inline int
+sa_hash_start(int value)
+{
+    uint32_t u = (uint32_t)value;
+
+    return (int)((u ^ (u >> 8) ^ (u >> 16)) & (SG_NAME_HASH_SZ - 1));
+}
+
+static void
+name_idx_build(void)
+{
+    int k, j, h;
+    const struct sg_lib_value_name_t * arr;
+    const struct sg_lib_value_name_t * vp;
+
+    memset(normal_op_idx, 0xff, sizeof(normal_op_idx));
+    memset(op2sa_idx, 0xff, sizeof(op2sa_idx));
+    memset(sa_hash, 0xff, sizeof(sa_hash));
+    for (vp = sg_lib_normal_opcodes, j = 0; vp->name; ++vp, ++j) {
+        if ((vp->value >= 0) && (vp->value < 256) &&
+            (normal_op_idx[vp->value] < 0))
+            normal_op_idx[vp->value] = j;
+    }
+    for (k = 0; k < (int)SG_NAME_IDX_NUM_SA; ++k) {
+        if (op2sa_idx[op_code2sa_arr[k].op_code] < 0)
+            op2sa_idx[op_code2sa_arr[k].op_code] = k;
+        arr = op_code2sa_arr[k].arr;
+        for (vp = arr, j = 0; vp->name; ++vp, ++j) {
+            for (h = sa_hash_start(vp->value); sa_hash[k][h] >= 0;
+                 h = (h + 1) & (SG_NAME_HASH_SZ - 1)) {
+                if (arr[sa_hash[k][h]].value == vp->value)
+                    break;      /* keep the first entry with this value */
+            }
+            if (sa_hash[k][h] < 0)
+                sa_hash[k][h] = j;
+        }
+    }
+}
+
+/* Returns true when the indexes can be used. */
+static bool
+name_idx_ready_chk(void)
+{
+    if (SG_IDX_LOAD(&name_idx_ready))
+        return true;
+    if (SG_IDX_CLAIM(&name_idx_claimed))
+        return false;   /* some other thread is building them */
+    name_idx_build();
+    SG_IDX_STORE(&name_idx_ready, 1);
+    return true;
+}
+
+static const struct sg_lib_value_name_t *
+get_normal_opcode_name(int opcode, int peri_type)
+{
+    int j;
+
+    if (! name_idx_ready_chk())
+        return get_value_name(sg_lib_normal_opcodes, opcode, peri_type);
+    if (peri_type < 0)
+        peri_type = 0;
+    j = normal_op_idx[opcode & 0xff];
+    return (j < 0) ? NULL :
+                     get_value_name_run(sg_lib_normal_opcodes + j, peri_type);
+}
+
+/* Returns matching op_code2sa_arr[] element or NULL. */
+static const struct op_code2sa_t *
+get_op_code2sa(int op_code, bool use_idx)
+{
+    int k;
+    const struct op_code2sa_t * osp;
+
+    if (use_idx) {
+        k = op2sa_idx[op_code & 0xff];
+        return (k < 0) ? NULL : (op_code2sa_arr + k);
+    }
+    for (osp = op_code2sa_arr; osp->arr; ++osp) {
+        if (op_code == osp->op_code)
+            return osp;
+    }
+    return NULL;
+}
+
+static const struct sg_lib_value_name_t *
+get_sa_name(const struct op_code2sa_t * osp, int service_action,
+            int peri_type, bool use_idx)
+{
+    int h, j;
+    const int16_t * hp;
+
+    if (! use_idx)
+        return get_value_name(osp->arr, service_action, peri_type);
+    if (peri_type < 0)
+        peri_type = 0;
+    hp = sa_hash[osp - op_code2sa_arr];
+    for (h = sa_hash_start(service_action); (j = hp[h]) >= 0;
+         h = (h + 1) & (SG_NAME_HASH_SZ - 1)) {
+        if (service_action == osp->arr[j].value)
+            return get_value_name_run(osp->arr + j, peri_type);
+    }
+    return NULL;
+}
+
 void
 sg_get_opcode_sa_name(uint8_t cmd_byte0, int service_action,
                       int peri_type, int buff_len, char * buff)
 {
+    bool use_idx;
     int d_pdt;
     const struct sg_lib_value_name_t * vnp;
     const struct op_code2sa_t * osp;
@@ -2209,27 +2606,22 @@ sg_get_opcode_sa_name(uint8_t cmd_byte0, int service_action,
     if (peri_type < 0)
         peri_type = 0;
     d_pdt = sg_lib_pdt_decay(peri_type);
-    for (osp = op_code2sa_arr; osp->arr; ++osp) {
-        if ((int)cmd_byte0 == osp->op_code) {
-            if ((osp->pdt_match < 0) || (d_pdt == osp->pdt_match)) {
-                vnp = get_value_name(osp->arr, service_action, peri_type);
-                if (vnp) {
-                    if (osp->prefix)
-                        sg_scnpr(buff, buff_len, "%s, %s", osp->prefix,
-                                 vnp->name);
-                    else
-                        sg_scnpr(buff, buff_len, "%s", vnp->name);
-                } else {
-                    sg_get_opcode_name(cmd_byte0, peri_type, sizeof(b), b);
-                    sg_scnpr(buff, buff_len, "%s service action=0x%x", b,
-                             service_action);
-                }
-            } else
-                sg_get_opcode_name(cmd_byte0, peri_type, buff_len, buff);
-            return;
+    use_idx = name_idx_ready_chk();
+    osp = get_op_code2sa(cmd_byte0, use_idx);
+    if (osp && ((osp->pdt_match < 0) || (d_pdt == osp->pdt_match))) {
+        vnp = get_sa_name(osp, service_action, peri_type, use_idx);
+        if (vnp) {
+            if (osp->prefix)
+                sg_scnpr(buff, buff_len, "%s, %s", osp->prefix, vnp->name);
+            else
+                sg_scnpr(buff, buff_len, "%s", vnp->name);
+        } else {
+            sg_get_opcode_name(cmd_byte0, peri_type, sizeof(b), b);
+            sg_scnpr(buff, buff_len, "%s service action=0x%x", b,
+                     service_action);
         }
-    }
-    sg_get_opcode_name(cmd_byte0, peri_type, buff_len, buff);
+    } else
+        sg_get_opcode_name(cmd_byte0, peri_type, buff_len, buff);
 }
 
 void
@@ -2256,7 +2648,7 @@ sg_get_opcode_name(uint8_t cmd_byte0, int peri_type, int buff_len,
     case 2:
     case 4:
     case 5:
-        vnp = get_value_name(sg_lib_normal_opcodes, cmd_byte0, peri_type);
+        vnp = get_normal_opcode_name(cmd_byte0, peri_type);
         if (vnp)
             sg_scnpr(buff, buff_len, "%s", vnp->name);
         else
@@ -2641,40 +3033,115 @@ sg_build_sense_buffer(bool desc, uint8_t *sbp, uint8_t skey, uint8_t asc,
 
 /* safe_strerror() contributed by Clayton Weaver <cgweav at email dot com>
  * Allows for situation in which strerror() is given a wild value (or the
- * C library is incomplete) and returns NULL. Still not thread safe.
+ * C library is incomplete) and returns NULL. Uses strerror_r() into a per
+ * thread buffer so it is thread safe where SG_LIB_TLS is supported.
  */
 
-static char safe_errbuf[64] = {'u', 'n', 'k', 'n', 'o', 'w', 'n', ' ',
-                               'e', 'r', 'r', 'n', 'o', ':', ' ', 0};
+#define SAFE_ERRBUF_LEN 128
+
+static SG_LIB_TLS char safe_errbuf[SAFE_ERRBUF_LEN];
 
 char *
 safe_strerror(int errnum)
 {
-    size_t len;
     char * errstr;
 
     if (errnum < 0)
         errnum = -errnum;
-    errstr = strerror(errnum);
+#if defined(SG_LIB_WIN32) || defined(SG_LIB_MINGW)
+    errstr = strerror(errnum);          /* MS CRT uses per thread buffer */
+#elif defined(__GLIBC__) && defined(_GNU_SOURCE)
+    errstr = strerror_r(errnum, safe_errbuf, SAFE_ERRBUF_LEN);
+#else
+    errstr = (0 == strerror_r(errnum, safe_errbuf, SAFE_ERRBUF_LEN)) ?
+             safe_errbuf : NULL;
+#endif
     if (NULL == errstr) {
-        len = strlen(safe_errbuf);
-        sg_scnpr(safe_errbuf + len, sizeof(safe_errbuf) - len, "%i", errnum);
+        sg_scnpr(safe_errbuf, SAFE_ERRBUF_LEN, "unknown errno: %i", errnum);
         return safe_errbuf;
     }
     return errstr;
 }
 
+/* The hex dump functions below render whole lines using this table and
+ * collect them in a hex_out_t buffer which is written with one fwrite()
+ * per block (or copied into the caller's buffer for dStrHexStr()). */
+static const char sg_hex_digits[] = "0123456789abcdef";
+
+#define HEX_OUT_BLEN 8192
+
+struct hex_out_t {
+    FILE * fp;
+    int len;
+    char b[HEX_OUT_BLEN];
+};
+
+static void
+hex_out_flush(struct hex_out_t * hop)
+{
+    if (hop->len > 0)
+        fwrite(hop->b, 1, hop->len, hop->fp);
+    hop->len = 0;
+}
+
+/* Appends 'len' characters from 'lp' followed by a newline. Lines are
+ * always much shorter than HEX_OUT_BLEN. */
 static void
-trimTrailingSpaces(char * b)
+hex_out_line(struct hex_out_t * hop, const char * lp, int len)
+{
+    if ((hop->len + len + 1) > HEX_OUT_BLEN)
+        hex_out_flush(hop);
+    memcpy(hop->b + hop->len, lp, len);
+    hop->len += len;
+    hop->b[hop->len++] = '\n';
+}
+
+/* Same digits as sprintf(cp, "%.2x", u) but without a trailing '\0'.
+ * Returns the number of digits. */
+static int
+hex_uint_put(char * cp, uint32_t u)
+{
+    int k, n;
+    char t[8];
+
+    for (n = 0; (u > 0) || (n < 2); ++n, u >>= 4)
+        t[n] = sg_hex_digits[u & 0xf];
+    for (k = 0; k < n; ++k)
+        cp[k] = t[n - 1 - k];
+    return n;
+}
+
+/* Writes 'num' (up to 16) bytes as space separated ASCII-hex pairs with an
+ * extra space between the 8th and 9th. No trailing space or '\0'. Returns
+ * the number of characters written. */
+static int
+hex_line_put(char * cp, const uint8_t * bp, int num)
 {
     int k;
+    char * p = cp;
 
-    for (k = ((int)strlen(b) - 1); k >= 0; --k) {
-        if (' ' != b[k])
-            break;
+    for (k = 0; k < num; ++k) {
+        if (k > 0)
+            *p++ = ' ';
+        if (8 == k)
+            *p++ = ' ';
+        *p++ = sg_hex_digits[bp[k] >> 4];
+        *p++ = sg_hex_digits[bp[k] & 0xf];
     }
-    if ('\0' != b[k + 1])
-        b[k + 1] = '\0';
+    return p - cp;
+}
+
+/* Output line starts with a space and the address (offset) in hex. Hex
+ * data starts in column 8, overwriting the end of an address with more
+ * than 6 digits. Places 'a' in 'cp', assumes cp[0..7] are spaces. */
+static inline void
+hex_addr_put(char * cp, uint32_t a)
+{
+    int alen;
+    char ad[8];
+
+    alen = hex_uint_put(ad, a);
+    memcpy(cp + 1, ad, (alen < 7) ? alen : 7);
 }
 
 /* Note the ASCII-hex output goes to stdout. [Most other output from functions
@@ -2686,86 +3153,35 @@ trimTrailingSpaces(char * b)
 static void
 dStrHexFp(const char* str, int len, int no_ascii, FILE * fp)
 {
-    const char * p = str;
-    const char * formatstr;
-    uint8_t c;
-    char buff[82];
-    int a = 0;
-    int bpstart = 5;
+    const uint8_t * bp = (const uint8_t *)str;
     const int cpstart = 60;
-    int cpos = cpstart;
-    int bpos = bpstart;
-    int i, k, blen;
+    int j, k, n, num;
+    char line[80];
+    struct hex_out_t ho;
 
     if (len <= 0)
         return;
-    blen = (int)sizeof(buff);
-    if (0 == no_ascii)  /* address at left and ASCII at right */
-        formatstr = "%.76s\n";
-    else                        /* previously when > 0 str was "%.58s\n" */
-        formatstr = "%s\n";     /* when < 0 str was: "%.48s\n" */
-    memset(buff, ' ', 80);
-    buff[80] = '\0';
-    if (no_ascii < 0) {
-        bpstart = 0;
-        bpos = bpstart;
-        for (k = 0; k < len; k++) {
-            c = *p++;
-            if (bpos == (bpstart + (8 * 3)))
-                bpos++;
-            sg_scnpr(&buff[bpos], blen - bpos, "%.2x", (int)(uint8_t)c);
-            buff[bpos + 2] = ' ';
-            if ((k > 0) && (0 == ((k + 1) % 16))) {
-                trimTrailingSpaces(buff);
-                fprintf(fp, formatstr, buff);
-                bpos = bpstart;
-                memset(buff, ' ', 80);
-            } else
-                bpos += 3;
-        }
-        if (bpos > bpstart) {
-            buff[bpos + 2] = '\0';
-            trimTrailingSpaces(buff);
-            fprintf(fp, "%s\n", buff);
-        }
-        return;
-    }
-    /* no_ascii>=0, start each line with address (offset) */
-    k = sg_scnpr(buff + 1, blen - 1, "%.2x", a);
-    buff[k + 1] = ' ';
-
-    for (i = 0; i < len; i++) {
-        c = *p++;
-        bpos += 3;
-        if (bpos == (bpstart + (9 * 3)))
-            bpos++;
-        sg_scnpr(&buff[bpos], blen - bpos, "%.2x", (int)(uint8_t)c);
-        buff[bpos + 2] = ' ';
-        if (no_ascii)
-            buff[cpos++] = ' ';
-        else {
-            if (! my_isprint(c))
-                c = '.';
-            buff[cpos++] = c;
+    ho.fp = fp;
+    ho.len = 0;
+    for (k = 0; k < len; k += 16, bp += 16) {
+        num = ((len - k) < 16) ? (len - k) : 16;
+        if (no_ascii < 0) {
+            hex_out_line(&ho, line, hex_line_put(line, bp, num));
+            continue;
         }
-        if (cpos > (cpstart + 15)) {
-            if (no_ascii)
-                trimTrailingSpaces(buff);
-            fprintf(fp, formatstr, buff);
-            bpos = bpstart;
-            cpos = cpstart;
-            a += 16;
-            memset(buff, ' ', 80);
-            k = sg_scnpr(buff + 1, blen - 1, "%.2x", a);
-            buff[k + 1] = ' ';
+        /* no_ascii>=0, start each line with address (offset) */
+        memset(line, ' ', 8);
+        hex_addr_put(line, k);
+        n = 8 + hex_line_put(line + 8, bp, num);
+        if (0 == no_ascii) {
+            memset(line + n, ' ', cpstart - n);
+            for (j = 0; j < num; ++j)
+                line[cpstart + j] = my_isprint(bp[j]) ? bp[j] : '.';
+            n = cpstart + num;
         }
+        hex_out_line(&ho, line, n);
     }
-    if (cpos > cpstart) {
-        buff[cpos] = '\0';
-        if (no_ascii)
-            trimTrailingSpaces(buff);
-        fprintf(fp, "%s\n", buff);
-    }
+    hex_out_flush(&ho);
 }
 
 void
@@ -2777,8 +3193,7 @@ dStrHex(const char* str, int len, int no_ascii)
 void
 dStrHexErr(const char* str, int len, int no_ascii)
 {
-    dStrHexFp(str, len, no_ascii,
-              (sg_warnings_strm ? sg_warnings_strm : stderr));
+    dStrHexFp(str, len, no_ascii, sg_get_warnings_strm());
 }
 
 #define DSHS_LINE_BLEN 160
@@ -2795,12 +3210,10 @@ int
 dStrHexStr(const char * str, int len, const char * leadin, int format,
            int b_len, char * b)
 {
-    uint8_t c;
-    int bpstart, bpos, k, n, prior_ascii_len;
     bool want_ascii;
-    char buff[DSHS_LINE_BLEN + 2];
-    char a[DSHS_BPL + 1];
-    const char * p = str;
+    int bpstart, j, k, m, n, num, rem;
+    const uint8_t * bp = (const uint8_t *)str;
+    char line[DSHS_LINE_BLEN + DSHS_BPL + 8];
 
     if (len <= 0) {
         if (b_len > 0)
@@ -2810,57 +3223,40 @@ dStrHexStr(const char * str, int len, const char * leadin, int format,
     if (b_len <= 0)
         return 0;
     want_ascii = !format;
-    if (want_ascii) {
-        memset(a, ' ', DSHS_BPL);
-        a[DSHS_BPL] = '\0';
-    }
     if (leadin) {
         bpstart = strlen(leadin);
         /* Cap leadin at (DSHS_LINE_BLEN - 70) characters */
         if (bpstart > (DSHS_LINE_BLEN - 70))
             bpstart = DSHS_LINE_BLEN - 70;
+        memcpy(line, leadin, bpstart);
     } else
         bpstart = 0;
-    bpos = bpstart;
-    prior_ascii_len = bpstart + (DSHS_BPL * 3) + 1;
-    n = 0;
-    memset(buff, ' ', DSHS_LINE_BLEN);
-    buff[DSHS_LINE_BLEN] = '\0';
-    if (bpstart > 0)
-        memcpy(buff, leadin, bpstart);
-    for (k = 0; k < len; k++) {
-        c = *p++;
-        if (bpos == (bpstart + ((DSHS_BPL / 2) * 3)))
-            bpos++;     /* for extra space in middle of each line's hex */
-        sg_scnpr(buff + bpos, (int)sizeof(buff) - bpos, "%.2x",
-                 (int)(uint8_t)c);
-        buff[bpos + 2] = ' ';
-        if (want_ascii)
-            a[k % DSHS_BPL] = my_isprint(c) ? c : '.';
-        if ((k > 0) && (0 == ((k + 1) % DSHS_BPL))) {
-            trimTrailingSpaces(buff);
-            if (want_ascii) {
-                n += sg_scnpr(b + n, b_len - n, "%-*s   %s\n",
-                              prior_ascii_len, buff, a);
-                memset(a, ' ', DSHS_BPL);
-            } else
-                n += sg_scnpr(b + n, b_len - n, "%s\n", buff);
-            if (n >= (b_len - 1))
-                return n;
-            memset(buff, ' ', DSHS_LINE_BLEN);
-            bpos = bpstart;
-            if (bpstart > 0)
-                memcpy(buff, leadin, bpstart);
-        } else
-            bpos += 3;
-    }
-    if (bpos > bpstart) {
-        trimTrailingSpaces(buff);
-        if (want_ascii)
-            n += sg_scnpr(b + n, b_len - n, "%-*s   %s\n", prior_ascii_len,
-                          buff, a);
-        else
-            n += sg_scnpr(b + n, b_len - n, "%s\n", buff);
+    for (k = 0, n = 0; k < len; k += DSHS_BPL, bp += DSHS_BPL) {
+        num = ((len - k) < DSHS_BPL) ? (len - k) : DSHS_BPL;
+        m = bpstart + hex_line_put(line + bpstart, bp, num);
+        if (want_ascii) {
+            /* ASCII starts 3 spaces after where a full line's hex ends + 1 */
+            j = bpstart + (DSHS_BPL * 3) + 1 + 3;
+            memset(line + m, ' ', j - m);
+            for (m = j, j = 0; j < DSHS_BPL; ++j, ++m) {
+                if (j < num)
+                    line[m] = my_isprint(bp[j]) ? bp[j] : '.';
+                else
+                    line[m] = ' ';
+            }
+        }
+        line[m++] = '\n';
+        /* append to 'b' truncating like sg_scnpr() */
+        rem = b_len - n;
+        if (rem > 1) {
+            if (m > (rem - 1))
+                m = rem - 1;
+            memcpy(b + n, line, m);
+            n += m;
+            b[n] = '\0';
+        }
+        if (n >= (b_len - 1))
+            return n;
     }
     return n;
 }
@@ -2884,6 +3280,244 @@ hex2str(const uint8_t * b_str, int len, const char * leadin, int format,
     return dStrHexStr((const char *)b_str, len, leadin, format, b_len, b);
 }
 
+/* Character classes for the ASCII hex input parser: hex digits map to their
+ * value, the rest to one of the HEX_IN_* values. */
+#define HEX_IN_SEP 0x10         /* space, tab or comma */
+#define HEX_IN_EOL 0x11         /* newline */
+#define HEX_IN_CMT 0x12         /* '#' or '\r': ignore rest of line */
+#define HEX_IN_BAD 0x13
+
+static const uint8_t hex_in_cls[256] = {
+    /* 0x00 */ 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x10, 0x11, 0x13, 0x13, 0x12, 0x13, 0x13,
+    /* 0x10 */ 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0x20 */ 0x10, 0x13, 0x13, 0x12, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x10, 0x13, 0x13, 0x13,
+    /* 0x30 */ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+               0x08, 0x09, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0x40 */ 0x13, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0x50 */ 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0x60 */ 0x13, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0x70 */ 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0x80 */ 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0x90 */ 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0xa0 */ 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0xb0 */ 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0xc0 */ 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0xd0 */ 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0xe0 */ 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+    /* 0xf0 */ 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+               0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13, 0x13,
+};
+
+/* State of the ASCII hex parser carried between input chunks */
+struct hex_in_t {
+    bool no_space;
+    bool in_comment;            /* skipping to end of line */
+    int ndig;                   /* hex digits seen in current byte */
+    unsigned int val;
+    int line;                   /* origin 1 */
+    int off;                    /* bytes placed in arr */
+    int max_len;
+    int64_t base;               /* input offset of start of current chunk */
+    int64_t line_start;         /* input offset of start of current line */
+    int64_t tok_start;          /* input offset of current token */
+    uint8_t * arr;
+};
+
+/* Feeds the next len bytes of input to the parser. Returns 0 if ok, else
+ * SG_LIB_SYNTAX_ERROR. */
+static int
+hex_in_parse(struct hex_in_t * hp, const uint8_t * bp, int64_t len)
+{
+    int64_t k;
+    const uint8_t * cp;
+    uint8_t c;
+
+    for (k = 0; k < len; ++k) {
+        if (hp->in_comment) {
+            cp = (const uint8_t *)memchr(bp + k, '\n', len - k);
+            if (NULL == cp)
+                break;
+            k = cp - bp;
+        }
+        c = hex_in_cls[bp[k]];
+        if (c < HEX_IN_SEP) {
+            if (hp->no_space) {
+                hp->val = (hp->val << 4) | c;
+                if (++hp->ndig < 2)
+                    continue;
+            } else {
+                if (0 == hp->ndig++)
+                    hp->tok_start = hp->base + k;
+                hp->val = (hp->val << 4) | c;
+                if (hp->val > 0xff) {
+                    pr2serr("%s: hex number larger than 0xff in line %d, "
+                            "pos %d\n", "sg_f2hex_arr", hp->line,
+                            (int)(hp->tok_start - hp->line_start + 1));
+                    return SG_LIB_SYNTAX_ERROR;
+                }
+                continue;
+            }
+        } else if (HEX_IN_BAD == c) {
+            pr2serr("%s: syntax error at line %d, pos %d\n", "sg_f2hex_arr",
+                    hp->line, (int)(hp->base + k - hp->line_start + 1));
+            return SG_LIB_SYNTAX_ERROR;
+        } else {
+            if (HEX_IN_EOL == c) {
+                hp->in_comment = false;
+                ++hp->line;
+                hp->line_start = hp->base + k + 1;
+            } else if (HEX_IN_CMT == c)
+                hp->in_comment = true;
+            if (hp->no_space || (0 == hp->ndig))
+                continue;
+        }
+        /* a complete byte */
+        if (hp->off >= hp->max_len) {
+            pr2serr("%s: array length exceeded\n", "sg_f2hex_arr");
+            return SG_LIB_SYNTAX_ERROR;
+        }
+        hp->arr[hp->off++] = (uint8_t)hp->val;
+        hp->val = 0;
+        hp->ndig = 0;
+    }
+    hp->base += len;
+    return 0;
+}
+
+int
+sg_f2hex_arr(const char * fname, bool as_binary, bool no_space,
+             uint8_t * mp_arr, int * mp_arr_len, int max_arr_len)
+{
+    bool has_stdin;
+    int fd, err, n;
+    int ret = 0;
+    int k = 0;
+    uint8_t * buf = NULL;
+    struct hex_in_t hex_in;
+    static const int hex_in_buf_sz = 64 * 1024;
+
+    if ((NULL == fname) || (NULL == mp_arr) || (NULL == mp_arr_len))
+        return SG_LIB_LOGIC_ERROR;
+    if ('\0' == fname[0])
+        return SG_LIB_SYNTAX_ERROR;
+    has_stdin = (0 == strcmp(fname, "-"));
+    if (has_stdin)
+        fd = STDIN_FILENO;
+    else {
+        fd = open(fname, O_RDONLY);
+        if (fd < 0) {
+            err = errno;
+            pr2serr("unable to open %s for reading: %s\n", fname,
+                    safe_strerror(err));
+            return sg_convert_errno(err);
+        }
+    }
+    if (as_binary) {
+        if (sg_set_binary_mode(fd) < 0)
+            perror("sg_set_binary_mode");
+        /* pipes and terminals may give short reads; keep reading till 0 */
+        while (k < max_arr_len) {
+            n = read(fd, mp_arr + k, max_arr_len - k);
+            if (0 == n)
+                break;
+            if (n < 0) {
+                if (EINTR == errno)
+                    continue;
+                err = errno;
+                pr2serr("read from binary file %s: %s\n", fname,
+                        safe_strerror(err));
+                ret = sg_convert_errno(err);
+                goto fini;
+            }
+            k += n;
+        }
+        if (0 == k) {
+            pr2serr("read 0 bytes from binary file %s\n", fname);
+            ret = SG_LIB_SYNTAX_ERROR;
+        }
+        *mp_arr_len = k;
+        goto fini;
+    }
+
+    memset(&hex_in, 0, sizeof(hex_in));
+    hex_in.no_space = no_space;
+    hex_in.line = 1;
+    hex_in.max_len = (max_arr_len > 0) ? max_arr_len : 0;
+    hex_in.arr = mp_arr;
+#ifndef SG_LIB_WIN32
+    if (! has_stdin) {
+        struct stat a_stat;
+
+        if ((0 == fstat(fd, &a_stat)) && S_ISREG(a_stat.st_mode) &&
+            (a_stat.st_size > 0) &&
+            ((uint64_t)a_stat.st_size <= (size_t)-1)) {
+            void * mp = mmap(NULL, a_stat.st_size, PROT_READ, MAP_PRIVATE,
+                             fd, 0);
+
+            if (MAP_FAILED != mp) {
+#ifdef MADV_SEQUENTIAL
+                madvise(mp, a_stat.st_size, MADV_SEQUENTIAL);
+#endif
+                ret = hex_in_parse(&hex_in, (const uint8_t *)mp,
+                                   a_stat.st_size);
+                munmap(mp, a_stat.st_size);
+                goto hex_done;
+            }
+        }
+    }
+#endif
+    buf = (uint8_t *)malloc(hex_in_buf_sz);
+    if (NULL == buf) {
+        ret = sg_convert_errno(ENOMEM);
+        goto fini;
+    }
+    while (true) {
+        n = read(fd, buf, hex_in_buf_sz);
+        if (0 == n)
+            break;
+        if (n < 0) {
+            if (EINTR == errno)
+                continue;
+            err = errno;
+            pr2serr("read from %s: %s\n", fname, safe_strerror(err));
+            ret = sg_convert_errno(err);
+            goto fini;
+        }
+        if ((ret = hex_in_parse(&hex_in, buf, n)))
+            break;
+    }
+#ifndef SG_LIB_WIN32
+hex_done:
+#endif
+    if ((0 == ret) && hex_in.no_space && hex_in.ndig) {
+        pr2serr("%s: odd number of hex digits\n", __func__);
+        ret = SG_LIB_SYNTAX_ERROR;
+    }
+    if ((0 == ret) && (! hex_in.no_space) && hex_in.ndig)
+        ret = hex_in_parse(&hex_in, (const uint8_t *)"\n", 1);
+    if (0 == ret)
+        *mp_arr_len = hex_in.off;
+fini:
+    free(buf);
+    if (! has_stdin)
+        close(fd);
+    return ret;
+}
+
 /* Returns true when executed on big endian machine; else returns false.
  * Useful for displaying ATA identify words (which need swapping on a
  * big endian machine). */
@@ -2900,16 +3534,155 @@ sg_is_big_endian()
                                     the most significant byte */
 }
 
+/* sg_all_zeros(), sg_all_ffs() and sg_first_non_zero() share a scanner
+ * that returns the offset of the first byte not equal to 'val' (or b_len
+ * if there is none). On x86 the SSE2, AVX2 or AVX-512 version is chosen
+ * on the first call by CPUID (via __builtin_cpu_supports()); elsewhere
+ * the buffer is scanned 8 bytes at a time. */
+typedef int (*scan_not_fn_t)(const uint8_t * bp, int b_len, uint8_t val);
+
+static int
+scan_not_generic(const uint8_t * bp, int b_len, uint8_t val)
+{
+    int k = 0;
+    uint64_t w;
+    const uint64_t pat = 0x0101010101010101ULL * val;
+
+    for ( ; (k + 8) <= b_len; k += 8) {
+        memcpy(&w, bp + k, sizeof(w));
+        if (pat != w)
+            break;
+    }
+    for ( ; k < b_len; ++k) {
+        if (val != bp[k])
+            break;
+    }
+    return k;
+}
+
+#ifdef SG_LIB_X86_SIMD
+
+__attribute__((target("sse2"))) static int
+scan_not_sse2(const uint8_t * bp, int b_len, uint8_t val)
+{
+    int k, m;
+    const __m128i pat = _mm_set1_epi8((char)val);
+
+    for (k = 0; (k + 16) <= b_len; k += 16) {
+        m = _mm_movemask_epi8(_mm_cmpeq_epi8(pat,
+                        _mm_loadu_si128((const __m128i *)(bp + k))));
+        if (0xffff != m)
+            return k + __builtin_ctz(~m);
+    }
+    return k + scan_not_generic(bp + k, b_len - k, val);
+}
+
+__attribute__((target("avx2"))) static int
+scan_not_avx2(const uint8_t * bp, int b_len, uint8_t val)
+{
+    int k;
+    uint32_t m;
+    __m256i a, b, c, d;
+    const __m256i pat = _mm256_set1_epi8((char)val);
+
+    /* 128 bytes per iteration, then locate within 32 byte lanes */
+    for (k = 0; (k + 128) <= b_len; k += 128) {
+        a = _mm256_cmpeq_epi8(pat,
+                        _mm256_loadu_si256((const __m256i *)(bp + k)));
+        b = _mm256_cmpeq_epi8(pat,
+                        _mm256_loadu_si256((const __m256i *)(bp + k + 32)));
+        c = _mm256_cmpeq_epi8(pat,
+                        _mm256_loadu_si256((const __m256i *)(bp + k + 64)));
+        d = _mm256_cmpeq_epi8(pat,
+                        _mm256_loadu_si256((const __m256i *)(bp + k + 96)));
+        a = _mm256_and_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, d));
+        if ((uint32_t)_mm256_movemask_epi8(a) != 0xffffffff)
+            break;
+    }
+    for ( ; (k + 32) <= b_len; k += 32) {
+        m = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(pat,
+                        _mm256_loadu_si256((const __m256i *)(bp + k))));
+        if (0xffffffff != m)
+            return k + __builtin_ctz(~m);
+    }
+    return k + scan_not_generic(bp + k, b_len - k, val);
+}
+
+__attribute__((target("avx512f"))) static int
+scan_not_avx512(const uint8_t * bp, int b_len, uint8_t val)
+{
+    int k;
+    __mmask8 m;
+    const __m512i pat = _mm512_set1_epi8((char)val);
+
+    /* 64 bit lane compares only need AVX-512F */
+    for (k = 0; (k + 256) <= b_len; k += 256) {
+        m = _mm512_cmpneq_epi64_mask(pat,
+                        _mm512_loadu_si512((const void *)(bp + k)));
+        m |= _mm512_cmpneq_epi64_mask(pat,
+                        _mm512_loadu_si512((const void *)(bp + k + 64)));
+        m |= _mm512_cmpneq_epi64_mask(pat,
+                        _mm512_loadu_si512((const void *)(bp + k + 128)));
+        m |= _mm512_cmpneq_epi64_mask(pat,
+                        _mm512_loadu_si512((const void *)(bp + k + 192)));
+        if (m)
+            break;
+    }
+    for ( ; (k + 64) <= b_len; k += 64) {
+        m = _mm512_cmpneq_epi64_mask(pat,
+                        _mm512_loadu_si512((const void *)(bp + k)));
+        if (m) {
+            k += 8 * __builtin_ctz(m);
+            return k + scan_not_generic(bp + k, 8, val);
+        }
+    }
+    return k + scan_not_generic(bp + k, b_len - k, val);
+}
+
+static int scan_not_resolve(const uint8_t * bp, int b_len, uint8_t val);
+
+static scan_not_fn_t scan_not_fn = scan_not_resolve;
+
+static int
+scan_not_resolve(const uint8_t * bp, int b_len, uint8_t val)
+{
+    scan_not_fn_t fn = scan_not_generic;
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        fn = scan_not_avx512;
+    else if (__builtin_cpu_supports("avx2"))
+        fn = scan_not_avx2;
+    else if (__builtin_cpu_supports("sse2"))
+        fn = scan_not_sse2;
+    __atomic_store_n(&scan_not_fn, fn, __ATOMIC_RELAXED);
+    return fn(bp, b_len, val);
+}
+
+static inline int
+scan_not(const uint8_t * bp, int b_len, uint8_t val)
+{
+    if (b_len < 32)
+        return scan_not_generic(bp, b_len, val);
+    return __atomic_load_n(&scan_not_fn, __ATOMIC_RELAXED)(bp, b_len, val);
+}
+
+#else
+
+static inline int
+scan_not(const uint8_t * bp, int b_len, uint8_t val)
+{
+    return scan_not_generic(bp, b_len, val);
+}
+
+#endif          /* SG_LIB_X86_SIMD */
+
 bool
 sg_all_zeros(const uint8_t * bp, int b_len)
 {
     if ((NULL == bp) || (b_len <= 0))
         return false;
-    for (--b_len; b_len >= 0; --b_len) {
-        if (0x0 != bp[b_len])
-            return false;
-    }
-    return true;
+    return (b_len == scan_not(bp, b_len, 0x0));
 }
 
 bool
@@ -2917,11 +3690,15 @@ sg_all_ffs(const uint8_t * bp, int b_len)
 {
     if ((NULL == bp) || (b_len <= 0))
         return false;
-    for (--b_len; b_len >= 0; --b_len) {
-        if (0xff != bp[b_len])
-            return false;
-    }
-    return true;
+    return (b_len == scan_not(bp, b_len, 0xff));
+}
+
+int
+sg_first_non_zero(const uint8_t * bp, int b_len)
+{
+    if ((NULL == bp) || (b_len < 0))
+        return -1;
+    return scan_not(bp, b_len, 0x0);
 }
 
 static uint16_t
@@ -2947,85 +3724,46 @@ swapb_uint16(uint16_t u)
 void
 dWordHex(const uint16_t* words, int num, int no_ascii, bool swapb)
 {
-    const uint16_t * p = words;
     uint16_t c;
-    char buff[82];
-    uint8_t upp, low;
-    int a = 0;
-    const int bpstart = 3;
+    char line[80];
+    const int bpstart = 8;
     const int cpstart = 52;
-    int cpos = cpstart;
-    int bpos = bpstart;
-    int i, k, blen;
+    int j, k, n;
+    char * cp;
+    struct hex_out_t ho;
 
     if (num <= 0)
         return;
-    blen = (int)sizeof(buff);
-    memset(buff, ' ', 80);
-    buff[80] = '\0';
-    if (no_ascii < 0) {
-        for (k = 0; k < num; k++) {
-            c = *p++;
+    ho.fp = stdout;
+    ho.len = 0;
+    for (k = 0; k < num; k += 8) {
+        n = ((num - k) < 8) ? (num - k) : 8;
+        memset(line, ' ', sizeof(line));
+        if (no_ascii >= 0)      /* start each line with address (offset) */
+            hex_addr_put(line, k);
+        for (j = 0; j < n; ++j) {
+            c = words[k + j];
             if (swapb)
                 c = swapb_uint16(c);
-            bpos += 5;
-            sg_scnpr(buff + bpos, blen - bpos, "%.4x", (my_uint)c);
-            buff[bpos + 4] = ' ';
-            if ((k > 0) && (0 == ((k + 1) % 8))) {
-                if (-2 == no_ascii)
-                    printf("%.39s\n", buff +8);
-                else
-                    printf("%.47s\n", buff);
-                bpos = bpstart;
-                memset(buff, ' ', 80);
+            cp = line + bpstart + (5 * j);
+            cp[0] = sg_hex_digits[(c >> 12) & 0xf];
+            cp[1] = sg_hex_digits[(c >> 8) & 0xf];
+            cp[2] = sg_hex_digits[(c >> 4) & 0xf];
+            cp[3] = sg_hex_digits[c & 0xf];
+            if (0 == no_ascii) {
+                cp = line + cpstart + (3 * j);
+                cp[0] = my_isprint((c >> 8) & 0xff) ? ((c >> 8) & 0xff) : '.';
+                cp[1] = my_isprint(c & 0xff) ? (c & 0xff) : '.';
             }
         }
-        if (bpos > bpstart) {
-            if (-2 == no_ascii)
-                printf("%.39s\n", buff +8);
-            else
-                printf("%.47s\n", buff);
-        }
-        return;
+        if (no_ascii >= 0)
+            hex_out_line(&ho, line, 76);
+        else if (-2 == no_ascii)
+            hex_out_line(&ho, line + 8, 39);
+        else
+            hex_out_line(&ho, line, 47);
     }
-    /* no_ascii>=0, start each line with address (offset) */
-    k = sg_scnpr(buff + 1, blen - 1, "%.2x", a);
-    buff[k + 1] = ' ';
-
-    for (i = 0; i < num; i++) {
-        c = *p++;
-        if (swapb)
-            c = swapb_uint16(c);
-        bpos += 5;
-        sg_scnpr(buff + bpos, blen - bpos, "%.4x", (my_uint)c);
-        buff[bpos + 4] = ' ';
-        if (no_ascii) {
-            buff[cpos++] = ' ';
-            buff[cpos++] = ' ';
-            buff[cpos++] = ' ';
-        } else {
-            upp = (c >> 8) & 0xff;
-            low = c & 0xff;
-            if (! my_isprint(upp))
-                upp = '.';
-            buff[cpos++] = upp;
-            if (! my_isprint(low))
-                low = '.';
-            buff[cpos++] = low;
-            buff[cpos++] = ' ';
-        }
-        if (cpos > (cpstart + 23)) {
-            printf("%.76s\n", buff);
-            bpos = bpstart;
-            cpos = cpstart;
-            a += 8;
-            memset(buff, ' ', 80);
-            k = sg_scnpr(buff + 1, blen - 1, "%.2x", a);
-            buff[k + 1] = ' ';
-        }
-    }
-    if (cpos > cpstart)
-        printf("%.76s\n", buff);
+    hex_out_flush(&ho);
 }
 
 /* If the number in 'buf' can be decoded or the multiplier is unknown
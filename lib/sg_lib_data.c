@@ -19,7 +19,7 @@
 #include "sg_lib_data.h"
 
 
-const char * sg_lib_version_str = "2.58 20180911";/* spc5r19, sbc4r15 */
+const char * sg_lib_version_str = "2.62 20261016";/* spc5r19, sbc4r15 */
 
 
 /* indexed by pdt; those that map to own index do not decay */
@@ -13,6 +13,8 @@
 #include <stdbool.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <time.h>
 #define __STDC_FORMAT_MACROS 1
 #include <inttypes.h>
 
@@ -21,7 +23,12 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_GETTIMEOFDAY
+#include <sys/time.h>
+#endif
+
 #include "sg_lib.h"
+#include "sg_lib_data.h"
 #include "sg_pt.h"
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
@@ -31,7 +38,7 @@
 #include "sg_pt_nvme.h"
 #endif
 
-static const char * scsi_pt_version_str = "3.09 20180712";
+static const char * scsi_pt_version_str = "3.12 20261015";
 
 
 const char *
@@ -46,6 +53,374 @@ sg_pt_version()
     return scsi_pt_version_str;
 }
 
+/*
+ * Pass-through statistics. When enabled (see scsi_pt_stats_enable() in
+ * sg_pt.h) each command is counted in a slot chosen by its device and its
+ * opcode (plus service action, if any). Each slot holds the result
+ * categories and a histogram of latencies in power of 2 microsecond
+ * buckets. Slots are claimed with compare-and-swap and the counters are
+ * bumped with atomic adds, so threads sharing a device need no lock.
+ */
+
+#define SG_PT_STATS_DEVS 32
+#define SG_PT_STATS_SLOTS 256
+#define SG_PT_STATS_BUCKETS 32  /* bucket k: latency < 2**k microseconds */
+#define SG_PT_STATS_NVME 0x80000000     /* key flag: NVMe command */
+#define SG_PT_STATS_USED 0x40000000     /* key flag: slot in use */
+#define SG_PT_STATS_NUM_CAT 6   /* SCSI_PT_RESULT_* (5) and pt error */
+
+/* The last device slot collects commands on devices once the others are
+ * taken. A slot is claimed by a compare-and-swap of fd_key from 0. */
+struct sg_pt_stats_dev {
+    int fd_key;         /* 0 for an empty slot, else dev_fd + 1 */
+    char name[64];
+};
+
+struct sg_pt_stats_ent {
+    uint32_t key;       /* 0 for empty, else flags|dev_idx<<20|op<<12|sa */
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+    uint64_t cat[SG_PT_STATS_NUM_CAT];
+    uint64_t hist[SG_PT_STATS_BUCKETS];
+};
+
+#ifdef __GNUC__
+#define SG_PT_STATS_ADD(p, v) __atomic_add_fetch((p), (v), __ATOMIC_RELAXED)
+#else
+#define SG_PT_STATS_ADD(p, v) (*(p) += (v))
+#endif
+
+static int pt_stats_state = -1;         /* -1: not checked, 0: off, 1: on */
+static bool pt_stats_atexit_done;
+static char pt_stats_fname[256];
+static struct sg_pt_stats_dev pt_stats_dev_arr[SG_PT_STATS_DEVS];
+static struct sg_pt_stats_ent pt_stats_arr[SG_PT_STATS_SLOTS];
+
+static void
+pt_stats_at_exit(void)
+{
+    if (pt_stats_state > 0)
+        scsi_pt_stats_dump(pt_stats_fname[0] ? pt_stats_fname : NULL);
+}
+
+int
+scsi_pt_stats_enable(bool enable, const char * file_name)
+{
+    if (! enable) {
+        pt_stats_state = 0;
+        return 0;
+    }
+    if (file_name) {
+        if (strlen(file_name) >= sizeof(pt_stats_fname))
+            return SG_LIB_SYNTAX_ERROR;
+        strcpy(pt_stats_fname, file_name);
+        if (! pt_stats_atexit_done) {
+            pt_stats_atexit_done = true;
+            if (atexit(pt_stats_at_exit))
+                return SG_LIB_CAT_OTHER;
+        }
+    }
+    pt_stats_state = 1;
+    return 0;
+}
+
+/* Called on each command so only checks the environment variable once */
+bool
+sg_pt_stats_on(void)
+{
+    const char * cp;
+
+    if (pt_stats_state < 0) {
+        cp = getenv("SG3_UTILS_PT_STATS");
+        if (cp)
+            scsi_pt_stats_enable(true, cp);
+        else
+            pt_stats_state = 0;
+    }
+    return pt_stats_state > 0;
+}
+
+/* Monotonic time in nanoseconds, for measuring latencies */
+uint64_t
+sg_pt_stats_clock_ns(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    if (0 == clock_gettime(CLOCK_MONOTONIC, &ts))
+        return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+#endif
+#ifdef HAVE_GETTIMEOFDAY
+    {
+        struct timeval tv;
+
+        if (0 == gettimeofday(&tv, NULL))
+            return ((uint64_t)tv.tv_sec * 1000000000) +
+                   ((uint64_t)tv.tv_usec * 1000);
+    }
+#endif
+    return 0;
+}
+
+/* Claims the first empty device slot for dev_fd and names it. Slots are
+ * never freed so later claims have higher indexes. If reuse is true and a
+ * slot for dev_fd is met first (claimed by another thread) it is returned
+ * instead. Returns the device's index. */
+static int
+pt_stats_add_dev(int dev_fd, const char * name, bool reuse)
+{
+    int k, cur;
+    int fd_key = dev_fd + 1;
+    struct sg_pt_stats_dev * dp;
+
+    for (k = 0, dp = pt_stats_dev_arr; k < SG_PT_STATS_DEVS - 1; ++k, ++dp) {
+#ifdef __GNUC__
+        cur = __atomic_load_n(&dp->fd_key, __ATOMIC_ACQUIRE);
+        if ((0 == cur) &&
+            __atomic_compare_exchange_n(&dp->fd_key, &cur, fd_key, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            break;
+#else
+        cur = dp->fd_key;
+        if (0 == cur) {
+            dp->fd_key = fd_key;
+            break;
+        }
+#endif
+        if (reuse && (fd_key == cur))
+            return k;
+    }
+    if (k >= SG_PT_STATS_DEVS - 1)
+        return SG_PT_STATS_DEVS - 1;    /* "(other devices)" */
+    snprintf(dp->name, sizeof(dp->name), "%s", name);
+    return k;
+}
+
+void
+sg_pt_stats_dev_name(int dev_fd, const char * name)
+{
+    if (sg_pt_stats_on() && (dev_fd >= 0))
+        pt_stats_add_dev(dev_fd, name, false);
+}
+
+/* Newest registration of dev_fd wins as file descriptors are re-used */
+static int
+pt_stats_dev_idx(int dev_fd)
+{
+    int k, cur;
+    int fd_key = dev_fd + 1;
+    char b[32];
+
+    for (k = SG_PT_STATS_DEVS - 2; k >= 0; --k) {
+#ifdef __GNUC__
+        cur = __atomic_load_n(&pt_stats_dev_arr[k].fd_key, __ATOMIC_ACQUIRE);
+#else
+        cur = pt_stats_dev_arr[k].fd_key;
+#endif
+        if (fd_key == cur)
+            return k;
+    }
+    snprintf(b, sizeof(b), "fd=%d", dev_fd);
+    return pt_stats_add_dev(dev_fd, b, true);
+}
+
+/* Service action of cmdp, or -1 if its opcode does not have one */
+static int
+pt_stats_sa(const uint8_t * cmdp)
+{
+    switch (cmdp[0]) {
+    case SG_VARIABLE_LENGTH_CMD:
+        return sg_get_unaligned_be16(cmdp + 8) & 0xfff;
+    case SG_MAINTENANCE_IN:
+    case SG_MAINTENANCE_OUT:
+    case SG_SERVICE_ACTION_IN_12:
+    case SG_SERVICE_ACTION_OUT_12:
+    case SG_SERVICE_ACTION_IN_16:
+    case SG_SERVICE_ACTION_OUT_16:
+    case SG_SERVICE_ACTION_BIDI:
+    case SG_PERSISTENT_RESERVE_IN:
+    case SG_PERSISTENT_RESERVE_OUT:
+    case SG_3PARTY_COPY_OUT:
+    case SG_3PARTY_COPY_IN:
+    case SG_READ_BUFFER:
+    case SG_READ_BUFFER_16:
+    case SG_WRITE_BUFFER:
+    case SG_SANITIZE:
+    case SG_ZONING_IN:
+    case SG_ZONING_OUT:
+        return cmdp[1] & 0x1f;
+    default:
+        return -1;
+    }
+}
+
+/* Records one completed command. res is what do_scsi_pt() (or the
+ * asynchronous equivalent) returned, category is from
+ * get_scsi_pt_result_category() and only used if res is 0. */
+void
+sg_pt_stats_record(int dev_fd, const uint8_t * cmdp, bool nvme_cmd, int res,
+                   int category, uint64_t elapsed_ns)
+{
+    int k, b, sa;
+    uint32_t key, h, cur;
+    uint64_t us = elapsed_ns / 1000;
+    struct sg_pt_stats_ent * ep;
+
+    if (NULL == cmdp)
+        return;
+    sa = nvme_cmd ? -1 : pt_stats_sa(cmdp);
+    key = SG_PT_STATS_USED | ((uint32_t)pt_stats_dev_idx(dev_fd) << 20) |
+          ((uint32_t)cmdp[0] << 12) | ((sa < 0) ? 0xfff : (uint32_t)sa);
+    if (nvme_cmd)
+        key |= SG_PT_STATS_NVME;
+    h = (key * 2654435761U) >> 24;      /* Fibonacci hash, 8 bits */
+    for (k = 0, ep = NULL; k < SG_PT_STATS_SLOTS; ++k) {
+        ep = pt_stats_arr + ((h + k) % SG_PT_STATS_SLOTS);
+#ifdef __GNUC__
+        cur = __atomic_load_n(&ep->key, __ATOMIC_ACQUIRE);
+        if ((0 == cur) &&
+            __atomic_compare_exchange_n(&ep->key, &cur, key, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            break;
+#else
+        cur = ep->key;
+        if (0 == cur) {
+            ep->key = key;
+            break;
+        }
+#endif
+        if (key == cur)
+            break;
+    }
+    if (k >= SG_PT_STATS_SLOTS)
+        return;         /* table full, drop */
+    for (b = 0; (b < SG_PT_STATS_BUCKETS - 1) && (us >= (1ULL << b)); ++b)
+        ;
+    if ((res) || (category < 0) || (category >= SG_PT_STATS_NUM_CAT - 1))
+        category = SG_PT_STATS_NUM_CAT - 1;
+    SG_PT_STATS_ADD(&ep->count, 1);
+    SG_PT_STATS_ADD(&ep->sum_us, us);
+    SG_PT_STATS_ADD(ep->cat + category, 1);
+    SG_PT_STATS_ADD(ep->hist + b, 1);
+    if (us > ep->max_us)        /* may lose a race, good enough */
+        ep->max_us = us;
+}
+
+static void
+pt_stats_json_str(FILE * fp, const char * cp)
+{
+    fputc('"', fp);
+    for ( ; *cp; ++cp) {
+        if (('"' == *cp) || ('\\' == *cp))
+            fprintf(fp, "\\%c", *cp);
+        else if ((unsigned char)*cp < 0x20)
+            fprintf(fp, "\\u%04x", (unsigned char)*cp);
+        else
+            fputc(*cp, fp);
+    }
+    fputc('"', fp);
+}
+
+static int
+pt_stats_key_cmp(const void * ap, const void * bp)
+{
+    uint32_t a = (*(const struct sg_pt_stats_ent * const *)ap)->key;
+    uint32_t b = (*(const struct sg_pt_stats_ent * const *)bp)->key;
+
+    return (a < b) ? -1 : ((a > b) ? 1 : 0);
+}
+
+int
+scsi_pt_stats_dump(const char * file_name)
+{
+    bool to_stderr = ((NULL == file_name) || ('\0' == file_name[0]) ||
+                      (0 == strcmp(file_name, "-")));
+    bool first_dev = true;
+    bool first;
+    int k, j, n, d, sa;
+    uint32_t key;
+    FILE * fp;
+    const struct sg_pt_stats_ent * ep;
+    const struct sg_pt_stats_ent * sorted[SG_PT_STATS_SLOTS];
+    static const char * cat_names[SG_PT_STATS_NUM_CAT] = {
+        "good", "status", "sense", "transport_err", "os_err", "pt_err"};
+    char b[80];
+
+    fp = to_stderr ? stderr : fopen(file_name, "w");
+    if (NULL == fp)
+        return -errno;
+    for (k = 0, n = 0; k < SG_PT_STATS_SLOTS; ++k) {
+        if (pt_stats_arr[k].key)
+            sorted[n++] = pt_stats_arr + k;
+    }
+    qsort(sorted, n, sizeof(sorted[0]), pt_stats_key_cmp);
+    fprintf(fp, "{\n  \"sg3_utils_pt_stats\": {\n    \"version\": \"%s\",\n"
+            "    \"devices\": [", scsi_pt_version_str);
+    for (d = 0; d < SG_PT_STATS_DEVS; ++d) {
+        first = true;
+        for (k = 0; k < n; ++k) {
+            ep = sorted[k];
+            key = ep->key;
+            if ((int)((key >> 20) & 0x3ff) != d)
+                continue;
+            if (first) {
+                fprintf(fp, "%s\n      {\n        \"device\": ",
+                        first_dev ? "" : ",");
+                pt_stats_json_str(fp, (d < SG_PT_STATS_DEVS - 1) ?
+                                  pt_stats_dev_arr[d].name :
+                                  "(other devices)");
+                fprintf(fp, ",\n        \"commands\": [");
+                first_dev = false;
+            }
+            sa = ((key & 0xfff) == 0xfff) ? -1 : (int)(key & 0xfff);
+            if (key & SG_PT_STATS_NVME)
+                snprintf(b, sizeof(b), "NVMe opcode=0x%x",
+                         (key >> 12) & 0xff);
+            else if (sa < 0)
+                sg_get_opcode_name((key >> 12) & 0xff, -1, sizeof(b), b);
+            else
+                sg_get_opcode_sa_name((key >> 12) & 0xff, sa, -1, sizeof(b),
+                                      b);
+            fprintf(fp, "%s\n          {\"name\": ", first ? "" : ",");
+            pt_stats_json_str(fp, b);
+            fprintf(fp, ", \"opcode\": %u", (key >> 12) & 0xff);
+            if (sa >= 0)
+                fprintf(fp, ", \"service_action\": %d", sa);
+            fprintf(fp, ", \"count\": %" PRIu64 ",\n           \"results\": "
+                    "{", ep->count);
+            for (j = 0; j < SG_PT_STATS_NUM_CAT; ++j)
+                fprintf(fp, "%s\"%s\": %" PRIu64, j ? ", " : "",
+                        cat_names[j], ep->cat[j]);
+            fprintf(fp, "},\n           \"total_us\": %" PRIu64 ", "
+                    "\"max_us\": %" PRIu64 ",\n           \"latency_us\": "
+                    "[", ep->sum_us, ep->max_us);
+            for (j = 0, first = true; j < SG_PT_STATS_BUCKETS; ++j) {
+                if (0 == ep->hist[j])
+                    continue;
+                if (j < SG_PT_STATS_BUCKETS - 1)
+                    fprintf(fp, "%s{\"lt\": %" PRIu64 ", \"count\": %" PRIu64
+                            "}", first ? "" : ", ", (uint64_t)1 << j,
+                            ep->hist[j]);
+                else
+                    fprintf(fp, "%s{\"ge\": %" PRIu64 ", \"count\": %" PRIu64
+                            "}", first ? "" : ", ", (uint64_t)1 << (j - 1),
+                            ep->hist[j]);
+                first = false;
+            }
+            fprintf(fp, "]}");
+        }
+        if (! first)
+            fprintf(fp, "\n        ]\n      }");
+    }
+    fprintf(fp, "\n    ]\n  }\n}\n");
+    if (to_stderr)
+        fflush(fp);
+    else if (fclose(fp))
+        return -errno;
+    return 0;
+}
+
 
 #if (HAVE_NVME && (! IGNORE_NVME))
 /* ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^ */
@@ -63,7 +438,9 @@ static const char * nvme_scsi_vendor_str = "NVMe    ";
 #define FF_SA (F_SA_HIGH | F_SA_LOW)
 #define F_INV_OP                0x200
 
-/* Table of SCSI operation code (opcodes) supported by SNTL */
+/* Table of SCSI operation code (opcodes) supported by SNTL. The rows under
+ * SG_LIB_LINUX are only translated by the Linux SNTL (sg_pt_linux_nvme.c);
+ * the FreeBSD and Win32 SNTLs must not advertise them. */
 struct sg_opcode_info_t sg_opcode_info_arr[] =
 {
     {0x0, 0, 0, {6,              /* TEST UNIT READY */
@@ -76,10 +453,50 @@ struct sg_opcode_info_t sg_opcode_info_arr[] =
       0x1, 0xff, 0xff, 0xff, 0xc7, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0} },
     {0x1d, 0, 0, {6,            /* SEND DIAGNOSTIC */
       0xf7, 0x0, 0xff, 0xff, 0xc7, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0} },
+#ifdef SG_LIB_LINUX
+    {0x25, 0, 0, {10,           /* READ CAPACITY(10) */
+      0x1, 0xff, 0xff, 0xff, 0xff, 0, 0, 0x1, 0xc7, 0, 0, 0, 0, 0, 0} },
+    {0x28, 0, 0, {10,           /* READ(10) */
+      0xe8, 0xff, 0xff, 0xff, 0xff, 0x0, 0xff, 0xff, 0xc7, 0, 0, 0, 0, 0,
+      0} },
+    {0x2a, 0, 0, {10,           /* WRITE(10) */
+      0xe8, 0xff, 0xff, 0xff, 0xff, 0x0, 0xff, 0xff, 0xc7, 0, 0, 0, 0, 0,
+      0} },
+    {0x2f, 0, 0, {10,           /* VERIFY(10) */
+      0xe6, 0xff, 0xff, 0xff, 0xff, 0x0, 0xff, 0xff, 0xc7, 0, 0, 0, 0, 0,
+      0} },
+    {0x35, 0, 0, {10,           /* SYNCHRONIZE CACHE(10) */
+      0x2, 0xff, 0xff, 0xff, 0xff, 0x0, 0xff, 0xff, 0xc7, 0, 0, 0, 0, 0,
+      0} },
+    {0x41, 0, 0, {10,           /* WRITE SAME(10) */
+      0xf8, 0xff, 0xff, 0xff, 0xff, 0x0, 0xff, 0xff, 0xc7, 0, 0, 0, 0, 0,
+      0} },
+    {0x42, 0, 0, {10,           /* UNMAP */
+      0x1, 0, 0, 0, 0, 0x0, 0xff, 0xff, 0xc7, 0, 0, 0, 0, 0, 0} },
+#endif
     {0x55, 0, 0, {10,           /* MODE SELECT(10) */
       0x13, 0x0, 0x0, 0x0, 0x0, 0x0, 0xff, 0xff, 0xc7, 0, 0, 0, 0, 0, 0} },
     {0x5a, 0, 0, {10,           /* MODE SENSE(10) */
       0x18, 0xff, 0xff, 0x0, 0x0, 0x0, 0xff, 0xff, 0xc7, 0, 0, 0, 0, 0, 0} },
+#ifdef SG_LIB_LINUX
+    {0x88, 0, 0, {16,           /* READ(16) */
+      0xe8, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0x0, 0xc7} },
+    {0x8a, 0, 0, {16,           /* WRITE(16) */
+      0xe8, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0x0, 0xc7} },
+    {0x8f, 0, 0, {16,           /* VERIFY(16) */
+      0xe6, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0x0, 0xc7} },
+    {0x91, 0, 0, {16,           /* SYNCHRONIZE CACHE(16) */
+      0x2, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0x0, 0xc7} },
+    {0x93, 0, 0, {16,           /* WRITE SAME(16) */
+      0xf9, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0x0, 0xc7} },
+    {0x9e, 0x10, F_SA_LOW, {16, /* READ CAPACITY(16) */
+      0x10, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 0xff, 0xff, 0x0, 0xc7} },
+#endif
     {0xa0, 0, 0, {12,           /* REPORT LUNS */
       0xe3, 0xff, 0, 0, 0, 0xff, 0xff, 0xff, 0xff, 0, 0xc7, 0, 0, 0, 0} },
     {0xa3, 0xc, F_SA_LOW, {12,  /* REPORT SUPPORTED OPERATION CODES */
@@ -361,10 +361,6 @@ check_pt_file_handle(int device_han, const char * device_name, int vb)
     }
 }
 
-#if (HAVE_NVME && (! IGNORE_NVME))
-static bool checked_ev_dsense = false;
-static bool ev_dsense = false;
-#endif
 
 struct sg_pt_base *
 construct_scsi_pt_obj_with_fd(int dev_han, int vb)
@@ -386,11 +382,7 @@ construct_scsi_pt_obj_with_fd(int dev_han, int vb)
                 ptp->dev_statp = &fdc_p->dev_stat;
 #if (HAVE_NVME && (! IGNORE_NVME))
                 sntl_init_dev_stat(ptp->dev_statp);
-                if (! checked_ev_dsense) {
-                    ev_dsense = sg_get_initial_dsense();
-                    checked_ev_dsense = true;
-                }
-                fdc_p->dev_stat.scsi_dsense = ev_dsense;
+                fdc_p->dev_stat.scsi_dsense = sg_get_initial_dsense();
 #endif
             } else if (vb)
                 pr2ws("%s: bad dev_han=%d\n", __func__, dev_han);
@@ -566,6 +558,29 @@ set_scsi_pt_data_out(struct sg_pt_base * vp, const uint8_t * dxferp,
     }
 }
 
+/* Only a scatter gather list with one element is supported */
+void
+set_scsi_pt_data_in_iov(struct sg_pt_base * vp,
+                        const struct sg_pt_iovec * iovp, int iov_count)
+{
+    if (iov_count > 1)
+        ++vp->impl.in_err;
+    else if (1 == iov_count)
+        set_scsi_pt_data_in(vp, (uint8_t *)iovp->iov_base,
+                            (int)iovp->iov_len);
+}
+
+void
+set_scsi_pt_data_out_iov(struct sg_pt_base * vp,
+                         const struct sg_pt_iovec * iovp, int iov_count)
+{
+    if (iov_count > 1)
+        ++vp->impl.in_err;
+    else if (1 == iov_count)
+        set_scsi_pt_data_out(vp, (const uint8_t *)iovp->iov_base,
+                             (int)iovp->iov_len);
+}
+
 void
 set_pt_metadata_xfer(struct sg_pt_base * vp, uint8_t * mdxferp,
                      uint32_t mdxfer_len, bool out_true)
@@ -930,6 +945,63 @@ get_pt_nvme_nsid(const struct sg_pt_base * vp)
     return 0;
 }
 
+/* No asynchronous pass-through interface on this OS */
+int
+do_pt_submit(struct sg_pt_base * vp __attribute__ ((unused)),
+             int fd __attribute__ ((unused)),
+             int time_secs __attribute__ ((unused)),
+             int verbose __attribute__ ((unused)))
+{
+    return SCSI_PT_DO_NOT_SUPPORTED;
+}
+
+int
+do_pt_receive(int dev_fd __attribute__ ((unused)),
+              int pack_id __attribute__ ((unused)),
+              struct sg_pt_base ** objpp, int verbose __attribute__ ((unused)))
+{
+    if (objpp)
+        *objpp = NULL;
+    return SCSI_PT_DO_NOT_SUPPORTED;
+}
+
+int
+scsi_pt_async_match(int dev_fd __attribute__ ((unused)),
+                    bool by_pack_id __attribute__ ((unused)),
+                    int verbose __attribute__ ((unused)))
+{
+    return SCSI_PT_DO_NOT_SUPPORTED;
+}
+
+int
+do_pt_submit_batch(struct sg_pt_base ** objp_arr __attribute__ ((unused)),
+                   int num_objs __attribute__ ((unused)),
+                   int fd __attribute__ ((unused)),
+                   int time_secs __attribute__ ((unused)), int * num_sentp,
+                   int verbose __attribute__ ((unused)))
+{
+    if (num_sentp)
+        *num_sentp = 0;
+    return SCSI_PT_DO_NOT_SUPPORTED;
+}
+
+int
+do_pt_receive_batch(int dev_fd __attribute__ ((unused)),
+                    struct sg_pt_base ** objp_arr __attribute__ ((unused)),
+                    int max_objs __attribute__ ((unused)), int * num_recvp,
+                    int verbose __attribute__ ((unused)))
+{
+    if (num_recvp)
+        *num_recvp = 0;
+    return SCSI_PT_DO_NOT_SUPPORTED;
+}
+
+int
+scsi_pt_nvme_uring(int q_depth, int verbose __attribute__ ((unused)))
+{
+    return (q_depth > 0) ? SCSI_PT_DO_NOT_SUPPORTED : 0;
+}
+
 char *
 get_scsi_pt_os_err_str(const struct sg_pt_base * vp, int max_b_len, char * b)
 {
@@ -7,7 +7,7 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
-/* sg_pt_linux version 1.44 20181212 */
+/* sg_pt_linux version 1.45 20261015 */
 
 
 #include <stdio.h>
@@ -108,6 +108,7 @@ static const char * linux_driver_suggests[] = {
 bool sg_bsg_nvme_char_major_checked = false;
 int sg_bsg_major = 0;
 volatile int sg_nvme_char_major = 0;
+volatile int sg_nvme_gen_char_major = 0;
 
 long sg_lin_page_size = 4096;   /* default, overridden with correct value */
 
@@ -118,8 +119,8 @@ long sg_lin_page_size = 4096;   /* default, overridden with correct value */
 void
 sg_find_bsg_nvme_char_major(int verbose)
 {
-    bool got_one = false;
     int n;
+    int num_found = 0;
     const char * proc_devices = "/proc/devices";
     char * cp;
     FILE *fp;
@@ -141,14 +142,16 @@ sg_find_bsg_nvme_char_major(int verbose)
         if (2 == sscanf(b, "%d %126s", &n, a)) {
             if (0 == strcmp("bsg", a)) {
                 sg_bsg_major = n;
-                if (got_one)
+                if (++num_found > 2)
                     break;
-                got_one = true;
             } else if (0 == strcmp("nvme", a)) {
                 sg_nvme_char_major = n;
-                if (got_one)
+                if (++num_found > 2)
+                    break;
+            } else if (0 == strcmp("nvme-generic", a)) {
+                sg_nvme_gen_char_major = n;
+                if (++num_found > 2)
                     break;
-                got_one = true;
             }
         } else
             break;
@@ -159,6 +162,9 @@ sg_find_bsg_nvme_char_major(int verbose)
                 pr2ws("found sg_bsg_major=%d\n", sg_bsg_major);
             if (sg_nvme_char_major > 0)
                 pr2ws("found sg_nvme_char_major=%d\n", sg_nvme_char_major);
+            if (sg_nvme_gen_char_major > 0)
+                pr2ws("found sg_nvme_gen_char_major=%d\n",
+                      sg_nvme_gen_char_major);
         } else
             pr2ws("found no bsg not nvme char device in %s\n", proc_devices);
     }
@@ -168,7 +174,8 @@ sg_find_bsg_nvme_char_major(int verbose)
 /* Assumes that sg_find_bsg_nvme_char_major() has already been called. Returns
  * true if dev_fd is a scsi generic pass-through device. If yields
  * *is_nvme_p = true with *nsid_p = 0 then dev_fd is a NVMe char device.
- * If yields *nsid_p > 0 then dev_fd is a NVMe block device. */
+ * If yields *nsid_p > 0 then dev_fd is a NVMe block device or a NVMe
+ * generic char device (e.g. /dev/ng0n1). */
 static bool
 check_file_type(int dev_fd, struct stat * dev_statp, bool * is_bsg_p,
                 bool * is_nvme_p, uint32_t * nsid_p, int * os_err_p,
@@ -198,6 +205,18 @@ check_file_type(int dev_fd, struct stat * dev_statp, bool * is_bsg_p,
                 is_bsg = true;
             else if (sg_nvme_char_major == major_num)
                 is_nvme = true;
+            else if ((sg_nvme_gen_char_major > 0) &&
+                     (sg_nvme_gen_char_major == major_num)) {
+                is_nvme = true;         /* generic char device has a NSID */
+                nsid = ioctl(dev_fd, NVME_IOCTL_ID, NULL);
+                if (SG_NVME_BROADCAST_NSID == nsid) {
+                    os_err = errno;
+                    if (verbose)
+                        pr2ws("%s: ioctl(NVME_IOCTL_ID) failed: %s "
+                              "(errno=%d)\n", __func__, safe_strerror(os_err),
+                              os_err);
+                }
+            }
         } else if (S_ISBLK(dev_statp->st_mode)) {
             is_block = true;
             if (BLOCK_EXT_MAJOR == major_num) {
@@ -227,6 +246,9 @@ skip_out:
             pr2ws("bsg device\n");
         else if (is_nvme && (0 == nsid))
             pr2ws("NVMe char device\n");
+        else if (is_nvme && (! is_block))
+            pr2ws("NVMe generic char device, nsid=%lld\n",
+                  ((uint32_t)-1 == nsid) ? -1LL : (long long)nsid);
         else if (is_nvme)
             pr2ws("NVMe block device, nsid=%lld\n",
                   ((uint32_t)-1 == nsid) ? -1LL : (long long)nsid);
@@ -246,6 +268,161 @@ skip_out:
     return is_sg;
 }
 
+/* What probing a device file descriptor found. Kept in a small process
+ * wide cache, one entry per slot with the slot chosen by the file
+ * descriptor, so binding another pt object to the same dev_fd (e.g. by the
+ * sg_ll_* functions) only costs a fstat(). The st_rdev and st_ino from that
+ * fstat() must match, so a file descriptor closed without calling
+ * scsi_pt_close_device() and then re-used for another device is probed
+ * again. A slot is skipped rather than waited on if another thread is
+ * using it. */
+struct probe_cache_ent {
+    bool valid;
+    bool is_sg;
+    bool is_bsg;
+    bool is_nvme;
+    int dev_fd;
+    int sg_version;
+    uint32_t nvme_nsid;
+    dev_t st_dev;
+    dev_t st_rdev;
+    ino_t st_ino;
+};
+
+#ifdef __GNUC__
+#define PROBE_CACHE_SLOTS 16
+
+static struct probe_cache_ent probe_cache_arr[PROBE_CACHE_SLOTS];
+static bool probe_cache_busy[PROBE_CACHE_SLOTS];
+
+/* Returns true if *pcep has been filled from a matching cache entry */
+static bool
+probe_cache_get(int dev_fd, const struct stat * statp,
+                struct probe_cache_ent * pcep)
+{
+    bool found = false;
+    int k = dev_fd % PROBE_CACHE_SLOTS;
+    const struct probe_cache_ent * ep = probe_cache_arr + k;
+
+    if (__atomic_test_and_set(probe_cache_busy + k, __ATOMIC_ACQUIRE))
+        return false;
+    if (ep->valid && (dev_fd == ep->dev_fd) &&
+        (statp->st_dev == ep->st_dev) && (statp->st_rdev == ep->st_rdev) &&
+        (statp->st_ino == ep->st_ino)) {
+        *pcep = *ep;
+        found = true;
+    }
+    __atomic_clear(probe_cache_busy + k, __ATOMIC_RELEASE);
+    return found;
+}
+
+static void
+probe_cache_put(const struct probe_cache_ent * pcep)
+{
+    int k = pcep->dev_fd % PROBE_CACHE_SLOTS;
+
+    if (__atomic_test_and_set(probe_cache_busy + k, __ATOMIC_ACQUIRE))
+        return;
+    probe_cache_arr[k] = *pcep;
+    probe_cache_arr[k].valid = true;
+    __atomic_clear(probe_cache_busy + k, __ATOMIC_RELEASE);
+}
+
+static void
+probe_cache_invalidate(int dev_fd)
+{
+    int k;
+
+    if (dev_fd < 0)
+        return;
+    k = dev_fd % PROBE_CACHE_SLOTS;
+    /* wait here, an entry for a closed dev_fd must not survive */
+    while (__atomic_test_and_set(probe_cache_busy + k, __ATOMIC_ACQUIRE))
+        ;
+    if (dev_fd == probe_cache_arr[k].dev_fd)
+        probe_cache_arr[k].valid = false;
+    __atomic_clear(probe_cache_busy + k, __ATOMIC_RELEASE);
+}
+
+#else
+
+static bool
+probe_cache_get(int dev_fd, const struct stat * statp,
+                struct probe_cache_ent * pcep)
+{
+    if (dev_fd || statp || pcep) { ; }  /* suppress warning */
+    return false;
+}
+
+static void
+probe_cache_put(const struct probe_cache_ent * pcep)
+{
+    if (pcep) { ; }     /* suppress warning */
+}
+
+static void
+probe_cache_invalidate(int dev_fd)
+{
+    if (dev_fd) { ; }   /* suppress warning */
+}
+
+#endif
+
+/* Finds out what sort of device dev_fd is, from the cache if possible,
+ * placing the result in *pcep and the fstat() output in *statp (zeroed if
+ * fstat() fails). Assumes sg_find_bsg_nvme_char_major() has already been
+ * called. Returns 0 if okay, else an errno value. */
+static int
+probe_file_handle(int dev_fd, struct probe_cache_ent * pcep,
+                  struct stat * statp, int verbose)
+{
+    int os_err;
+
+    memset(pcep, 0, sizeof(*pcep));
+    memset(statp, 0, sizeof(*statp));
+    if ((dev_fd >= 0) && (0 == fstat(dev_fd, statp)) &&
+        probe_cache_get(dev_fd, statp, pcep)) {
+        if (verbose > 4)
+            pr2ws("%s: dev_fd=%d found in cache\n", __func__, dev_fd);
+        return 0;
+    }
+    pcep->is_sg = check_file_type(dev_fd, statp, &pcep->is_bsg,
+                                  &pcep->is_nvme, &pcep->nvme_nsid, &os_err,
+                                  verbose);
+    if (pcep->is_sg) {
+        if (ioctl(dev_fd, SG_GET_VERSION_NUM, &pcep->sg_version) < 0) {
+            pcep->sg_version = 0;
+            if (verbose > 3)
+                pr2ws("%s: ioctl(SG_GET_VERSION_NUM) failed: errno: %d "
+                      "[%s]\n", __func__, errno, safe_strerror(errno));
+        }
+        if (verbose > 4) {
+            int ver = pcep->sg_version;
+
+            if (pcep->sg_version >= SG_LINUX_SG_VER_V4) {
+#ifdef IGNORE_LINUX_SGV4
+                pr2ws("%s: sg driver version %d.%02d.%02d but config "
+                      "override back to v3\n", __func__, ver / 10000,
+                      (ver / 100) % 100, ver % 100);
+#else
+                pr2ws("%s: sg driver version %d.%02d.%02d so choose v4\n",
+                      __func__, ver / 10000, (ver / 100) % 100, ver % 100);
+#endif
+            } else if (verbose > 5)
+                pr2ws("%s: sg driver version %d.%02d.%02d so choose v3\n",
+                      __func__, ver / 10000, (ver / 100) % 100, ver % 100);
+        }
+    }
+    if (0 == os_err) {
+        pcep->dev_fd = dev_fd;
+        pcep->st_dev = statp->st_dev;
+        pcep->st_rdev = statp->st_rdev;
+        pcep->st_ino = statp->st_ino;
+        probe_cache_put(pcep);
+    }
+    return os_err;
+}
+
 /* Assumes dev_fd is an "open" file handle associated with device_name. If
  * the implementation (possibly for one OS) cannot determine from dev_fd if
  * a SCSI or NVMe pass-through is referenced, then it might guess based on
@@ -336,13 +513,21 @@ scsi_pt_open_flags(const char * device_name, int flags, int verbose)
     if (verbose > 1) {
         pr2ws("open %s with flags=0x%x\n", device_name, flags);
     }
-    fd = open(device_name, flags);
-    if (fd < 0) {
-        fd = -errno;
-        if (verbose > 1)
-            pr2ws("%s: open(%s, 0x%x) failed: %s\n", __func__, device_name,
-                  flags, safe_strerror(-fd));
+    if (0 == strncmp(device_name, SG_MEM_DEV_PREFIX,
+                     sizeof(SG_MEM_DEV_PREFIX) - 1))
+        fd = sg_mem_open(device_name + sizeof(SG_MEM_DEV_PREFIX) - 1, flags,
+                         verbose);
+    else {
+        fd = open(device_name, flags);
+        if (fd < 0) {
+            fd = -errno;
+            if (verbose > 1)
+                pr2ws("%s: open(%s, 0x%x) failed: %s\n", __func__,
+                      device_name, flags, safe_strerror(-fd));
+        }
     }
+    if (fd >= 0)
+        sg_pt_stats_dev_name(fd, device_name);
     return fd;
 }
 
@@ -362,17 +547,15 @@ scsi_pt_close_device(int device_fd)
 {
     int res;
 
+    probe_cache_invalidate(device_fd);
+    sg_nvme_async_release(device_fd);
+    sg_mem_close(device_fd);
     res = close(device_fd);
     if (res < 0)
         res = -errno;
     return res;
 }
 
-#if (HAVE_NVME && (! IGNORE_NVME))
-static bool checked_ev_dsense = false;
-static bool ev_dsense = false;
-#endif
-
 
 /* Caller should additionally call get_scsi_pt_os_err() after this call */
 struct sg_pt_base *
@@ -386,11 +569,7 @@ construct_scsi_pt_obj_with_fd(int dev_fd, int verbose)
     if (ptp) {
 #if (HAVE_NVME && (! IGNORE_NVME))
         sntl_init_dev_stat(&ptp->dev_stat);
-        if (! checked_ev_dsense) {
-            ev_dsense = sg_get_initial_dsense();
-            checked_ev_dsense = true;
-        }
-        ptp->dev_stat.scsi_dsense = ev_dsense;
+        ptp->dev_stat.scsi_dsense = sg_get_initial_dsense();
 #endif
         err = set_pt_file_handle((struct sg_pt_base *)ptp, dev_fd, verbose);
         if ((0 == err) && (! ptp->is_nvme)) {
@@ -428,18 +607,30 @@ destruct_scsi_pt_obj(struct sg_pt_base * vp)
             ptp->free_nvme_id_ctlp = NULL;
             ptp->nvme_id_ctlp = NULL;
         }
+        if (ptp->free_nvme_id_nsp) {
+            free(ptp->free_nvme_id_nsp);
+            ptp->free_nvme_id_nsp = NULL;
+            ptp->nvme_id_nsp = NULL;
+        }
         if (ptp)
             free(ptp);
     }
 }
 
-/* Remembers previous device file descriptor */
+/* Remembers previous device file descriptor and what was found out about
+ * that device (including the cached NVMe controller and namespace IDENTIFY
+ * responses) */
 void
 clear_scsi_pt_obj(struct sg_pt_base * vp)
 {
-    bool is_sg, is_bsg, is_nvme;
-    int fd;
+    bool is_sg, is_bsg, is_nvme, is_mem;
+    int fd, sg_version;
     uint32_t nvme_nsid;
+    uint64_t dev_rdev, dev_ino;
+    uint8_t * nvme_id_ctlp;
+    uint8_t * free_nvme_id_ctlp;
+    uint8_t * nvme_id_nsp;
+    uint8_t * free_nvme_id_nsp;
     struct sg_sntl_dev_state_t dev_stat;
     struct sg_pt_linux_scsi * ptp = &vp->impl;
 
@@ -448,10 +639,16 @@ clear_scsi_pt_obj(struct sg_pt_base * vp)
         is_sg = ptp->is_sg;
         is_bsg = ptp->is_bsg;
         is_nvme = ptp->is_nvme;
+        is_mem = ptp->is_mem;
+        sg_version = ptp->sg_version;
         nvme_nsid = ptp->nvme_nsid;
+        dev_rdev = ptp->dev_rdev;
+        dev_ino = ptp->dev_ino;
+        nvme_id_ctlp = ptp->nvme_id_ctlp;
+        free_nvme_id_ctlp = ptp->free_nvme_id_ctlp;
+        nvme_id_nsp = ptp->nvme_id_nsp;
+        free_nvme_id_nsp = ptp->free_nvme_id_nsp;
         dev_stat = ptp->dev_stat;
-        if (ptp->free_nvme_id_ctlp)
-            free(ptp->free_nvme_id_ctlp);
         memset(ptp, 0, sizeof(struct sg_pt_linux_scsi));
         ptp->io_hdr.guard = 'Q';
 #ifdef BSG_PROTOCOL_SCSI
@@ -464,8 +661,16 @@ clear_scsi_pt_obj(struct sg_pt_base * vp)
         ptp->is_sg = is_sg;
         ptp->is_bsg = is_bsg;
         ptp->is_nvme = is_nvme;
+        ptp->is_mem = is_mem;
         ptp->nvme_direct = false;
+        ptp->sg_version = sg_version;
         ptp->nvme_nsid = nvme_nsid;
+        ptp->dev_rdev = dev_rdev;
+        ptp->dev_ino = dev_ino;
+        ptp->nvme_id_ctlp = nvme_id_ctlp;
+        ptp->free_nvme_id_ctlp = free_nvme_id_ctlp;
+        ptp->nvme_id_nsp = nvme_id_nsp;
+        ptp->free_nvme_id_nsp = free_nvme_id_nsp;
         ptp->dev_stat = dev_stat;
     }
 }
@@ -478,6 +683,7 @@ int
 set_pt_file_handle(struct sg_pt_base * vp, int dev_fd, int verbose)
 {
     struct sg_pt_linux_scsi * ptp = &vp->impl;
+    struct probe_cache_ent pce;
     struct stat a_stat;
 
     if (! sg_bsg_nvme_char_major_checked) {
@@ -486,43 +692,39 @@ set_pt_file_handle(struct sg_pt_base * vp, int dev_fd, int verbose)
     }
     ptp->dev_fd = dev_fd;
     if (dev_fd >= 0) {
-        ptp->is_sg = check_file_type(dev_fd, &a_stat, &ptp->is_bsg,
-                                     &ptp->is_nvme, &ptp->nvme_nsid,
-                                     &ptp->os_err, verbose);
-        if (ptp->is_sg) {
-            if (ioctl(dev_fd, SG_GET_VERSION_NUM, &ptp->sg_version) < 0) {
-                ptp->sg_version = 0;
-                if (verbose > 3)
-                    pr2ws("%s: ioctl(SG_GET_VERSION_NUM) failed: errno: %d "
-                          "[%s]\n", __func__, errno, safe_strerror(errno));
-            }
-            if (verbose > 4) {
-                int ver = ptp->sg_version;
-
-                if (ptp->sg_version >= SG_LINUX_SG_VER_V4) {
-#ifdef IGNORE_LINUX_SGV4
-                    pr2ws("%s: sg driver version %d.%02d.%02d but config "
-                          "override back to v3\n", __func__, ver / 10000,
-                          (ver / 100) % 100, ver % 100);
-#else
-                    pr2ws("%s: sg driver version %d.%02d.%02d so choose v4\n",
-                          __func__, ver / 10000, (ver / 100) % 100,
-                          ver % 100);
-#endif
-                } else if (verbose > 5)
-                    pr2ws("%s: sg driver version %d.%02d.%02d so choose v3\n",
-                          __func__, ver / 10000, (ver / 100) % 100,
-                          ver % 100);
-            }
-        }
+        ptp->os_err = probe_file_handle(dev_fd, &pce, &a_stat, verbose);
+        ptp->is_sg = pce.is_sg;
+        ptp->is_bsg = pce.is_bsg;
+        ptp->is_nvme = pce.is_nvme;
+        ptp->nvme_nsid = pce.nvme_nsid;
+        ptp->sg_version = pce.sg_version;
+        ptp->is_mem = S_ISREG(a_stat.st_mode) && sg_mem_is_mem(dev_fd);
     } else {
+        memset(&a_stat, 0, sizeof(a_stat));
         ptp->is_sg = false;
         ptp->is_bsg = false;
         ptp->is_nvme = false;
+        ptp->is_mem = false;
         ptp->nvme_direct = false;
         ptp->nvme_nsid = 0;
         ptp->os_err = 0;
     }
+    /* Cached NVMe IDENTIFY responses are only valid for the same device */
+    if (((uint64_t)a_stat.st_rdev != ptp->dev_rdev) ||
+        ((uint64_t)a_stat.st_ino != ptp->dev_ino)) {
+        if (ptp->free_nvme_id_ctlp) {
+            free(ptp->free_nvme_id_ctlp);
+            ptp->free_nvme_id_ctlp = NULL;
+            ptp->nvme_id_ctlp = NULL;
+        }
+        if (ptp->free_nvme_id_nsp) {
+            free(ptp->free_nvme_id_nsp);
+            ptp->free_nvme_id_nsp = NULL;
+            ptp->nvme_id_nsp = NULL;
+        }
+        ptp->dev_rdev = (uint64_t)a_stat.st_rdev;
+        ptp->dev_ino = (uint64_t)a_stat.st_ino;
+    }
     return ptp->os_err;
 }
 
@@ -599,6 +801,68 @@ set_scsi_pt_data_out(struct sg_pt_base * vp, const uint8_t * dxferp,
     }
 }
 
+/* Returns the sum of the lengths in the scatter gather list, or UINT64_MAX
+ * if any is too large for the v4 header */
+static uint64_t
+pt_iov_sum(const struct sg_pt_iovec * iovp, int iov_count)
+{
+    int k;
+    uint64_t sum = 0;
+
+    for (k = 0; k < iov_count; ++k) {
+        if (iovp[k].iov_len > UINT32_MAX)
+            return UINT64_MAX;
+        sum += iovp[k].iov_len;
+    }
+    return sum;
+}
+
+/* Setup for data transfer from device into a scatter gather list. Like the
+ * sg driver, din_xferp then points to the list and din_xfer_len is the
+ * total length */
+void
+set_scsi_pt_data_in_iov(struct sg_pt_base * vp,
+                        const struct sg_pt_iovec * iovp, int iov_count)
+{
+    uint64_t sum;
+    struct sg_pt_linux_scsi * ptp = &vp->impl;
+
+    if (ptp->io_hdr.din_xferp)
+        ++ptp->in_err;
+    if (iov_count > 0) {
+        sum = pt_iov_sum(iovp, iov_count);
+        if (sum > UINT32_MAX) {
+            ++ptp->in_err;
+            return;
+        }
+        ptp->io_hdr.din_xferp = (__u64)(sg_uintptr_t)iovp;
+        ptp->io_hdr.din_xfer_len = (uint32_t)sum;
+        ptp->io_hdr.din_iovec_count = iov_count;
+    }
+}
+
+/* Setup for data transfer toward device from a scatter gather list */
+void
+set_scsi_pt_data_out_iov(struct sg_pt_base * vp,
+                         const struct sg_pt_iovec * iovp, int iov_count)
+{
+    uint64_t sum;
+    struct sg_pt_linux_scsi * ptp = &vp->impl;
+
+    if (ptp->io_hdr.dout_xferp)
+        ++ptp->in_err;
+    if (iov_count > 0) {
+        sum = pt_iov_sum(iovp, iov_count);
+        if (sum > UINT32_MAX) {
+            ++ptp->in_err;
+            return;
+        }
+        ptp->io_hdr.dout_xferp = (__u64)(sg_uintptr_t)iovp;
+        ptp->io_hdr.dout_xfer_len = (uint32_t)sum;
+        ptp->io_hdr.dout_iovec_count = iov_count;
+    }
+}
+
 void
 set_pt_metadata_xfer(struct sg_pt_base * vp, uint8_t * dxferp,
                      uint32_t dxfer_len, bool out_true)
@@ -855,50 +1119,80 @@ get_pt_nvme_nsid(const struct sg_pt_base * vp)
     return ptp->nvme_nsid;
 }
 
-/* Executes SCSI command using sg v3 interface */
+/* Transfers the request held in ptp's v4 header into the v3 header at
+ * v3_hdrp. Returns 0 if okay, else SCSI_PT_DO_BAD_PARAMS. */
 static int
-do_scsi_pt_v3(struct sg_pt_linux_scsi * ptp, int fd, int time_secs,
-              int verbose)
+v4_to_v3_request(const struct sg_pt_linux_scsi * ptp,
+                 struct sg_io_hdr * v3_hdrp, int time_secs, int verbose)
 {
-    struct sg_io_hdr v3_hdr;
-
-    memset(&v3_hdr, 0, sizeof(v3_hdr));
+    memset(v3_hdrp, 0, sizeof(*v3_hdrp));
     /* convert v4 to v3 header */
-    v3_hdr.interface_id = 'S';
-    v3_hdr.dxfer_direction = SG_DXFER_NONE;
-    v3_hdr.cmdp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.request;
-    v3_hdr.cmd_len = (uint8_t)ptp->io_hdr.request_len;
+    v3_hdrp->interface_id = 'S';
+    v3_hdrp->dxfer_direction = SG_DXFER_NONE;
+    v3_hdrp->cmdp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.request;
+    v3_hdrp->cmd_len = (uint8_t)ptp->io_hdr.request_len;
     if (ptp->io_hdr.din_xfer_len > 0) {
         if (ptp->io_hdr.dout_xfer_len > 0) {
             if (verbose)
                 pr2ws("sgv3 doesn't support bidi\n");
             return SCSI_PT_DO_BAD_PARAMS;
         }
-        v3_hdr.dxferp = (void *)(long)ptp->io_hdr.din_xferp;
-        v3_hdr.dxfer_len = (unsigned int)ptp->io_hdr.din_xfer_len;
-        v3_hdr.dxfer_direction =  SG_DXFER_FROM_DEV;
+        v3_hdrp->dxferp = (void *)(long)ptp->io_hdr.din_xferp;
+        v3_hdrp->dxfer_len = (unsigned int)ptp->io_hdr.din_xfer_len;
+        v3_hdrp->iovec_count = ptp->io_hdr.din_iovec_count;
+        v3_hdrp->dxfer_direction =  SG_DXFER_FROM_DEV;
     } else if (ptp->io_hdr.dout_xfer_len > 0) {
-        v3_hdr.dxferp = (void *)(long)ptp->io_hdr.dout_xferp;
-        v3_hdr.dxfer_len = (unsigned int)ptp->io_hdr.dout_xfer_len;
-        v3_hdr.dxfer_direction =  SG_DXFER_TO_DEV;
+        v3_hdrp->dxferp = (void *)(long)ptp->io_hdr.dout_xferp;
+        v3_hdrp->dxfer_len = (unsigned int)ptp->io_hdr.dout_xfer_len;
+        v3_hdrp->iovec_count = ptp->io_hdr.dout_iovec_count;
+        v3_hdrp->dxfer_direction =  SG_DXFER_TO_DEV;
     }
     if (ptp->io_hdr.response && (ptp->io_hdr.max_response_len > 0)) {
-        v3_hdr.sbp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.response;
-        v3_hdr.mx_sb_len = (uint8_t)ptp->io_hdr.max_response_len;
+        v3_hdrp->sbp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.response;
+        v3_hdrp->mx_sb_len = (uint8_t)ptp->io_hdr.max_response_len;
     }
-    v3_hdr.pack_id = (int)ptp->io_hdr.request_extra;
+    v3_hdrp->pack_id = (int)ptp->io_hdr.request_extra;
     if (BSG_FLAG_Q_AT_HEAD & ptp->io_hdr.flags)
-        v3_hdr.flags |= SG_FLAG_Q_AT_HEAD;      /* favour AT_HEAD */
+        v3_hdrp->flags |= SG_FLAG_Q_AT_HEAD;      /* favour AT_HEAD */
     else if (BSG_FLAG_Q_AT_TAIL & ptp->io_hdr.flags)
-        v3_hdr.flags |= SG_FLAG_Q_AT_TAIL;
+        v3_hdrp->flags |= SG_FLAG_Q_AT_TAIL;
 
-    if (NULL == v3_hdr.cmdp) {
+    if (NULL == v3_hdrp->cmdp) {
         if (verbose)
             pr2ws("No SCSI command (cdb) given [v3]\n");
         return SCSI_PT_DO_BAD_PARAMS;
     }
     /* io_hdr.timeout is in milliseconds, if greater than zero */
-    v3_hdr.timeout = ((time_secs > 0) ? (time_secs * 1000) : DEF_TIMEOUT);
+    v3_hdrp->timeout = ((time_secs > 0) ? (time_secs * 1000) : DEF_TIMEOUT);
+    return 0;
+}
+
+/* Transfers the response fields from a completed v3 header into ptp's v4
+ * header. */
+static void
+v3_to_v4_response(struct sg_pt_linux_scsi * ptp,
+                  const struct sg_io_hdr * v3_hdrp)
+{
+    ptp->io_hdr.device_status = (__u32)v3_hdrp->status;
+    ptp->io_hdr.driver_status = (__u32)v3_hdrp->driver_status;
+    ptp->io_hdr.transport_status = (__u32)v3_hdrp->host_status;
+    ptp->io_hdr.response_len = (__u32)v3_hdrp->sb_len_wr;
+    ptp->io_hdr.duration = (__u32)v3_hdrp->duration;
+    ptp->io_hdr.din_resid = (__s32)v3_hdrp->resid;
+    /* v3_hdr.info not passed back since no mapping defined (yet) */
+}
+
+/* Executes SCSI command using sg v3 interface */
+static int
+do_scsi_pt_v3(struct sg_pt_linux_scsi * ptp, int fd, int time_secs,
+              int verbose)
+{
+    int res;
+    struct sg_io_hdr v3_hdr;
+
+    res = v4_to_v3_request(ptp, &v3_hdr, time_secs, verbose);
+    if (res)
+        return res;
     /* Finally do the v3 SG_IO ioctl */
     if (ioctl(fd, SG_IO, &v3_hdr) < 0) {
         ptp->os_err = errno;
@@ -907,13 +1201,7 @@ do_scsi_pt_v3(struct sg_pt_linux_scsi * ptp, int fd, int time_secs,
                   safe_strerror(ptp->os_err), ptp->os_err);
         return -ptp->os_err;
     }
-    ptp->io_hdr.device_status = (__u32)v3_hdr.status;
-    ptp->io_hdr.driver_status = (__u32)v3_hdr.driver_status;
-    ptp->io_hdr.transport_status = (__u32)v3_hdr.host_status;
-    ptp->io_hdr.response_len = (__u32)v3_hdr.sb_len_wr;
-    ptp->io_hdr.duration = (__u32)v3_hdr.duration;
-    ptp->io_hdr.din_resid = (__s32)v3_hdr.resid;
-    /* v3_hdr.info not passed back since no mapping defined (yet) */
+    v3_to_v4_response(ptp, &v3_hdr);
     return 0;
 }
 
@@ -939,13 +1227,15 @@ do_scsi_pt_v4(struct sg_pt_linux_scsi * ptp, int fd, int time_secs,
     return 0;
 }
 
-/* Executes SCSI command (or at least forwards it to lower layers).
- * Returns 0 for success, negative numbers are negated 'errno' values from
- * OS system calls. Positive return values are errors from this package. */
-int
-do_scsi_pt(struct sg_pt_base * vp, int fd, int time_secs, int verbose)
+/* Common checks before a command held in vp is sent. Reconciles the fd
+ * given to do_scsi_pt() (or do_pt_submit()) with the one associated with
+ * vp, placing the result in *fdp. Returns 0 if okay, otherwise the value
+ * that the caller should return. */
+static int
+pt_pre_send_checks(struct sg_pt_base * vp, int * fdp, int verbose)
 {
     int err;
+    int fd = *fdp;
     struct sg_pt_linux_scsi * ptp = &vp->impl;
     bool have_checked_for_type = (ptp->dev_fd >= 0);
 
@@ -971,7 +1261,7 @@ do_scsi_pt(struct sg_pt_base * vp, int fd, int time_secs, int verbose)
             pr2ws("%s: invalid file descriptors\n", __func__);
         return SCSI_PT_DO_BAD_PARAMS;
     } else
-        fd = ptp->dev_fd;
+        *fdp = ptp->dev_fd;
     if (! have_checked_for_type) {
         err = set_pt_file_handle(vp, ptp->dev_fd, verbose);
         if (err)
@@ -979,8 +1269,124 @@ do_scsi_pt(struct sg_pt_base * vp, int fd, int time_secs, int verbose)
     }
     if (ptp->os_err)
         return -ptp->os_err;
+    return 0;
+}
+
+static int pt_dispatch(struct sg_pt_base * vp, int fd, int time_secs,
+                       int verbose);
+
+/* Copies len bytes between the flat buffer bp and a scatter gather list */
+static void
+pt_iov_copy(const struct sg_pt_iovec * iovp, int iov_count, uint8_t * bp,
+            uint32_t len, bool to_iov)
+{
+    int k;
+    uint32_t n;
+
+    for (k = 0; (k < iov_count) && (len > 0); ++k, bp += n, len -= n) {
+        n = (iovp[k].iov_len < len) ? (uint32_t)iovp[k].iov_len : len;
+        if (to_iov)
+            memcpy(iovp[k].iov_base, bp, n);
+        else
+            memcpy(bp, iovp[k].iov_base, n);
+    }
+}
+
+/* The NVMe, mem: and bsg pass-throughs take flat data buffers so while
+ * the command in vp is executed (by pt_dispatch() or, if submit, by
+ * sg_mem_async_submit()) its scatter gather lists are replaced by bounce
+ * buffers. */
+static int
+do_scsi_pt_flat(struct sg_pt_base * vp, int fd, int time_secs, bool submit,
+                int verbose)
+{
+    int res;
+    int din_cnt, dout_cnt;
+    uint32_t n;
+    __u64 din_iov, dout_iov;
+    uint8_t * din_bp = NULL;
+    uint8_t * dout_bp = NULL;
+    uint8_t * free_din_bp = NULL;
+    uint8_t * free_dout_bp = NULL;
+    struct sg_pt_linux_scsi * ptp = &vp->impl;
+
+    din_cnt = ptp->io_hdr.din_iovec_count;
+    dout_cnt = ptp->io_hdr.dout_iovec_count;
+    din_iov = ptp->io_hdr.din_xferp;
+    dout_iov = ptp->io_hdr.dout_xferp;
+    if (din_cnt > 0) {
+        din_bp = sg_memalign(ptp->io_hdr.din_xfer_len, 0, &free_din_bp,
+                             false);
+        if (NULL == din_bp)
+            return -ENOMEM;
+        ptp->io_hdr.din_xferp = (__u64)(sg_uintptr_t)din_bp;
+        ptp->io_hdr.din_iovec_count = 0;
+    }
+    if (dout_cnt > 0) {
+        dout_bp = sg_memalign(ptp->io_hdr.dout_xfer_len, 0, &free_dout_bp,
+                              false);
+        if (NULL == dout_bp) {
+            res = -ENOMEM;
+            goto fini;
+        }
+        pt_iov_copy((const struct sg_pt_iovec *)(sg_uintptr_t)dout_iov,
+                    dout_cnt, dout_bp, ptp->io_hdr.dout_xfer_len, false);
+        ptp->io_hdr.dout_xferp = (__u64)(sg_uintptr_t)dout_bp;
+        ptp->io_hdr.dout_iovec_count = 0;
+    }
+    if (verbose > 4)
+        pr2ws("%s: bounce buffers for din_iovec_count=%d, "
+              "dout_iovec_count=%d\n", __func__, din_cnt, dout_cnt);
+    if (submit)
+        res = sg_mem_async_submit(vp, time_secs, verbose);
+    else
+        res = pt_dispatch(vp, fd, time_secs, verbose);
+    if ((din_cnt > 0) && (0 == res)) {
+        n = ptp->io_hdr.din_xfer_len;
+        if ((ptp->io_hdr.din_resid > 0) &&
+            ((uint32_t)ptp->io_hdr.din_resid < n))
+            n -= ptp->io_hdr.din_resid;
+        pt_iov_copy((const struct sg_pt_iovec *)(sg_uintptr_t)din_iov,
+                    din_cnt, din_bp, n, true);
+    }
+fini:
+    if (din_cnt > 0) {
+        ptp->io_hdr.din_xferp = din_iov;
+        ptp->io_hdr.din_iovec_count = din_cnt;
+    }
+    if (dout_cnt > 0) {
+        ptp->io_hdr.dout_xferp = dout_iov;
+        ptp->io_hdr.dout_iovec_count = dout_cnt;
+    }
+    if (free_din_bp)
+        free(free_din_bp);
+    if (free_dout_bp)
+        free(free_dout_bp);
+    return res;
+}
+
+/* True if vp has a scatter gather list that its pass-through can not take
+ * as is, see do_scsi_pt_flat() */
+static inline bool
+pt_needs_flat(const struct sg_pt_linux_scsi * ptp)
+{
+    return (ptp->io_hdr.din_iovec_count || ptp->io_hdr.dout_iovec_count) &&
+           (ptp->is_nvme || ptp->is_mem || ptp->is_bsg);
+}
+
+/* Sends the command in vp, already checked by pt_pre_send_checks(), to the
+ * pass-through for its device type */
+static int
+pt_dispatch(struct sg_pt_base * vp, int fd, int time_secs, int verbose)
+{
+    struct sg_pt_linux_scsi * ptp = &vp->impl;
+
+    if (pt_needs_flat(ptp))
+        return do_scsi_pt_flat(vp, fd, time_secs, false, verbose);
     if (ptp->is_nvme)
         return sg_do_nvme_pt(vp, -1, time_secs, verbose);
+    else if (ptp->is_mem)
+        return sg_do_mem_pt(vp, time_secs, verbose);
     else if (ptp->is_sg) {
 #ifdef IGNORE_LINUX_SGV4
         return do_scsi_pt_v3(ptp, fd, time_secs, verbose);
@@ -1000,3 +1406,382 @@ do_scsi_pt(struct sg_pt_base * vp, int fd, int time_secs, int verbose)
     pr2ws("%s: Should never reach this point\n", __func__);
     return 0;
 }
+
+/* Adds a completed command to the pass-through statistics */
+static void
+pt_stats_done(struct sg_pt_base * vp, int res, uint64_t start_ns)
+{
+    const struct sg_pt_linux_scsi * ptp = &vp->impl;
+
+    sg_pt_stats_record(ptp->dev_fd,
+                       (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.request,
+                       ptp->nvme_direct, res,
+                       (res ? -1 : get_scsi_pt_result_category(vp)),
+                       sg_pt_stats_clock_ns() - start_ns);
+}
+
+/* Executes SCSI command (or at least forwards it to lower layers).
+ * Returns 0 for success, negative numbers are negated 'errno' values from
+ * OS system calls. Positive return values are errors from this package. */
+int
+do_scsi_pt(struct sg_pt_base * vp, int fd, int time_secs, int verbose)
+{
+    int res;
+    uint64_t start_ns;
+
+    res = pt_pre_send_checks(vp, &fd, verbose);
+    if (res)
+        return res;
+    if (! sg_pt_stats_on())
+        return pt_dispatch(vp, fd, time_secs, verbose);
+    start_ns = sg_pt_stats_clock_ns();
+    res = pt_dispatch(vp, fd, time_secs, verbose);
+    pt_stats_done(vp, res, start_ns);
+    return res;
+}
+
+/* For the asynchronous interface: called with each object taken by
+ * do_pt_receive() and friends */
+static inline void
+pt_stats_async_done(struct sg_pt_base * vp)
+{
+    if (vp && vp->impl.stats_start_ns) {
+        pt_stats_done(vp, 0, vp->impl.stats_start_ns);
+        vp->impl.stats_start_ns = 0;
+    }
+}
+
+/* Returns the sg driver version number if dev_fd is a sg device node,
+ * else 0. If is_nvmep is non-NULL, *is_nvmep is set if dev_fd is a NVMe
+ * device. Only used by the asynchronous functions that are given a bare
+ * file descriptor. */
+static int
+sg_fd_get_version(int dev_fd, bool * is_nvmep, int verbose)
+{
+    struct probe_cache_ent pce;
+    struct stat a_stat;
+
+    if (! sg_bsg_nvme_char_major_checked) {
+        sg_bsg_nvme_char_major_checked = true;
+        sg_find_bsg_nvme_char_major(verbose);
+    }
+    if (is_nvmep)
+        *is_nvmep = false;
+    if (probe_file_handle(dev_fd, &pce, &a_stat, verbose))
+        return 0;
+    if (is_nvmep)
+        *is_nvmep = pce.is_nvme;
+    return pce.is_sg ? pce.sg_version : 0;
+}
+
+/* Sends the command in vp to the sg driver without waiting for it to
+ * complete. Uses ioctl(SG_IOSUBMIT) with the sg v4 interface, otherwise
+ * write() with the sg v3 interface. The address of vp is placed in the
+ * usr_ptr field so do_pt_receive() can find it again. NVMe devices are
+ * handled by sg_nvme_async_submit() and mem: pseudo disks by
+ * sg_mem_async_submit(). NVMe commands are only queued on their io_uring
+ * ring unless flush is true. */
+static int
+pt_submit(struct sg_pt_base * vp, int fd, int time_secs, bool flush,
+          int verbose)
+{
+    int res;
+    struct sg_pt_linux_scsi * ptp = &vp->impl;
+    struct sg_io_hdr v3_hdr;
+
+    res = pt_pre_send_checks(vp, &fd, verbose);
+    if (res)
+        return res;
+    if (pt_needs_flat(ptp)) {
+        if (ptp->is_mem)
+            return do_scsi_pt_flat(vp, fd, time_secs, true, verbose);
+        if (verbose > 2)
+            pr2ws("%s: scatter gather list only given synchronously\n",
+                  __func__);
+        return SCSI_PT_DO_NOT_SUPPORTED;
+    }
+    if (ptp->is_nvme)
+        return sg_nvme_async_submit(vp, time_secs, flush, verbose);
+    if (ptp->is_mem)
+        return sg_mem_async_submit(vp, time_secs, verbose);
+    if (! ptp->is_sg) {
+        if (verbose > 2)
+            pr2ws("%s: only sg device nodes are asynchronous\n", __func__);
+        return SCSI_PT_DO_NOT_SUPPORTED;
+    }
+#ifndef IGNORE_LINUX_SGV4
+    if (ptp->sg_version >= SG_LINUX_SG_VER_V4) {
+        if (0 == ptp->io_hdr.request) {
+            if (verbose)
+                pr2ws("No SCSI command (cdb) given [v4]\n");
+            return SCSI_PT_DO_BAD_PARAMS;
+        }
+        ptp->io_hdr.timeout = ((time_secs > 0) ? (time_secs * 1000) :
+                                                 DEF_TIMEOUT);
+        ptp->io_hdr.usr_ptr = (__u64)(sg_uintptr_t)vp;
+        if (ioctl(fd, SG_IOSUBMIT, &ptp->io_hdr) < 0) {
+            ptp->os_err = errno;
+            if (verbose > 1)
+                pr2ws("ioctl(SG_IOSUBMIT) failed: %s (errno=%d)\n",
+                      safe_strerror(ptp->os_err), ptp->os_err);
+            return -ptp->os_err;
+        }
+        return 0;
+    }
+#endif
+    res = v4_to_v3_request(ptp, &v3_hdr, time_secs, verbose);
+    if (res)
+        return res;
+    v3_hdr.usr_ptr = vp;
+    if (write(fd, &v3_hdr, sizeof(v3_hdr)) < 0) {
+        ptp->os_err = errno;
+        if (verbose > 1)
+            pr2ws("write(sg v3) failed: %s (errno=%d)\n",
+                  safe_strerror(ptp->os_err), ptp->os_err);
+        return -ptp->os_err;
+    }
+    return 0;
+}
+
+/* pt_submit() with the start time kept for the statistics */
+static int
+pt_submit_stats(struct sg_pt_base * vp, int fd, int time_secs, bool flush,
+                int verbose)
+{
+    int res;
+    struct sg_pt_linux_scsi * ptp = &vp->impl;
+
+    if (sg_pt_stats_on())
+        ptp->stats_start_ns = sg_pt_stats_clock_ns();
+    res = pt_submit(vp, fd, time_secs, flush, verbose);
+    if (res && ptp->stats_start_ns) {
+        pt_stats_done(vp, res, ptp->stats_start_ns);
+        ptp->stats_start_ns = 0;
+    }
+    return res;
+}
+
+int
+do_pt_submit(struct sg_pt_base * vp, int fd, int time_secs, int verbose)
+{
+    return pt_submit_stats(vp, fd, time_secs, true, verbose);
+}
+
+/* Fetches a response with ioctl(SG_IORECEIVE) or read() depending on the
+ * interface (v4 or v3) the sg driver associated with dev_fd offers. The
+ * response fields are copied into the object named by the usr_ptr field,
+ * which do_pt_submit() set to the address of that object. */
+static int
+pt_receive(int dev_fd, int pack_id, struct sg_pt_base ** objpp, int verbose)
+{
+    bool is_nvme;
+    int err, sg_version;
+    struct sg_pt_base * vp;
+    struct sg_pt_linux_scsi * ptp;
+    struct sg_io_hdr v3_hdr;
+
+    if (objpp)
+        *objpp = NULL;
+    if (dev_fd < 0) {
+        if (verbose)
+            pr2ws("%s: invalid file descriptor\n", __func__);
+        return SCSI_PT_DO_BAD_PARAMS;
+    }
+    if (sg_mem_is_mem(dev_fd))
+        return sg_mem_async_receive(dev_fd, objpp, verbose);
+    sg_version = sg_fd_get_version(dev_fd, &is_nvme, verbose);
+    if (is_nvme)        /* pack_id is ignored, responses are oldest first */
+        return sg_nvme_async_receive(dev_fd, true, objpp, verbose);
+#ifndef IGNORE_LINUX_SGV4
+    if (sg_version >= SG_LINUX_SG_VER_V4) {
+        struct sg_io_v4 h4;
+
+        memset(&h4, 0, sizeof(h4));
+        h4.guard = 'Q';
+        h4.request_extra = (__u32)pack_id;
+        if (ioctl(dev_fd, SG_IORECEIVE, &h4) < 0) {
+            err = errno;
+            if ((verbose > 1) && (EAGAIN != err))
+                pr2ws("ioctl(SG_IORECEIVE) failed: %s (errno=%d)\n",
+                      safe_strerror(err), err);
+            return -err;
+        }
+        vp = (struct sg_pt_base *)(sg_uintptr_t)h4.usr_ptr;
+        if (NULL == vp) {
+            if (verbose)
+                pr2ws("%s: response not from do_pt_submit()\n", __func__);
+            return SCSI_PT_DO_BAD_PARAMS;
+        }
+        ptp = &vp->impl;
+        ptp->io_hdr.device_status = h4.device_status;
+        ptp->io_hdr.driver_status = h4.driver_status;
+        ptp->io_hdr.transport_status = h4.transport_status;
+        ptp->io_hdr.response_len = h4.response_len;
+        ptp->io_hdr.duration = h4.duration;
+        ptp->io_hdr.din_resid = h4.din_resid;
+        ptp->io_hdr.dout_resid = h4.dout_resid;
+        ptp->io_hdr.info = h4.info;
+        ptp->io_hdr.request_tag = h4.request_tag;
+        ptp->os_err = 0;
+        if (objpp)
+            *objpp = vp;
+        return 0;
+    }
+#endif
+    memset(&v3_hdr, 0, sizeof(v3_hdr));
+    v3_hdr.interface_id = 'S';
+    v3_hdr.pack_id = pack_id;
+    if (read(dev_fd, &v3_hdr, sizeof(v3_hdr)) < 0) {
+        err = errno;
+        if ((verbose > 1) && (EAGAIN != err))
+            pr2ws("read(sg v3) failed: %s (errno=%d)\n", safe_strerror(err),
+                  err);
+        return -err;
+    }
+    vp = (struct sg_pt_base *)v3_hdr.usr_ptr;
+    if (NULL == vp) {
+        if (verbose)
+            pr2ws("%s: response not from do_pt_submit()\n", __func__);
+        return SCSI_PT_DO_BAD_PARAMS;
+    }
+    ptp = &vp->impl;
+    v3_to_v4_response(ptp, &v3_hdr);
+    ptp->os_err = 0;
+    if (objpp)
+        *objpp = vp;
+    return 0;
+}
+
+int
+do_pt_receive(int dev_fd, int pack_id, struct sg_pt_base ** objpp,
+              int verbose)
+{
+    int res;
+    struct sg_pt_base * vp = NULL;
+
+    res = pt_receive(dev_fd, pack_id, &vp, verbose);
+    if (0 == res)
+        pt_stats_async_done(vp);
+    if (objpp)
+        *objpp = vp;
+    return res;
+}
+
+int
+scsi_pt_async_match(int dev_fd, bool by_pack_id, int verbose)
+{
+    int val = by_pack_id ? 1 : 0;
+
+    if (sg_fd_get_version(dev_fd, NULL, verbose) <= 0)
+        return SCSI_PT_DO_NOT_SUPPORTED;
+    if (ioctl(dev_fd, SG_SET_FORCE_PACK_ID, &val) < 0) {
+        int err = errno;
+
+        if (verbose)
+            pr2ws("ioctl(SG_SET_FORCE_PACK_ID) failed: %s (errno=%d)\n",
+                  safe_strerror(err), err);
+        return -err;
+    }
+    return 0;
+}
+
+/* Sends each of the num_objs commands in objp_arr as do_pt_submit() does,
+ * stopping at the first error. The number actually sent is placed in
+ * *num_sentp. The sg driver in this tree has no multiple request ioctl so
+ * this is one system call per command; callers need not change if that
+ * becomes available. NVMe commands are queued on their io_uring rings and
+ * given to the kernel together at the end. */
+int
+do_pt_submit_batch(struct sg_pt_base ** objp_arr, int num_objs, int fd,
+                   int time_secs, int * num_sentp, int verbose)
+{
+    bool nvme_queued = false;
+    int k, res;
+
+    if (num_sentp)
+        *num_sentp = 0;
+    if ((NULL == objp_arr) || (num_objs < 0))
+        return SCSI_PT_DO_BAD_PARAMS;
+    for (k = 0, res = 0; k < num_objs; ++k) {
+        res = pt_submit_stats(objp_arr[k], fd, time_secs, false, verbose);
+        if (objp_arr[k]->impl.is_nvme)
+            nvme_queued = true;
+        if (res) {
+            if (verbose > 1)
+                pr2ws("%s: stopped at index %d of %d\n", __func__, k,
+                      num_objs);
+            break;
+        }
+        if (num_sentp)
+            ++*num_sentp;
+    }
+    if (nvme_queued) {
+        int r = sg_nvme_async_flush(verbose);
+
+        if (0 == res)
+            res = r;
+    }
+    return res;
+}
+
+/* Fetches up to max_objs responses of commands sent with do_pt_submit() on
+ * dev_fd. Waits (if dev_fd is blocking) for the first one, then takes as
+ * many more as ioctl(SG_GET_NUM_WAITING) says are ready without further
+ * waiting. The objects are placed in objp_arr, their number in *num_recvp.
+ * Returns 0 if at least one response was fetched, else an error as for
+ * do_pt_receive(). */
+int
+do_pt_receive_batch(int dev_fd, struct sg_pt_base ** objp_arr, int max_objs,
+                    int * num_recvp, int verbose)
+{
+    int k, res, num_waiting;
+
+    if (num_recvp)
+        *num_recvp = 0;
+    if ((NULL == objp_arr) || (max_objs < 1))
+        return SCSI_PT_DO_BAD_PARAMS;
+    res = do_pt_receive(dev_fd, -1, objp_arr + 0, verbose);
+    if (res)
+        return res;
+    k = 1;
+    if (num_recvp)
+        *num_recvp = k;
+    if (objp_arr[0]->impl.is_nvme) {    /* reap without waiting */
+        for ( ; k < max_objs; ++k) {
+            if (sg_nvme_async_receive(dev_fd, false, objp_arr + k, verbose))
+                break;
+            pt_stats_async_done(objp_arr[k]);
+            if (num_recvp)
+                *num_recvp = k + 1;
+        }
+        return 0;
+    }
+    if (objp_arr[0]->impl.is_mem) {
+        for ( ; k < max_objs; ++k) {
+            if (sg_mem_async_receive(dev_fd, objp_arr + k, 0))
+                break;
+            pt_stats_async_done(objp_arr[k]);
+            if (num_recvp)
+                *num_recvp = k + 1;
+        }
+        return 0;
+    }
+    while (k < max_objs) {
+        if (ioctl(dev_fd, SG_GET_NUM_WAITING, &num_waiting) < 0) {
+            if (verbose > 1)
+                pr2ws("%s: ioctl(SG_GET_NUM_WAITING) failed, errno=%d\n",
+                      __func__, errno);
+            break;
+        }
+        if (num_waiting < 1)
+            break;
+        for ( ; (num_waiting > 0) && (k < max_objs); --num_waiting, ++k) {
+            res = do_pt_receive(dev_fd, -1, objp_arr + k, verbose);
+            if (res)
+                return 0;       /* have at least one, report that */
+            if (num_recvp)
+                *num_recvp = k + 1;
+        }
+    }
+    return 0;
+}
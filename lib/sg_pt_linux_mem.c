@@ -0,0 +1,1340 @@
+/*
+ * Copyright (c) 2026 Douglas Gilbert.
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the BSD_LICENSE file.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* sg_pt_linux_mem version 1.00 20261015 */
+
+/* This file contains a pseudo disk held in (sparse) memory. It is reached
+ * through the same pass-through interface as real devices: a "device"
+ * name starting with "mem:" given to scsi_pt_open_device() or
+ * scsi_pt_open_flags() creates it and do_scsi_pt() executes SCSI commands
+ * against it. The rest of the name is a comma separated list of options:
+ *     size=<n>     capacity in bytes (default: 1g); multipliers like
+ *                  k, m, g and t (powers of 1024) are accepted
+ *     bs=<n>       logical block size in bytes (default: 512)
+ *     lat_us=<n>   latency added to each command, in microseconds
+ *     zone=<n>     zone size in bytes; makes a host aware zoned disk with
+ *                  sequential write preferred zones (default: not zoned)
+ *     err_lba=<n>  reads and verifies that include this LBA fail with a
+ *                  MEDIUM ERROR (unrecovered read error)
+ *     err_every=<n>  every n-th media access command fails with ABORTED
+ *                  COMMAND
+ *     ro           write protected
+ * For example: "mem:size=64g,bs=4096,lat_us=20". The store is a memfd (a
+ * file in tmpfs) so blocks never written (or unmapped) take no memory and
+ * read back as zeros. The pseudo disk lasts until its file descriptor is
+ * given to scsi_pt_close_device(). */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1   /* for fallocate(), SEEK_DATA and SEEK_HOLE */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#define __STDC_FORMAT_MACROS 1
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <linux/falloc.h>
+
+#include "sg_pt.h"
+#include "sg_lib.h"
+#include "sg_linux_inc.h"
+#include "sg_pt_linux.h"
+#include "sg_unaligned.h"
+#include "sg_pr2serr.h"
+
+#define SCSI_TEST_UNIT_READY_OPC  0x0
+#define SCSI_REQUEST_SENSE_OPC  0x3
+#define SCSI_INQUIRY_OPC     0x12
+#define SCSI_READ_CAPACITY10_OPC  0x25
+#define SCSI_READ10_OPC  0x28
+#define SCSI_WRITE10_OPC  0x2a
+#define SCSI_VERIFY10_OPC  0x2f
+#define SCSI_SYNC_CACHE10_OPC  0x35
+#define SCSI_WRITE_SAME10_OPC  0x41
+#define SCSI_UNMAP_OPC  0x42
+#define SCSI_READ16_OPC  0x88
+#define SCSI_WRITE16_OPC  0x8a
+#define SCSI_VERIFY16_OPC  0x8f
+#define SCSI_SYNC_CACHE16_OPC  0x91
+#define SCSI_WRITE_SAME16_OPC  0x93
+#define SCSI_ZBC_OUT_OPC  0x94
+#define SCSI_ZBC_IN_OPC  0x95
+#define SCSI_SERVICE_ACT_IN_OPC  0x9e
+#define SCSI_REPORT_LUNS_OPC 0xa0
+#define SCSI_READ_CAPACITY16_SA  0x10
+#define SCSI_GET_LBA_STATUS_SA  0x12
+#define SCSI_REPORT_ZONES_SA  0x0
+#define SCSI_RESET_WP_SA  0x4
+
+/* Additional Sense Code (ASC) */
+#define NO_ADDITIONAL_SENSE 0x0
+#define UNRECOVERED_READ_ERR 0x11
+#define MISCOMPARE_VERIFY_ASC 0x1d
+#define PARAMETER_LIST_LENGTH_ERR 0x1a
+#define INVALID_OPCODE 0x20
+#define LBA_OUT_OF_RANGE 0x21
+#define INVALID_FIELD_IN_CDB 0x24
+#define INVALID_FIELD_IN_PARAM_LIST 0x26
+#define WRITE_PROTECTED 0x27
+#define TRANSPORT_PROBLEM 0x4b
+
+#define SG_MEM_DEF_SIZE (1024LL * 1024 * 1024)
+#define SG_MEM_DEF_LB_SZ 512
+#define SG_MEM_MAX_DEVS 16
+#define SG_MEM_MAX_UNMAP_DESCS 256
+#define SG_MEM_BOUNCE_SZ (1024 * 1024)
+#define SG_MEM_NO_ERR_LBA UINT64_MAX
+
+#ifdef __GNUC__
+#define SG_MEM_TLS __thread
+#else
+#define SG_MEM_TLS
+#endif
+
+struct sg_mem_dev {
+    bool read_only;
+    bool dsense;
+    int fd;                     /* memfd holding the data, handed to user */
+    uint32_t lb_sz;
+    uint32_t lat_us;
+    uint32_t err_every;         /* 0 -> no injected ABORTED COMMANDs */
+    uint32_t serial;
+    uint32_t num_zones;         /* 0 -> not zoned */
+    uint64_t num_lbs;
+    uint64_t zone_lbs;
+    uint64_t err_lba;           /* SG_MEM_NO_ERR_LBA -> none */
+    uint64_t media_cmds;        /* count of media access commands */
+    uint64_t * zone_wp;         /* write pointer of each zone */
+};
+
+static struct sg_mem_dev * mem_dev_arr[SG_MEM_MAX_DEVS];
+static uint32_t mem_dev_serial;
+
+/* Completed asynchronous commands, see sg_mem_async_submit() */
+static SG_MEM_TLS struct sg_pt_base * mem_done_head;
+static SG_MEM_TLS struct sg_pt_base * mem_done_tail;
+
+
+static struct sg_mem_dev *
+mem_dev_find(int dev_fd)
+{
+    int k;
+    struct sg_mem_dev * mdp;
+
+    if (dev_fd < 0)
+        return NULL;
+    for (k = 0; k < SG_MEM_MAX_DEVS; ++k) {
+        mdp = __atomic_load_n(mem_dev_arr + k, __ATOMIC_ACQUIRE);
+        if (mdp && (dev_fd == mdp->fd))
+            return mdp;
+    }
+    return NULL;
+}
+
+bool
+sg_mem_is_mem(int dev_fd)
+{
+    return !! mem_dev_find(dev_fd);
+}
+
+static void
+mem_dev_free(struct sg_mem_dev * mdp)
+{
+    if (mdp->zone_wp)
+        free(mdp->zone_wp);
+    free(mdp);
+}
+
+/* Parses the options after "mem:" into mdp. Returns 0 if okay, else
+ * SG_LIB_SYNTAX_ERROR */
+static int
+mem_parse_opts(const char * opts, struct sg_mem_dev * mdp, int64_t * sizep,
+               int64_t * zone_szp, int vb)
+{
+    int res = 0;
+    int64_t ll;
+    char * cp;
+    char * vp;
+    char * savep = NULL;
+    char * dupp;
+
+    dupp = strdup(opts);
+    if (NULL == dupp)
+        return sg_convert_errno(ENOMEM);
+    for (cp = strtok_r(dupp, ",", &savep); cp;
+         cp = strtok_r(NULL, ",", &savep)) {
+        vp = strchr(cp, '=');
+        if (vp)
+            *vp++ = '\0';
+        if (0 == strcmp(cp, "ro")) {
+            mdp->read_only = true;
+            continue;
+        }
+        ll = vp ? sg_get_llnum(vp) : -1;
+        if (ll < 0)
+            goto bad_opt;
+        if (0 == strcmp(cp, "size")) {
+            *sizep = ll;
+        } else if (0 == strcmp(cp, "bs")) {
+            if ((ll < 512) || (ll > 65536) || (ll & (ll - 1)))
+                goto bad_opt;
+            mdp->lb_sz = (uint32_t)ll;
+        } else if (0 == strcmp(cp, "lat_us")) {
+            if (ll > UINT32_MAX)
+                goto bad_opt;
+            mdp->lat_us = (uint32_t)ll;
+        } else if (0 == strcmp(cp, "zone")) {
+            *zone_szp = ll;
+        } else if (0 == strcmp(cp, "err_lba")) {
+            mdp->err_lba = (uint64_t)ll;
+        } else if (0 == strcmp(cp, "err_every")) {
+            if (ll > UINT32_MAX)
+                goto bad_opt;
+            mdp->err_every = (uint32_t)ll;
+        } else
+            goto bad_opt;
+    }
+    free(dupp);
+    return 0;
+
+bad_opt:
+    if (vb)
+        pr2ws("mem: bad option '%s%s%s', expect size=, bs=, lat_us=, zone=, "
+              "err_lba=, err_every= or ro\n", cp, (vp ? "=" : ""),
+              (vp ? vp : ""));
+    res = SG_LIB_SYNTAX_ERROR;
+    free(dupp);
+    return res;
+}
+
+/* Returns a file descriptor of a sparse file of the given size that is
+ * not in the file system name space, else a negated errno */
+static int
+mem_make_store(int64_t size, int vb)
+{
+    int fd, err;
+
+#ifdef SYS_memfd_create
+    fd = syscall(SYS_memfd_create, "sg3_utils_mem", 0x1 /* MFD_CLOEXEC */);
+#else
+    fd = -1;
+    errno = ENOSYS;
+#endif
+    if (fd < 0) {
+        char b[] = "/tmp/sg3_utils_memXXXXXX";
+
+        if (vb > 2)
+            pr2ws("%s: memfd_create() failed, errno=%d, try a temporary "
+                  "file\n", __func__, errno);
+        fd = mkstemp(b);
+        if (fd < 0) {
+            err = errno;
+            if (vb)
+                pr2ws("%s: mkstemp() failed: %s\n", __func__,
+                      safe_strerror(err));
+            return -err;
+        }
+        unlink(b);
+    }
+    if (ftruncate(fd, size) < 0) {
+        err = errno;
+        if (vb)
+            pr2ws("%s: ftruncate(%" PRId64 ") failed: %s\n", __func__, size,
+                  safe_strerror(err));
+        close(fd);
+        return -err;
+    }
+    return fd;
+}
+
+/* Creates a memory backed pseudo disk as described by the options (the
+ * part of the device name after "mem:"). The access mode in flags is
+ * ignored (use the "ro" option). Returns a file descriptor (>= 0) for use
+ * with the pass-through functions, else a negated errno. */
+int
+sg_mem_open(const char * opts, int flags, int vb)
+{
+    int k, fd;
+    int64_t size = SG_MEM_DEF_SIZE;
+    int64_t zone_sz = 0;
+    struct sg_mem_dev * mdp;
+    struct sg_mem_dev * expect;
+
+    if (vb > 1)
+        pr2ws("%s: options: %s, flags=0x%x\n", __func__, opts, flags);
+    mdp = (struct sg_mem_dev *)calloc(1, sizeof(*mdp));
+    if (NULL == mdp)
+        return -ENOMEM;
+    mdp->lb_sz = SG_MEM_DEF_LB_SZ;
+    mdp->err_lba = SG_MEM_NO_ERR_LBA;
+    mdp->fd = -1;
+    if (mem_parse_opts(opts, mdp, &size, &zone_sz, vb)) {
+        mem_dev_free(mdp);
+        return -EINVAL;
+    }
+    mdp->num_lbs = (uint64_t)size / mdp->lb_sz;
+    if (0 == mdp->num_lbs) {
+        if (vb)
+            pr2ws("mem: size=%" PRId64 " is less than one block (bs=%u)\n",
+                  size, mdp->lb_sz);
+        mem_dev_free(mdp);
+        return -EINVAL;
+    }
+    if (zone_sz > 0) {
+        mdp->zone_lbs = (uint64_t)zone_sz / mdp->lb_sz;
+        if (0 == mdp->zone_lbs) {
+            if (vb)
+                pr2ws("mem: zone size is less than one block\n");
+            mem_dev_free(mdp);
+            return -EINVAL;
+        }
+        mdp->num_zones = (mdp->num_lbs + mdp->zone_lbs - 1) / mdp->zone_lbs;
+        mdp->zone_wp = (uint64_t *)calloc(mdp->num_zones, sizeof(uint64_t));
+        if (NULL == mdp->zone_wp) {
+            mem_dev_free(mdp);
+            return -ENOMEM;
+        }
+        for (k = 0; k < (int)mdp->num_zones; ++k)
+            mdp->zone_wp[k] = (uint64_t)k * mdp->zone_lbs;
+    }
+    mdp->dsense = sg_get_initial_dsense();
+    mdp->serial = __atomic_add_fetch(&mem_dev_serial, 1, __ATOMIC_RELAXED);
+    fd = mem_make_store(mdp->num_lbs * mdp->lb_sz, vb);
+    if (fd < 0) {
+        mem_dev_free(mdp);
+        return fd;
+    }
+    mdp->fd = fd;
+    for (k = 0; k < SG_MEM_MAX_DEVS; ++k) {
+        expect = NULL;
+        if (__atomic_compare_exchange_n(mem_dev_arr + k, &expect, mdp, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            break;
+    }
+    if (k >= SG_MEM_MAX_DEVS) {
+        if (vb)
+            pr2ws("mem: too many open pseudo disks (max: %d)\n",
+                  SG_MEM_MAX_DEVS);
+        close(fd);
+        mem_dev_free(mdp);
+        return -EMFILE;
+    }
+    if (vb > 1)
+        pr2ws("%s: fd=%d, %" PRIu64 " blocks of %u bytes, %u zones\n",
+              __func__, fd, mdp->num_lbs, mdp->lb_sz, mdp->num_zones);
+    return fd;
+}
+
+/* Forgets the pseudo disk associated with dev_fd (if any) and drops its
+ * outstanding asynchronous responses. The caller closes dev_fd which
+ * frees the memory holding the data. */
+void
+sg_mem_close(int dev_fd)
+{
+    int k;
+    struct sg_mem_dev * mdp;
+
+    for (k = 0; k < SG_MEM_MAX_DEVS; ++k) {
+        mdp = __atomic_load_n(mem_dev_arr + k, __ATOMIC_ACQUIRE);
+        if (mdp && (dev_fd == mdp->fd)) {
+            __atomic_store_n(mem_dev_arr + k, NULL, __ATOMIC_RELEASE);
+            mem_dev_free(mdp);
+            break;
+        }
+    }
+    while (sg_mem_async_receive(dev_fd, NULL, 0) == 0)
+        ;
+}
+
+/* Builds sense data in ptp. If info_valid, the INFORMATION field is set to
+ * info. If sks_byte >= 0 a field pointer (as for INVALID FIELD IN CDB or
+ * PARAMETER LIST) is added, sks_bit < 0 means no bit position. */
+static void
+mem_mk_sense(struct sg_pt_linux_scsi * ptp, const struct sg_mem_dev * mdp,
+             int sk, int asc, int ascq, bool info_valid, uint64_t info,
+             int sks_byte, int sks_bit, int vb)
+{
+    bool dsense = mdp->dsense;
+    int n, sl;
+    uint8_t * sbp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.response;
+    uint8_t sks[3];
+    uint8_t sb[40];
+
+    ptp->io_hdr.device_status = SAM_STAT_CHECK_CONDITION;
+    memset(sb, 0, sizeof(sb));
+    sg_build_sense_buffer(dsense, sb, sk, asc, ascq);
+    if (sks_byte >= 0) {
+        sks[0] = 0x80;
+        if (INVALID_FIELD_IN_CDB == asc)
+            sks[0] |= 0x40;
+        if (sks_bit >= 0)
+            sks[0] |= 0x8 | (0x7 & sks_bit);
+        sg_put_unaligned_be16(sks_byte, sks + 1);
+    }
+    if (dsense) {
+        sl = 8;
+        if (info_valid) {
+            sb[sl] = 0x0;       /* information descriptor */
+            sb[sl + 1] = 0xa;
+            sb[sl + 2] = 0x80;
+            sg_put_unaligned_be64(info, sb + sl + 4);
+            sl += 12;
+        }
+        if (sks_byte >= 0) {
+            sb[sl] = 0x2;       /* sense key specific descriptor */
+            sb[sl + 1] = 0x6;
+            memcpy(sb + sl + 4, sks, 3);
+            sl += 8;
+        }
+        sb[7] = sl - 8;
+    } else {
+        sl = 18;
+        if (info_valid) {
+            sb[0] |= 0x80;
+            sg_put_unaligned_be32((uint32_t)info, sb + 3);
+        }
+        if (sks_byte >= 0)
+            memcpy(sb + 15, sks, 3);
+    }
+    n = ptp->io_hdr.max_response_len;
+    n = (n < sl) ? n : sl;
+    if (sbp && (n > 0))
+        memcpy(sbp, sb, n);
+    ptp->io_hdr.response_len = (n > 0) ? n : 0;
+    if (vb > 3)
+        pr2ws("%s: [sense_key,asc,ascq]: [0x%x,0x%x,0x%x]\n", __func__, sk,
+              asc, ascq);
+}
+
+static void
+mem_mk_sense_asc(struct sg_pt_linux_scsi * ptp, const struct sg_mem_dev * mdp,
+                 int sk, int asc, int ascq, int vb)
+{
+    mem_mk_sense(ptp, mdp, sk, asc, ascq, false, 0, -1, -1, vb);
+}
+
+/* Set in_bit to -1 to indicate no bit position of invalid field */
+static void
+mem_mk_sense_invalid_fld(struct sg_pt_linux_scsi * ptp,
+                         const struct sg_mem_dev * mdp, bool in_cdb,
+                         int in_byte, int in_bit, int vb)
+{
+    mem_mk_sense(ptp, mdp, SPC_SK_ILLEGAL_REQUEST,
+                 (in_cdb ? INVALID_FIELD_IN_CDB : INVALID_FIELD_IN_PARAM_LIST),
+                 0, false, 0, in_byte, in_bit, vb);
+}
+
+/* Copies up to n bytes from src to the data-in buffer, respecting the
+ * allocation length alloc_len, and sets the residual count */
+static void
+mem_din_copy(struct sg_pt_linux_scsi * ptp, const uint8_t * src, uint32_t n,
+             uint32_t alloc_len)
+{
+    n = (alloc_len < n) ? alloc_len : n;
+    n = (n < ptp->io_hdr.din_xfer_len) ? n : ptp->io_hdr.din_xfer_len;
+    ptp->io_hdr.din_resid = ptp->io_hdr.din_xfer_len - n;
+    if (n > 0)
+        memcpy((uint8_t *)(sg_uintptr_t)ptp->io_hdr.din_xferp, src, n);
+}
+
+/* pread() or pwrite() all len bytes. Returns 0 or a negated errno */
+static int
+mem_pio(const struct sg_mem_dev * mdp, uint8_t * bp, uint64_t len,
+        uint64_t off, bool is_write)
+{
+    ssize_t res;
+
+    while (len > 0) {
+        if (is_write)
+            res = pwrite(mdp->fd, bp, len, (off_t)off);
+        else
+            res = pread(mdp->fd, bp, len, (off_t)off);
+        if (res < 0) {
+            if (EINTR == errno)
+                continue;
+            return -errno;
+        } else if (0 == res) {      /* beyond end of store */
+            if (is_write)
+                return -EIO;
+            memset(bp, 0, len);
+            break;
+        }
+        bp += res;
+        off += res;
+        len -= res;
+    }
+    return 0;
+}
+
+/* Unmaps num blocks starting at lba. They read back as zeros */
+static int
+mem_punch(const struct sg_mem_dev * mdp, uint64_t lba, uint64_t num)
+{
+    if (0 == num)
+        return 0;
+    if (fallocate(mdp->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                  (off_t)(lba * mdp->lb_sz), (off_t)(num * mdp->lb_sz)) < 0)
+        return -errno;
+    return 0;
+}
+
+/* Moves the write pointer of each zone written to (forward only) */
+static void
+mem_zone_written(struct sg_mem_dev * mdp, uint64_t lba, uint64_t num)
+{
+    uint32_t z;
+    uint64_t end = lba + num;
+    uint64_t z_end, new_wp, wp;
+
+    if ((0 == mdp->num_zones) || (0 == num))
+        return;
+    for (z = lba / mdp->zone_lbs; (z < mdp->num_zones) && (lba < end); ++z) {
+        z_end = (uint64_t)(z + 1) * mdp->zone_lbs;
+        new_wp = (end < z_end) ? end : z_end;
+        wp = __atomic_load_n(mdp->zone_wp + z, __ATOMIC_RELAXED);
+        while ((wp < new_wp) &&
+               (! __atomic_compare_exchange_n(mdp->zone_wp + z, &wp, new_wp,
+                                              true, __ATOMIC_RELAXED,
+                                              __ATOMIC_RELAXED)))
+            ;
+        lba = z_end;
+    }
+}
+
+/* Returns true (after building sense data) if [lba, lba + num) is not
+ * within the pseudo disk */
+static bool
+mem_lba_out_of_range(struct sg_pt_linux_scsi * ptp,
+                     const struct sg_mem_dev * mdp, uint64_t lba,
+                     uint64_t num, int vb)
+{
+    if ((lba < mdp->num_lbs) && (num <= (mdp->num_lbs - lba)))
+        return false;
+    mem_mk_sense_asc(ptp, mdp, SPC_SK_ILLEGAL_REQUEST, LBA_OUT_OF_RANGE, 0,
+                     vb);
+    return true;
+}
+
+static bool
+mem_write_protected(struct sg_pt_linux_scsi * ptp,
+                    const struct sg_mem_dev * mdp, int vb)
+{
+    if (! mdp->read_only)
+        return false;
+    mem_mk_sense_asc(ptp, mdp, SPC_SK_DATA_PROTECT, WRITE_PROTECTED, 0, vb);
+    return true;
+}
+
+static void
+mem_tur(struct sg_pt_linux_scsi * ptp, const struct sg_mem_dev * mdp, int vb)
+{
+    if (vb > 4)
+        pr2ws("%s: fd=%d\n", __func__, mdp->fd);
+    if (ptp) { ; }              /* suppress warning */
+}
+
+static void
+mem_req_sense(struct sg_pt_linux_scsi * ptp, const struct sg_mem_dev * mdp,
+              const uint8_t * cdbp, int vb)
+{
+    bool desc = !! (0x1 & cdbp[1]);
+    uint8_t rs_dout[32];
+
+    if (vb > 4)
+        pr2ws("%s: fd=%d\n", __func__, mdp->fd);
+    memset(rs_dout, 0, sizeof(rs_dout));
+    sg_build_sense_buffer(desc, rs_dout, SPC_SK_NO_SENSE,
+                          NO_ADDITIONAL_SENSE, 0);
+    mem_din_copy(ptp, rs_dout, (desc ? 8 : 18), cdbp[4]);
+}
+
+static void
+mem_rluns(struct sg_pt_linux_scsi * ptp, const struct sg_mem_dev * mdp,
+          const uint8_t * cdbp, int vb)
+{
+    uint8_t rl_dout[16];
+
+    if (vb > 4)
+        pr2ws("%s: fd=%d\n", __func__, mdp->fd);
+    memset(rl_dout, 0, sizeof(rl_dout));
+    sg_put_unaligned_be32(8, rl_dout + 0);      /* one LUN: 0 */
+    mem_din_copy(ptp, rl_dout, sizeof(rl_dout),
+                 sg_get_unaligned_be32(cdbp + 6));
+}
+
+static void
+mem_inq(struct sg_pt_linux_scsi * ptp, const struct sg_mem_dev * mdp,
+        const uint8_t * cdbp, int vb)
+{
+    int n;
+    uint8_t inq_dout[128];
+    char b[32];
+
+    if (0x2 & cdbp[1]) {        /* Reject CmdDt=1 */
+        mem_mk_sense_invalid_fld(ptp, mdp, true, 1, 1, vb);
+        return;
+    }
+    memset(inq_dout, 0, sizeof(inq_dout));
+    snprintf(b, sizeof(b), "MEM%08x", mdp->serial);
+    if (0 == (0x1 & cdbp[1])) {         /* standard INQUIRY */
+        if (cdbp[2]) {
+            mem_mk_sense_invalid_fld(ptp, mdp, true, 2, 7, vb);
+            return;
+        }
+        inq_dout[2] = 0x6;      /* SPC-4 */
+        inq_dout[3] = 0x2;      /* response data format */
+        inq_dout[4] = 36 - 5;
+        inq_dout[7] = 0x2;      /* CMDQUE */
+        memcpy(inq_dout + 8, "Linux   ", 8);
+        memcpy(inq_dout + 16, "sg3_utils mem   ", 16);
+        memcpy(inq_dout + 32, "1.00", 4);
+        n = 36;
+    } else {
+        inq_dout[1] = cdbp[2];
+        switch (cdbp[2]) {
+        case 0x0:       /* Supported VPD pages */
+            inq_dout[4] = 0x0;
+            inq_dout[5] = 0x80;
+            inq_dout[6] = 0x83;
+            inq_dout[7] = 0xb0;
+            inq_dout[8] = 0xb1;
+            inq_dout[9] = 0xb2;
+            n = 10;
+            break;
+        case 0x80:      /* Unit serial number */
+            n = strlen(b);
+            memcpy(inq_dout + 4, b, n);
+            n += 4;
+            break;
+        case 0x83:      /* Device identification: T10 vendor id */
+            inq_dout[4] = 0x2;  /* ASCII */
+            inq_dout[5] = 0x1;  /* association: LU, type: T10 vendor id */
+            memcpy(inq_dout + 8, "Linux   sg3_utils mem ", 22);
+            n = strlen(b);
+            memcpy(inq_dout + 30, b, n);
+            inq_dout[7] = 22 + n;
+            n += 30;
+            break;
+        case 0xb0:      /* Block limits */
+            inq_dout[4] = 0x1;  /* WSNZ */
+            sg_put_unaligned_be32(UINT32_MAX, inq_dout + 20);
+            sg_put_unaligned_be32(SG_MEM_MAX_UNMAP_DESCS, inq_dout + 24);
+            n = 64;
+            break;
+        case 0xb1:      /* Block device characteristics */
+            sg_put_unaligned_be16(0x1, inq_dout + 4);   /* non-rotating */
+            if (mdp->num_zones)
+                inq_dout[8] = 0x10;     /* ZONED: host aware */
+            n = 64;
+            break;
+        case 0xb2:      /* Logical block provisioning */
+            inq_dout[5] = 0xe4; /* LBPU, LBPWS, LBPWS10, LBPRZ=1 */
+            inq_dout[6] = 0x2;  /* thin provisioned */
+            n = 8;
+            break;
+        default:
+            mem_mk_sense_invalid_fld(ptp, mdp, true, 2, 7, vb);
+            return;
+        }
+        sg_put_unaligned_be16(n - 4, inq_dout + 2);
+    }
+    mem_din_copy(ptp, inq_dout, n, sg_get_unaligned_be16(cdbp + 3));
+}
+
+static void
+mem_readcap(struct sg_pt_linux_scsi * ptp, const struct sg_mem_dev * mdp,
+            const uint8_t * cdbp, int vb)
+{
+    bool is_rc16 = (SCSI_SERVICE_ACT_IN_OPC == cdbp[0]);
+    uint32_t alloc_len, n;
+    uint64_t last_lba = mdp->num_lbs - 1;
+    uint8_t rc_dout[32];
+
+    if (vb > 4)
+        pr2ws("%s: READ CAPACITY(%d)\n", __func__, (is_rc16 ? 16 : 10));
+    memset(rc_dout, 0, sizeof(rc_dout));
+    if (is_rc16) {
+        alloc_len = sg_get_unaligned_be32(cdbp + 10);
+        sg_put_unaligned_be64(last_lba, rc_dout + 0);
+        sg_put_unaligned_be32(mdp->lb_sz, rc_dout + 8);
+        rc_dout[14] = 0xc0;     /* LBPME, LBPRZ */
+        n = 32;
+    } else {
+        alloc_len = 8;
+        if (last_lba > 0xfffffffe)      /* tell user to use RC(16) */
+            sg_put_unaligned_be32(0xffffffff, rc_dout + 0);
+        else
+            sg_put_unaligned_be32((uint32_t)last_lba, rc_dout + 0);
+        sg_put_unaligned_be32(mdp->lb_sz, rc_dout + 4);
+        n = 8;
+    }
+    mem_din_copy(ptp, rc_dout, n, alloc_len);
+}
+
+/* READ(10), READ(16), WRITE(10) and WRITE(16) */
+static int
+mem_rw(struct sg_pt_linux_scsi * ptp, struct sg_mem_dev * mdp,
+       const uint8_t * cdbp, int vb)
+{
+    bool is_16 = ((SCSI_READ16_OPC == cdbp[0]) ||
+                  (SCSI_WRITE16_OPC == cdbp[0]));
+    bool is_read = ((SCSI_READ10_OPC == cdbp[0]) ||
+                    (SCSI_READ16_OPC == cdbp[0]));
+    int res;
+    uint32_t xfer_len;
+    uint64_t lba, num, bytes;
+    uint8_t * bp;
+
+    if (is_16) {
+        lba = sg_get_unaligned_be64(cdbp + 2);
+        num = sg_get_unaligned_be32(cdbp + 10);
+    } else {
+        lba = sg_get_unaligned_be32(cdbp + 2);
+        num = sg_get_unaligned_be16(cdbp + 7);
+    }
+    if (vb > 4)
+        pr2ws("%s: %s lba=0x%" PRIx64 ", num=%" PRIu64 "\n", __func__,
+              (is_read ? "READ" : "WRITE"), lba, num);
+    if (mem_lba_out_of_range(ptp, mdp, lba, num, vb))
+        return 0;
+    if ((! is_read) && mem_write_protected(ptp, mdp, vb))
+        return 0;
+    bytes = num * mdp->lb_sz;
+    xfer_len = is_read ? ptp->io_hdr.din_xfer_len :
+                         ptp->io_hdr.dout_xfer_len;
+    if (bytes > xfer_len) {
+        if (vb)
+            pr2ws("%s: transfer length (%" PRIu64 " blocks) exceeds data "
+                  "buffer (%u bytes)\n", __func__, num, xfer_len);
+        mem_mk_sense_invalid_fld(ptp, mdp, true, (is_16 ? 10 : 7), -1, vb);
+        return 0;
+    }
+    if (is_read) {
+        bp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.din_xferp;
+        if ((mdp->err_lba >= lba) && (mdp->err_lba < (lba + num))) {
+            /* good blocks before the bad one are transferred */
+            bytes = (mdp->err_lba - lba) * mdp->lb_sz;
+            res = mem_pio(mdp, bp, bytes, lba * mdp->lb_sz, false);
+            if (res)
+                return res;
+            ptp->io_hdr.din_resid = xfer_len - bytes;
+            mem_mk_sense(ptp, mdp, SPC_SK_MEDIUM_ERROR, UNRECOVERED_READ_ERR,
+                         0, true, mdp->err_lba, -1, -1, vb);
+            return 0;
+        }
+        ptp->io_hdr.din_resid = xfer_len - bytes;
+    } else {
+        bp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
+        ptp->io_hdr.dout_resid = xfer_len - bytes;
+    }
+    res = mem_pio(mdp, bp, bytes, lba * mdp->lb_sz, ! is_read);
+    if (res)
+        return res;
+    if (! is_read)
+        mem_zone_written(mdp, lba, num);
+    return 0;
+}
+
+/* VERIFY(10) and VERIFY(16) with BYTCHK 0 (medium check) or 1 (compare
+ * with data-out buffer) */
+static int
+mem_verify(struct sg_pt_linux_scsi * ptp, const struct sg_mem_dev * mdp,
+           const uint8_t * cdbp, int vb)
+{
+    bool is_16 = (SCSI_VERIFY16_OPC == cdbp[0]);
+    int res, bytchk;
+    uint32_t k, chunk;
+    uint64_t lba, num, bytes, off;
+    const uint8_t * dop;
+    uint8_t * bbp;
+
+    bytchk = (cdbp[1] >> 1) & 0x3;
+    if (is_16) {
+        lba = sg_get_unaligned_be64(cdbp + 2);
+        num = sg_get_unaligned_be32(cdbp + 10);
+    } else {
+        lba = sg_get_unaligned_be32(cdbp + 2);
+        num = sg_get_unaligned_be16(cdbp + 7);
+    }
+    if (vb > 4)
+        pr2ws("%s: lba=0x%" PRIx64 ", num=%" PRIu64 ", bytchk=%d\n",
+              __func__, lba, num, bytchk);
+    if (bytchk > 1) {
+        mem_mk_sense_invalid_fld(ptp, mdp, true, 1, 2, vb);
+        return 0;
+    }
+    if (mem_lba_out_of_range(ptp, mdp, lba, num, vb))
+        return 0;
+    if ((mdp->err_lba >= lba) && (mdp->err_lba < (lba + num))) {
+        mem_mk_sense(ptp, mdp, SPC_SK_MEDIUM_ERROR, UNRECOVERED_READ_ERR, 0,
+                     true, mdp->err_lba, -1, -1, vb);
+        return 0;
+    }
+    if (0 == bytchk)
+        return 0;
+    bytes = num * mdp->lb_sz;
+    if (bytes > ptp->io_hdr.dout_xfer_len) {
+        mem_mk_sense_invalid_fld(ptp, mdp, true, (is_16 ? 10 : 7), -1, vb);
+        return 0;
+    }
+    ptp->io_hdr.dout_resid = ptp->io_hdr.dout_xfer_len - bytes;
+    dop = (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
+    bbp = (uint8_t *)malloc(SG_MEM_BOUNCE_SZ);
+    if (NULL == bbp)
+        return -ENOMEM;
+    for (off = 0, res = 0; off < bytes; off += chunk) {
+        chunk = ((bytes - off) < SG_MEM_BOUNCE_SZ) ? (bytes - off) :
+                                                     SG_MEM_BOUNCE_SZ;
+        res = mem_pio(mdp, bbp, chunk, lba * mdp->lb_sz + off, false);
+        if (res)
+            break;
+        if (0 == memcmp(bbp, dop + off, chunk))
+            continue;
+        for (k = 0; (k < chunk) && (bbp[k] == dop[off + k]); ++k)
+            ;
+        /* INFORMATION field: offset of first miscompare */
+        mem_mk_sense(ptp, mdp, SPC_SK_MISCOMPARE, MISCOMPARE_VERIFY_ASC, 0,
+                     true, off + k, -1, -1, vb);
+        break;
+    }
+    free(bbp);
+    return res;
+}
+
+static int
+mem_unmap(struct sg_pt_linux_scsi * ptp, struct sg_mem_dev * mdp,
+          const uint8_t * cdbp, int vb)
+{
+    int res;
+    uint32_t k, plen, dlen, num_desc;
+    uint64_t lba, num;
+    const uint8_t * dop = (const uint8_t *)(sg_uintptr_t)
+                                ptp->io_hdr.dout_xferp;
+
+    if (0x1 & cdbp[1]) {        /* ANCHOR */
+        mem_mk_sense_invalid_fld(ptp, mdp, true, 1, 0, vb);
+        return 0;
+    }
+    if (mem_write_protected(ptp, mdp, vb))
+        return 0;
+    plen = sg_get_unaligned_be16(cdbp + 7);
+    plen = (plen < ptp->io_hdr.dout_xfer_len) ? plen :
+                                                ptp->io_hdr.dout_xfer_len;
+    if (plen < 8)
+        return 0;       /* nothing to do */
+    dlen = sg_get_unaligned_be16(dop + 2);
+    if (dlen > (plen - 8)) {
+        mem_mk_sense_asc(ptp, mdp, SPC_SK_ILLEGAL_REQUEST,
+                         PARAMETER_LIST_LENGTH_ERR, 0, vb);
+        return 0;
+    }
+    num_desc = dlen / 16;
+    if (num_desc > SG_MEM_MAX_UNMAP_DESCS) {
+        mem_mk_sense_invalid_fld(ptp, mdp, false, 2, -1, vb);
+        return 0;
+    }
+    for (k = 0; k < num_desc; ++k) {    /* check all before acting */
+        lba = sg_get_unaligned_be64(dop + 8 + (k * 16));
+        num = sg_get_unaligned_be32(dop + 8 + (k * 16) + 8);
+        if (mem_lba_out_of_range(ptp, mdp, lba, num, vb))
+            return 0;
+    }
+    for (k = 0; k < num_desc; ++k) {
+        lba = sg_get_unaligned_be64(dop + 8 + (k * 16));
+        num = sg_get_unaligned_be32(dop + 8 + (k * 16) + 8);
+        if (vb > 4)
+            pr2ws("%s: lba=0x%" PRIx64 ", num=%" PRIu64 "\n", __func__, lba,
+                  num);
+        res = mem_punch(mdp, lba, num);
+        if (res)
+            return res;
+    }
+    return 0;
+}
+
+/* WRITE SAME(10) and WRITE SAME(16). A block of zeros (or NDOB) with the
+ * UNMAP bit set unmaps, otherwise the block is written num times */
+static int
+mem_write_same(struct sg_pt_linux_scsi * ptp, struct sg_mem_dev * mdp,
+               const uint8_t * cdbp, int vb)
+{
+    bool is_16 = (SCSI_WRITE_SAME16_OPC == cdbp[0]);
+    bool unmap = !! (0x8 & cdbp[1]);
+    bool ndob = is_16 && (0x1 & cdbp[1]);
+    int res;
+    uint32_t k, per_chunk;
+    uint64_t lba, num, done, n;
+    const uint8_t * dop = NULL;
+    uint8_t * bbp;
+
+    if (is_16) {
+        lba = sg_get_unaligned_be64(cdbp + 2);
+        num = sg_get_unaligned_be32(cdbp + 10);
+    } else {
+        lba = sg_get_unaligned_be32(cdbp + 2);
+        num = sg_get_unaligned_be16(cdbp + 7);
+    }
+    if (vb > 4)
+        pr2ws("%s: lba=0x%" PRIx64 ", num=%" PRIu64 ", unmap=%d, ndob=%d\n",
+              __func__, lba, num, (int)unmap, (int)ndob);
+    if (0 == num) {             /* WSNZ=1 in Block limits VPD page */
+        mem_mk_sense_invalid_fld(ptp, mdp, true, (is_16 ? 10 : 7), -1, vb);
+        return 0;
+    }
+    if (mem_lba_out_of_range(ptp, mdp, lba, num, vb))
+        return 0;
+    if (mem_write_protected(ptp, mdp, vb))
+        return 0;
+    if (! ndob) {
+        if (ptp->io_hdr.dout_xfer_len < mdp->lb_sz) {
+            mem_mk_sense_invalid_fld(ptp, mdp, true, (is_16 ? 10 : 7), -1,
+                                     vb);
+            return 0;
+        }
+        dop = (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
+        ptp->io_hdr.dout_resid = ptp->io_hdr.dout_xfer_len - mdp->lb_sz;
+        if (sg_all_zeros(dop, mdp->lb_sz))
+            dop = NULL;
+    }
+    if (unmap && (NULL == dop))
+        return mem_punch(mdp, lba, num);
+    per_chunk = SG_MEM_BOUNCE_SZ / mdp->lb_sz;
+    bbp = (uint8_t *)calloc(per_chunk, mdp->lb_sz);
+    if (NULL == bbp)
+        return -ENOMEM;
+    if (dop) {
+        for (k = 0; k < per_chunk; ++k)
+            memcpy(bbp + (k * mdp->lb_sz), dop, mdp->lb_sz);
+    }
+    for (done = 0, res = 0; done < num; done += n) {
+        n = ((num - done) < per_chunk) ? (num - done) : per_chunk;
+        res = mem_pio(mdp, bbp, n * mdp->lb_sz, (lba + done) * mdp->lb_sz,
+                      true);
+        if (res)
+            break;
+    }
+    free(bbp);
+    if (0 == res)
+        mem_zone_written(mdp, lba, num);
+    return res;
+}
+
+/* GET LBA STATUS(16). Mapped and deallocated extents are found with
+ * lseek(SEEK_DATA) and lseek(SEEK_HOLE) on the store. */
+static int
+mem_get_lba_status(struct sg_pt_linux_scsi * ptp,
+                   const struct sg_mem_dev * mdp, const uint8_t * cdbp,
+                   int vb)
+{
+    int res = 0;
+    uint32_t k, alloc_len, max_desc;
+    uint64_t lba, end_lba, d_lba, h_lba;
+    off_t off, d_off, h_off;
+    uint8_t * gls_dout;
+
+    lba = sg_get_unaligned_be64(cdbp + 2);
+    alloc_len = sg_get_unaligned_be32(cdbp + 10);
+    if (vb > 4)
+        pr2ws("%s: lba=0x%" PRIx64 ", alloc_len=%u\n", __func__, lba,
+              alloc_len);
+    if (mem_lba_out_of_range(ptp, mdp, lba, 1, vb))
+        return 0;
+    max_desc = (alloc_len > 24) ? ((alloc_len - 8) / 16) : 1;
+    max_desc = (max_desc < 1024) ? max_desc : 1024;
+    gls_dout = (uint8_t *)calloc(1, 8 + (max_desc * 16));
+    if (NULL == gls_dout)
+        return -ENOMEM;
+    end_lba = mdp->num_lbs;
+    for (k = 0; (k < max_desc) && (lba < end_lba); ++k) {
+        off = (off_t)(lba * mdp->lb_sz);
+        d_off = lseek(mdp->fd, off, SEEK_DATA);
+        if (d_off < 0) {
+            if (ENXIO != errno) {
+                res = -errno;
+                break;
+            }
+            d_lba = end_lba;            /* hole to the end */
+        } else
+            d_lba = (uint64_t)d_off / mdp->lb_sz;
+        if (d_lba > lba) {              /* deallocated extent */
+            h_lba = d_lba;
+            gls_dout[8 + (k * 16) + 12] = 0x1;
+        } else {                        /* mapped extent */
+            h_off = lseek(mdp->fd, off, SEEK_HOLE);
+            if (h_off < 0) {
+                res = -errno;
+                break;
+            }
+            h_lba = ((uint64_t)h_off + mdp->lb_sz - 1) / mdp->lb_sz;
+            if (h_lba <= lba)
+                h_lba = lba + 1;
+        }
+        h_lba = (h_lba < end_lba) ? h_lba : end_lba;
+        if ((h_lba - lba) > UINT32_MAX)
+            h_lba = lba + UINT32_MAX;
+        sg_put_unaligned_be64(lba, gls_dout + 8 + (k * 16));
+        sg_put_unaligned_be32((uint32_t)(h_lba - lba),
+                              gls_dout + 8 + (k * 16) + 8);
+        lba = h_lba;
+    }
+    if (0 == res) {
+        sg_put_unaligned_be32(4 + (k * 16), gls_dout + 0);
+        mem_din_copy(ptp, gls_dout, 8 + (k * 16), alloc_len);
+    }
+    free(gls_dout);
+    return res;
+}
+
+/* REPORT ZONES. All zones are sequential write preferred */
+static int
+mem_report_zones(struct sg_pt_linux_scsi * ptp,
+                 const struct sg_mem_dev * mdp, const uint8_t * cdbp, int vb)
+{
+    bool partial = !! (0x80 & cdbp[14]);
+    int ro = 0x3f & cdbp[14];
+    int cond;
+    uint32_t z, alloc_len, max_desc, num_desc, num_match;
+    uint64_t lba, z_start, z_len, wp;
+    uint8_t * rz_dout;
+    uint8_t * dp;
+
+    if (0 == mdp->num_zones) {
+        mem_mk_sense_asc(ptp, mdp, SPC_SK_ILLEGAL_REQUEST, INVALID_OPCODE, 0,
+                         vb);
+        return 0;
+    }
+    lba = sg_get_unaligned_be64(cdbp + 2);
+    alloc_len = sg_get_unaligned_be32(cdbp + 10);
+    if (vb > 4)
+        pr2ws("%s: lba=0x%" PRIx64 ", alloc_len=%u, options=0x%x\n",
+              __func__, lba, alloc_len, ro);
+    if (mem_lba_out_of_range(ptp, mdp, lba, 1, vb))
+        return 0;
+    switch (ro) {
+    case 0x0:   /* all */
+    case 0x1:   /* empty */
+    case 0x2:   /* implicitly opened */
+    case 0x5:   /* full */
+    case 0x10:  /* reset write pointer recommended */
+    case 0x11:  /* non-sequential write resources active */
+    case 0x3f:  /* not write pointer */
+        break;
+    default:
+        mem_mk_sense_invalid_fld(ptp, mdp, true, 14, 5, vb);
+        return 0;
+    }
+    max_desc = (alloc_len > 64) ? ((alloc_len - 64) / 64) : 0;
+    max_desc = (max_desc < mdp->num_zones) ? max_desc : mdp->num_zones;
+    rz_dout = (uint8_t *)calloc(1, 64 + (max_desc * 64));
+    if (NULL == rz_dout)
+        return -ENOMEM;
+    num_desc = 0;
+    num_match = 0;
+    for (z = lba / mdp->zone_lbs; z < mdp->num_zones; ++z) {
+        z_start = (uint64_t)z * mdp->zone_lbs;
+        z_len = mdp->num_lbs - z_start;
+        z_len = (z_len < mdp->zone_lbs) ? z_len : mdp->zone_lbs;
+        wp = __atomic_load_n(mdp->zone_wp + z, __ATOMIC_RELAXED);
+        if (wp == z_start)
+            cond = 0x1;         /* EMPTY */
+        else if (wp >= (z_start + z_len))
+            cond = 0xe;         /* FULL */
+        else
+            cond = 0x2;         /* IMPLICITLY OPENED */
+        if ((0x1 == ro) && (0x1 != cond))
+            continue;
+        if ((0x2 == ro) && (0x2 != cond))
+            continue;
+        if ((0x5 == ro) && (0xe != cond))
+            continue;
+        if ((0x10 == ro) || (0x11 == ro) || (0x3f == ro))
+            continue;
+        ++num_match;
+        if (num_desc >= max_desc) {
+            if (partial)
+                break;
+            continue;
+        }
+        dp = rz_dout + 64 + (num_desc * 64);
+        dp[0] = 0x3;            /* sequential write preferred */
+        dp[1] = cond << 4;
+        sg_put_unaligned_be64(z_len, dp + 8);
+        sg_put_unaligned_be64(z_start, dp + 16);
+        sg_put_unaligned_be64((0xe == cond) ? UINT64_MAX : wp, dp + 24);
+        ++num_desc;
+    }
+    sg_put_unaligned_be32(num_match * 64, rz_dout + 0);
+    sg_put_unaligned_be64(mdp->num_lbs - 1, rz_dout + 8);
+    mem_din_copy(ptp, rz_dout, 64 + (num_desc * 64), alloc_len);
+    free(rz_dout);
+    return 0;
+}
+
+/* RESET WRITE POINTER: of the zone starting at the given LBA or, if the
+ * ALL bit is set, of all zones. The zones' data is unmapped. */
+static int
+mem_reset_wp(struct sg_pt_linux_scsi * ptp, struct sg_mem_dev * mdp,
+             const uint8_t * cdbp, int vb)
+{
+    bool all = !! (0x1 & cdbp[14]);
+    int res;
+    uint32_t z, z_first, z_last;
+    uint64_t lba = sg_get_unaligned_be64(cdbp + 2);
+    uint64_t z_start, z_len;
+
+    if (vb > 4)
+        pr2ws("%s: lba=0x%" PRIx64 ", all=%d\n", __func__, lba, (int)all);
+    if (0 == mdp->num_zones) {
+        mem_mk_sense_asc(ptp, mdp, SPC_SK_ILLEGAL_REQUEST, INVALID_OPCODE, 0,
+                         vb);
+        return 0;
+    }
+    if (mem_write_protected(ptp, mdp, vb))
+        return 0;
+    if (all) {
+        z_first = 0;
+        z_last = mdp->num_zones - 1;
+    } else {
+        if (mem_lba_out_of_range(ptp, mdp, lba, 1, vb))
+            return 0;
+        if (lba % mdp->zone_lbs) {      /* must be start of a zone */
+            mem_mk_sense_invalid_fld(ptp, mdp, true, 2, -1, vb);
+            return 0;
+        }
+        z_first = z_last = lba / mdp->zone_lbs;
+    }
+    for (z = z_first; z <= z_last; ++z) {
+        z_start = (uint64_t)z * mdp->zone_lbs;
+        z_len = mdp->num_lbs - z_start;
+        z_len = (z_len < mdp->zone_lbs) ? z_len : mdp->zone_lbs;
+        res = mem_punch(mdp, z_start, z_len);
+        if (res)
+            return res;
+        __atomic_store_n(mdp->zone_wp + z, z_start, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+/* Returns true (after building sense data) if this media access command
+ * is chosen by err_every=<n> to fail */
+static bool
+mem_inject_error(struct sg_pt_linux_scsi * ptp, struct sg_mem_dev * mdp,
+                 int vb)
+{
+    uint64_t count;
+
+    if (0 == mdp->err_every)
+        return false;
+    count = __atomic_add_fetch(&mdp->media_cmds, 1, __ATOMIC_RELAXED);
+    if (count % mdp->err_every)
+        return false;
+    if (vb > 2)
+        pr2ws("mem: injecting ABORTED COMMAND on media access command %"
+              PRIu64 "\n", count);
+    mem_mk_sense_asc(ptp, mdp, SPC_SK_ABORTED_COMMAND, TRANSPORT_PROBLEM, 0,
+                     vb);
+    return true;
+}
+
+static void
+mem_delay(const struct sg_mem_dev * mdp)
+{
+    struct timespec ts;
+
+    if (0 == mdp->lat_us)
+        return;
+    ts.tv_sec = mdp->lat_us / 1000000;
+    ts.tv_nsec = (mdp->lat_us % 1000000) * 1000;
+    while ((nanosleep(&ts, &ts) < 0) && (EINTR == errno))
+        ;
+}
+
+/* Executes the SCSI command in vp against the pseudo disk associated with
+ * its file descriptor. Returns 0 when a SCSI status (and possibly sense
+ * data) has been placed in vp, else a negated errno or one of the
+ * SCSI_PT_DO_* values as for do_scsi_pt(). */
+int
+sg_do_mem_pt(struct sg_pt_base * vp, int time_secs, int vb)
+{
+    int res = 0;
+    uint8_t sa;
+    struct sg_pt_linux_scsi * ptp = &vp->impl;
+    struct sg_mem_dev * mdp;
+    const uint8_t * cdbp;
+    struct timespec start_ts, end_ts;
+
+    cdbp = (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.request;
+    if (NULL == cdbp) {
+        if (vb)
+            pr2ws("No SCSI command (cdb) given\n");
+        return SCSI_PT_DO_BAD_PARAMS;
+    }
+    mdp = mem_dev_find(ptp->dev_fd);
+    if (NULL == mdp) {
+        if (vb)
+            pr2ws("%s: fd=%d is not a mem: device\n", __func__,
+                  ptp->dev_fd);
+        return -ENODEV;
+    }
+    if (vb > 3)
+        pr2ws("%s: opcode=0x%x, fd=%d, time_secs=%d\n", __func__, cdbp[0],
+              ptp->dev_fd, time_secs);
+    clock_gettime(CLOCK_MONOTONIC, &start_ts);
+    ptp->io_hdr.device_status = 0;
+    ptp->io_hdr.driver_status = 0;
+    ptp->io_hdr.transport_status = 0;
+    ptp->io_hdr.response_len = 0;
+    ptp->io_hdr.din_resid = 0;
+    ptp->io_hdr.dout_resid = 0;
+    ptp->os_err = 0;
+    mem_delay(mdp);
+    switch (cdbp[0]) {
+    case SCSI_TEST_UNIT_READY_OPC:
+        mem_tur(ptp, mdp, vb);
+        break;
+    case SCSI_REQUEST_SENSE_OPC:
+        mem_req_sense(ptp, mdp, cdbp, vb);
+        break;
+    case SCSI_INQUIRY_OPC:
+        mem_inq(ptp, mdp, cdbp, vb);
+        break;
+    case SCSI_REPORT_LUNS_OPC:
+        mem_rluns(ptp, mdp, cdbp, vb);
+        break;
+    case SCSI_READ_CAPACITY10_OPC:
+        mem_readcap(ptp, mdp, cdbp, vb);
+        break;
+    case SCSI_READ10_OPC:
+    case SCSI_READ16_OPC:
+    case SCSI_WRITE10_OPC:
+    case SCSI_WRITE16_OPC:
+        if (! mem_inject_error(ptp, mdp, vb))
+            res = mem_rw(ptp, mdp, cdbp, vb);
+        break;
+    case SCSI_VERIFY10_OPC:
+    case SCSI_VERIFY16_OPC:
+        if (! mem_inject_error(ptp, mdp, vb))
+            res = mem_verify(ptp, mdp, cdbp, vb);
+        break;
+    case SCSI_SYNC_CACHE10_OPC:
+    case SCSI_SYNC_CACHE16_OPC:
+        mem_inject_error(ptp, mdp, vb);    /* nothing cached */
+        break;
+    case SCSI_UNMAP_OPC:
+        if (! mem_inject_error(ptp, mdp, vb))
+            res = mem_unmap(ptp, mdp, cdbp, vb);
+        break;
+    case SCSI_WRITE_SAME10_OPC:
+    case SCSI_WRITE_SAME16_OPC:
+        if (! mem_inject_error(ptp, mdp, vb))
+            res = mem_write_same(ptp, mdp, cdbp, vb);
+        break;
+    case SCSI_SERVICE_ACT_IN_OPC:
+        sa = 0x1f & cdbp[1];
+        if (SCSI_READ_CAPACITY16_SA == sa)
+            mem_readcap(ptp, mdp, cdbp, vb);
+        else if (SCSI_GET_LBA_STATUS_SA == sa)
+            res = mem_get_lba_status(ptp, mdp, cdbp, vb);
+        else
+            goto unsupported;
+        break;
+    case SCSI_ZBC_IN_OPC:
+        if (SCSI_REPORT_ZONES_SA != (0x1f & cdbp[1]))
+            goto unsupported;
+        res = mem_report_zones(ptp, mdp, cdbp, vb);
+        break;
+    case SCSI_ZBC_OUT_OPC:
+        if (SCSI_RESET_WP_SA != (0x1f & cdbp[1]))
+            goto unsupported;
+        res = mem_reset_wp(ptp, mdp, cdbp, vb);
+        break;
+    default:
+unsupported:
+        if (vb > 2) {
+            char b[64];
+
+            sg_get_command_name(cdbp, -1, sizeof(b), b);
+            pr2ws("%s: SCSI %s command not supported\n", __func__, b);
+        }
+        mem_mk_sense_asc(ptp, mdp, SPC_SK_ILLEGAL_REQUEST, INVALID_OPCODE, 0,
+                         vb);
+        break;
+    }
+    if (res < 0) {
+        ptp->os_err = -res;
+        if (vb)
+            pr2ws("%s: store access failed: %s\n", __func__,
+                  safe_strerror(-res));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_ts);
+    ptp->io_hdr.duration = (end_ts.tv_sec - start_ts.tv_sec) * 1000 +
+                           (end_ts.tv_nsec - start_ts.tv_nsec) / 1000000;
+    return res;
+}
+
+/* Asynchronous commands on a pseudo disk are executed when submitted, the
+ * object is then placed on a per thread list of completed commands. */
+int
+sg_mem_async_submit(struct sg_pt_base * vp, int time_secs, int vb)
+{
+    int res = sg_do_mem_pt(vp, time_secs, vb);
+
+    if (res)
+        return res;
+    vp->impl.nvme_async_next = NULL;
+    if (mem_done_tail)
+        mem_done_tail->impl.nvme_async_next = vp;
+    else
+        mem_done_head = vp;
+    mem_done_tail = vp;
+    return 0;
+}
+
+/* Takes the oldest completed command on dev_fd, placing it in *objpp (if
+ * objpp is non-NULL). Returns -EAGAIN if there is none. */
+int
+sg_mem_async_receive(int dev_fd, struct sg_pt_base ** objpp, int vb)
+{
+    struct sg_pt_base * vp;
+    struct sg_pt_base * prev_vp = NULL;
+
+    if (objpp)
+        *objpp = NULL;
+    for (vp = mem_done_head; vp; prev_vp = vp, vp = vp->impl.nvme_async_next) {
+        if (dev_fd != vp->impl.dev_fd)
+            continue;
+        if (prev_vp)
+            prev_vp->impl.nvme_async_next = vp->impl.nvme_async_next;
+        else
+            mem_done_head = vp->impl.nvme_async_next;
+        if (mem_done_tail == vp)
+            mem_done_tail = prev_vp;
+        vp->impl.nvme_async_next = NULL;
+        if (objpp)
+            *objpp = vp;
+        return 0;
+    }
+    if (vb > 2)
+        pr2ws("%s: no completed commands on fd=%d\n", __func__, dev_fd);
+    return -EAGAIN;
+}
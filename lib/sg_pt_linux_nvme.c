@@ -41,11 +41,14 @@
  *                   MA 02110-1301, USA.
  */
 
-/* sg_pt_linux_nvme version 1.05 20180602 */
+/* sg_pt_linux_nvme version 1.06 20261015 */
 
-/* This file contains a small "SPC-only" SNTL to support the SES pass-through
- * of SEND DIAGNOSTIC and RECEIVE DIAGNOSTIC RESULTS through NVME-MI
- * SES Send and SES Receive. */
+/* This file contains a small SNTL (SCSI to NVMe translation layer). Apart
+ * from some SPC commands it supports the SES pass-through of SEND DIAGNOSTIC
+ * and RECEIVE DIAGNOSTIC RESULTS through NVME-MI SES Send and SES Receive.
+ * The SBC commands READ, WRITE, VERIFY, SYNCHRONIZE CACHE, READ CAPACITY,
+ * UNMAP and WRITE SAME are translated to NVMe NVM (IO) commands sent via
+ * NVME_IOCTL_IO_CMD . */
 
 
 #include <stdio.h>
@@ -73,6 +76,20 @@
 
 #include <linux/major.h>
 
+/* io_uring NVMe pass-through (IORING_OP_URING_CMD) needs lk 5.19 headers */
+#if defined(HAVE_LINUX_IO_URING_H) && defined(HAVE_LINUX_NVME_IOCTL_H) && \
+    defined(__GNUC__)
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <linux/nvme_ioctl.h>   /* before sg_pt_linux.h */
+#if defined(NVME_URING_CMD_IO) && defined(IORING_SETUP_SQE128) && \
+    defined(__NR_io_uring_setup)
+#define SG_NVME_URING 1
+#endif
+#endif
+
 #include "sg_pt.h"
 #include "sg_lib.h"
 #include "sg_linux_inc.h"
@@ -91,6 +108,20 @@
 #define SCSI_REP_SUP_TMFS_OPC  0xd
 #define SCSI_MODE_SENSE10_OPC  0x5a
 #define SCSI_MODE_SELECT10_OPC  0x55
+#define SCSI_READ_CAPACITY10_OPC  0x25
+#define SCSI_READ10_OPC  0x28
+#define SCSI_WRITE10_OPC  0x2a
+#define SCSI_VERIFY10_OPC  0x2f
+#define SCSI_SYNC_CACHE10_OPC  0x35
+#define SCSI_READ16_OPC  0x88
+#define SCSI_WRITE16_OPC  0x8a
+#define SCSI_VERIFY16_OPC  0x8f
+#define SCSI_SYNC_CACHE16_OPC  0x91
+#define SCSI_SERVICE_ACT_IN_OPC  0x9e
+#define SCSI_READ_CAPACITY16_SA  0x10
+#define SCSI_WRITE_SAME10_OPC  0x41
+#define SCSI_UNMAP_OPC  0x42
+#define SCSI_WRITE_SAME16_OPC  0x93
 
 /* Additional Sense Code (ASC) */
 #define NO_ADDITIONAL_SENSE 0x0
@@ -101,6 +132,7 @@
 #define INVALID_OPCODE 0x20
 #define LBA_OUT_OF_RANGE 0x21
 #define INVALID_FIELD_IN_CDB 0x24
+#define LU_NOT_SUPPORTED_ASC 0x25
 #define INVALID_FIELD_IN_PARAM_LIST 0x26
 #define UA_RESET_ASC 0x29
 #define UA_CHANGED_ASC 0x2a
@@ -257,17 +289,50 @@ mk_sense_invalid_fld(struct sg_pt_linux_scsi * ptp, bool in_cdb, int in_byte,
               ((in_bit > 0) ? (0x7 & in_bit) : 0));
 }
 
+/* Places the completion queue entry's CDW0 (result) and status field (res:
+ * CDW3 31:17) in ptp. For NVMe commands given directly, a 32 byte "sense"
+ * buffer holding them is built. Returns ((SCT << 8) | SC). */
+static uint16_t
+nvme_set_completion(struct sg_pt_linux_scsi * ptp, uint32_t result, int res)
+{
+    uint16_t sct_sc;
+    uint32_t n;
+
+    ptp->nvme_result = result;
+    if (ptp->nvme_direct && ptp->io_hdr.response &&
+        (ptp->io_hdr.max_response_len > 3)) {
+        /* build 32 byte "sense" buffer */
+        uint8_t * sbp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.response;
+        uint16_t st = (uint16_t)res;
+
+        n = ptp->io_hdr.max_response_len;
+        n = (n < 32) ? n : 32;
+        memset(sbp, 0 , n);
+        ptp->io_hdr.response_len = n;
+        sg_put_unaligned_le32(result, sbp + SG_NVME_PT_CQ_RESULT);
+        if (n > 15) /* LSBit will be 0 (Phase bit) after (st << 1) */
+            sg_put_unaligned_le16(st << 1, sbp + SG_NVME_PT_CQ_STATUS_P);
+    }
+    /* clear upper bits (DNR and More) leaving ((SCT << 8) | SC) */
+    sct_sc = 0x7ff & res;       /* 11 bits */
+    ptp->nvme_status = sct_sc;
+    ptp->nvme_stat_dnr = !!(0x4000 & res);
+    ptp->nvme_stat_more = !!(0x2000 & res);
+    return sct_sc;
+}
+
 /* Returns 0 for success. Returns SG_LIB_NVME_STATUS if there is non-zero
  * NVMe status (from the completion queue) with the value placed in
  * ptp->nvme_status. If Unix error from ioctl then return negated value
  * (equivalent -errno from basic Unix system functions like open()).
  * CDW0 from the completion queue is placed in ptp->nvme_result in the
  * absence of a Unix error. If time_secs is negative it is treated as
- * a timeout in milliseconds (of abs(time_secs) ). */
+ * a timeout in milliseconds (of abs(time_secs) ). When is_admin is true
+ * the command is sent via NVME_IOCTL_ADMIN_CMD, otherwise it is an NVM (IO)
+ * command sent via NVME_IOCTL_IO_CMD . */
 static int
-do_nvme_admin_cmd(struct sg_pt_linux_scsi * ptp,
-                  struct sg_nvme_passthru_cmd *cmdp, void * dp, bool is_read,
-                  int time_secs, int vb)
+do_nvme_cmd(struct sg_pt_linux_scsi * ptp, struct sg_nvme_passthru_cmd *cmdp,
+            void * dp, bool is_read, bool is_admin, int time_secs, int vb)
 {
     const uint32_t cmd_len = sizeof(struct sg_nvme_passthru_cmd);
     int res;
@@ -277,13 +342,13 @@ do_nvme_admin_cmd(struct sg_pt_linux_scsi * ptp,
     char nam[64];
 
     if (vb)
-        sg_get_nvme_opcode_name(*up, true, sizeof(nam), nam);
+        sg_get_nvme_opcode_name(*up, is_admin, sizeof(nam), nam);
     else
         nam[0] = '\0';
     cmdp->timeout_ms = (time_secs < 0) ? (-time_secs) : (1000 * time_secs);
     ptp->os_err = 0;
     if (vb > 2) {
-        pr2ws("NVMe Admin command: %s\n", nam);
+        pr2ws("NVMe %s command: %s\n", (is_admin ? "Admin" : "IO"), nam);
         hex2stderr((const uint8_t *)cmdp, cmd_len, 1);
         if ((vb > 3) && (! is_read) && dp) {
             uint32_t len = sg_get_unaligned_le32(up + SG_NVME_PT_DATA_LEN);
@@ -300,7 +365,8 @@ do_nvme_admin_cmd(struct sg_pt_linux_scsi * ptp,
             }
         }
     }
-    res = ioctl(ptp->dev_fd, NVME_IOCTL_ADMIN_CMD, cmdp);
+    res = ioctl(ptp->dev_fd, (is_admin ? NVME_IOCTL_ADMIN_CMD :
+                                         NVME_IOCTL_IO_CMD), cmdp);
     if (res < 0) {  /* OS error (errno negated) */
         ptp->os_err = -res;
         if (vb > 1) {
@@ -311,27 +377,7 @@ do_nvme_admin_cmd(struct sg_pt_linux_scsi * ptp,
     }
 
     /* Now res contains NVMe completion queue CDW3 31:17 (15 bits) */
-    ptp->nvme_result = cmdp->result;
-    if (ptp->nvme_direct && ptp->io_hdr.response &&
-        (ptp->io_hdr.max_response_len > 3)) {
-        /* build 32 byte "sense" buffer */
-        uint8_t * sbp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.response;
-        uint16_t st = (uint16_t)res;
-
-        n = ptp->io_hdr.max_response_len;
-        n = (n < 32) ? n : 32;
-        memset(sbp, 0 , n);
-        ptp->io_hdr.response_len = n;
-        sg_put_unaligned_le32(cmdp->result,
-                              sbp + SG_NVME_PT_CQ_RESULT);
-        if (n > 15) /* LSBit will be 0 (Phase bit) after (st << 1) */
-            sg_put_unaligned_le16(st << 1, sbp + SG_NVME_PT_CQ_STATUS_P);
-    }
-    /* clear upper bits (DNR and More) leaving ((SCT << 8) | SC) */
-    sct_sc = 0x7ff & res;       /* 11 bits */
-    ptp->nvme_status = sct_sc;
-    ptp->nvme_stat_dnr = !!(0x4000 & res);
-    ptp->nvme_stat_more = !!(0x2000 & res);
+    sct_sc = nvme_set_completion(ptp, cmdp->result, res);
     if (sct_sc) {  /* when non-zero, treat as command error */
         if (vb > 1) {
             char b[80];
@@ -359,6 +405,22 @@ do_nvme_admin_cmd(struct sg_pt_linux_scsi * ptp,
     return 0;
 }
 
+static inline int
+do_nvme_admin_cmd(struct sg_pt_linux_scsi * ptp,
+                  struct sg_nvme_passthru_cmd *cmdp, void * dp, bool is_read,
+                  int time_secs, int vb)
+{
+    return do_nvme_cmd(ptp, cmdp, dp, is_read, true, time_secs, vb);
+}
+
+static inline int
+do_nvme_io_cmd(struct sg_pt_linux_scsi * ptp,
+               struct sg_nvme_passthru_cmd *cmdp, void * dp, bool is_read,
+               int time_secs, int vb)
+{
+    return do_nvme_cmd(ptp, cmdp, dp, is_read, false, time_secs, vb);
+}
+
 static void
 sntl_check_enclosure_override(struct sg_pt_linux_scsi * ptp, int vb)
 {
@@ -440,6 +502,98 @@ sntl_cache_identity(struct sg_pt_linux_scsi * ptp, int time_secs, int vb)
     return (ret < 0) ? sg_convert_errno(-ret) : ret;
 }
 
+/* Caches the identify namespace response (4096 bytes) for ptp->nvme_nsid .
+ * Returns 0 on success; otherwise a positive value is returned */
+static int
+sntl_cache_ns_identity(struct sg_pt_linux_scsi * ptp, int time_secs, int vb)
+{
+    int ret;
+    uint32_t pg_sz = sg_get_page_size();
+    uint8_t * up;
+    struct sg_nvme_passthru_cmd cmd;
+
+    up = sg_memalign(pg_sz, pg_sz, &ptp->free_nvme_id_nsp, false);
+    ptp->nvme_id_nsp = up;
+    if (NULL == up) {
+        pr2ws("%s: sg_memalign() failed to get memory\n", __func__);
+        return sg_convert_errno(ENOMEM);
+    }
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.opcode = 0x6;   /* Identify */
+    cmd.nsid = ptp->nvme_nsid;
+    cmd.cdw10 = 0x0;    /* CNS=0x0 Identify namespace */
+    cmd.addr = (uint64_t)(sg_uintptr_t)ptp->nvme_id_nsp;
+    cmd.data_len = pg_sz;
+    ret = do_nvme_admin_cmd(ptp, &cmd, up, true, time_secs, vb);
+    if (ret) {
+        free(ptp->free_nvme_id_nsp);
+        ptp->free_nvme_id_nsp = NULL;
+        ptp->nvme_id_nsp = NULL;
+    }
+    return (ret < 0) ? sg_convert_errno(-ret) : ret;
+}
+
+/* True if the identify namespace response is cached or can be fetched */
+static bool
+sntl_have_ns_identity(struct sg_pt_linux_scsi * ptp, int time_secs, int vb)
+{
+    if (ptp->nvme_id_nsp)
+        return true;
+    if ((0 == ptp->nvme_nsid) || (ptp->nvme_nsid >= SG_NVME_BROADCAST_NSID))
+        return false;
+    return (0 == sntl_cache_ns_identity(ptp, time_secs, vb > 3));
+}
+
+static uint32_t sntl_max_lbs_per_cmd(const struct sg_pt_linux_scsi * ptp);
+
+/* Fills in the Block Limits VPD page (0xb0) fields after the page length.
+ * The limits are those of single NVMe commands: Dataset Management takes
+ * up to 256 ranges, Write Zeroes up to 65536 blocks. */
+static void
+sntl_block_limits_vpd(struct sg_pt_linux_scsi * ptp, uint8_t * dop,
+                      int time_secs, int vb)
+{
+    uint16_t oncs = sg_get_unaligned_le16(ptp->nvme_id_ctlp + 520);
+    const uint8_t * nsp;
+
+    dop[4] = 0x1;       /* WSNZ=1, WRITE SAME with 0 blocks is rejected */
+    if (! sntl_have_ns_identity(ptp, time_secs, vb))
+        return;
+    nsp = ptp->nvme_id_nsp;
+    sg_put_unaligned_be32(sntl_max_lbs_per_cmd(ptp), dop + 8);
+    if (0x10 & nsp[24]) {       /* NSFEAT: OPTPERF, NPWG and NPDG valid */
+        /* NPWG -> OPTIMAL TRANSFER LENGTH GRANULARITY */
+        sg_put_unaligned_be16(sg_get_unaligned_le16(nsp + 64) + 1, dop + 6);
+        /* NPDG -> OPTIMAL UNMAP GRANULARITY */
+        sg_put_unaligned_be32(sg_get_unaligned_le16(nsp + 68) + 1,
+                              dop + 28);
+    }
+    if (0x4 & oncs) {           /* Dataset Management supported */
+        sg_put_unaligned_be32(0xffffffff, dop + 20);
+        sg_put_unaligned_be32(256, dop + 24);
+    }
+    if (0x8 & oncs)             /* Write Zeroes supported */
+        sg_put_unaligned_be64(0x10000, dop + 36);
+}
+
+/* Fills in the Logical Block Provisioning VPD page (0xb2) fields after the
+ * page length. Deallocated blocks read back as zeros when DLFEAT says so. */
+static void
+sntl_lb_prov_vpd(struct sg_pt_linux_scsi * ptp, uint8_t * dop, int time_secs,
+                 int vb)
+{
+    uint16_t oncs = sg_get_unaligned_le16(ptp->nvme_id_ctlp + 520);
+
+    if (0x4 & oncs)
+        dop[5] |= 0x80;         /* LBPU: UNMAP supported */
+    dop[5] |= 0x60;             /* LBPWS and LBPWS10 */
+    if (sntl_have_ns_identity(ptp, time_secs, vb) &&
+        (0x1 == (0x7 & ptp->nvme_id_nsp[33])))
+        dop[5] |= 0x4;          /* LBPRZ: DLFEAT says deallocated -> zeros */
+    if (0x4 & oncs)
+        dop[6] = 0x2;           /* provisioning type: thin */
+}
+
 static const char * nvme_scsi_vendor_str = "NVMe    ";
 static const uint16_t inq_resp_len = 36;
 
@@ -480,7 +634,7 @@ sntl_inq(struct sg_pt_linux_scsi * ptp, const uint8_t * cdbp, int time_secs,
         case 0:
             /* inq_dout[0] = (PQ=0)<<5 | (PDT=0); prefer pdt=0xd --> SES */
             inq_dout[1] = pg_cd;
-            n = 11;
+            n = 13;
             sg_put_unaligned_be16(n - 4, inq_dout + 2);
             inq_dout[4] = 0x0;
             inq_dout[5] = 0x80;
@@ -488,6 +642,8 @@ sntl_inq(struct sg_pt_linux_scsi * ptp, const uint8_t * cdbp, int time_secs,
             inq_dout[7] = 0x86;
             inq_dout[8] = 0x87;
             inq_dout[9] = 0x92;
+            inq_dout[10] = 0xb0;
+            inq_dout[11] = 0xb2;
             inq_dout[n - 1] = SG_NVME_VPD_NICR;     /* last VPD number */
             break;
         case 0x80:
@@ -553,6 +709,18 @@ sntl_inq(struct sg_pt_linux_scsi * ptp, const uint8_t * cdbp, int time_secs,
             sg_put_unaligned_be16(n - 4, inq_dout + 2);
             inq_dout[9] = 0x1;  /* SFS SPC Discovery 2016 */
             break;
+        case 0xb0:      /* Block limits */
+            inq_dout[1] = pg_cd;
+            n = 64;
+            sg_put_unaligned_be16(n - 4, inq_dout + 2);
+            sntl_block_limits_vpd(ptp, inq_dout, time_secs, vb);
+            break;
+        case 0xb2:      /* Logical block provisioning */
+            inq_dout[1] = pg_cd;
+            n = 8;
+            sg_put_unaligned_be16(n - 4, inq_dout + 2);
+            sntl_lb_prov_vpd(ptp, inq_dout, time_secs, vb);
+            break;
         case SG_NVME_VPD_NICR:  /* 0xde (vendor (sg3_utils) specific) */
             inq_dout[1] = pg_cd;
             sg_put_unaligned_be16((16 + 4096) - 4, inq_dout + 2);
@@ -1158,120 +1326,1555 @@ sntl_rep_tmfs(struct sg_pt_linux_scsi * ptp, const uint8_t * cdbp,
     return 0;
 }
 
-/* Executes NVMe Admin command (or at least forwards it to lower layers).
- * Returns 0 for success, negative numbers are negated 'errno' values from
- * OS system calls. Positive return values are errors from this package.
- * When time_secs is 0 the Linux NVMe Admin command default of 60 seconds
- * is used. */
-int
-sg_do_nvme_pt(struct sg_pt_base * vp, int fd, int time_secs, int vb)
+/* Logical block size (in bytes) of the current format of the namespace.
+ * Assumes the identify namespace response has been cached. */
+static uint32_t
+sntl_ns_lb_sz(const struct sg_pt_linux_scsi * ptp)
 {
-    bool scsi_cdb;
-    bool is_read = false;
-    int n, len, hold_dev_fd;
-    uint16_t sa;
-    struct sg_pt_linux_scsi * ptp = &vp->impl;
-    struct sg_nvme_passthru_cmd cmd;
-    const uint8_t * cdbp;
-    void * dp = NULL;
-;
-    if (! ptp->io_hdr.request) {
+    const uint8_t * up = ptp->nvme_id_nsp;
+    uint8_t lbads = up[128 + (4 * (0xf & up[26])) + 2];  /* FLBAS -> LBAF */
+
+    return (lbads < 9) ? 512 : (1U << lbads);
+}
+
+/* Number of logical blocks in the namespace (NSZE) */
+static uint64_t
+sntl_ns_nsze(const struct sg_pt_linux_scsi * ptp)
+{
+    return sg_get_unaligned_le64(ptp->nvme_id_nsp + 0);
+}
+
+/* Maximum number of logical blocks that one NVMe IO command can carry. The
+ * NLB field is 16 bits (0 based) and the controller may have a Maximum
+ * Data Transfer Size (MDTS) which is in units of the minimum memory page
+ * size (CAP.MPSMIN), assumed here to be 4096 bytes. */
+static uint32_t
+sntl_max_lbs_per_cmd(const struct sg_pt_linux_scsi * ptp)
+{
+    uint8_t mdts = ptp->nvme_id_ctlp[77];
+    uint32_t mx_lbs = 0x10000;
+    uint64_t mx_bytes;
+
+    if (mdts > 0) {
+        mx_bytes = (uint64_t)4096 << ((mdts > 32) ? 32 : mdts);
+        mx_bytes /= sntl_ns_lb_sz(ptp);
+        if (mx_bytes < mx_lbs)
+            mx_lbs = (mx_bytes > 0) ? (uint32_t)mx_bytes : 1;
+    }
+    return mx_lbs;
+}
+
+/* Called by SNTL commands that access the medium of a namespace (e.g.
+ * READ and WRITE). Caches the identify controller and namespace responses
+ * if that has not already been done. Returns 0 if the caller should
+ * continue. If *sense_madep is set on return then sense data has been built
+ * and the caller should return 0. Other returned values are errors that
+ * the caller should return. */
+static int
+sntl_prep_media_access(struct sg_pt_linux_scsi * ptp, bool * sense_madep,
+                       int time_secs, int vb)
+{
+    int res;
+    const uint8_t * up;
+
+    *sense_madep = false;
+    if (NULL == ptp->nvme_id_ctlp) {
+        res = sntl_cache_identity(ptp, time_secs, vb);
+        if (SG_LIB_NVME_STATUS == res) {
+            mk_sense_from_nvme_status(ptp, vb);
+            *sense_madep = true;
+            return 0;
+        } else if (res)
+            return res;
+    }
+    if ((0 == ptp->nvme_nsid) || (ptp->nvme_nsid >= SG_NVME_BROADCAST_NSID)) {
+        /* e.g. the NVMe char device: /dev/nvme0 */
         if (vb)
-            pr2ws("No NVMe command given (set_scsi_pt_cdb())\n");
-        return SCSI_PT_DO_BAD_PARAMS;
+            pr2ws("%s: media access needs a namespace (e.g. /dev/nvme0n1)\n",
+                  __func__);
+        mk_sense_asc_ascq(ptp, SPC_SK_ILLEGAL_REQUEST, LU_NOT_SUPPORTED_ASC,
+                          0, vb);
+        *sense_madep = true;
+        return 0;
     }
-    hold_dev_fd = ptp->dev_fd;
-    if (fd >= 0) {
-        if ((ptp->dev_fd >= 0) && (fd != ptp->dev_fd)) {
-            if (vb)
-                pr2ws("%s: file descriptor given to create() and here "
-                      "differ\n", __func__);
-            return SCSI_PT_DO_BAD_PARAMS;
-        }
-        ptp->dev_fd = fd;
-    } else if (ptp->dev_fd < 0) {
+    if (NULL == ptp->nvme_id_nsp) {
+        res = sntl_cache_ns_identity(ptp, time_secs, vb);
+        if (SG_LIB_NVME_STATUS == res) {
+            mk_sense_from_nvme_status(ptp, vb);
+            *sense_madep = true;
+            return 0;
+        } else if (res)
+            return res;
+    }
+    up = ptp->nvme_id_nsp;
+    if ((0x10 & up[26]) && sg_get_unaligned_le16(up + 128 +
+                                                 (4 * (0xf & up[26])))) {
+        /* metadata interleaved with data is not expected by SCSI users */
         if (vb)
-            pr2ws("%s: invalid file descriptors\n", __func__);
-        return SCSI_PT_DO_BAD_PARAMS;
+            pr2ws("%s: extended LBA format with metadata not supported\n",
+                  __func__);
+        mk_sense_asc_ascq(ptp, SPC_SK_ILLEGAL_REQUEST, INVALID_OPCODE, 0, vb);
+        *sense_madep = true;
     }
-    n = ptp->io_hdr.request_len;
-    cdbp = (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.request;
-    if (vb > 3)
-        pr2ws("%s: opcode=0x%x, fd=%d (dev_fd=%d), time_secs=%d\n", __func__,
-              cdbp[0], fd, hold_dev_fd, time_secs);
-    scsi_cdb = sg_is_scsi_cdb(cdbp, n);
-    /* direct NVMe command (i.e. 64 bytes long) or SNTL */
-    ptp->nvme_direct = ! scsi_cdb;
-    if (scsi_cdb) {
-        switch (cdbp[0]) {
-        case SCSI_INQUIRY_OPC:
-            return sntl_inq(ptp, cdbp, time_secs, vb);
-        case SCSI_REPORT_LUNS_OPC:
-            return sntl_rluns(ptp, cdbp, time_secs, vb);
-        case SCSI_TEST_UNIT_READY_OPC:
-            return sntl_tur(ptp, time_secs, vb);
-        case SCSI_REQUEST_SENSE_OPC:
-            return sntl_req_sense(ptp, cdbp, time_secs, vb);
-        case SCSI_SEND_DIAGNOSTIC_OPC:
-            return sntl_senddiag(ptp, cdbp, time_secs, vb);
-        case SCSI_RECEIVE_DIAGNOSTIC_OPC:
-            return sntl_recvdiag(ptp, cdbp, time_secs, vb);
-        case SCSI_MODE_SENSE10_OPC:
-        case SCSI_MODE_SELECT10_OPC:
-            return sntl_mode_ss(ptp, cdbp, time_secs, vb);
-        case SCSI_MAINT_IN_OPC:
-            sa = 0x1f & cdbp[1];        /* service action */
-            if (SCSI_REP_SUP_OPCS_OPC == sa)
-                return sntl_rep_opcodes(ptp, cdbp, time_secs, vb);
-            else if (SCSI_REP_SUP_TMFS_OPC == sa)
-                return sntl_rep_tmfs(ptp, cdbp, time_secs, vb);
-            /* fall through */
-        default:
-            if (vb > 2) {
-                char b[64];
+    return 0;
+}
 
-                sg_get_command_name(cdbp, -1, sizeof(b), b);
-                pr2ws("%s: no translation to NVMe for SCSI %s command\n",
-                      __func__, b);
-            }
-            mk_sense_asc_ascq(ptp, SPC_SK_ILLEGAL_REQUEST, INVALID_OPCODE,
-                              0, vb);
-            return 0;
+/* Issues NVMe IO command nvme_opc (e.g. Read, Write or Compare) for num_lbs
+ * logical blocks starting at lba. If necessary it is split into several
+ * NVMe commands, see sntl_max_lbs_per_cmd(). dp may be NULL for commands
+ * without a data transfer (e.g. Verify). Returns values as per
+ * do_nvme_cmd() . */
+static int
+sntl_do_media_cmd(struct sg_pt_linux_scsi * ptp, uint8_t nvme_opc,
+                  uint64_t lba, uint32_t num_lbs, bool fua, uint8_t * dp,
+                  bool is_read, int time_secs, int vb)
+{
+    int res;
+    uint32_t n;
+    const uint32_t lb_sz = sntl_ns_lb_sz(ptp);
+    const uint32_t mx_lbs = sntl_max_lbs_per_cmd(ptp);
+    struct sg_nvme_passthru_cmd cmd;
+
+    for ( ; num_lbs > 0; num_lbs -= n, lba += n) {
+        n = (num_lbs < mx_lbs) ? num_lbs : mx_lbs;
+        memset(&cmd, 0, sizeof(cmd));
+        cmd.opcode = nvme_opc;
+        cmd.nsid = ptp->nvme_nsid;
+        cmd.cdw10 = (uint32_t)lba;              /* SLBA, lower dword */
+        cmd.cdw11 = (uint32_t)(lba >> 32);      /* SLBA, upper dword */
+        cmd.cdw12 = 0xffff & (n - 1);           /* NLB is 0 based */
+        if (fua)
+            cmd.cdw12 |= 0x40000000;
+        if (dp) {
+            cmd.addr = (uint64_t)(sg_uintptr_t)dp;
+            cmd.data_len = n * lb_sz;
         }
+        res = do_nvme_io_cmd(ptp, &cmd, dp, is_read, time_secs, vb);
+        if (res)
+            return res;
+        if (dp)
+            dp += n * lb_sz;
     }
-    len = (int)sizeof(cmd);
-    n = (n < len) ? n : len;
-    if (n < 64) {
+    return 0;
+}
+
+/* Returns true (after building sense data) if the range of num_lbs logical
+ * blocks starting at lba is not within the namespace */
+static bool
+sntl_lba_out_of_range(struct sg_pt_linux_scsi * ptp, uint64_t lba,
+                      uint32_t num_lbs, int vb)
+{
+    uint64_t nsze = sntl_ns_nsze(ptp);
+
+    if ((lba < nsze) && (num_lbs <= (nsze - lba)))
+        return false;
+    if (vb)
+        pr2ws("%s: lba=0x%" PRIx64 ", num=%u exceeds capacity (0x%" PRIx64
+              " blocks)\n", __func__, lba, num_lbs, nsze);
+    mk_sense_asc_ascq(ptp, SPC_SK_ILLEGAL_REQUEST, LBA_OUT_OF_RANGE, 0, vb);
+    return true;
+}
+
+/* SCSI READ(10), READ(16), WRITE(10) and WRITE(16) to NVMe Read and Write
+ * commands. Protection information is not supported so RDPROTECT and
+ * WRPROTECT must be zero. */
+static int
+sntl_rw(struct sg_pt_linux_scsi * ptp, const uint8_t * cdbp, int time_secs,
+        int vb)
+{
+    bool is_read, fua, sense_made;
+    int res;
+    uint32_t num_lbs, xfer_len;
+    uint64_t lba, len;
+    uint8_t * dp;
+
+    is_read = ((SCSI_READ10_OPC == cdbp[0]) || (SCSI_READ16_OPC == cdbp[0]));
+    if ((SCSI_READ10_OPC == cdbp[0]) || (SCSI_WRITE10_OPC == cdbp[0])) {
+        lba = sg_get_unaligned_be32(cdbp + 2);
+        num_lbs = sg_get_unaligned_be16(cdbp + 7);
+    } else {
+        lba = sg_get_unaligned_be64(cdbp + 2);
+        num_lbs = sg_get_unaligned_be32(cdbp + 10);
+    }
+    fua = !! (0x8 & cdbp[1]);
+    if (vb > 3)
+        pr2ws("%s: %s lba=0x%" PRIx64 ", num=%u, fua=%d, time_secs=%d\n",
+              __func__, (is_read ? "read" : "write"), lba, num_lbs, (int)fua,
+              time_secs);
+    if (0xe0 & cdbp[1]) {       /* RDPROTECT or WRPROTECT */
+        mk_sense_invalid_fld(ptp, true, 1, 7, vb);
+        return 0;
+    }
+    res = sntl_prep_media_access(ptp, &sense_made, time_secs, vb);
+    if (res || sense_made)
+        return res;
+    if (sntl_lba_out_of_range(ptp, lba, num_lbs, vb))
+        return 0;
+    if (0 == num_lbs)
+        return 0;
+    len = (uint64_t)num_lbs * sntl_ns_lb_sz(ptp);
+    if (is_read) {
+        xfer_len = ptp->io_hdr.din_xfer_len;
+        dp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.din_xferp;
+    } else {
+        xfer_len = ptp->io_hdr.dout_xfer_len;
+        dp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
+    }
+    if ((NULL == dp) || (len > xfer_len)) {
         if (vb)
-            pr2ws("%s: command length of %d bytes is too short\n", __func__,
-                  n);
+            pr2ws("%s: data-%s buffer too short: %u bytes, need %" PRIu64
+                  "\n", __func__, (is_read ? "in" : "out"), xfer_len, len);
         return SCSI_PT_DO_BAD_PARAMS;
     }
-    memcpy(&cmd, (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.request, n);
-    if (n < len)        /* zero out rest of 'cmd' */
-        memset((uint8_t *)&cmd + n, 0, len - n);
-    if (ptp->io_hdr.din_xfer_len > 0) {
-        cmd.data_len = ptp->io_hdr.din_xfer_len;
-        dp = (void *)(sg_uintptr_t)ptp->io_hdr.din_xferp;
-        cmd.addr = (uint64_t)(sg_uintptr_t)ptp->io_hdr.din_xferp;
-        is_read = true;
-    } else if (ptp->io_hdr.dout_xfer_len > 0) {
-        cmd.data_len = ptp->io_hdr.dout_xfer_len;
-        dp = (void *)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
-        cmd.addr = (uint64_t)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
-        is_read = false;
-    }
-    return do_nvme_admin_cmd(ptp, &cmd, dp, is_read, time_secs, vb);
+    res = sntl_do_media_cmd(ptp, (is_read ? 0x2 : 0x1), lba, num_lbs, fua,
+                            dp, is_read, time_secs, vb);
+    if (SG_LIB_NVME_STATUS == res) {
+        mk_sense_from_nvme_status(ptp, vb);
+        return 0;
+    } else if (res)
+        return res;
+    if (is_read)
+        ptp->io_hdr.din_resid = xfer_len - (uint32_t)len;
+    else
+        ptp->io_hdr.dout_resid = xfer_len - (uint32_t)len;
+    return 0;
 }
 
-#else           /* (HAVE_NVME && (! IGNORE_NVME)) [around line 140] */
-
-int
-sg_do_nvme_pt(struct sg_pt_base * vp, int fd, int time_secs, int vb)
+/* SCSI VERIFY(10) and VERIFY(16). BYTCHK=0 maps to NVMe Verify and
+ * BYTCHK=1 maps to NVMe Compare. If the controller does not support the
+ * required command (see ONCS in identify controller) then the blocks are
+ * read into a bounce buffer and, for BYTCHK=1, compared in this code. */
+static int
+sntl_verify(struct sg_pt_linux_scsi * ptp, const uint8_t * cdbp,
+            int time_secs, int vb)
 {
-    if (vb) {
-        pr2ws("%s: not supported, ", __func__);
-#ifdef HAVE_NVME
+    bool is_cmp, nvme_cmd_ok, sense_made;
+    int res;
+    uint8_t bytchk;
+    uint16_t oncs;
+    uint32_t num_lbs, n, lb_sz, bb_lbs, pg_sz;
+    uint64_t lba, len;
+    uint8_t * dop = NULL;
+    uint8_t * bbp;
+    uint8_t * free_bbp;
+
+    if (SCSI_VERIFY10_OPC == cdbp[0]) {
+        lba = sg_get_unaligned_be32(cdbp + 2);
+        num_lbs = sg_get_unaligned_be16(cdbp + 7);
+    } else {
+        lba = sg_get_unaligned_be64(cdbp + 2);
+        num_lbs = sg_get_unaligned_be32(cdbp + 10);
+    }
+    bytchk = 0x3 & (cdbp[1] >> 1);
+    if (vb > 3)
+        pr2ws("%s: lba=0x%" PRIx64 ", num=%u, bytchk=%u, time_secs=%d\n",
+              __func__, lba, num_lbs, bytchk, time_secs);
+    if (0xe0 & cdbp[1]) {       /* VRPROTECT */
+        mk_sense_invalid_fld(ptp, true, 1, 7, vb);
+        return 0;
+    }
+    if (bytchk > 1) {   /* 2 is reserved, 3 (compare one block) unsupported */
+        mk_sense_invalid_fld(ptp, true, 1, 2, vb);
+        return 0;
+    }
+    is_cmp = (1 == bytchk);
+    res = sntl_prep_media_access(ptp, &sense_made, time_secs, vb);
+    if (res || sense_made)
+        return res;
+    if (sntl_lba_out_of_range(ptp, lba, num_lbs, vb))
+        return 0;
+    if (0 == num_lbs)
+        return 0;
+    lb_sz = sntl_ns_lb_sz(ptp);
+    len = (uint64_t)num_lbs * lb_sz;
+    if (is_cmp) {
+        dop = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
+        if ((NULL == dop) || (len > ptp->io_hdr.dout_xfer_len)) {
+            if (vb)
+                pr2ws("%s: data-out buffer too short: %u bytes, need %"
+                      PRIu64 "\n", __func__, ptp->io_hdr.dout_xfer_len, len);
+            return SCSI_PT_DO_BAD_PARAMS;
+        }
+    }
+    oncs = sg_get_unaligned_le16(ptp->nvme_id_ctlp + 520);
+    nvme_cmd_ok = is_cmp ? !! (0x1 & oncs) : !! (0x80 & oncs);
+    if (nvme_cmd_ok) {
+        res = sntl_do_media_cmd(ptp, (is_cmp ? 0x5 : 0xc), lba, num_lbs,
+                                false, dop, false, time_secs, vb);
+        goto fini;
+    }
+    /* Controller lacks NVMe Compare or Verify, so read blocks instead */
+    pg_sz = sg_get_page_size();
+    bb_lbs = (1024 * 1024) / lb_sz;
+    if (0 == bb_lbs)
+        bb_lbs = 1;
+    n = (num_lbs < bb_lbs) ? num_lbs : bb_lbs;
+    bbp = sg_memalign(n * lb_sz, pg_sz, &free_bbp, false);
+    if (NULL == bbp) {
+        pr2ws("%s: sg_memalign() failed to get memory\n", __func__);
+        return sg_convert_errno(ENOMEM);
+    }
+    for (res = 0 ; num_lbs > 0; num_lbs -= n, lba += n) {
+        n = (num_lbs < bb_lbs) ? num_lbs : bb_lbs;
+        res = sntl_do_media_cmd(ptp, 0x2, lba, n, false, bbp, true,
+                                time_secs, vb);
+        if (res)
+            break;
+        if (is_cmp) {
+            if (memcmp(bbp, dop, n * lb_sz)) {
+                if (vb)
+                    pr2ws("%s: miscompare in blocks starting at lba=0x%"
+                          PRIx64 "\n", __func__, lba);
+                mk_sense_asc_ascq(ptp, SPC_SK_MISCOMPARE,
+                                  MISCOMPARE_VERIFY_ASC, 0, vb);
+                break;
+            }
+            dop += n * lb_sz;
+        }
+    }
+    free(free_bbp);
+fini:
+    if (SG_LIB_NVME_STATUS == res) {
+        mk_sense_from_nvme_status(ptp, vb);
+        return 0;
+    } else if (res)
+        return res;
+    if (is_cmp && (SAM_STAT_CHECK_CONDITION != ptp->io_hdr.device_status))
+        ptp->io_hdr.dout_resid = ptp->io_hdr.dout_xfer_len - (uint32_t)len;
+    return 0;
+}
+
+/* SCSI SYNCHRONIZE CACHE(10) and (16) to NVMe Flush. The LBA range is
+ * ignored so the whole namespace is flushed; SBC permits that. If the
+ * controller reports no volatile write cache (VWC) there is nothing to do. */
+static int
+sntl_sync_cache(struct sg_pt_linux_scsi * ptp, const uint8_t * cdbp,
+                int time_secs, int vb)
+{
+    bool sense_made;
+    int res;
+    struct sg_nvme_passthru_cmd cmd;
+
+    if (vb > 3)
+        pr2ws("%s: immed=%d, time_secs=%d\n", __func__,
+              (int)!!(0x2 & cdbp[1]), time_secs);
+    res = sntl_prep_media_access(ptp, &sense_made, time_secs, vb);
+    if (res || sense_made)
+        return res;
+    if (0 == (0x1 & ptp->nvme_id_ctlp[525])) {
+        if (vb > 3)
+            pr2ws("%s: no volatile write cache so nothing to flush\n",
+                  __func__);
+        return 0;
+    }
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.opcode = 0x0;   /* Flush */
+    cmd.nsid = ptp->nvme_nsid;
+    res = do_nvme_io_cmd(ptp, &cmd, NULL, false, time_secs, vb);
+    if (SG_LIB_NVME_STATUS == res) {
+        mk_sense_from_nvme_status(ptp, vb);
+        return 0;
+    }
+    return res;
+}
+
+/* SCSI READ CAPACITY(10) and READ CAPACITY(16), built from the identify
+ * namespace response */
+static int
+sntl_readcap(struct sg_pt_linux_scsi * ptp, const uint8_t * cdbp,
+             int time_secs, int vb)
+{
+    bool is_rc16 = (SCSI_SERVICE_ACT_IN_OPC == cdbp[0]);
+    bool sense_made;
+    int res;
+    uint32_t alloc_len, n, lb_sz;
+    uint64_t last_lba;
+    uint8_t rc_dout[32];
+
+    if (vb > 3)
+        pr2ws("%s: READ CAPACITY(%d), time_secs=%d\n", __func__,
+              (is_rc16 ? 16 : 10), time_secs);
+    res = sntl_prep_media_access(ptp, &sense_made, time_secs, vb);
+    if (res || sense_made)
+        return res;
+    last_lba = sntl_ns_nsze(ptp);
+    last_lba = (last_lba > 0) ? (last_lba - 1) : 0;
+    lb_sz = sntl_ns_lb_sz(ptp);
+    memset(rc_dout, 0, sizeof(rc_dout));
+    if (is_rc16) {
+        alloc_len = sg_get_unaligned_be32(cdbp + 10);
+        sg_put_unaligned_be64(last_lba, rc_dout + 0);
+        sg_put_unaligned_be32(lb_sz, rc_dout + 8);
+        if (0x4 & sg_get_unaligned_le16(ptp->nvme_id_ctlp + 520)) {
+            rc_dout[14] = 0x80;         /* LBPME: DSM deallocate */
+            if (0x1 == (0x7 & ptp->nvme_id_nsp[33]))
+                rc_dout[14] |= 0x40;    /* LBPRZ */
+        }
+        n = 32;
+    } else {
+        alloc_len = 8;
+        if (last_lba > 0xfffffffe)      /* tell user to use RC(16) */
+            sg_put_unaligned_be32(0xffffffff, rc_dout + 0);
+        else
+            sg_put_unaligned_be32((uint32_t)last_lba, rc_dout + 0);
+        sg_put_unaligned_be32(lb_sz, rc_dout + 4);
+        n = 8;
+    }
+    n = (alloc_len < n) ? alloc_len : n;
+    n = (n < ptp->io_hdr.din_xfer_len) ? n : ptp->io_hdr.din_xfer_len;
+    ptp->io_hdr.din_resid = ptp->io_hdr.din_xfer_len - n;
+    if (n > 0)
+        memcpy((uint8_t *)(sg_uintptr_t)ptp->io_hdr.din_xferp, rc_dout, n);
+    return 0;
+}
+
+/* Sends one NVMe Dataset Management command with the deallocate (AD)
+ * attribute for num_rng ranges (1 to 256) held in rngp */
+static int
+sntl_do_dsm_dealloc(struct sg_pt_linux_scsi * ptp, uint8_t * rngp,
+                    uint32_t num_rng, int time_secs, int vb)
+{
+    struct sg_nvme_passthru_cmd cmd;
+
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.opcode = 0x9;   /* Dataset Management */
+    cmd.nsid = ptp->nvme_nsid;
+    cmd.addr = (uint64_t)(sg_uintptr_t)rngp;
+    cmd.data_len = num_rng * 16;
+    cmd.cdw10 = 0xff & (num_rng - 1);   /* NR is 0 based */
+    cmd.cdw11 = 0x4;                    /* AD: attribute deallocate */
+    return do_nvme_io_cmd(ptp, &cmd, rngp, false, time_secs, vb);
+}
+
+/* SCSI UNMAP to NVMe Dataset Management (deallocate). The block descriptors
+ * in the parameter list are gathered into batches of up to 256 ranges, the
+ * most one NVMe command accepts. All descriptors are checked before any
+ * range is deallocated. */
+static int
+sntl_unmap(struct sg_pt_linux_scsi * ptp, const uint8_t * cdbp, int time_secs,
+           int vb)
+{
+    bool sense_made;
+    int res;
+    uint32_t param_len, bd_len, num_bd, k, num_lbs, nr;
+    uint32_t pg_sz = sg_get_page_size();
+    uint64_t lba;
+    const uint8_t * dop;
+    const uint8_t * bdp;
+    uint8_t * rngp;
+    uint8_t * free_rngp;
+
+    param_len = sg_get_unaligned_be16(cdbp + 7);
+    if (vb > 3)
+        pr2ws("%s: param_len=%u, time_secs=%d\n", __func__, param_len,
+              time_secs);
+    if (0x1 & cdbp[1]) {        /* ANCHOR */
+        mk_sense_invalid_fld(ptp, true, 1, 0, vb);
+        return 0;
+    }
+    res = sntl_prep_media_access(ptp, &sense_made, time_secs, vb);
+    if (res || sense_made)
+        return res;
+    if (0 == (0x4 & sg_get_unaligned_le16(ptp->nvme_id_ctlp + 520))) {
+        if (vb > 1)
+            pr2ws("%s: controller lacks Dataset Management\n", __func__);
+        mk_sense_asc_ascq(ptp, SPC_SK_ILLEGAL_REQUEST, INVALID_OPCODE, 0, vb);
+        return 0;
+    }
+    if (0 == param_len)
+        return 0;
+    dop = (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
+    if ((NULL == dop) || (param_len > ptp->io_hdr.dout_xfer_len)) {
+        if (vb)
+            pr2ws("%s: data-out buffer too short: %u bytes, need %u\n",
+                  __func__, ptp->io_hdr.dout_xfer_len, param_len);
+        return SCSI_PT_DO_BAD_PARAMS;
+    }
+    if (param_len < 8) {
+        mk_sense_asc_ascq(ptp, SPC_SK_ILLEGAL_REQUEST,
+                          PARAMETER_LIST_LENGTH_ERR, 0, vb);
+        return 0;
+    }
+    bd_len = sg_get_unaligned_be16(dop + 2);
+    if (bd_len > (param_len - 8))
+        bd_len = param_len - 8;
+    num_bd = bd_len / 16;
+    for (k = 0, bdp = dop + 8; k < num_bd; ++k, bdp += 16) {
+        lba = sg_get_unaligned_be64(bdp + 0);
+        num_lbs = sg_get_unaligned_be32(bdp + 8);
+        if (sntl_lba_out_of_range(ptp, lba, num_lbs, vb))
+            return 0;
+    }
+    rngp = sg_memalign(pg_sz, pg_sz, &free_rngp, false);
+    if (NULL == rngp) {
+        pr2ws("%s: sg_memalign() failed to get memory\n", __func__);
+        return sg_convert_errno(ENOMEM);
+    }
+    for (k = 0, nr = 0, res = 0, bdp = dop + 8; k < num_bd; ++k, bdp += 16) {
+        num_lbs = sg_get_unaligned_be32(bdp + 8);
+        if (0 == num_lbs)
+            continue;
+        memset(rngp + (nr * 16), 0, 16);
+        sg_put_unaligned_le32(num_lbs, rngp + (nr * 16) + 4);
+        sg_put_unaligned_le64(sg_get_unaligned_be64(bdp + 0),
+                              rngp + (nr * 16) + 8);
+        if (++nr >= 256) {
+            res = sntl_do_dsm_dealloc(ptp, rngp, nr, time_secs, vb);
+            if (res)
+                break;
+            nr = 0;
+        }
+    }
+    if ((0 == res) && (nr > 0))
+        res = sntl_do_dsm_dealloc(ptp, rngp, nr, time_secs, vb);
+    free(free_rngp);
+    if (SG_LIB_NVME_STATUS == res) {
+        mk_sense_from_nvme_status(ptp, vb);
+        return 0;
+    } else if (res)
+        return res;
+    ptp->io_hdr.dout_resid = ptp->io_hdr.dout_xfer_len - param_len;
+    return 0;
+}
+
+/* SCSI WRITE SAME(10) and (16). When NDOB is set or the data-out block is
+ * all zeros this becomes NVMe Write Zeroes, with DEAC (deallocate) set if
+ * the UNMAP bit is set. Otherwise (or if the controller lacks Write Zeroes)
+ * the block is replicated in a bounce buffer and written with NVMe Write. */
+static int
+sntl_write_same(struct sg_pt_linux_scsi * ptp, const uint8_t * cdbp,
+                int time_secs, int vb)
+{
+    bool is_ws16 = (SCSI_WRITE_SAME16_OPC == cdbp[0]);
+    bool unmap, ndob, zeros, sense_made;
+    int res;
+    uint32_t num_lbs, n, k, lb_sz, bb_lbs;
+    uint32_t pg_sz = sg_get_page_size();
+    uint64_t lba;
+    const uint8_t * dop = NULL;
+    uint8_t * bbp;
+    uint8_t * free_bbp;
+    struct sg_nvme_passthru_cmd cmd;
+
+    if (is_ws16) {
+        lba = sg_get_unaligned_be64(cdbp + 2);
+        num_lbs = sg_get_unaligned_be32(cdbp + 10);
+    } else {
+        lba = sg_get_unaligned_be32(cdbp + 2);
+        num_lbs = sg_get_unaligned_be16(cdbp + 7);
+    }
+    unmap = !! (0x8 & cdbp[1]);
+    ndob = is_ws16 && (0x1 & cdbp[1]);
+    if (vb > 3)
+        pr2ws("%s: lba=0x%" PRIx64 ", num=%u, unmap=%d, ndob=%d, "
+              "time_secs=%d\n", __func__, lba, num_lbs, (int)unmap,
+              (int)ndob, time_secs);
+    if (0xe0 & cdbp[1]) {       /* WRPROTECT */
+        mk_sense_invalid_fld(ptp, true, 1, 7, vb);
+        return 0;
+    }
+    if (0x10 & cdbp[1]) {       /* ANCHOR */
+        mk_sense_invalid_fld(ptp, true, 1, 4, vb);
+        return 0;
+    }
+    res = sntl_prep_media_access(ptp, &sense_made, time_secs, vb);
+    if (res || sense_made)
+        return res;
+    if (0 == num_lbs) {         /* Block limits VPD page has WSNZ=1 */
+        mk_sense_invalid_fld(ptp, true, (is_ws16 ? 10 : 7), -1, vb);
+        return 0;
+    }
+    if (sntl_lba_out_of_range(ptp, lba, num_lbs, vb))
+        return 0;
+    lb_sz = sntl_ns_lb_sz(ptp);
+    if (! ndob) {
+        dop = (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
+        if ((NULL == dop) || (lb_sz > ptp->io_hdr.dout_xfer_len)) {
+            if (vb)
+                pr2ws("%s: data-out buffer too short: %u bytes, need %u\n",
+                      __func__, ptp->io_hdr.dout_xfer_len, lb_sz);
+            return SCSI_PT_DO_BAD_PARAMS;
+        }
+    }
+    zeros = ndob || sg_all_zeros(dop, lb_sz);
+    if (zeros && (0x8 & sg_get_unaligned_le16(ptp->nvme_id_ctlp + 520))) {
+        for ( ; num_lbs > 0; num_lbs -= n, lba += n) {
+            n = (num_lbs < 0x10000) ? num_lbs : 0x10000;
+            memset(&cmd, 0, sizeof(cmd));
+            cmd.opcode = 0x8;   /* Write Zeroes */
+            cmd.nsid = ptp->nvme_nsid;
+            cmd.cdw10 = (uint32_t)lba;
+            cmd.cdw11 = (uint32_t)(lba >> 32);
+            cmd.cdw12 = 0xffff & (n - 1);
+            if (unmap)
+                cmd.cdw12 |= 0x2000000;         /* DEAC */
+            res = do_nvme_io_cmd(ptp, &cmd, NULL, false, time_secs, vb);
+            if (res)
+                break;
+        }
+    } else {
+        bb_lbs = (1024 * 1024) / lb_sz;
+        if (0 == bb_lbs)
+            bb_lbs = 1;
+        n = (num_lbs < bb_lbs) ? num_lbs : bb_lbs;
+        bbp = sg_memalign(n * lb_sz, pg_sz, &free_bbp, false);
+        if (NULL == bbp) {
+            pr2ws("%s: sg_memalign() failed to get memory\n", __func__);
+            return sg_convert_errno(ENOMEM);
+        }
+        if (! zeros) {  /* sg_memalign() has already zeroed the buffer */
+            for (k = 0; k < n; ++k)
+                memcpy(bbp + (k * lb_sz), dop, lb_sz);
+        }
+        for ( ; num_lbs > 0; num_lbs -= n, lba += n) {
+            n = (num_lbs < bb_lbs) ? num_lbs : bb_lbs;
+            res = sntl_do_media_cmd(ptp, 0x1, lba, n, false, bbp, false,
+                                    time_secs, vb);
+            if (res)
+                break;
+        }
+        free(free_bbp);
+    }
+    if (SG_LIB_NVME_STATUS == res) {
+        mk_sense_from_nvme_status(ptp, vb);
+        return 0;
+    } else if (res)
+        return res;
+    if (! ndob)
+        ptp->io_hdr.dout_resid = ptp->io_hdr.dout_xfer_len - lb_sz;
+    return 0;
+}
+
+/* Copies the NVMe command given directly (e.g. by set_scsi_pt_cdb()) into
+ * *cmdp and points it at the data-in or data-out buffer. Returns 0 or
+ * SCSI_PT_DO_BAD_PARAMS . */
+static int
+nvme_direct_build(struct sg_pt_linux_scsi * ptp,
+                  struct sg_nvme_passthru_cmd * cmdp, void ** dpp,
+                  bool * is_readp, int vb)
+{
+    int n = ptp->io_hdr.request_len;
+    int len = (int)sizeof(*cmdp);
+
+    n = (n < len) ? n : len;
+    if (n < 64) {
+        if (vb)
+            pr2ws("%s: command length of %d bytes is too short\n", __func__,
+                  n);
+        return SCSI_PT_DO_BAD_PARAMS;
+    }
+    memcpy(cmdp, (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.request, n);
+    if (n < len)        /* zero out rest of 'cmd' */
+        memset((uint8_t *)cmdp + n, 0, len - n);
+    *dpp = NULL;
+    if (ptp->io_hdr.din_xfer_len > 0) {
+        cmdp->data_len = ptp->io_hdr.din_xfer_len;
+        *dpp = (void *)(sg_uintptr_t)ptp->io_hdr.din_xferp;
+        cmdp->addr = (uint64_t)(sg_uintptr_t)ptp->io_hdr.din_xferp;
+        *is_readp = true;
+    } else if (ptp->io_hdr.dout_xfer_len > 0) {
+        cmdp->data_len = ptp->io_hdr.dout_xfer_len;
+        *dpp = (void *)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
+        cmdp->addr = (uint64_t)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
+        *is_readp = false;
+    }
+    return 0;
+}
+
+/* Executes NVMe Admin command (or at least forwards it to lower layers).
+ * Returns 0 for success, negative numbers are negated 'errno' values from
+ * OS system calls. Positive return values are errors from this package.
+ * When time_secs is 0 the Linux NVMe Admin command default of 60 seconds
+ * is used. */
+int
+sg_do_nvme_pt(struct sg_pt_base * vp, int fd, int time_secs, int vb)
+{
+    bool scsi_cdb;
+    bool is_read = false;
+    int n, hold_dev_fd;
+    uint16_t sa;
+    struct sg_pt_linux_scsi * ptp = &vp->impl;
+    struct sg_nvme_passthru_cmd cmd;
+    const uint8_t * cdbp;
+    void * dp = NULL;
+;
+    if (! ptp->io_hdr.request) {
+        if (vb)
+            pr2ws("No NVMe command given (set_scsi_pt_cdb())\n");
+        return SCSI_PT_DO_BAD_PARAMS;
+    }
+    hold_dev_fd = ptp->dev_fd;
+    if (fd >= 0) {
+        if ((ptp->dev_fd >= 0) && (fd != ptp->dev_fd)) {
+            if (vb)
+                pr2ws("%s: file descriptor given to create() and here "
+                      "differ\n", __func__);
+            return SCSI_PT_DO_BAD_PARAMS;
+        }
+        ptp->dev_fd = fd;
+    } else if (ptp->dev_fd < 0) {
+        if (vb)
+            pr2ws("%s: invalid file descriptors\n", __func__);
+        return SCSI_PT_DO_BAD_PARAMS;
+    }
+    n = ptp->io_hdr.request_len;
+    cdbp = (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.request;
+    if (vb > 3)
+        pr2ws("%s: opcode=0x%x, fd=%d (dev_fd=%d), time_secs=%d\n", __func__,
+              cdbp[0], fd, hold_dev_fd, time_secs);
+    scsi_cdb = sg_is_scsi_cdb(cdbp, n);
+    /* direct NVMe command (i.e. 64 bytes long) or SNTL */
+    ptp->nvme_direct = ! scsi_cdb;
+    if (scsi_cdb) {
+        switch (cdbp[0]) {
+        case SCSI_INQUIRY_OPC:
+            return sntl_inq(ptp, cdbp, time_secs, vb);
+        case SCSI_REPORT_LUNS_OPC:
+            return sntl_rluns(ptp, cdbp, time_secs, vb);
+        case SCSI_TEST_UNIT_READY_OPC:
+            return sntl_tur(ptp, time_secs, vb);
+        case SCSI_REQUEST_SENSE_OPC:
+            return sntl_req_sense(ptp, cdbp, time_secs, vb);
+        case SCSI_SEND_DIAGNOSTIC_OPC:
+            return sntl_senddiag(ptp, cdbp, time_secs, vb);
+        case SCSI_RECEIVE_DIAGNOSTIC_OPC:
+            return sntl_recvdiag(ptp, cdbp, time_secs, vb);
+        case SCSI_MODE_SENSE10_OPC:
+        case SCSI_MODE_SELECT10_OPC:
+            return sntl_mode_ss(ptp, cdbp, time_secs, vb);
+        case SCSI_READ10_OPC:
+        case SCSI_READ16_OPC:
+        case SCSI_WRITE10_OPC:
+        case SCSI_WRITE16_OPC:
+            return sntl_rw(ptp, cdbp, time_secs, vb);
+        case SCSI_VERIFY10_OPC:
+        case SCSI_VERIFY16_OPC:
+            return sntl_verify(ptp, cdbp, time_secs, vb);
+        case SCSI_SYNC_CACHE10_OPC:
+        case SCSI_SYNC_CACHE16_OPC:
+            return sntl_sync_cache(ptp, cdbp, time_secs, vb);
+        case SCSI_READ_CAPACITY10_OPC:
+            return sntl_readcap(ptp, cdbp, time_secs, vb);
+        case SCSI_UNMAP_OPC:
+            return sntl_unmap(ptp, cdbp, time_secs, vb);
+        case SCSI_WRITE_SAME10_OPC:
+        case SCSI_WRITE_SAME16_OPC:
+            return sntl_write_same(ptp, cdbp, time_secs, vb);
+        case SCSI_SERVICE_ACT_IN_OPC:
+            if (SCSI_READ_CAPACITY16_SA == (0x1f & cdbp[1]))
+                return sntl_readcap(ptp, cdbp, time_secs, vb);
+            goto no_translation;
+        case SCSI_MAINT_IN_OPC:
+            sa = 0x1f & cdbp[1];        /* service action */
+            if (SCSI_REP_SUP_OPCS_OPC == sa)
+                return sntl_rep_opcodes(ptp, cdbp, time_secs, vb);
+            else if (SCSI_REP_SUP_TMFS_OPC == sa)
+                return sntl_rep_tmfs(ptp, cdbp, time_secs, vb);
+            /* fall through */
+        default:
+no_translation:
+            if (vb > 2) {
+                char b[64];
+
+                sg_get_command_name(cdbp, -1, sizeof(b), b);
+                pr2ws("%s: no translation to NVMe for SCSI %s command\n",
+                      __func__, b);
+            }
+            mk_sense_asc_ascq(ptp, SPC_SK_ILLEGAL_REQUEST, INVALID_OPCODE,
+                              0, vb);
+            return 0;
+        }
+    }
+    n = nvme_direct_build(ptp, &cmd, &dp, &is_read, vb);
+    if (n)
+        return n;
+    return do_nvme_admin_cmd(ptp, &cmd, dp, is_read, time_secs, vb);
+}
+
+
+/*
+ * Asynchronous NVMe commands for do_pt_submit() and do_pt_receive().
+ *
+ * Each thread has up to SG_NVME_URING_SLOTS io_uring rings, one per device
+ * file descriptor, so the submit and receive paths need no locking. The
+ * rings are freed when their thread exits (by a pthread key destructor)
+ * and when their device is closed: by scsi_pt_close_device() in the
+ * calling thread, while the rings other threads hold for that device are
+ * marked stale and freed by those threads on their next use. Commands are
+ * placed in 128 byte SQEs as IORING_OP_URING_CMD (NVME_URING_CMD_IO or
+ * NVME_URING_CMD_ADMIN) and their 32 byte CQEs are reaped by
+ * sg_nvme_async_receive(). If io_uring is unavailable, disabled or the
+ * device lacks uring_cmd (e.g. a NVMe block device) the ioctl() path is
+ * used instead: the command is executed when submitted and placed on a per
+ * thread list of completed commands.
+ */
+
+#ifdef __GNUC__
+#define SG_NVME_TLS __thread
+#else
+#define SG_NVME_TLS
+#endif
+
+static SG_NVME_TLS struct sg_pt_base * nvme_done_head;
+static SG_NVME_TLS struct sg_pt_base * nvme_done_tail;
+
+static void
+nvme_done_append(struct sg_pt_base * vp)
+{
+    vp->impl.nvme_async_next = NULL;
+    if (nvme_done_tail)
+        nvme_done_tail->impl.nvme_async_next = vp;
+    else
+        nvme_done_head = vp;
+    nvme_done_tail = vp;
+}
+
+/* Removes and returns the oldest completed command for dev_fd, or NULL */
+static struct sg_pt_base *
+nvme_done_take(int dev_fd)
+{
+    struct sg_pt_base * vp;
+    struct sg_pt_base * prev_vp = NULL;
+
+    for (vp = nvme_done_head; vp; prev_vp = vp, vp = vp->impl.nvme_async_next) {
+        if (dev_fd != vp->impl.dev_fd)
+            continue;
+        if (prev_vp)
+            prev_vp->impl.nvme_async_next = vp->impl.nvme_async_next;
+        else
+            nvme_done_head = vp->impl.nvme_async_next;
+        if (nvme_done_tail == vp)
+            nvme_done_tail = prev_vp;
+        vp->impl.nvme_async_next = NULL;
+        return vp;
+    }
+    return NULL;
+}
+
+#ifdef SG_NVME_URING
+
+#define SG_NVME_URING_DEF_DEPTH 128
+#define SG_NVME_URING_MAX_DEPTH 4096
+#define SG_NVME_URING_SLOTS 4
+
+struct sg_nvme_uring {
+    bool in_use;
+    bool ioctl_only;    /* no io_uring or no uring_cmd: use ioctl()s */
+    bool stale;         /* dev_fd closed by another thread (atomic) */
+    bool cmd_ok;        /* a uring_cmd has completed on this ring */
+    int dev_fd;
+    int ring_fd;        /* -1 if no ring */
+    uint32_t to_submit; /* SQEs queued but not yet given to the kernel */
+    uint32_t in_flight; /* SQEs queued whose CQEs are not yet reaped */
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t * sq_head;
+    uint32_t * sq_tail;
+    uint32_t * sq_mask;
+    uint32_t * sq_array;
+    uint32_t * cq_head;
+    uint32_t * cq_tail;
+    uint32_t * cq_mask;
+    uint8_t * sqes;     /* 128 byte SQEs (IORING_SETUP_SQE128) */
+    uint8_t * cqes;     /* 32 byte CQEs (IORING_SETUP_CQE32) */
+    void * sq_ring_p;
+    void * cq_ring_p;
+    size_t sq_ring_sz;
+    size_t cq_ring_sz;
+    size_t sqes_sz;
+};
+
+#define SG_NVME_SQE_SZ (2 * sizeof(struct io_uring_sqe))
+#define SG_NVME_CQE_SZ (2 * sizeof(struct io_uring_cqe))
+
+static int sg_nvme_uring_q_depth = -1;  /* -1: check environment first */
+
+/* A thread's rings. Each table is on a list (guarded by nvme_uring_mutex)
+ * so sg_nvme_async_release() can find the rings of other threads. Claiming
+ * and freeing a slot also take that mutex; other slot fields are only
+ * touched by the owning thread. */
+struct sg_nvme_uring_tbl {
+    struct sg_nvme_uring arr[SG_NVME_URING_SLOTS];
+    struct sg_nvme_uring_tbl * next;
+};
+
+static pthread_mutex_t nvme_uring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t nvme_uring_once = PTHREAD_ONCE_INIT;
+static pthread_key_t nvme_uring_key;
+static bool nvme_uring_key_ok;
+static struct sg_nvme_uring_tbl * nvme_uring_tbl_head;
+
+static SG_NVME_TLS struct sg_nvme_uring_tbl * nvme_uring_tbl;
+
+static int
+nvme_uring_depth(void)
+{
+    int k;
+    const char * cp;
+
+    if (sg_nvme_uring_q_depth < 0) {
+        k = SG_NVME_URING_DEF_DEPTH;
+        cp = getenv("SG3_UTILS_NVME_URING");
+        if (cp && (1 == sscanf(cp, "%d", &k)) && (k < 0))
+            k = 0;
+        sg_nvme_uring_q_depth = (k > SG_NVME_URING_MAX_DEPTH) ?
+                                SG_NVME_URING_MAX_DEPTH : k;
+    }
+    return sg_nvme_uring_q_depth;
+}
+
+static void
+nvme_uring_unmap(struct sg_nvme_uring * urp)
+{
+    if (urp->sqes)
+        munmap(urp->sqes, urp->sqes_sz);
+    if (urp->cq_ring_p && (urp->cq_ring_p != urp->sq_ring_p))
+        munmap(urp->cq_ring_p, urp->cq_ring_sz);
+    if (urp->sq_ring_p)
+        munmap(urp->sq_ring_p, urp->sq_ring_sz);
+    if (urp->ring_fd >= 0)
+        close(urp->ring_fd);
+    urp->sqes = NULL;
+    urp->sq_ring_p = NULL;
+    urp->cq_ring_p = NULL;
+    urp->ring_fd = -1;
+}
+
+/* Frees the ring in *urp and its slot; called by the owning thread */
+static void
+nvme_uring_teardown(struct sg_nvme_uring * urp)
+{
+    nvme_uring_unmap(urp);
+    pthread_mutex_lock(&nvme_uring_mutex);
+    memset(urp, 0, sizeof(*urp));
+    urp->ring_fd = -1;
+    pthread_mutex_unlock(&nvme_uring_mutex);
+}
+
+/* pthread key destructor: frees the rings of an exiting thread */
+static void
+nvme_uring_tbl_free(void * p)
+{
+    int k;
+    struct sg_nvme_uring_tbl * tp = (struct sg_nvme_uring_tbl *)p;
+    struct sg_nvme_uring_tbl ** tpp;
+
+    pthread_mutex_lock(&nvme_uring_mutex);
+    for (tpp = &nvme_uring_tbl_head; *tpp; tpp = &(*tpp)->next) {
+        if (tp == *tpp) {
+            *tpp = tp->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&nvme_uring_mutex);
+    for (k = 0; k < SG_NVME_URING_SLOTS; ++k) {
+        if (tp->arr[k].in_use)
+            nvme_uring_unmap(tp->arr + k);
+    }
+    if (tp == nvme_uring_tbl)
+        nvme_uring_tbl = NULL;
+    free(tp);
+}
+
+static void
+nvme_uring_key_init(void)
+{
+    nvme_uring_key_ok = (0 == pthread_key_create(&nvme_uring_key,
+                                                 nvme_uring_tbl_free));
+}
+
+/* Returns this thread's table of rings. If it has none and create is true
+ * then one is allocated; NULL if none (or out of memory). */
+static struct sg_nvme_uring_tbl *
+nvme_uring_tbl_get(bool create)
+{
+    int k;
+    struct sg_nvme_uring_tbl * tp = nvme_uring_tbl;
+
+    if (tp || (! create))
+        return tp;
+    pthread_once(&nvme_uring_once, nvme_uring_key_init);
+    tp = (struct sg_nvme_uring_tbl *)calloc(1, sizeof(*tp));
+    if (NULL == tp)
+        return NULL;
+    for (k = 0; k < SG_NVME_URING_SLOTS; ++k)
+        tp->arr[k].ring_fd = -1;
+    pthread_mutex_lock(&nvme_uring_mutex);
+    tp->next = nvme_uring_tbl_head;
+    nvme_uring_tbl_head = tp;
+    pthread_mutex_unlock(&nvme_uring_mutex);
+    if (nvme_uring_key_ok)
+        pthread_setspecific(nvme_uring_key, tp);
+    nvme_uring_tbl = tp;
+    return tp;
+}
+
+/* io_uring_setup() errors meaning this kernel can never give a ring for
+ * NVMe uring_cmds. EINVAL is only returned there for unknown setup flags
+ * (IORING_SETUP_SQE128 and IORING_SETUP_CQE32 need lk 5.19). Others (e.g.
+ * ENOMEM, EMFILE) may pass, so the ring is set up again later. */
+static bool
+nvme_uring_unsupported(int err)
+{
+    return (ENOSYS == err) || (EOPNOTSUPP == err) || (EINVAL == err);
+}
+
+/* Sets up a ring for dev_fd in *urp. Returns false if that failed for a
+ * reason that may pass, leaving the slot free. If io_uring (with 128 byte
+ * SQEs) is unsupported then *urp is marked ioctl_only so the ioctl() path
+ * is used for dev_fd by this thread. */
+static bool
+nvme_uring_setup(struct sg_nvme_uring * urp, int dev_fd, int depth, int vb)
+{
+    int fd, err;
+    uint8_t * sq_p;
+    uint8_t * cq_p;
+    void * p;
+    struct io_uring_params params;
+
+    pthread_mutex_lock(&nvme_uring_mutex);
+    memset(urp, 0, sizeof(*urp));
+    urp->in_use = true;
+    urp->dev_fd = dev_fd;
+    urp->ring_fd = -1;
+    pthread_mutex_unlock(&nvme_uring_mutex);
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SQE128 | IORING_SETUP_CQE32;
+    fd = (int)syscall(__NR_io_uring_setup, (unsigned int)depth, &params);
+    if (fd < 0) {
+        err = errno;
+        if (vb > 1)
+            pr2ws("%s: io_uring_setup() failed: %s, using ioctl()s\n",
+                  __func__, strerror(err));
+        if (nvme_uring_unsupported(err)) {
+            urp->ioctl_only = true;
+            return true;
+        }
+        nvme_uring_teardown(urp);
+        return false;
+    }
+    urp->ring_fd = fd;
+    urp->sq_entries = params.sq_entries;
+    urp->cq_entries = params.cq_entries;
+    urp->sq_ring_sz = params.sq_off.array +
+                      (params.sq_entries * sizeof(uint32_t));
+    urp->cq_ring_sz = params.cq_off.cqes +
+                      (params.cq_entries * SG_NVME_CQE_SZ);
+    if (IORING_FEAT_SINGLE_MMAP & params.features) {
+        if (urp->cq_ring_sz > urp->sq_ring_sz)
+            urp->sq_ring_sz = urp->cq_ring_sz;
+        urp->cq_ring_sz = urp->sq_ring_sz;
+    }
+    p = mmap(NULL, urp->sq_ring_sz, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == p)
+        goto fail;
+    urp->sq_ring_p = p;
+    if (IORING_FEAT_SINGLE_MMAP & params.features)
+        urp->cq_ring_p = p;
+    else {
+        p = mmap(NULL, urp->cq_ring_sz, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == p)
+            goto fail;
+        urp->cq_ring_p = p;
+    }
+    urp->sqes_sz = params.sq_entries * SG_NVME_SQE_SZ;
+    p = mmap(NULL, urp->sqes_sz, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (MAP_FAILED == p)
+        goto fail;
+    urp->sqes = (uint8_t *)p;
+    sq_p = (uint8_t *)urp->sq_ring_p;
+    cq_p = (uint8_t *)urp->cq_ring_p;
+    urp->sq_head = (uint32_t *)(sq_p + params.sq_off.head);
+    urp->sq_tail = (uint32_t *)(sq_p + params.sq_off.tail);
+    urp->sq_mask = (uint32_t *)(sq_p + params.sq_off.ring_mask);
+    urp->sq_array = (uint32_t *)(sq_p + params.sq_off.array);
+    urp->cq_head = (uint32_t *)(cq_p + params.cq_off.head);
+    urp->cq_tail = (uint32_t *)(cq_p + params.cq_off.tail);
+    urp->cq_mask = (uint32_t *)(cq_p + params.cq_off.ring_mask);
+    urp->cqes = cq_p + params.cq_off.cqes;
+    if (vb > 2)
+        pr2ws("%s: dev_fd=%d, ring_fd=%d, sq_entries=%u, cq_entries=%u\n",
+              __func__, dev_fd, fd, urp->sq_entries, urp->cq_entries);
+    return true;
+fail:
+    if (vb > 1)
+        pr2ws("%s: mmap() failed: %s, using ioctl()s\n", __func__,
+              strerror(errno));
+    nvme_uring_teardown(urp);
+    return false;
+}
+
+/* Returns this thread's ring for dev_fd. If there is none and create is
+ * true then one is set up if a slot is free. Returns NULL if there is no
+ * ring (i.e. use the ioctl() path). A ring marked stale (dev_fd was closed
+ * by another thread) is freed, with completed commands for dev_fd, first. */
+static struct sg_nvme_uring *
+nvme_uring_get(int dev_fd, bool create, int vb)
+{
+    int k, depth;
+    struct sg_nvme_uring * urp;
+    struct sg_nvme_uring * free_urp = NULL;
+    struct sg_nvme_uring_tbl * tp = nvme_uring_tbl_get(create);
+
+    if (NULL == tp)
+        return NULL;
+    for (k = 0, urp = tp->arr; k < SG_NVME_URING_SLOTS; ++k, ++urp) {
+        if (urp->in_use) {
+            if (dev_fd != urp->dev_fd)
+                continue;
+            if (! __atomic_load_n(&urp->stale, __ATOMIC_ACQUIRE))
+                return urp;
+            if (vb > 2)
+                pr2ws("%s: dev_fd=%d was closed, freeing its ring\n",
+                      __func__, dev_fd);
+            nvme_uring_teardown(urp);
+            while (nvme_done_take(dev_fd))
+                ;
+        }
+        if (NULL == free_urp)
+            free_urp = urp;
+    }
+    if ((! create) || (NULL == free_urp))
+        return NULL;
+    depth = nvme_uring_depth();
+    if (depth < 1)
+        return NULL;
+    return nvme_uring_setup(free_urp, dev_fd, depth, vb) ? free_urp : NULL;
+}
+
+/* Gives queued SQEs to the kernel and, if min_complete > 0, waits for that
+ * many completions. Returns 0 or a negated errno. */
+static int
+nvme_uring_enter(struct sg_nvme_uring * urp, uint32_t min_complete, int vb)
+{
+    int n, err;
+    unsigned int flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+
+    if ((0 == urp->to_submit) && (0 == min_complete))
+        return 0;
+    do {
+        n = (int)syscall(__NR_io_uring_enter, urp->ring_fd, urp->to_submit,
+                         min_complete, flags, NULL, 0);
+    } while ((n < 0) && (EINTR == errno));
+    if (n < 0) {
+        err = errno;
+        if (vb > 1)
+            pr2ws("%s: io_uring_enter() failed: %s\n", __func__,
+                  strerror(err));
+        return -err;
+    }
+    urp->to_submit -= ((uint32_t)n < urp->to_submit) ? (uint32_t)n :
+                                                       urp->to_submit;
+    return 0;
+}
+
+/* Places *cmdp in the next SQE of urp with vp as its user_data. Returns 0,
+ * or -EAGAIN if the ring is full (so do_pt_receive() some responses and
+ * try again). */
+static int
+nvme_uring_queue(struct sg_nvme_uring * urp, struct sg_pt_base * vp,
+                 const struct sg_nvme_passthru_cmd * cmdp, bool is_admin,
+                 int time_secs, int vb)
+{
+    uint32_t tail, idx;
+    struct io_uring_sqe * sqep;
+    struct nvme_uring_cmd * ucp;
+
+    tail = *urp->sq_tail;
+    if (((tail - __atomic_load_n(urp->sq_head, __ATOMIC_ACQUIRE)) >=
+         urp->sq_entries) || (urp->in_flight >= urp->cq_entries))
+        return -EAGAIN;
+    idx = tail & *urp->sq_mask;
+    sqep = (struct io_uring_sqe *)(urp->sqes + (idx * SG_NVME_SQE_SZ));
+    memset(sqep, 0, SG_NVME_SQE_SZ);
+    sqep->opcode = IORING_OP_URING_CMD;
+    sqep->fd = urp->dev_fd;
+    sqep->cmd_op = is_admin ? NVME_URING_CMD_ADMIN : NVME_URING_CMD_IO;
+    sqep->user_data = (uint64_t)(sg_uintptr_t)vp;
+    ucp = (struct nvme_uring_cmd *)sqep->cmd;
+    ucp->opcode = cmdp->opcode;
+    ucp->flags = cmdp->flags;
+    ucp->nsid = cmdp->nsid;
+    ucp->cdw2 = cmdp->cdw2;
+    ucp->cdw3 = cmdp->cdw3;
+    ucp->metadata = cmdp->metadata;
+    ucp->addr = cmdp->addr;
+    ucp->metadata_len = cmdp->metadata_len;
+    ucp->data_len = cmdp->data_len;
+    ucp->cdw10 = cmdp->cdw10;
+    ucp->cdw11 = cmdp->cdw11;
+    ucp->cdw12 = cmdp->cdw12;
+    ucp->cdw13 = cmdp->cdw13;
+    ucp->cdw14 = cmdp->cdw14;
+    ucp->cdw15 = cmdp->cdw15;
+    ucp->timeout_ms = (time_secs < 0) ? (-time_secs) : (1000 * time_secs);
+    /* kept in case the command has to be re-sent with an ioctl() */
+    vp->impl.io_hdr.timeout = ucp->timeout_ms;
+    if (vb > 2) {
+        char nam[64];
+
+        sg_get_nvme_opcode_name(cmdp->opcode, is_admin, sizeof(nam), nam);
+        pr2ws("NVMe %s command via io_uring: %s\n",
+              (is_admin ? "Admin" : "IO"), nam);
+        hex2stderr((const uint8_t *)ucp, sizeof(*ucp), 1);
+    }
+    urp->sq_array[idx] = idx;
+    __atomic_store_n(urp->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++urp->to_submit;
+    ++urp->in_flight;
+    return 0;
+}
+
+/* Takes the next CQE from urp, waiting for one if wait is true. Returns 0
+ * and the object, the CQE res and CQE result (CDW0), or -EAGAIN if there
+ * is none, else a negated errno. */
+static int
+nvme_uring_reap(struct sg_nvme_uring * urp, bool wait,
+                struct sg_pt_base ** vpp, int * cq_resp, uint32_t * resultp,
+                int vb)
+{
+    int res;
+    uint32_t head;
+    const struct io_uring_cqe * cqep;
+
+    while (true) {
+        head = *urp->cq_head;
+        if (head != __atomic_load_n(urp->cq_tail, __ATOMIC_ACQUIRE))
+            break;
+        if ((! wait) || (0 == urp->in_flight))
+            return -EAGAIN;
+        res = nvme_uring_enter(urp, 1, vb);
+        if (res)
+            return res;
+    }
+    cqep = (const struct io_uring_cqe *)(urp->cqes +
+                                ((head & *urp->cq_mask) * SG_NVME_CQE_SZ));
+    *vpp = (struct sg_pt_base *)(sg_uintptr_t)cqep->user_data;
+    *cq_resp = cqep->res;
+    *resultp = (uint32_t)cqep->big_cqe[0];
+    __atomic_store_n(urp->cq_head, head + 1, __ATOMIC_RELEASE);
+    if (urp->in_flight > 0)
+        --urp->in_flight;
+    return 0;
+}
+
+/* Builds, in *cmdp, the single NVMe command that SCSI READ, WRITE or VERIFY
+ * (BYTCHK=0) translates to. Returns false if the command should instead go
+ * through sg_do_nvme_pt() (e.g. it would be split, or sense data is due) */
+static bool
+sntl_async_build(struct sg_pt_linux_scsi * ptp, const uint8_t * cdbp,
+                 struct sg_nvme_passthru_cmd * cmdp, int time_secs, int vb)
+{
+    bool is_read = false;
+    bool is_verify = false;
+    bool sense_made;
+    uint8_t nvme_opc;
+    uint32_t num_lbs, xfer_len;
+    uint64_t lba, nsze;
+    uint64_t len = 0;
+    uint8_t * dp = NULL;
+
+    switch (cdbp[0]) {
+    case SCSI_READ10_OPC:
+    case SCSI_READ16_OPC:
+        is_read = true;
+        nvme_opc = 0x2;
+        break;
+    case SCSI_WRITE10_OPC:
+    case SCSI_WRITE16_OPC:
+        nvme_opc = 0x1;
+        break;
+    case SCSI_VERIFY10_OPC:
+    case SCSI_VERIFY16_OPC:
+        if (0x6 & cdbp[1])      /* BYTCHK */
+            return false;
+        is_verify = true;
+        nvme_opc = 0xc;
+        break;
+    default:
+        return false;
+    }
+    if (0xe0 & cdbp[1])         /* xxPROTECT */
+        return false;
+    if (0x80 & cdbp[0]) {       /* 16 byte variants */
+        lba = sg_get_unaligned_be64(cdbp + 2);
+        num_lbs = sg_get_unaligned_be32(cdbp + 10);
+    } else {
+        lba = sg_get_unaligned_be32(cdbp + 2);
+        num_lbs = sg_get_unaligned_be16(cdbp + 7);
+    }
+    if (sntl_prep_media_access(ptp, &sense_made, time_secs, vb) ||
+        sense_made)
+        return false;
+    if (is_verify && (0 == (0x80 & sg_get_unaligned_le16(ptp->nvme_id_ctlp +
+                                                         520))))
+        return false;
+    nsze = sntl_ns_nsze(ptp);
+    if ((0 == num_lbs) || (num_lbs > sntl_max_lbs_per_cmd(ptp)) ||
+        (lba >= nsze) || (num_lbs > (nsze - lba)))
+        return false;
+    if (! is_verify) {
+        len = (uint64_t)num_lbs * sntl_ns_lb_sz(ptp);
+        if (is_read) {
+            xfer_len = ptp->io_hdr.din_xfer_len;
+            dp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.din_xferp;
+        } else {
+            xfer_len = ptp->io_hdr.dout_xfer_len;
+            dp = (uint8_t *)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
+        }
+        if ((NULL == dp) || (len > xfer_len))
+            return false;
+    }
+    memset(cmdp, 0, sizeof(*cmdp));
+    cmdp->opcode = nvme_opc;
+    cmdp->nsid = ptp->nvme_nsid;
+    cmdp->cdw10 = (uint32_t)lba;
+    cmdp->cdw11 = (uint32_t)(lba >> 32);
+    cmdp->cdw12 = 0xffff & (num_lbs - 1);
+    if ((! is_verify) && (0x8 & cdbp[1]))
+        cmdp->cdw12 |= 0x40000000;      /* FUA */
+    if (dp) {
+        cmdp->addr = (uint64_t)(sg_uintptr_t)dp;
+        cmdp->data_len = (uint32_t)len;
+    }
+    ptp->nvme_async_len = (uint32_t)len;
+    return true;
+}
+
+/* Places the outcome of an asynchronous NVMe command (CQE res and result)
+ * in ptp, as do_nvme_cmd() and the SNTL would have */
+static void
+nvme_async_complete(struct sg_pt_linux_scsi * ptp, int cq_res,
+                    uint32_t result, int vb)
+{
+    const uint8_t * cdbp;
+
+    if (cq_res < 0) {
+        ptp->os_err = -cq_res;
+        if (vb > 1)
+            pr2ws("%s: uring_cmd failed: %s\n", __func__, strerror(-cq_res));
+        return;
+    }
+    ptp->os_err = 0;
+    if (nvme_set_completion(ptp, result, cq_res)) {
+        if (! ptp->nvme_direct)
+            mk_sense_from_nvme_status(ptp, vb);
+        return;
+    }
+    if (ptp->nvme_direct || (0 == ptp->nvme_async_len))
+        return;
+    cdbp = (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.request;
+    if ((SCSI_READ10_OPC == cdbp[0]) || (SCSI_READ16_OPC == cdbp[0]))
+        ptp->io_hdr.din_resid = ptp->io_hdr.din_xfer_len -
+                                ptp->nvme_async_len;
+    else
+        ptp->io_hdr.dout_resid = ptp->io_hdr.dout_xfer_len -
+                                 ptp->nvme_async_len;
+}
+
+#endif          /* SG_NVME_URING */
+
+/* Called by do_pt_submit() for NVMe devices after its checks. NVMe
+ * commands given directly (as Admin commands) and SCSI READ, WRITE and
+ * VERIFY (see sntl_async_build()) go to this thread's io_uring ring for
+ * the device. It is given to the kernel now if flush is true, otherwise by
+ * sg_nvme_async_flush(). Other commands, or all when there is no ring, are
+ * executed by sg_do_nvme_pt() now and wait for sg_nvme_async_receive(). */
+int
+sg_nvme_async_submit(struct sg_pt_base * vp, int time_secs, bool flush,
+                     int vb)
+{
+    int res;
+    struct sg_pt_linux_scsi * ptp = &vp->impl;
+#ifdef SG_NVME_URING
+    bool is_admin, is_read;
+    const uint8_t * cdbp;
+    void * dp;
+    struct sg_nvme_uring * urp;
+    struct sg_nvme_passthru_cmd cmd;
+
+    urp = nvme_uring_get(ptp->dev_fd, true, vb);
+    cdbp = (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.request;
+    if (urp && (! urp->ioctl_only) && cdbp) {
+        ptp->nvme_direct = ! sg_is_scsi_cdb(cdbp, ptp->io_hdr.request_len);
+        if (ptp->nvme_direct) {
+            is_admin = true;
+            ptp->nvme_async_len = 0;
+            res = nvme_direct_build(ptp, &cmd, &dp, &is_read, vb);
+            if (res)
+                return res;
+        } else {
+            is_admin = false;
+            if (! sntl_async_build(ptp, cdbp, &cmd, time_secs, vb))
+                goto ioctl_path;
+        }
+        res = nvme_uring_queue(urp, vp, &cmd, is_admin, time_secs, vb);
+        if (res)
+            return res;
+        return flush ? nvme_uring_enter(urp, 0, vb) : 0;
+    }
+ioctl_path:
+#else
+    if (flush) { ; }            /* suppress warning */
+#endif
+    res = sg_do_nvme_pt(vp, -1, time_secs, vb);
+    if ((res < 0) || (SCSI_PT_DO_BAD_PARAMS == res))
+        return res;     /* not "sent", so do_pt_receive() will not see it */
+    nvme_done_append(vp);
+    return 0;
+}
+
+/* Gives all SQEs that this thread has queued to the kernel. Returns 0 or
+ * the first error. */
+int
+sg_nvme_async_flush(int vb)
+{
+#ifdef SG_NVME_URING
+    int k, res;
+    int ret = 0;
+    struct sg_nvme_uring * urp;
+    struct sg_nvme_uring_tbl * tp = nvme_uring_tbl_get(false);
+
+    if (NULL == tp)
+        return 0;
+    for (k = 0, urp = tp->arr; k < SG_NVME_URING_SLOTS; ++k, ++urp) {
+        if (urp->in_use && (urp->ring_fd >= 0) && (urp->to_submit > 0) &&
+            (! __atomic_load_n(&urp->stale, __ATOMIC_ACQUIRE))) {
+            res = nvme_uring_enter(urp, 0, vb);
+            if (res && (0 == ret))
+                ret = res;
+        }
+    }
+    return ret;
+#else
+    if (vb) { ; }               /* suppress warning */
+    return 0;
+#endif
+}
+
+/* Fetches the oldest completed asynchronous NVMe command on dev_fd
+ * submitted by this thread. If wait is true and dev_fd is blocking then
+ * waits for one. Returns 0 (placing its object in *objpp), or -EAGAIN if
+ * none is ready, else negated errno. */
+int
+sg_nvme_async_receive(int dev_fd, bool wait, struct sg_pt_base ** objpp,
+                      int vb)
+{
+    struct sg_pt_base * vp;
+#ifdef SG_NVME_URING
+    int res, cq_res, fl;
+    uint32_t result;
+    struct sg_nvme_uring * urp;
+#endif
+
+    if (objpp)
+        *objpp = NULL;
+#ifdef SG_NVME_URING
+    urp = nvme_uring_get(dev_fd, false, vb);    /* drops stale responses */
+#endif
+    vp = nvme_done_take(dev_fd);
+    if (vp)
+        goto fini;
+#ifdef SG_NVME_URING
+    if ((NULL == urp) || (urp->ring_fd < 0))
+        return -EAGAIN;
+    if (wait) {
+        fl = fcntl(dev_fd, F_GETFL);
+        if ((fl >= 0) && (O_NONBLOCK & fl))
+            wait = false;
+    }
+    res = nvme_uring_enter(urp, 0, vb);
+    if (res)
+        return res;
+    res = nvme_uring_reap(urp, wait, &vp, &cq_res, &result, vb);
+    if (res)
+        return res;
+    /* only errors saying uring_cmd is unsupported disable the ring, others
+     * belong to this command */
+    if ((cq_res < 0) && (! urp->cmd_ok) &&
+        ((-EOPNOTSUPP == cq_res) || (-ENOSYS == cq_res))) {
+        /* e.g. NVMe block devices have no uring_cmd support */
+        if (vb > 1)
+            pr2ws("%s: dev_fd=%d lacks NVMe uring_cmd, using ioctl()s\n",
+                  __func__, dev_fd);
+        urp->ioctl_only = true;
+        res = sg_do_nvme_pt(vp, -1, -(int)vp->impl.io_hdr.timeout, vb);
+        if (res < 0)
+            vp->impl.os_err = -res;
+    } else {
+        if (cq_res >= 0)
+            urp->cmd_ok = true;
+        nvme_async_complete(&vp->impl, cq_res, result, vb);
+    }
+#else
+    if (wait) { ; }             /* suppress warning */
+    if (vb) { ; }               /* suppress warning */
+    return -EAGAIN;
+#endif
+fini:
+    if (objpp)
+        *objpp = vp;
+    return 0;
+}
+
+/* Called when dev_fd is closed: frees this thread's ring for dev_fd and
+ * forgets completed commands for it. Rings that other threads have for
+ * dev_fd are marked stale; each is freed when its thread next uses it (or
+ * exits). Commands still in flight on those rings are lost. */
+void
+sg_nvme_async_release(int dev_fd)
+{
+#ifdef SG_NVME_URING
+    int k;
+    struct sg_nvme_uring * urp;
+    struct sg_nvme_uring_tbl * tp;
+
+    urp = nvme_uring_get(dev_fd, false, 0);
+    if (urp)
+        nvme_uring_teardown(urp);
+    pthread_mutex_lock(&nvme_uring_mutex);
+    for (tp = nvme_uring_tbl_head; tp; tp = tp->next) {
+        if (tp == nvme_uring_tbl)
+            continue;
+        for (k = 0, urp = tp->arr; k < SG_NVME_URING_SLOTS; ++k, ++urp) {
+            if (urp->in_use && (dev_fd == urp->dev_fd))
+                __atomic_store_n(&urp->stale, true, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&nvme_uring_mutex);
+#endif
+    while (nvme_done_take(dev_fd))
+        ;
+}
+
+int
+scsi_pt_nvme_uring(int q_depth, int verbose)
+{
+#ifdef SG_NVME_URING
+    if (verbose > 2)
+        pr2ws("%s: q_depth=%d\n", __func__, q_depth);
+    sg_nvme_uring_q_depth = (q_depth < 0) ? 0 :
+                    ((q_depth > SG_NVME_URING_MAX_DEPTH) ?
+                     SG_NVME_URING_MAX_DEPTH : q_depth);
+    return 0;
+#else
+    if (verbose > 2)
+        pr2ws("%s: io_uring support not built in\n", __func__);
+    return (q_depth > 0) ? SCSI_PT_DO_NOT_SUPPORTED : 0;
+#endif
+}
+
+#else           /* (HAVE_NVME && (! IGNORE_NVME)) [around line 140] */
+
+int
+sg_do_nvme_pt(struct sg_pt_base * vp, int fd, int time_secs, int vb)
+{
+    if (vb) {
+        pr2ws("%s: not supported, ", __func__);
+#ifdef HAVE_NVME
         pr2ws("HAVE_NVME, ");
 #else
         pr2ws("don't HAVE_NVME, ");
@@ -1290,4 +2893,47 @@ sg_do_nvme_pt(struct sg_pt_base * vp, int fd, int time_secs, int vb)
     return -ENOTTY;             /* inappropriate ioctl error */
 }
 
+int
+sg_nvme_async_submit(struct sg_pt_base * vp, int time_secs, bool flush,
+                     int vb)
+{
+    if (vp) { ; }               /* suppress warning */
+    if (time_secs) { ; }        /* suppress warning */
+    if (flush) { ; }            /* suppress warning */
+    if (vb) { ; }               /* suppress warning */
+    return SCSI_PT_DO_NOT_SUPPORTED;
+}
+
+int
+sg_nvme_async_flush(int vb)
+{
+    if (vb) { ; }               /* suppress warning */
+    return 0;
+}
+
+int
+sg_nvme_async_receive(int dev_fd, bool wait, struct sg_pt_base ** objpp,
+                      int vb)
+{
+    if (objpp)
+        *objpp = NULL;
+    if (dev_fd) { ; }           /* suppress warning */
+    if (wait) { ; }             /* suppress warning */
+    if (vb) { ; }               /* suppress warning */
+    return SCSI_PT_DO_NOT_SUPPORTED;
+}
+
+void
+sg_nvme_async_release(int dev_fd)
+{
+    if (dev_fd) { ; }           /* suppress warning */
+}
+
+int
+scsi_pt_nvme_uring(int q_depth, int verbose)
+{
+    if (verbose) { ; }          /* suppress warning */
+    return (q_depth > 0) ? SCSI_PT_DO_NOT_SUPPORTED : 0;
+}
+
 #endif          /* (HAVE_NVME && (! IGNORE_NVME)) */
@@ -265,6 +265,29 @@ set_scsi_pt_data_out(struct sg_pt_base * vp, const uint8_t * dxferp,
     }
 }
 
+/* Only a scatter gather list with one element is supported */
+void
+set_scsi_pt_data_in_iov(struct sg_pt_base * vp,
+                        const struct sg_pt_iovec * iovp, int iov_count)
+{
+    if (iov_count > 1)
+        ++vp->impl.in_err;
+    else if (1 == iov_count)
+        set_scsi_pt_data_in(vp, (uint8_t *)iovp->iov_base,
+                            (int)iovp->iov_len);
+}
+
+void
+set_scsi_pt_data_out_iov(struct sg_pt_base * vp,
+                         const struct sg_pt_iovec * iovp, int iov_count)
+{
+    if (iov_count > 1)
+        ++vp->impl.in_err;
+    else if (1 == iov_count)
+        set_scsi_pt_data_out(vp, (const uint8_t *)iovp->iov_base,
+                             (int)iovp->iov_len);
+}
+
 void
 set_scsi_pt_packet_id(struct sg_pt_base * vp, int pack_id)
 {
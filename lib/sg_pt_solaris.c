@@ -71,7 +71,7 @@ scsi_pt_open_flags(const char * device_name, int flags_arg, int verbose)
 
     flags_arg = flags_arg;  /* ignore flags argument, suppress warning */
     if (verbose > 1) {
-        fprintf(sg_warnings_strm ? sg_warnings_strm : stderr,
+        fprintf(sg_get_warnings_strm(),
                 "open %s with flags=0x%x\n", device_name, oflags);
     }
     fd = open(device_name, oflags);
@@ -106,7 +106,7 @@ construct_scsi_pt_obj_with_fd(int dev_fd, int verbose)
         ptp->uscsi.uscsi_flags = USCSI_READ | USCSI_ISOLATE | USCSI_RQENABLE;
         ptp->uscsi.uscsi_timeout = DEF_TIMEOUT;
     } else if (verbose)
-        fprintf(sg_warnings_strm ? sg_warnings_strm : stderr,
+        fprintf(sg_get_warnings_strm(),
                 "%s: calloc() out of memory\n", __func__);
     return (struct sg_pt_base *)ptp;
 }
@@ -197,6 +197,29 @@ set_scsi_pt_data_out(struct sg_pt_base * vp, const uint8_t * dxferp,
     }
 }
 
+/* Only a scatter gather list with one element is supported */
+void
+set_scsi_pt_data_in_iov(struct sg_pt_base * vp,
+                        const struct sg_pt_iovec * iovp, int iov_count)
+{
+    if (iov_count > 1)
+        ++vp->impl.in_err;
+    else if (1 == iov_count)
+        set_scsi_pt_data_in(vp, (uint8_t *)iovp->iov_base,
+                            (int)iovp->iov_len);
+}
+
+void
+set_scsi_pt_data_out_iov(struct sg_pt_base * vp,
+                         const struct sg_pt_iovec * iovp, int iov_count)
+{
+    if (iov_count > 1)
+        ++vp->impl.in_err;
+    else if (1 == iov_count)
+        set_scsi_pt_data_out(vp, (const uint8_t *)iovp->iov_base,
+                             (int)iovp->iov_len);
+}
+
 void
 set_scsi_pt_packet_id(struct sg_pt_base * vp, int pack_id)
 {
@@ -250,7 +273,7 @@ int
 do_scsi_pt(struct sg_pt_base * vp, int fd, int time_secs, int verbose)
 {
     struct sg_pt_solaris_scsi * ptp = &vp->impl;
-    FILE * ferr = sg_warnings_strm ? sg_warnings_strm : stderr;
+    FILE * ferr = sg_get_warnings_strm();
 
     ptp->os_err = 0;
     if (ptp->in_err) {
@@ -149,6 +149,7 @@ struct sg_pt_win32_scsi {
     bool mdxfer_out;    /* direction of metadata xfer, true->data-out */
     bool have_nvme_cmd;
     bool is_read;
+    bool iov_multi;     /* scatter gather list with > 1 element given */
     int sense_len;
     int scsi_status;
     int resid;
@@ -949,6 +950,29 @@ set_scsi_pt_data_out(struct sg_pt_base * vp, const uint8_t * dxferp,
     }
 }
 
+/* Only a scatter gather list with one element is supported */
+void
+set_scsi_pt_data_in_iov(struct sg_pt_base * vp,
+                        const struct sg_pt_iovec * iovp, int iov_count)
+{
+    if (iov_count > 1)
+        vp->implp->iov_multi = true;
+    else if (1 == iov_count)
+        set_scsi_pt_data_in(vp, (uint8_t *)iovp->iov_base,
+                            (int)iovp->iov_len);
+}
+
+void
+set_scsi_pt_data_out_iov(struct sg_pt_base * vp,
+                         const struct sg_pt_iovec * iovp, int iov_count)
+{
+    if (iov_count > 1)
+        vp->implp->iov_multi = true;
+    else if (1 == iov_count)
+        set_scsi_pt_data_out(vp, (const uint8_t *)iovp->iov_base,
+                             (int)iovp->iov_len);
+}
+
 void
 set_pt_metadata_xfer(struct sg_pt_base * vp, uint8_t * mdxferp,
                      uint32_t mdxfer_len, bool out_true)
@@ -1202,6 +1226,11 @@ do_scsi_pt(struct sg_pt_base * vp, int dev_fd, int time_secs, int vb)
             pr2ws("%s: NULL 1st argument to this function\n", __func__);
         return SCSI_PT_DO_BAD_PARAMS;
     }
+    if (psp->iov_multi) {
+        if (vb)
+            pr2ws("%s: scatter gather lists not supported\n", __func__);
+        return SCSI_PT_DO_BAD_PARAMS;
+    }
     psp->os_err = 0;
     if (dev_fd >= 0) {
         if ((psp->dev_fd >= 0) && (dev_fd != psp->dev_fd)) {
@@ -1353,6 +1382,63 @@ get_pt_nvme_nsid(const struct sg_pt_base * vp)
     return psp->nvme_nsid;
 }
 
+/* No asynchronous pass-through interface on this OS */
+int
+do_pt_submit(struct sg_pt_base * vp __attribute__ ((unused)),
+             int fd __attribute__ ((unused)),
+             int time_secs __attribute__ ((unused)),
+             int verbose __attribute__ ((unused)))
+{
+    return SCSI_PT_DO_NOT_SUPPORTED;
+}
+
+int
+do_pt_receive(int dev_fd __attribute__ ((unused)),
+              int pack_id __attribute__ ((unused)),
+              struct sg_pt_base ** objpp, int verbose __attribute__ ((unused)))
+{
+    if (objpp)
+        *objpp = NULL;
+    return SCSI_PT_DO_NOT_SUPPORTED;
+}
+
+int
+scsi_pt_async_match(int dev_fd __attribute__ ((unused)),
+                    bool by_pack_id __attribute__ ((unused)),
+                    int verbose __attribute__ ((unused)))
+{
+    return SCSI_PT_DO_NOT_SUPPORTED;
+}
+
+int
+do_pt_submit_batch(struct sg_pt_base ** objp_arr __attribute__ ((unused)),
+                   int num_objs __attribute__ ((unused)),
+                   int fd __attribute__ ((unused)),
+                   int time_secs __attribute__ ((unused)), int * num_sentp,
+                   int verbose __attribute__ ((unused)))
+{
+    if (num_sentp)
+        *num_sentp = 0;
+    return SCSI_PT_DO_NOT_SUPPORTED;
+}
+
+int
+do_pt_receive_batch(int dev_fd __attribute__ ((unused)),
+                    struct sg_pt_base ** objp_arr __attribute__ ((unused)),
+                    int max_objs __attribute__ ((unused)), int * num_recvp,
+                    int verbose __attribute__ ((unused)))
+{
+    if (num_recvp)
+        *num_recvp = 0;
+    return SCSI_PT_DO_NOT_SUPPORTED;
+}
+
+int
+scsi_pt_nvme_uring(int q_depth, int verbose __attribute__ ((unused)))
+{
+    return (q_depth > 0) ? SCSI_PT_DO_NOT_SUPPORTED : 0;
+}
+
 /* Use the transport_err for Windows errors. */
 char *
 get_scsi_pt_transport_err_str(const struct sg_pt_base * vp, int max_b_len,
@@ -45,6 +45,8 @@
 #include <limits.h>
 #define __STDC_FORMAT_MACROS 1
 #include <inttypes.h>
+#include <poll.h>
+#include <time.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -66,11 +68,23 @@
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
 
-static const char * version_str = "6.05 20181213";
+static const char * version_str = "6.11 20261016";
 
 
 #define ME "sg_dd: "
 
+#define JNL_MAX_REGIONS 16      /* most recent, kept in journal file */
+#define DEF_JNL_SECS 30         /* between checkpoints */
+
+#define AUTO_MAX_BYTES (8 * 1024 * 1024)  /* bpt=auto upper limit */
+#define AUTO_MIN_BYTES 4096
+#define AUTO_WIN_MS 250         /* measure throughput over this, at least */
+#define AUTO_WIN_XFERS 4        /* and at least this many transfers */
+#define AUTO_MAX_LAT_MS 500     /* don't grow transfers taking longer */
+#define AUTO_REPROBE_WINS 40    /* once settled, climb again after this */
+#define VPD_BLOCK_LIMITS 0xb0
+#define VPD_BLOCK_LIMITS_LEN 64
+
 
 #define STR_SZ 1024
 #define INOUTF_SZ 512
@@ -122,6 +136,8 @@ static const char * version_str = "6.05 20181213";
 
 #define MIN_RESERVED_SIZE 8192
 
+#define MAX_QD 16               /* SG_MAX_QUEUE of sg v3 driver, per fd */
+
 #define MAX_UNIT_ATTENTIONS 10
 #define MAX_ABORTED_CMDS 256
 
@@ -134,6 +150,8 @@ static int in_partial = 0;
 static int64_t out_full = 0;
 static int out_partial = 0;
 static int64_t out_sparse_num = 0;
+static int64_t out_cmp_same_num = 0;
+static int out_cmp_rd_fails = 0;
 static int recovered_errs = 0;
 static int unrecovered_errs = 0;
 static int read_longs = 0;
@@ -150,14 +168,17 @@ static int coe_limit = 0;
 static int coe_count = 0;
 static struct timeval start_tm;
 
-static uint8_t * zeros_buff = NULL;
-static uint8_t * free_zeros_buff = NULL;
 static int read_long_blk_inc = READ_LONG_DEF_BLK_INC;
+static bool sparse_punch = true;        /* oflag=sparse makes holes */
+static uint8_t * cmp_buff = NULL;       /* oflag=cmp reads OFILE into */
+static uint8_t * free_cmp_buff = NULL;
+static char jnl_fname[INOUTF_SZ];       /* journal=JFILE */
 
 static const char * proc_allow_dio = "/proc/scsi/sg/allow_dio";
 
 struct flags_t {
     bool append;
+    bool cmp;
     bool dio;
     bool direct;
     bool dpo;
@@ -171,12 +192,54 @@ struct flags_t {
     int coe;
     int nocache;
     int pdt;
+    int qd;             /* commands outstanding, 0 -> lockstep copy */
     int retries;
 };
 
 static struct flags_t iflag;
 static struct flags_t oflag;
 
+struct jnl_region_t {
+    int64_t start;              /* blocks from the start of the copy */
+    int64_t blocks;
+    uint32_t crc;               /* CRC-32 of what was written */
+};
+
+/* State of the checkpoint journal (journal=JFILE) */
+struct jnl_t {
+    bool csum;                  /* jcsum=1: checksum each region */
+    int secs;                   /* jsecs=SECS between checkpoints */
+    int nregs;
+    int64_t skip;               /* skip, seek and count of the whole copy */
+    int64_t seek;
+    int64_t count;
+    int64_t done;               /* blocks copied at the last checkpoint */
+    uint32_t crc;               /* of the region since the last checkpoint */
+    time_t last;
+    const char * inf;
+    const char * outf;
+    struct jnl_region_t regs[JNL_MAX_REGIONS];  /* oldest first */
+};
+
+static struct jnl_t jnl;
+
+/* State of the bpt=auto hill climb, see auto_bpt_done() */
+struct auto_bpt_t {
+    bool settled;
+    int cur;                    /* blocks per transfer now */
+    int lo;
+    int hi;                     /* buffers are this many blocks */
+    int best;                   /* blocks per transfer with best_rate */
+    int dir;                    /* 1: doubling, -1: halving */
+    int reversals;
+    int nxfers;                 /* transfers in this window */
+    int wins;                   /* windows since settled */
+    int64_t blks;               /* blocks in this window */
+    double best_rate;           /* blocks per second */
+    struct timespec start;      /* of this window */
+};
+static uint32_t crc32_tab[256];
+
 static void calc_duration_throughput(bool contin);
 
 
@@ -206,6 +269,13 @@ print_stats(const char * str)
             out_partial);
     if (oflag.sparse)
         pr2serr("%s%" PRId64 " bypassed records out\n", str, out_sparse_num);
+    if (oflag.cmp) {
+        pr2serr("%s%" PRId64 " records out same, not written\n", str,
+                out_cmp_same_num);
+        if (out_cmp_rd_fails > 0)
+            pr2serr("%s%d reads of output for cmp failed, so written\n",
+                    str, out_cmp_rd_fails);
+    }
     if (recovered_errs > 0)
         pr2serr("%s%d recovered errors\n", str, recovered_errs);
     if (num_retries > 0)
@@ -356,16 +426,21 @@ usage()
             "              [obs=BS] [of=OFILE] [oflag=FLAGS] "
             "[seek=SEEK] [skip=SKIP]\n"
             "              [--dry-run] [--help] [--verbose] [--version]\n\n"
-            "              [blk_sgio=0|1] [bpt=BPT] [cdbsz=6|10|12|16] "
+            "              [blk_sgio=0|1] [bpt=BPT|auto] [cdbsz=6|10|12|16] "
             "[coe=0|1|2|3]\n"
-            "              [coe_limit=CL] [dio=0|1] [odir=0|1] "
-            "[of2=OFILE2] [retries=RETR]\n"
-            "              [sync=0|1] [time=0|1] [verbose=VERB]\n"
+            "              [coe_limit=CL] [dio=0|1] [jcsum=0|1] "
+            "[journal=JFILE]\n"
+            "              [jsecs=SECS] [odir=0|1] [of2=OFILE2] "
+            "[retries=RETR] [sync=0|1]\n"
+            "              [time=0|1] [verbose=VERB]\n"
             "  where:\n"
             "    blk_sgio    0->block device use normal I/O(def), 1->use "
             "SG_IO\n"
             "    bpt         is blocks_per_transfer (default is 128 or 32 "
             "when BS>=2048)\n"
+            "                'auto' sizes transfers from the Block Limits "
+            "VPD page and\n"
+            "                measured throughput\n"
             "    bs          logical block size (default is 512)\n");
     pr2serr("    cdbsz       size of SCSI READ or WRITE cdb (default is "
             "10)\n"
@@ -385,7 +460,13 @@ usage()
             "    if          file or device to read from (def: stdin)\n"
             "    iflag       comma separated list from: [coe,dio,direct,"
             "dpo,dsync,excl,\n"
-            "                flock,fua,nocache,null,sgio]\n"
+            "                flock,fua,nocache,null,qd=N,sgio]\n"
+            "    jcsum       1->journal keeps CRC-32 of each region, "
+            "verified on resume\n"
+            "    journal     checkpoint the copy in JFILE; if JFILE exists "
+            "resume from it\n"
+            "    jsecs       seconds between journal checkpoints (def: "
+            "30)\n"
             "    obs         output logical block size (if given must be "
             "same as 'bs=')\n"
             "    odir        1->use O_DIRECT when opening block dev, "
@@ -396,10 +477,15 @@ usage()
             "    of2         additional output file (def: /dev/null), "
             "OFILE2 should be\n"
             "                normal file or pipe\n"
-            "    oflag       comma separated list from: [append,coe,dio,"
-            "direct,dpo,\n"
-            "                dsync,excl,flock,fua,nocache,null,sgio,"
-            "sparse]\n"
+            "    oflag       comma separated list from: [append,cmp,coe,dio,"
+            "direct,\n"
+            "                dpo,dsync,excl,flock,fua,nocache,null,qd=N,"
+            "sgio,sparse]\n"
+            "                qd=N keeps up to N READs (iflag) or WRITEs "
+            "(oflag)\n"
+            "                outstanding on a sg device (N: 1 to %d)\n"
+            "                cmp reads OFILE first and only writes blocks "
+            "that differ\n"
             "    retries     retry sgio errors RETR times (def: 0)\n"
             "    seek        block position to start writing to OFILE\n"
             "    skip        block position to start reading from IFILE\n"
@@ -415,7 +501,7 @@ usage()
             "times\n"
             "    --version   print version information then exit\n\n"
             "copy from IFILE to OFILE, similar to dd command; "
-            "specialized for SCSI devices\n");
+            "specialized for SCSI devices\n", MAX_QD);
 }
 
 
@@ -1084,6 +1170,1514 @@ sg_write(int sg_fd, uint8_t * buff, int blocks, int64_t to_block,
 }
 
 
+/* WRITE via sg_write() with the unit attention, aborted command and
+ * retries handling of the lockstep copy. Returns 0 on success. */
+static int
+sg_write_retry(int sg_fd, uint8_t * buff, int blocks, int64_t to_block,
+               bool * diop)
+{
+    int res;
+    int retries_tmp = oflag.retries;
+
+    while (true) {
+        res = sg_write(sg_fd, buff, blocks, to_block, blk_sz, &oflag, diop);
+        if ((0 == res) || (SG_LIB_CAT_NOT_READY == res) ||
+            (SG_LIB_SYNTAX_ERROR == res) || (res < 0))
+            break;
+        else if (SG_LIB_CAT_UNIT_ATTENTION == res) {
+            if (--max_uas > 0)
+                pr2serr("Unit attention, continuing (w)\n");
+            else {
+                pr2serr("Unit attention, too many (w)\n");
+                break;
+            }
+        } else if (SG_LIB_CAT_ABORTED_COMMAND == res) {
+            if (--max_aborted > 0)
+                pr2serr("Aborted command, continuing (w)\n");
+            else {
+                pr2serr("Aborted command, too many (w)\n");
+                break;
+            }
+        } else if (retries_tmp > 0) {
+            pr2serr(">>> retrying a sgio write, lba=0x%" PRIx64 "\n",
+                    (uint64_t)to_block);
+            --retries_tmp;
+            ++num_retries;
+            if (unrecovered_errs > 0)
+                --unrecovered_errs;
+        } else
+            break;
+    }
+    if (res)
+        pr2serr("sg_write failed,%s seek=%" PRId64 "\n",
+                ((-2 == res) ? " try reducing bpt or qd," : ""), to_block);
+    return res;
+}
+
+/* WRITE SAME(16) with the UNMAP bit set and a block of zeros as its data,
+ * so the blocks read back as zeros whether or not the device deallocates
+ * them. 0 -> successful, SG_LIB_CAT_INVALID_OP and SG_LIB_CAT_ILLEGAL_REQ
+ * -> not supported, -1 -> other errors, else a SG_LIB_CAT_* value */
+static int
+sg_write_same_unmap(int sg_fd, int64_t to_block, int blocks)
+{
+    int res, k;
+    uint8_t * zbp;
+    uint8_t wsCmd[MAX_SCSI_CDBSZ];
+    uint8_t senseBuff[SENSE_BUFF_LEN];
+    struct sg_io_hdr io_hdr;
+
+    zbp = (uint8_t *)calloc(1, blk_sz);
+    if (NULL == zbp)
+        return -1;
+    memset(wsCmd, 0, sizeof(wsCmd));
+    wsCmd[0] = 0x93;
+    wsCmd[1] = 0x8;             /* UNMAP bit */
+    sg_put_unaligned_be64(to_block, wsCmd + 2);
+    sg_put_unaligned_be32(blocks, wsCmd + 10);
+
+    memset(&io_hdr, 0, sizeof(struct sg_io_hdr));
+    io_hdr.interface_id = 'S';
+    io_hdr.cmd_len = 16;
+    io_hdr.cmdp = wsCmd;
+    io_hdr.dxfer_direction = SG_DXFER_TO_DEV;
+    io_hdr.dxfer_len = blk_sz;
+    io_hdr.dxferp = zbp;
+    io_hdr.mx_sb_len = SENSE_BUFF_LEN;
+    io_hdr.sbp = senseBuff;
+    io_hdr.timeout = DEF_TIMEOUT;
+    io_hdr.pack_id = (int)to_block;
+
+    if (verbose > 2) {
+        pr2serr("    write same cdb: ");
+        for (k = 0; k < 16; ++k)
+            pr2serr("%02x ", wsCmd[k]);
+        pr2serr("\n");
+    }
+    while (((res = ioctl(sg_fd, SG_IO, &io_hdr)) < 0) &&
+           ((EINTR == errno) || (EAGAIN == errno)))
+        ;
+    free(zbp);
+    if (res < 0) {
+        perror("write same (SG_IO) on sg device, error");
+        return -1;
+    }
+    res = sg_err_category3(&io_hdr);
+    switch (res) {
+    case SG_LIB_CAT_CLEAN:
+        return 0;
+    case SG_LIB_CAT_RECOVERED:
+        ++recovered_errs;
+        sg_chk_n_print3("write same", &io_hdr, verbose > 1);
+        return 0;
+    case SG_LIB_CAT_INVALID_OP:
+    case SG_LIB_CAT_ILLEGAL_REQ:
+        if (verbose > 1)
+            sg_chk_n_print3("write same", &io_hdr, true);
+        return res;
+    default:
+        sg_chk_n_print3("write same", &io_hdr, verbose > 1);
+        return res;
+    }
+}
+
+/* Makes a hole of 'blocks' zeroed blocks at block 'to_block' of the
+ * output, see sparse_output(). Returns 0 on success. */
+static int
+sparse_hole(int outfd, int out_type, int64_t to_block, int blocks)
+{
+    int res;
+    off64_t len = (off64_t)blocks * blk_sz;
+    char ebuff[EBUFF_SZ];
+
+    if (verbose > 2)
+        pr2serr("sparse hole: seek blk=%" PRId64 ", blocks=%d\n", to_block,
+                blocks);
+    out_sparse_num += blocks;
+    if (FT_SG & out_type) {
+        if (! sparse_punch)
+            return 0;
+        do {
+            res = sg_write_same_unmap(outfd, to_block, blocks);
+        } while (((SG_LIB_CAT_UNIT_ATTENTION == res) && (--max_uas > 0)) ||
+                 ((SG_LIB_CAT_ABORTED_COMMAND == res) &&
+                  (--max_aborted > 0)));
+        if ((SG_LIB_CAT_INVALID_OP == res) ||
+            (SG_LIB_CAT_ILLEGAL_REQ == res)) {
+            pr2serr(">> WRITE SAME(16) with UNMAP not supported, zeroed "
+                    "blocks will be skipped\n");
+            sparse_punch = false;
+            return 0;
+        } else if (res)
+            pr2serr("write same (unmap) failed, seek=%" PRId64 "\n",
+                    to_block);
+        return res;
+    }
+#ifdef FALLOC_FL_PUNCH_HOLE
+    if (sparse_punch) {
+        off64_t off = lseek64(outfd, 0, SEEK_CUR);
+
+        if ((off < 0) ||
+            (fallocate(outfd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                       off, len) < 0)) {
+            if (verbose)
+                pr2serr(">> unable to punch holes in %s output (%s), "
+                        "zeroed blocks will be skipped\n",
+                        ((FT_BLOCK & out_type) ? "block device" : "file"),
+                        safe_strerror(errno));
+            sparse_punch = false;
+        }
+    }
+#endif
+    if (lseek64(outfd, len, SEEK_CUR) < 0) {
+        snprintf(ebuff, EBUFF_SZ, "sparse tried to bypass write: seek=%"
+                 PRId64 ", rel offset=%" PRId64 " but ...", to_block,
+                 (int64_t)len);
+        perror(ebuff);
+        return SG_LIB_FILE_ERROR;
+    }
+    return 0;
+}
+
+/* Writes 'blocks' blocks at 'bp' to block 'to_block' of the output (a
+ * regular file or block device is written at its current offset). Used
+ * when oflag=sparse or oflag=cmp split a segment. Returns 0 on success. */
+static int
+output_run(int outfd, int out_type, uint8_t * bp, int blocks,
+           int64_t to_block)
+{
+    bool dio_tmp;
+    int n, res;
+    char ebuff[EBUFF_SZ];
+
+    if (FT_SG & out_type) {
+        dio_tmp = oflag.dio;
+        res = sg_write_retry(outfd, bp, blocks, to_block, &dio_tmp);
+        if (res)
+            return res;
+    } else {
+        n = blocks * blk_sz;
+        while (((res = write(outfd, bp, n)) < 0) &&
+               ((EINTR == errno) || (EAGAIN == errno)))
+            ;
+        if (verbose > 2)
+            pr2serr("write(unix, run): count=%d, res=%d\n", n, res);
+        if (res < 0) {
+            snprintf(ebuff, EBUFF_SZ, ME "writing, seek=%" PRId64 " ",
+                     to_block);
+            perror(ebuff);
+            return -1;
+        } else if (res < n) {
+            pr2serr("output file probably full, seek=%" PRId64 " ",
+                    to_block);
+            out_full += res / blk_sz;
+            if ((res % blk_sz) > 0)
+                out_partial++;
+            return -1;
+        }
+    }
+    out_full += blocks;
+    return 0;
+}
+
+/* oflag=sparse output of the 'blocks' blocks at 'bp', destined for block
+ * 'to_block' of the output. Runs of logical blocks that are all zeros
+ * become holes: punched with fallocate(FALLOC_FL_PUNCH_HOLE) in a file or
+ * block device, or deallocated with WRITE SAME(16) (UNMAP) on a sg device.
+ * If that is not supported they are skipped over as before. The other
+ * blocks are written. When 'last' is set the final block is always written
+ * so the output ends up with the expected length. Returns 0 when done, 1
+ * if there are no zeroed blocks (the caller writes the segment in the
+ * usual way), else an error. The number of hole blocks at the end of the
+ * segment is placed in *tail_holep. */
+static int
+sparse_output(int outfd, int out_type, uint8_t * bp, int blocks,
+              int64_t to_block, bool last, int * tail_holep)
+{
+    int k, z, d, res;
+    int bs = blk_sz;
+
+    *tail_holep = 0;
+    for (k = 0; k < blocks; k += z + d) {
+        /* zeroed blocks from k, found with one vectorized scan */
+        z = sg_first_non_zero(bp + (k * bs), (blocks - k) * bs) / bs;
+        if (last && ((k + z) == blocks))
+            --z;
+        /* then blocks that are not all zeros */
+        for (d = 1; ((k + z + d) < blocks) &&
+                    (! sg_all_zeros(bp + ((k + z + d) * bs), bs)); ++d)
+            ;
+        if ((k + z) >= blocks)
+            d = 0;
+        if ((0 == k) && (0 == z) && (d == blocks))
+            return 1;
+        if (z > 0) {
+            res = sparse_hole(outfd, out_type, to_block + k, z);
+            if (res)
+                return res;
+            if ((k + z) == blocks)
+                *tail_holep = z;
+        }
+        if (0 == d)
+            continue;
+        res = output_run(outfd, out_type, bp + ((k + z) * bs), d,
+                         to_block + k + z);
+        if (res)
+            return res;
+    }
+    return 0;
+}
+
+/* READ, to check what is there, of 'blocks' blocks at from_block of sg_fd
+ * into buff, using the cdb size and dpo of *fp. Used by oflag=cmp and
+ * when resuming from a journal. Unlike sg_read() it leaves the error and
+ * residual counts of the copy alone and only prints sense data if
+ * verbose. A unit attention or aborted command is tried again once.
+ * Returns the number of blocks read or -1 if the READ failed. */
+static int
+sg_read_chk(int sg_fd, uint8_t * buff, int blocks, int64_t from_block,
+            int bs, const struct flags_t * fp)
+{
+    int res, k, tries;
+    uint8_t rdCmd[MAX_SCSI_CDBSZ];
+    uint8_t senseBuff[SENSE_BUFF_LEN];
+    struct sg_io_hdr io_hdr;
+
+    if (sg_build_scsi_cdb(rdCmd, fp->cdbsz, blocks, from_block, false,
+                          false, fp->dpo))
+        return -1;
+    for (tries = 0; tries < 2; ++tries) {
+        memset(&io_hdr, 0, sizeof(struct sg_io_hdr));
+        io_hdr.interface_id = 'S';
+        io_hdr.cmd_len = fp->cdbsz;
+        io_hdr.cmdp = rdCmd;
+        io_hdr.dxfer_direction = SG_DXFER_FROM_DEV;
+        io_hdr.dxfer_len = bs * blocks;
+        io_hdr.dxferp = buff;
+        io_hdr.mx_sb_len = SENSE_BUFF_LEN;
+        io_hdr.sbp = senseBuff;
+        io_hdr.timeout = DEF_TIMEOUT;
+        io_hdr.pack_id = (int)from_block;
+        if (verbose > 2) {
+            pr2serr("    check read cdb: ");
+            for (k = 0; k < fp->cdbsz; ++k)
+                pr2serr("%02x ", rdCmd[k]);
+            pr2serr("\n");
+        }
+        while (((res = ioctl(sg_fd, SG_IO, &io_hdr)) < 0) &&
+               ((EINTR == errno) || (EAGAIN == errno)))
+            ;
+        if (res < 0) {
+            if (verbose)
+                perror("check reading (SG_IO) on sg device, error");
+            return -1;
+        }
+        res = sg_err_category3(&io_hdr);
+        switch (res) {
+        case SG_LIB_CAT_CLEAN:
+        case SG_LIB_CAT_RECOVERED:
+            res = io_hdr.resid / bs;
+            return (res < blocks) ? (blocks - res) : 0;
+        case SG_LIB_CAT_UNIT_ATTENTION:
+        case SG_LIB_CAT_ABORTED_COMMAND:
+            if (verbose)
+                sg_chk_n_print3("check reading", &io_hdr, verbose > 1);
+            continue;
+        default:
+            if (verbose)
+                sg_chk_n_print3("check reading", &io_hdr, verbose > 1);
+            return -1;
+        }
+    }
+    return -1;
+}
+
+/* oflag=cmp output of the 'blocks' blocks at 'bp', destined for block
+ * 'to_block' of the output. The destination range is read into cmp_buff
+ * first and only runs of blocks that differ are written. Blocks that
+ * cannot be read back (e.g. beyond the end of a regular file) count as
+ * different. Returns 0 on success. */
+static int
+cmp_output(int outfd, int out_type, uint8_t * bp, int blocks,
+           int64_t to_block)
+{
+    bool same;
+    int k, s, d, res, valid;
+    int bs = blk_sz;
+    int n = blocks * blk_sz;
+    off64_t off = 0;
+
+    if (FT_SG & out_type) {
+        valid = sg_read_chk(outfd, cmp_buff, blocks, to_block, bs, &oflag);
+        if (valid < 0) {
+            ++out_cmp_rd_fails;
+            if (verbose)
+                pr2serr("cmp: unable to read output, seek=%" PRId64 ", so "
+                        "write it\n", to_block);
+            valid = 0;
+        }
+    } else {
+        off = lseek64(outfd, 0, SEEK_CUR);
+        res = -1;
+        if (off >= 0) {
+            while (((res = pread64(outfd, cmp_buff, n, off)) < 0) &&
+                   ((EINTR == errno) || (EAGAIN == errno)))
+                ;
+        }
+        if (verbose > 2)
+            pr2serr("pread(unix, cmp): count=%d, res=%d\n", n, res);
+        valid = (res > 0) ? (res / bs) : 0;
+    }
+    same = (valid == blocks) && (0 == memcmp(bp, cmp_buff, n));
+    for (k = 0; k < blocks; k += s + d) {
+        if (same) {     /* usual case when resyncing: skip whole segment */
+            s = blocks;
+            d = 0;
+        } else {
+            /* blocks the same as the output, then blocks that differ */
+            for (s = 0; ((k + s) < valid) &&
+                        (0 == memcmp(bp + ((k + s) * bs),
+                                     cmp_buff + ((k + s) * bs), bs)); ++s)
+                ;
+            for (d = 0; ((k + s + d) < blocks) &&
+                        (((k + s + d) >= valid) ||
+                         memcmp(bp + ((k + s + d) * bs),
+                                cmp_buff + ((k + s + d) * bs), bs)); ++d)
+                ;
+        }
+        if (verbose > 2)
+            pr2serr("cmp: seek blk=%" PRId64 ", same blocks=%d, differing "
+                    "blocks=%d\n", to_block + k, s, d);
+        if (s > 0) {
+            out_cmp_same_num += s;
+            if (! (FT_SG & out_type)) {
+                if (lseek64(outfd, (off64_t)s * bs, SEEK_CUR) < 0) {
+                    perror("cmp tried to bypass write, lseek64");
+                    return SG_LIB_FILE_ERROR;
+                }
+            }
+        }
+        if (d > 0) {
+            res = output_run(outfd, out_type, bp + ((k + s) * bs), d,
+                             to_block + k + s);
+            if (res)
+                return res;
+        }
+    }
+    return 0;
+}
+
+/* Checkpoint journal (journal=JFILE). Every SECS seconds the output is
+ * flushed to the media, then the number of blocks fully copied is recorded
+ * in JFILE. JFILE is replaced atomically (written to JFILE.tmp then renamed)
+ * so it always holds a complete checkpoint. With jcsum=1 a CRC-32 of the
+ * data of each region (between consecutive checkpoints) is kept as well;
+ * on resume the most recent regions are read back from OFILE and any that
+ * do not verify are copied again. Without it the last chunks copied are
+ * compared with IFILE instead. */
+
+static void
+crc32_init(void)
+{
+    int k, j;
+    uint32_t c;
+
+    for (k = 0; k < 256; ++k) {
+        for (c = k, j = 0; j < 8; ++j)
+            c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+        crc32_tab[k] = c;
+    }
+}
+
+/* CRC-32 (as used by Ethernet and zlib) continued over bp[0..len-1]. Start
+ * with crc of 0. */
+static uint32_t
+crc32_calc(uint32_t crc, const uint8_t * bp, int len)
+{
+    crc = ~crc;
+    while (len-- > 0)
+        crc = crc32_tab[(crc ^ *bp++) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+/* Called with data, in order, once it has been output */
+static void
+jnl_add(const uint8_t * bp, int blocks)
+{
+    if (jnl_fname[0] && jnl.csum)
+        jnl.crc = crc32_calc(jnl.crc, bp, blocks * blk_sz);
+}
+
+static bool
+jnl_due(void)
+{
+    return jnl_fname[0] && ((time(NULL) - jnl.last) >= jnl.secs);
+}
+
+/* Records the blocks copied so far (jnl.count - dd_count) in the journal.
+ * Must only be called when all of those blocks have been written. Errors
+ * are reported but do not stop the copy. */
+static void
+jnl_checkpoint(int outfd, int out_type)
+{
+    int k, n, fd, res;
+    int64_t done = jnl.count - dd_count;
+    char * cp;
+    char b[4096];
+    char tmp[INOUTF_SZ + 8];
+
+    jnl.last = time(NULL);
+    if (done <= jnl.done)
+        return;
+    /* what the journal records must be on the media first */
+    if (FT_SG & out_type) {
+        res = sg_ll_sync_cache_10(outfd, false, false, 0, 0, 0, false, 0);
+        if (SG_LIB_CAT_UNIT_ATTENTION == res)
+            res = sg_ll_sync_cache_10(outfd, false, false, 0, 0, 0, false,
+                                      0);
+        if (res && (SG_LIB_CAT_INVALID_OP != res)) {
+            pr2serr("journal: unable to synchronize cache, no checkpoint\n");
+            return;
+        }
+    } else if ((! (FT_DEV_NULL & out_type)) && (fdatasync(outfd) < 0)) {
+        perror("journal: fdatasync on output, no checkpoint");
+        return;
+    }
+    if (jnl.csum) {
+        if (JNL_MAX_REGIONS == jnl.nregs) {
+            memmove(jnl.regs, jnl.regs + 1,
+                    (JNL_MAX_REGIONS - 1) * sizeof(jnl.regs[0]));
+            --jnl.nregs;
+        }
+        jnl.regs[jnl.nregs].start = jnl.done;
+        jnl.regs[jnl.nregs].blocks = done - jnl.done;
+        jnl.regs[jnl.nregs].crc = jnl.crc;
+        ++jnl.nregs;
+        jnl.crc = 0;
+    }
+    jnl.done = done;
+
+    n = snprintf(b, sizeof(b), "sg_dd journal 1\nif=%s\nof=%s\nbs=%d\n"
+                 "skip=%" PRId64 "\nseek=%" PRId64 "\ncount=%" PRId64 "\n"
+                 "done=%" PRId64 "\n", jnl.inf, jnl.outf, blk_sz, jnl.skip,
+                 jnl.seek, jnl.count, done);
+    for (k = 0; k < jnl.nregs; ++k)
+        n += snprintf(b + n, sizeof(b) - n, "region=%" PRId64 ",%" PRId64
+                      ",%08x\n", jnl.regs[k].start, jnl.regs[k].blocks,
+                      jnl.regs[k].crc);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", jnl_fname);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("journal: open");
+        return;
+    }
+    res = write(fd, b, n);
+    if ((res != n) || (fsync(fd) < 0)) {
+        perror("journal: write");
+        close(fd);
+        return;
+    }
+    close(fd);
+    if (rename(tmp, jnl_fname) < 0) {
+        perror("journal: rename");
+        return;
+    }
+    /* and make the rename itself durable */
+    snprintf(tmp, sizeof(tmp), "%s", jnl_fname);
+    cp = strrchr(tmp, '/');
+    if (NULL == cp)
+        snprintf(tmp, sizeof(tmp), ".");
+    else
+        *((cp == tmp) ? (cp + 1) : cp) = '\0';
+    fd = open(tmp, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    if (verbose > 1)
+        pr2serr("journal: checkpoint, %" PRId64 " blocks copied\n", done);
+}
+
+/* Reads region 'rp' back from the output and places its CRC-32 in *crcp.
+ * Returns false if it could not be read. */
+static bool
+jnl_region_crc(int outfd, int out_type, const struct jnl_region_t * rp,
+               int bpt, uint32_t * crcp)
+{
+    bool ok = true;
+    int n, res;
+    int64_t k;
+    uint8_t * bp;
+    uint8_t * free_bp;
+
+    bp = sg_memalign(blk_sz * bpt, 0, &free_bp, false);
+    if (NULL == bp)
+        return false;
+    *crcp = 0;
+    for (k = 0; ok && (k < rp->blocks); k += n) {
+        n = ((rp->blocks - k) > bpt) ? bpt : (rp->blocks - k);
+        if (FT_SG & out_type)
+            ok = (n == sg_read_chk(outfd, bp, n, jnl.seek + rp->start + k,
+                                   blk_sz, &oflag));
+        else {
+            res = pread64(outfd, bp, n * blk_sz,
+                          (off64_t)(jnl.seek + rp->start + k) * blk_sz);
+            ok = (res == (n * blk_sz));
+        }
+        if (ok)
+            *crcp = crc32_calc(*crcp, bp, n * blk_sz);
+    }
+    free(free_bp);
+    return ok;
+}
+
+/* Reads the 'blocks' blocks at 'start' (blocks from the start of the copy)
+ * of both IFILE and OFILE into bp and bp2. Returns 1 if they are the same,
+ * 0 if they differ or either could not be read. */
+static int
+jnl_tail_same(int infd, int in_type, int outfd, int out_type, int64_t start,
+              int blocks, uint8_t * bp, uint8_t * bp2)
+{
+    int nbytes = blocks * blk_sz;
+    int res;
+
+    if (FT_SG & in_type)
+        res = (blocks == sg_read_chk(infd, bp, blocks, jnl.skip + start,
+                                     blk_sz, &iflag));
+    else
+        res = (nbytes == pread64(infd, bp, nbytes,
+                                 (off64_t)(jnl.skip + start) * blk_sz));
+    if (! res)
+        return 0;
+    if (FT_SG & out_type)
+        res = (blocks == sg_read_chk(outfd, bp2, blocks, jnl.seek + start,
+                                     blk_sz, &oflag));
+    else
+        res = (nbytes == pread64(outfd, bp2, nbytes,
+                                 (off64_t)(jnl.seek + start) * blk_sz));
+    return (res && (0 == memcmp(bp, bp2, nbytes))) ? 1 : 0;
+}
+
+/* If the journal exists, checks that it was written by a copy with the same
+ * arguments, verifies the tail of what it records (with its region
+ * checksums if it has them, else by comparing the last chunks copied with
+ * IFILE) then advances skip, seek and dd_count past what has already been
+ * copied. Returns 0 on success (including when there is no journal
+ * yet), else an error. */
+static int
+jnl_resume(const char * inf, int infd, int in_type, const char * outf,
+           int outfd, int out_type, int bpt, int64_t * skipp,
+           int64_t * seekp)
+{
+    bool good = false;
+    bool verified = false;
+    int k, n;
+    int64_t v;
+    int64_t done = -1;
+    uint32_t crc;
+    char * cp;
+    const char * bad = NULL;
+    uint8_t * bp;
+    uint8_t * free_bp;
+    FILE * fp;
+    struct jnl_region_t * rp;
+    char line[INOUTF_SZ + 16];
+
+    crc32_init();
+    jnl.inf = inf;
+    jnl.outf = outf;
+    jnl.skip = *skipp;
+    jnl.seek = *seekp;
+    jnl.count = dd_count;
+    jnl.last = time(NULL);
+    fp = fopen(jnl_fname, "r");
+    if (NULL == fp) {
+        if (ENOENT == errno)
+            return 0;           /* a new copy */
+        perror("journal: open");
+        return SG_LIB_FILE_ERROR;
+    }
+    if (fgets(line, sizeof(line), fp) &&
+        (0 == strcmp(line, "sg_dd journal 1\n")))
+        good = true;
+    while (good && (NULL == bad) && fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\n")] = '\0';
+        cp = strchr(line, '=');
+        if (NULL == cp) {
+            good = false;
+            break;
+        }
+        *cp++ = '\0';
+        v = strtoll(cp, NULL, 10);
+        if (0 == strcmp(line, "if")) {
+            if (strcmp(cp, inf))
+                bad = "if";
+        } else if (0 == strcmp(line, "of")) {
+            if (strcmp(cp, outf))
+                bad = "of";
+        } else if (0 == strcmp(line, "bs")) {
+            if (v != blk_sz)
+                bad = "bs";
+        } else if (0 == strcmp(line, "skip")) {
+            if (v != jnl.skip)
+                bad = "skip";
+        } else if (0 == strcmp(line, "seek")) {
+            if (v != jnl.seek)
+                bad = "seek";
+        } else if (0 == strcmp(line, "count")) {
+            if (v != jnl.count)
+                bad = "count";
+        } else if (0 == strcmp(line, "done"))
+            done = v;
+        else if (0 == strcmp(line, "region")) {
+            if (JNL_MAX_REGIONS == jnl.nregs)
+                good = false;
+            else {
+                rp = jnl.regs + jnl.nregs++;
+                if (3 != sscanf(cp, "%" SCNd64 ",%" SCNd64 ",%" SCNx32,
+                                &rp->start, &rp->blocks, &rp->crc))
+                    good = false;
+            }
+        }
+    }
+    fclose(fp);
+    if (bad) {
+        pr2serr("journal %s is from a copy with a different '%s=', remove "
+                "it to start again\n", jnl_fname, bad);
+        return SG_LIB_CONTRADICT;
+    }
+    if ((! good) || (done < 0) || (done > jnl.count)) {
+        pr2serr("%s is not a valid sg_dd journal\n", jnl_fname);
+        return SG_LIB_SYNTAX_ERROR;
+    }
+    /* verify the tail: re-copy the most recent regions that don't match */
+    while ((jnl.nregs > 0) && (! (FT_DEV_NULL & out_type))) {
+        rp = jnl.regs + jnl.nregs - 1;
+        if ((rp->start < 0) || ((rp->start + rp->blocks) != done))
+            break;
+        if (jnl_region_crc(outfd, out_type, rp, bpt, &crc) &&
+            (crc == rp->crc)) {
+            if (verbose)
+                pr2serr("journal: region at %" PRId64 " (%" PRId64
+                        " blocks) verified\n", rp->start, rp->blocks);
+            verified = true;
+            break;
+        }
+        pr2serr("journal: region at %" PRId64 " (%" PRId64 " blocks) does "
+                "not verify, copying it again\n", rp->start, rp->blocks);
+        done = rp->start;
+        --jnl.nregs;
+    }
+    if (! jnl.csum)
+        jnl.nregs = 0;
+    jnl.done = done;
+    if (0 == done)
+        return 0;
+    if ((STDIN_FILENO == infd) || (FT_FIFO & in_type) ||
+        (STDOUT_FILENO == outfd) || (FT_FIFO & out_type)) {
+        pr2serr("journal: can only resume when IFILE and OFILE are "
+                "seekable\n");
+        return SG_LIB_CONTRADICT;
+    }
+    /* no region checksum to go by: compare the last chunks with IFILE */
+    if ((! verified) && (! (FT_DEV_NULL & out_type))) {
+        bp = sg_memalign(2 * blk_sz * bpt, 0, &free_bp, false);
+        if (NULL == bp) {
+            pr2serr("Not enough user memory\n");
+            return sg_convert_errno(ENOMEM);
+        }
+        for (k = 0; (done > 0) && (k < JNL_MAX_REGIONS); ++k) {
+            n = (done > bpt) ? bpt : (int)done;
+            if (jnl_tail_same(infd, in_type, outfd, out_type, done - n, n,
+                              bp, bp + (blk_sz * bpt))) {
+                if (verbose)
+                    pr2serr("journal: last %d blocks copied match IFILE\n",
+                            n);
+                verified = true;
+                break;
+            }
+            pr2serr("journal: %d blocks at %" PRId64 " differ from IFILE, "
+                    "copying them again\n", n, done - n);
+            done -= n;
+        }
+        free(free_bp);
+        if ((! verified) && (done > 0)) {
+            pr2serr("journal: OFILE does not match IFILE before the "
+                    "checkpoint, remove %s to start again\n", jnl_fname);
+            return SG_LIB_CAT_MISCOMPARE;
+        }
+        while ((jnl.nregs > 0) && ((jnl.regs[jnl.nregs - 1].start +
+                                    jnl.regs[jnl.nregs - 1].blocks) > done))
+            --jnl.nregs;
+        jnl.done = done;
+        if (0 == done)
+            return 0;
+    }
+    *skipp += done;
+    *seekp += done;
+    dd_count -= done;
+    if ((! (FT_SG & in_type)) &&
+        (lseek64(infd, (off64_t)*skipp * blk_sz, SEEK_SET) < 0)) {
+        perror("journal: lseek64 on input");
+        return SG_LIB_FILE_ERROR;
+    }
+    if ((! ((FT_SG | FT_DEV_NULL) & out_type)) &&
+        (lseek64(outfd, (off64_t)*seekp * blk_sz, SEEK_SET) < 0)) {
+        perror("journal: lseek64 on output");
+        return SG_LIB_FILE_ERROR;
+    }
+    pr2serr("Resuming from journal %s: %" PRId64 " of %" PRId64 " blocks "
+            "already copied\n", jnl_fname, done, jnl.count);
+    return 0;
+}
+
+/* Reads the MAXIMUM and OPTIMAL TRANSFER LENGTH fields (in blocks) of the
+ * Block Limits VPD page of a sg device. Zero means not given. */
+static void
+auto_bpt_vpd(int sg_fd, const char * name, int * maxp, int * optp)
+{
+    int res;
+    uint32_t u;
+    uint8_t b[VPD_BLOCK_LIMITS_LEN];
+
+    memset(b, 0, sizeof(b));
+    res = sg_ll_inquiry(sg_fd, false, true, VPD_BLOCK_LIMITS, b, sizeof(b),
+                        false, (verbose > 1) ? (verbose - 1) : 0);
+    if (res || (VPD_BLOCK_LIMITS != b[1]) ||
+        (sg_get_unaligned_be16(b + 2) < 12)) {
+        if (verbose)
+            pr2serr("bpt=auto: no Block Limits VPD page from %s\n", name);
+        return;
+    }
+    u = sg_get_unaligned_be32(b + 8);
+    if ((u > 0) && ((0 == *maxp) || ((int64_t)u < *maxp)))
+        *maxp = (u > INT_MAX) ? INT_MAX : (int)u;
+    u = sg_get_unaligned_be32(b + 12);
+    if ((u > 0) && (0 == *optp))
+        *optp = (u > INT_MAX) ? INT_MAX : (int)u;
+    if (verbose)
+        pr2serr("bpt=auto: %s: maximum transfer length=%u, optimal=%u "
+                "blocks\n", name, sg_get_unaligned_be32(b + 8),
+                sg_get_unaligned_be32(b + 12));
+}
+
+/* Limits the transfer size to what the sg driver's reserved buffer on
+ * sg_fd can hold, after asking for a reserved buffer of 'hi' blocks */
+static int
+auto_bpt_reserved(int sg_fd, int hi)
+{
+    int t = hi * blk_sz;
+
+    if (ioctl(sg_fd, SG_SET_RESERVED_SIZE, &t) < 0)
+        perror(ME "SG_SET_RESERVED_SIZE error");
+    if ((ioctl(sg_fd, SG_GET_RESERVED_SIZE, &t) < 0) || (t < blk_sz))
+        return hi;
+    if (verbose)
+        pr2serr("bpt=auto: sg reserved buffer is %d bytes\n", t);
+    return ((t / blk_sz) < hi) ? (t / blk_sz) : hi;
+}
+
+/* Limits the transfer size to the largest request the block layer takes
+ * for a block device accessed with SG_IO (blk_sgio=1). That comes from the
+ * BLKSECTGET ioctl (in 512 byte sectors) or, failing that, the queue's
+ * max_sectors_kb in sysfs. */
+static int
+auto_bpt_blk_max(int fd, const char * name, int hi)
+{
+    int k;
+    int n = 0;
+    unsigned short us;
+    char b[128];
+    FILE * fp;
+    struct stat st;
+
+#ifdef BLKSECTGET
+    if ((ioctl(fd, BLKSECTGET, &us) >= 0) && (us > 0))
+        n = (int)(((int64_t)us * 512) / blk_sz);
+#endif
+    if ((0 == n) && (fstat(fd, &st) >= 0) && S_ISBLK(st.st_mode)) {
+        snprintf(b, sizeof(b), "/sys/dev/block/%u:%u/queue/max_sectors_kb",
+                 major(st.st_rdev), minor(st.st_rdev));
+        fp = fopen(b, "r");
+        if (NULL == fp) {       /* a partition, try the whole disk */
+            snprintf(b, sizeof(b), "/sys/dev/block/%u:%u/../queue/"
+                     "max_sectors_kb", major(st.st_rdev), minor(st.st_rdev));
+            fp = fopen(b, "r");
+        }
+        if (fp) {
+            if ((1 == fscanf(fp, "%d", &k)) && (k > 0))
+                n = (int)(((int64_t)k * 1024) / blk_sz);
+            fclose(fp);
+        }
+    }
+    if (n < 1)
+        return hi;
+    if (verbose)
+        pr2serr("bpt=auto: %s: block layer maximum transfer is %d blocks\n",
+                name, n);
+    return (n < hi) ? n : hi;
+}
+
+/* Sets the range and starting point of the bpt=auto hill climb from the
+ * Block Limits VPD page of sg IFILE and OFILE, their reserved buffer sizes
+ * (or block layer limits with blk_sgio=1) and the cdb size. The starting
+ * point is the OPTIMAL TRANSFER LENGTH if given, otherwise the usual
+ * default. */
+static void
+auto_bpt_init(struct auto_bpt_t * ap, int infd, int in_type, int outfd,
+              int out_type)
+{
+    int mx = 0;
+    int opt = 0;
+
+    memset(ap, 0, sizeof(*ap));
+    if (FT_SG & in_type)
+        auto_bpt_vpd(infd, "if", &mx, &opt);
+    if (FT_SG & out_type)
+        auto_bpt_vpd(outfd, "of", &mx, &opt);
+    ap->hi = AUTO_MAX_BYTES / blk_sz;
+    if ((mx > 0) && (mx < ap->hi))
+        ap->hi = mx;
+    if ((FT_SG & in_type) && (! (FT_BLOCK & in_type)))
+        ap->hi = auto_bpt_reserved(infd, ap->hi);
+    if ((FT_SG & out_type) && (! (FT_BLOCK & out_type)))
+        ap->hi = auto_bpt_reserved(outfd, ap->hi);
+    if ((FT_BLOCK & in_type) && (FT_SG & in_type))
+        ap->hi = auto_bpt_blk_max(infd, "if", ap->hi);
+    if ((FT_BLOCK & out_type) && (FT_SG & out_type))
+        ap->hi = auto_bpt_blk_max(outfd, "of", ap->hi);
+    /* the transfer length of a 6 byte cdb is 8 bits (0 means 256) */
+    if ((((FT_SG & in_type) && (6 == iflag.cdbsz)) ||
+         ((FT_SG & out_type) && (6 == oflag.cdbsz))) && (ap->hi > 256))
+        ap->hi = 256;
+    if (ap->hi < 1)
+        ap->hi = 1;
+    ap->lo = AUTO_MIN_BYTES / blk_sz;
+    if (ap->lo < 1)
+        ap->lo = 1;
+    if (ap->lo > ap->hi)
+        ap->lo = ap->hi;
+    ap->cur = (opt > 0) ? opt : ((blk_sz >= 2048) ?
+                DEF_BLOCKS_PER_2048TRANSFER : DEF_BLOCKS_PER_TRANSFER);
+    if (ap->cur > ap->hi)
+        ap->cur = ap->hi;
+    if (ap->cur < ap->lo)
+        ap->cur = ap->lo;
+    ap->best = ap->cur;
+    ap->dir = 1;
+    clock_gettime(CLOCK_MONOTONIC, &ap->start);
+    if (verbose)
+        pr2serr("bpt=auto: from %d blocks per transfer, range %d to %d\n",
+                ap->cur, ap->lo, ap->hi);
+}
+
+/* Hill climb step at the end of a measurement window. Transfers double
+ * (or halve) while throughput improves by more than 5%; when it does not,
+ * go back to the best size and try the other direction. After turning
+ * twice (or reaching a limit) settle, then climb again from there after
+ * AUTO_REPROBE_WINS windows in case conditions have changed. Transfers
+ * are not grown once they take longer than AUTO_MAX_LAT_MS on average. */
+static void
+auto_bpt_window(struct auto_bpt_t * ap, double secs)
+{
+    int next;
+    double rate = ap->blks / secs;
+    double lat_ms = (secs * 1000.0) / ap->nxfers;
+
+    if (verbose > 2)
+        pr2serr("bpt=auto: %d blocks per transfer: %.1f MB/sec, %.2f ms "
+                "per transfer\n", ap->cur, (rate * blk_sz) / 1000000.0,
+                lat_ms);
+    if (ap->settled) {
+        if (++ap->wins < AUTO_REPROBE_WINS)
+            return;
+        ap->settled = false;
+        ap->reversals = 0;
+        ap->best_rate = rate;
+    } else if (rate > (ap->best_rate * 1.05)) {
+        ap->best = ap->cur;
+        ap->best_rate = rate;
+    } else if (ap->cur != ap->best) {
+        ap->dir = -ap->dir;
+        ++ap->reversals;
+    } else
+        ap->best_rate = rate;   /* re-measured */
+    if ((ap->dir > 0) && (lat_ms > AUTO_MAX_LAT_MS) &&
+        (ap->cur == ap->best)) {
+        ap->dir = -1;
+        ++ap->reversals;
+    }
+    next = ap->best;
+    while ((next == ap->best) && (ap->reversals < 2)) {
+        next = (ap->dir > 0) ? (ap->best * 2) : (ap->best / 2);
+        if (next > ap->hi)
+            next = ap->hi;
+        if (next < ap->lo)
+            next = ap->lo;
+        if (next == ap->best) {         /* at a limit, turn around */
+            ap->dir = -ap->dir;
+            ++ap->reversals;
+        }
+    }
+    if (ap->reversals >= 2) {
+        next = ap->best;
+        ap->settled = true;
+        ap->wins = 0;
+        if (verbose > 1)
+            pr2serr("bpt=auto: settled on %d blocks per transfer, %.1f "
+                    "MB/sec\n", next, (ap->best_rate * blk_sz) / 1000000.0);
+    }
+    ap->cur = next;
+}
+
+/* Called after each transfer of 'blocks' blocks has been output, in order.
+ * 'blocks_per' is the transfer size in use; if it is below the climb's
+ * current size then an ENOMEM has reduced it so the upper limit is lowered.
+ * Returns the number of blocks per transfer to use next. */
+static int
+auto_bpt_done(struct auto_bpt_t * ap, int blocks, int blocks_per)
+{
+    double secs;
+    struct timespec now;
+
+    if (blocks_per < ap->cur) {
+        ap->hi = blocks_per;
+        if (ap->lo > ap->hi)
+            ap->lo = ap->hi;
+        ap->cur = blocks_per;
+        if (ap->best > ap->hi)
+            ap->best = ap->hi;
+    }
+    ap->blks += blocks;
+    ++ap->nxfers;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    secs = (now.tv_sec - ap->start.tv_sec) +
+           ((now.tv_nsec - ap->start.tv_nsec) / 1000000000.0);
+    if ((ap->nxfers >= AUTO_WIN_XFERS) && (secs * 1000.0 >= AUTO_WIN_MS)) {
+        auto_bpt_window(ap, secs);
+        ap->blks = 0;
+        ap->nxfers = 0;
+        ap->start = now;
+    }
+    return ap->cur;
+}
+
+/* Queue depth copy engine, used when iflag=qd=N and/or oflag=qd=N are
+ * given. A single thread keeps up to iflag.qd READs and oflag.qd WRITEs
+ * outstanding using the sg driver's asynchronous interface: a sg_io_hdr is
+ * write()-n to the sg file descriptor to submit a command and read() back
+ * when it completes. Chunks of (up to) bpt blocks pass through a ring of
+ * slots in sequence order and are output in that order, so the output
+ * (sg device, file or pipe) sees the data in the same order as the lockstep
+ * copy does. A command that completes with an error is re-issued with
+ * sg_read() or sg_write() so their retry and 'coe' handling applies. */
+
+#define QD_FREE 0
+#define QD_RD_SUBMITTED 1
+#define QD_RD_DONE 2
+#define QD_WR_SUBMITTED 3
+#define QD_WR_DONE 4            /* written, waiting for earlier chunks */
+
+struct qd_slot_t {
+    int state;
+    int blocks;
+    bool more;                  /* false for last chunk (for oflag=sparse) */
+    int64_t seq;
+    int64_t lba;                /* READ from here */
+    int64_t out_lba;            /* WRITE to here */
+    uint8_t * buff;
+    uint8_t * free_buff;
+    uint8_t cdb[MAX_SCSI_CDBSZ];
+    uint8_t sense[SENSE_BUFF_LEN];
+    struct sg_io_hdr io_hdr;
+};
+
+struct qd_ctl_t {
+    bool in_async;              /* READs submitted with write(infd) */
+    bool out_async;             /* WRITEs submitted with write(outfd) */
+    int infd;
+    int in_type;
+    int outfd;
+    int out_type;
+    int out2fd;                 /* -1 if no of2= */
+    int dio_incomplete;
+    int sparse_blocks;          /* hole at end of last chunk output */
+    int64_t end_seq;            /* chunks from this one are not output */
+    struct auto_bpt_t * abp;    /* bpt=auto, else NULL */
+};
+
+/* Submits a READ or WRITE of the slot's blocks. Returns 0 on success,
+ * SG_LIB_SYNTAX_ERROR if the cdb can't be built, -2 for ENOMEM and -1
+ * for other errors. */
+static int
+qd_submit(int sg_fd, struct qd_slot_t * sp, bool write_true,
+          const struct flags_t * fp)
+{
+    int res, k;
+    int64_t lba = write_true ? sp->out_lba : sp->lba;
+    struct sg_io_hdr * hp = &sp->io_hdr;
+
+    if (sg_build_scsi_cdb(sp->cdb, fp->cdbsz, sp->blocks, lba, write_true,
+                          fp->fua, fp->dpo)) {
+        pr2serr(ME "bad %s cdb build, block=%" PRId64 ", blocks=%d\n",
+                (write_true ? "wr" : "rd"), lba, sp->blocks);
+        return SG_LIB_SYNTAX_ERROR;
+    }
+    memset(hp, 0, sizeof(struct sg_io_hdr));
+    hp->interface_id = 'S';
+    hp->cmd_len = fp->cdbsz;
+    hp->cmdp = sp->cdb;
+    hp->dxfer_direction = write_true ? SG_DXFER_TO_DEV : SG_DXFER_FROM_DEV;
+    hp->dxfer_len = blk_sz * sp->blocks;
+    hp->dxferp = sp->buff;
+    hp->mx_sb_len = SENSE_BUFF_LEN;
+    hp->sbp = sp->sense;
+    hp->timeout = DEF_TIMEOUT;
+    hp->pack_id = (int)lba;
+    hp->usr_ptr = sp;
+    if (fp->dio)
+        hp->flags |= SG_FLAG_DIRECT_IO;
+
+    if (verbose > 2) {
+        pr2serr("    %s cdb (qd): ", (write_true ? "write" : "read"));
+        for (k = 0; k < fp->cdbsz; ++k)
+            pr2serr("%02x ", sp->cdb[k]);
+        pr2serr("\n");
+    }
+    while (((res = write(sg_fd, hp, sizeof(struct sg_io_hdr))) < 0) &&
+           ((EINTR == errno) || (EAGAIN == errno)))
+        ;
+    if (res < 0) {
+        if (ENOMEM == errno)
+            return -2;
+        perror(write_true ? "writing (async sg) on sg device, error" :
+                            "reading (async sg) on sg device, error");
+        return -1;
+    }
+    sp->state = write_true ? QD_WR_SUBMITTED : QD_RD_SUBMITTED;
+    return 0;
+}
+
+/* Fetches one completed command from sg_fd. Returns 0 and sets *spp to
+ * its slot, 1 if none has completed, or -1 if error. */
+static int
+qd_receive(int sg_fd, struct qd_slot_t ** spp)
+{
+    int res;
+    struct qd_slot_t * sp;
+    struct sg_io_hdr io_hdr;
+
+    memset(&io_hdr, 0, sizeof(struct sg_io_hdr));
+    io_hdr.interface_id = 'S';
+    io_hdr.pack_id = -1;
+    while (((res = read(sg_fd, &io_hdr, sizeof(struct sg_io_hdr))) < 0) &&
+           (EINTR == errno))
+        ;
+    if (res < 0) {
+        if (EAGAIN == errno)
+            return 1;
+        perror("receiving (async sg) from sg device, error");
+        return -1;
+    }
+    sp = (struct qd_slot_t *)io_hdr.usr_ptr;
+    sp->io_hdr = io_hdr;
+    *spp = sp;
+    return 0;
+}
+
+/* Handles a completed READ (or WRITE if write_true). Returns 0 if the
+ * chunk is now good, 1 if fewer blocks were read than asked for (the
+ * chunk is still good), else an error. */
+static int
+qd_complete(struct qd_ctl_t * qcp, struct qd_slot_t * sp, bool write_true)
+{
+    bool dio_tmp;
+    int res, blks_read;
+    struct sg_io_hdr * hp = &sp->io_hdr;
+    const struct flags_t * fp = write_true ? &oflag : &iflag;
+    const char * np = write_true ? "writing" : "reading";
+
+    if (verbose > 2)
+        pr2serr("      %s (qd) lba=%" PRId64 " duration=%u ms\n", np,
+                (write_true ? sp->out_lba : sp->lba), hp->duration);
+    res = sg_err_category3(hp);
+    switch (res) {
+    case SG_LIB_CAT_RECOVERED:
+        ++recovered_errs;
+        sg_chk_n_print3(np, hp, verbose > 1);
+#if defined(__GNUC__)
+#if (__GNUC__ >= 7)
+        __attribute__((fallthrough));
+        /* FALL THROUGH */
+#endif
+#endif
+    case SG_LIB_CAT_CLEAN:
+        if (fp->dio &&
+            ((hp->info & SG_INFO_DIRECT_IO_MASK) != SG_INFO_DIRECT_IO))
+            ++qcp->dio_incomplete;
+        if (! write_true)
+            sum_of_resids += hp->resid;
+        return 0;
+    default:
+        break;
+    }
+    /* re-issue synchronously, the lockstep error handling then applies */
+    if (verbose)
+        pr2serr("%s (qd) at lba=%" PRId64 " failed, category=%d, "
+                "re-issuing\n", np, (write_true ? sp->out_lba : sp->lba),
+                res);
+    dio_tmp = fp->dio;
+    if (write_true)
+        res = sg_write_retry(qcp->outfd, sp->buff, sp->blocks, sp->out_lba,
+                             &dio_tmp);
+    else {
+        blks_read = sp->blocks;
+        res = sg_read(qcp->infd, sp->buff, sp->blocks, sp->lba, blk_sz,
+                      &iflag, &dio_tmp, &blks_read);
+        if (res)
+            pr2serr("sg_read failed, at or after lba=%" PRId64 " [0x%"
+                    PRIx64 "]\n", sp->lba, sp->lba);
+        else if (blks_read < sp->blocks) {
+            sp->blocks = blks_read;
+            res = 1;
+        }
+    }
+    if ((res >= 0) && (res <= 1) && fp->dio && (! dio_tmp))
+        ++qcp->dio_incomplete;
+    return res;
+}
+
+/* Reads a chunk from a device or file that is not accessed
+ * asynchronously. Returns 0 if all blocks were read, 1 if less (including
+ * none) and sp->blocks has been reduced, else an error. */
+static int
+qd_read_sync(struct qd_ctl_t * qcp, struct qd_slot_t * sp)
+{
+    bool dio_tmp;
+    int res, blks_read;
+    char ebuff[EBUFF_SZ];
+
+    if (FT_SG & qcp->in_type) {         /* blk_sgio=1 on a block device */
+        dio_tmp = iflag.dio;
+        blks_read = sp->blocks;
+        res = sg_read(qcp->infd, sp->buff, sp->blocks, sp->lba, blk_sz,
+                      &iflag, &dio_tmp, &blks_read);
+        if (res) {
+            pr2serr("sg_read failed, at or after lba=%" PRId64 " [0x%"
+                    PRIx64 "]\n", sp->lba, sp->lba);
+            return res;
+        }
+        if (iflag.dio && (! dio_tmp))
+            ++qcp->dio_incomplete;
+        if (blks_read < sp->blocks) {
+            sp->blocks = blks_read;
+            return 1;
+        }
+        return 0;
+    }
+    while (((res = read(qcp->infd, sp->buff, sp->blocks * blk_sz)) < 0) &&
+           ((EINTR == errno) || (EAGAIN == errno)))
+        ;
+    if (verbose > 2)
+        pr2serr("read(unix): count=%d, res=%d\n", sp->blocks * blk_sz, res);
+    if (res < 0) {
+        snprintf(ebuff, EBUFF_SZ, ME "reading, skip=%" PRId64 " ", sp->lba);
+        perror(ebuff);
+        return -1;
+    } else if (res < sp->blocks * blk_sz) {
+        sp->blocks = res / blk_sz;
+        if ((res % blk_sz) > 0) {
+            sp->blocks++;
+            in_partial++;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/* Outputs a chunk whose data is ready: to of2 (if given), then either
+ * through sparse_output() (oflag=sparse) or cmp_output() (oflag=cmp),
+ * submitted as an asynchronous WRITE, or written out synchronously.
+ * Returns 0 on success. */
+static int
+qd_output(struct qd_ctl_t * qcp, struct qd_slot_t * sp)
+{
+    bool dio_tmp;
+    int res;
+    int nbytes = sp->blocks * blk_sz;
+    char ebuff[EBUFF_SZ];
+
+    if (qcp->out2fd >= 0) {
+        while (((res = write(qcp->out2fd, sp->buff, nbytes)) < 0) &&
+               ((EINTR == errno) || (EAGAIN == errno)))
+            ;
+        if (verbose > 2)
+            pr2serr("write to of2: count=%d, res=%d\n", nbytes, res);
+        if (res < 0) {
+            snprintf(ebuff, EBUFF_SZ, ME "writing to of2, seek=%" PRId64
+                     " ", sp->out_lba);
+            perror(ebuff);
+            return -1;
+        }
+    }
+    res = 1;
+    if (oflag.sparse && (! (FT_DEV_NULL & qcp->out_type))) {
+        res = sparse_output(qcp->outfd, qcp->out_type, sp->buff, sp->blocks,
+                            sp->out_lba, ! sp->more, &qcp->sparse_blocks);
+        if ((res < 0) || (res > 1))
+            return res;
+    }
+    if (oflag.cmp && (! (FT_DEV_NULL & qcp->out_type))) {
+        res = cmp_output(qcp->outfd, qcp->out_type, sp->buff, sp->blocks,
+                         sp->out_lba);
+        if (res)
+            return res;
+    } else if (0 == res)
+        ;       /* done by sparse_output() */
+    else if (qcp->out_async)
+        return qd_submit(qcp->outfd, sp, true, &oflag);
+    else if (FT_SG & qcp->out_type) {   /* blk_sgio=1 on a block device */
+        dio_tmp = oflag.dio;
+        res = sg_write_retry(qcp->outfd, sp->buff, sp->blocks, sp->out_lba,
+                             &dio_tmp);
+        if (res)
+            return res;
+        if (oflag.dio && (! dio_tmp))
+            ++qcp->dio_incomplete;
+        out_full += sp->blocks;
+    } else if (FT_DEV_NULL & qcp->out_type)
+        out_full += sp->blocks;
+    else {
+        while (((res = write(qcp->outfd, sp->buff, nbytes)) < 0) &&
+               ((EINTR == errno) || (EAGAIN == errno)))
+            ;
+        if (verbose > 2)
+            pr2serr("write(unix): count=%d, res=%d\n", nbytes, res);
+        if (res < 0) {
+            snprintf(ebuff, EBUFF_SZ, ME "writing, seek=%" PRId64 " ",
+                     sp->out_lba);
+            perror(ebuff);
+            return -1;
+        } else if (res < nbytes) {
+            pr2serr("output file probably full, seek=%" PRId64 " ",
+                    sp->out_lba);
+            out_full += res / blk_sz;
+            if ((res % blk_sz) > 0)
+                out_partial++;
+            return -1;
+        }
+        out_full += sp->blocks;
+    }
+    sp->state = QD_WR_DONE;
+    return 0;
+}
+
+/* Frees written chunks, from *seqp up to wr_seq, in sequence order and
+ * stops at the first one that is still being written (or failed). So
+ * dd_count, and with it a checkpoint, only ever covers a prefix of the
+ * copy that is all on OFILE even though WRITEs complete out of order. */
+static void
+qd_written(struct qd_slot_t * slots, int nslots, int64_t * seqp,
+           int64_t wr_seq)
+{
+    struct qd_slot_t * sp;
+
+    for ( ; *seqp < wr_seq; ++*seqp) {
+        sp = slots + (*seqp % nslots);
+        if (QD_WR_DONE != sp->state)
+            break;
+        jnl_add(sp->buff, sp->blocks);
+        dd_count -= sp->blocks;
+        sp->state = QD_FREE;
+    }
+}
+
+/* Copies dd_count blocks keeping several commands outstanding, see above.
+ * Decrements dd_count as chunks are written, in sequence order (to 0 if
+ * the input ends early) and returns 0 on success. After an error the
+ * outstanding WRITEs are drained first so dd_count then reflects all of
+ * the copy, up to the first chunk not written, that is on OFILE. */
+static int
+qd_copy(struct qd_ctl_t * qcp, int bpt, int64_t skip, int64_t seek)
+{
+    bool stop = false;          /* stop issuing reads */
+    int k, n, res, iqd, oqd, nslots;
+    int rd_out = 0;
+    int wr_out = 0;
+    int ret = 0;
+    int64_t remaining = dd_count;
+    int64_t rd_seq = 0;
+    int64_t wr_seq = 0;
+    int64_t done_seq = 0;
+    struct qd_slot_t * sp;
+    struct qd_slot_t * slots;
+    struct pollfd pfd[2];
+
+    iqd = (qcp->in_async && (iflag.qd > 1)) ? iflag.qd : 1;
+    oqd = (qcp->out_async && (oflag.qd > 1)) ? oflag.qd : 1;
+    nslots = iqd + oqd;
+    qcp->end_seq = INT64_MAX;
+    if (verbose)
+        pr2serr("qd copy: %d READs (%s), %d WRITEs (%s) outstanding, %d "
+                "buffers\n", iqd, (qcp->in_async ? "async" : "sync"), oqd,
+                (qcp->out_async ? "async" : "sync"), nslots);
+    slots = (struct qd_slot_t *)calloc(nslots, sizeof(struct qd_slot_t));
+    if (NULL == slots) {
+        pr2serr("Not enough user memory\n");
+        return sg_convert_errno(ENOMEM);
+    }
+    for (k = 0; k < nslots; ++k) {
+        slots[k].buff = sg_memalign(blk_sz * bpt, 0, &slots[k].free_buff,
+                                    false);
+        if (NULL == slots[k].buff) {
+            pr2serr("sg_memalign: error, out of memory?\n");
+            ret = sg_convert_errno(ENOMEM);
+            goto fini;
+        }
+    }
+
+    while (true) {
+        qd_written(slots, nslots, &done_seq, wr_seq);
+        /* checkpoint when no WRITEs are outstanding, see jnl_checkpoint() */
+        if ((0 == ret) && (0 == wr_out) && jnl_due())
+            jnl_checkpoint(qcp->outfd, qcp->out_type);
+        /* fill free slots, in sequence order, with READs (or read()s) */
+        while ((! stop) && (0 == ret) && (remaining > 0) && (rd_out < iqd)) {
+            sp = slots + (rd_seq % nslots);
+            if (QD_FREE != sp->state)
+                break;
+            sp->seq = rd_seq;
+            n = qcp->abp ? qcp->abp->cur : bpt;
+            sp->blocks = (remaining > n) ? n : remaining;
+            sp->lba = skip;
+            sp->out_lba = seek;
+            remaining -= sp->blocks;
+            sp->more = (remaining > 0);
+            if (qcp->in_async) {
+                res = qd_submit(qcp->infd, sp, false, &iflag);
+                if (res) {
+                    ret = res;
+                    break;
+                }
+                ++rd_out;
+            } else {
+                res = qd_read_sync(qcp, sp);
+                if ((res < 0) || (res > 1)) {
+                    ret = res;
+                    break;
+                } else if (1 == res) {
+                    stop = true;
+                    qcp->end_seq = rd_seq + 1;
+                    if (0 == sp->blocks)
+                        break;          /* nothing read */
+                }
+                in_full += sp->blocks;
+                sp->state = QD_RD_DONE;
+            }
+            skip += sp->blocks;
+            seek += sp->blocks;
+            ++rd_seq;
+        }
+        /* output, strictly in sequence order */
+        while ((0 == ret) && (wr_seq < rd_seq) && (wr_seq < qcp->end_seq) &&
+               (wr_out < oqd) && (! ((wr_out > 0) && jnl_due()))) {
+            sp = slots + (wr_seq % nslots);
+            if (QD_RD_DONE != sp->state)
+                break;
+            res = qd_output(qcp, sp);
+            if (res) {
+                ret = res;
+                break;
+            }
+            if (qcp->abp)
+                auto_bpt_done(qcp->abp, sp->blocks, qcp->abp->cur);
+            if (QD_WR_SUBMITTED == sp->state)
+                ++wr_out;
+            ++wr_seq;
+        }
+        if ((0 == rd_out) && (0 == wr_out)) {
+            if (ret || stop || (0 == remaining))
+                break;
+            continue;
+        }
+
+        /* wait for, then process, completions */
+        n = 0;
+        if (rd_out > 0) {
+            pfd[n].fd = qcp->infd;
+            pfd[n++].events = POLLIN;
+        }
+        if (wr_out > 0) {
+            pfd[n].fd = qcp->outfd;
+            pfd[n++].events = POLLIN;
+        }
+        res = poll(pfd, n, -1);
+        if (res < 0) {
+            if (EINTR == errno)
+                continue;
+            perror("poll on sg device(s)");
+            ret = -1;
+            break;
+        }
+        for (k = 0; k < n; ++k) {
+            if (0 == pfd[k].revents)
+                continue;
+            while (0 == (res = qd_receive(pfd[k].fd, &sp))) {
+                if (QD_RD_SUBMITTED == sp->state) {
+                    --rd_out;
+                    if (ret) {          /* draining after an error */
+                        sp->state = QD_FREE;
+                        continue;
+                    }
+                    res = qd_complete(qcp, sp, false);
+                    if ((res < 0) || (res > 1)) {
+                        ret = res;
+                        sp->state = QD_FREE;
+                        continue;
+                    } else if (1 == res) {
+                        stop = true;
+                        if (qcp->end_seq > sp->seq + 1)
+                            qcp->end_seq = sp->seq + 1;
+                    }
+                    if (sp->seq < qcp->end_seq)
+                        in_full += sp->blocks;
+                    sp->state = QD_RD_DONE;
+                } else if (QD_WR_SUBMITTED == sp->state) {
+                    --wr_out;
+                    /* also when draining after an error */
+                    res = qd_complete(qcp, sp, true);
+                    if (res) {
+                        if (0 == ret)
+                            ret = res;
+                        sp->state = QD_FREE;
+                        continue;
+                    }
+                    out_full += sp->blocks;
+                    sp->state = QD_WR_DONE;
+                } else {
+                    pr2serr("%s: unexpected completion, state=%d\n",
+                            __func__, sp->state);
+                    ret = -1;
+                    goto fini;
+                }
+            }
+            if (res < 0) {
+                ret = -1;
+                goto fini;      /* can't drain, leave it to close() */
+            }
+        }
+    }
+    qd_written(slots, nslots, &done_seq, wr_seq);
+    if ((0 == ret) && stop)
+        dd_count = 0;           /* input ended early, as lockstep does */
+fini:
+    for (k = 0; k < nslots; ++k)
+        free(slots[k].free_buff);
+    free(slots);
+    return ret;
+}
+
+
 static void
 calc_duration_throughput(bool contin)
 {
@@ -1135,6 +2729,8 @@ process_flags(const char * arg, struct flags_t * fp)
             *np++ = '\0';
         if (0 == strcmp(cp, "append"))
             fp->append = true;
+        else if (0 == strcmp(cp, "cmp"))
+            fp->cmp = true;
         else if (0 == strcmp(cp, "coe"))
             ++fp->coe;
         else if (0 == strcmp(cp, "dio"))
@@ -1155,7 +2751,13 @@ process_flags(const char * arg, struct flags_t * fp)
             ++fp->nocache;
         else if (0 == strcmp(cp, "null"))
             ;
-        else if (0 == strcmp(cp, "sgio"))
+        else if (0 == strncmp(cp, "qd=", 3)) {
+            fp->qd = sg_get_num(cp + 3);
+            if ((fp->qd < 1) || (fp->qd > MAX_QD)) {
+                pr2serr("qd= expects a number from 1 to %d\n", MAX_QD);
+                return 1;
+            }
+        } else if (0 == strcmp(cp, "sgio"))
             fp->sgio = true;
         else if (0 == strcmp(cp, "sparse"))
             fp->sparse = true;
@@ -1411,7 +3013,8 @@ open_of(const char * outf, int64_t seek, int bpt, struct flags_t * ofp,
         outfd = -1; /* don't bother opening */
     else {
         if (! (FT_RAW & *out_typep)) {
-            flags = O_WRONLY | O_CREAT;
+            flags = ((ofp->cmp || jnl_fname[0]) ? O_RDWR : O_WRONLY) |
+                    O_CREAT;
             if (ofp->direct)
                 flags |= O_DIRECT;
             if (ofp->excl)
@@ -1427,7 +3030,7 @@ open_of(const char * outf, int64_t seek, int bpt, struct flags_t * ofp,
                 goto file_err;
             }
         } else {
-            flags = O_WRONLY;
+            flags = (ofp->cmp || jnl_fname[0]) ? O_RDWR : O_WRONLY;
             if (ofp->direct)
                 flags |= O_DIRECT;
             if (ofp->excl)
@@ -1496,6 +3099,7 @@ int
 main(int argc, char * argv[])
 {
     bool bpt_given = false;
+    bool bpt_auto = false;
     bool cdbsz_given = false;
     bool dio_tmp, first;
     bool do_sync = false;
@@ -1515,6 +3119,7 @@ main(int argc, char * argv[])
     int out_type = FT_OTHER;
     int out2_type = FT_OTHER;
     int penult_blocks = 0;
+    int sparse_tail = 0;
     int ret = 0;
     int64_t skip = 0;
     int64_t seek = 0;
@@ -1530,12 +3135,14 @@ main(int argc, char * argv[])
     char out2f[INOUTF_SZ];
     char str[STR_SZ];
     char ebuff[EBUFF_SZ];
+    struct auto_bpt_t ab;
 
     inf[0] = '\0';
     outf[0] = '\0';
     out2f[0] = '\0';
     iflag.cdbsz = DEF_SCSI_CDBSZ;
     oflag.cdbsz = DEF_SCSI_CDBSZ;
+    jnl.secs = DEF_JNL_SECS;
 
     for (k = 1; k < argc; k++) {
         if (argv[k]) {
@@ -1555,10 +3162,14 @@ main(int argc, char * argv[])
             iflag.sgio = !! sg_get_num(buf);
             oflag.sgio = iflag.sgio;
         } else if (0 == strcmp(key, "bpt")) {
-            bpt = sg_get_num(buf);
-            if (-1 == bpt) {
-                pr2serr(ME "bad argument to 'bpt='\n");
-                return SG_LIB_SYNTAX_ERROR;
+            if (0 == strcmp(buf, "auto"))
+                bpt_auto = true;
+            else {
+                bpt = sg_get_num(buf);
+                if (-1 == bpt) {
+                    pr2serr(ME "bad argument to 'bpt='\n");
+                    return SG_LIB_SYNTAX_ERROR;
+                }
             }
             bpt_given = true;
         } else if (0 == strcmp(key, "bs")) {
@@ -1616,6 +3227,20 @@ main(int argc, char * argv[])
                 pr2serr(ME "bad argument to 'iflag='\n");
                 return SG_LIB_SYNTAX_ERROR;
             }
+        } else if (0 == strcmp(key, "jcsum"))
+            jnl.csum = !! sg_get_num(buf);
+        else if (0 == strcmp(key, "journal")) {
+            if ('\0' != jnl_fname[0]) {
+                pr2serr("Second JFILE argument??\n");
+                return SG_LIB_CONTRADICT;
+            } else
+                snprintf(jnl_fname, INOUTF_SZ, "%s", buf);
+        } else if (0 == strcmp(key, "jsecs")) {
+            jnl.secs = sg_get_num(buf);
+            if (jnl.secs < 1) {
+                pr2serr(ME "bad argument to 'jsecs='\n");
+                return SG_LIB_SYNTAX_ERROR;
+            }
         } else if (0 == strcmp(key, "obs"))
             obs = sg_get_num(buf);
         else if (0 == strcmp(key, "odir")) {
@@ -1748,12 +3373,25 @@ main(int argc, char * argv[])
         pr2serr("Can't use both append and seek switches\n");
         return SG_LIB_CONTRADICT;
     }
+    if (oflag.cmp && (oflag.append || oflag.sparse)) {
+        pr2serr("Can't use oflag=cmp with append or sparse\n");
+        return SG_LIB_CONTRADICT;
+    }
+    if (jnl_fname[0] && oflag.append) {
+        pr2serr("Can't use both journal and append switches\n");
+        return SG_LIB_CONTRADICT;
+    }
     if (bpt < 1) {
         pr2serr("bpt must be greater than 0\n");
         return SG_LIB_SYNTAX_ERROR;
     }
     if (iflag.sparse)
         pr2serr("sparse flag ignored for iflag\n");
+    if (iflag.cmp)
+        pr2serr("cmp flag ignored for iflag\n");
+    if (oflag.cmp && (oflag.qd > 1))
+        pr2serr("oflag=cmp makes WRITEs synchronous, qd=%d only applies to "
+                "READs\n", oflag.qd);
 
     /* defaulting transfer size to 128*2048 for CD/DVDs is too large
        for the block layer in lk 2.6 and results in an EIO on the
@@ -1802,9 +3440,10 @@ main(int argc, char * argv[])
         pr2serr("For more information use '--help'\n");
         return SG_LIB_CONTRADICT;
     }
-    if (oflag.sparse) {
+    if (oflag.sparse || oflag.cmp) {
         if (STDOUT_FILENO == outfd) {
-            pr2serr("oflag=sparse needs seekable output file\n");
+            pr2serr("oflag=%s needs seekable output file\n",
+                    (oflag.cmp ? "cmp" : "sparse"));
             return SG_LIB_CONTRADICT;
         }
     }
@@ -1915,6 +3554,16 @@ main(int argc, char * argv[])
             oflag.cdbsz = MAX_SCSI_CDBSZ;
         }
     }
+    if (bpt_auto) {
+        auto_bpt_init(&ab, infd, in_type, outfd, out_type);
+        bpt = ab.hi;            /* buffers are allocated for the largest */
+    }
+    if (jnl_fname[0]) {
+        res = jnl_resume(inf, infd, in_type, outf, outfd, out_type, bpt,
+                         &skip, &seek);
+        if (res)
+            return res;
+    }
 
     if (iflag.dio || iflag.direct || oflag.direct || (FT_RAW & in_type) ||
         (FT_RAW & out_type)) {  /* want heap buffer aligned to page_size */
@@ -1931,8 +3580,15 @@ main(int argc, char * argv[])
             return sg_convert_errno(ENOMEM);
         }
     }
+    if (oflag.cmp) {
+        cmp_buff = sg_memalign(blk_sz * bpt, 0, &free_cmp_buff, false);
+        if (NULL == cmp_buff) {
+            pr2serr("Not enough user memory for oflag=cmp\n");
+            return sg_convert_errno(ENOMEM);
+        }
+    }
 
-    blocks_per = bpt;
+    blocks_per = bpt_auto ? ab.cur : bpt;
 #ifdef DEBUG
     pr2serr("Start of loop, count=%" PRId64 ", blocks_per=%d\n", dd_count,
             blocks_per);
@@ -1950,14 +3606,41 @@ main(int argc, char * argv[])
         goto bypass_copy;
     }
 
+    if (iflag.qd || oflag.qd) {
+        struct qd_ctl_t qc;
+
+        memset(&qc, 0, sizeof(qc));
+        /* sg async submission is a write() so needs O_RDWR */
+        qc.in_async = (FT_SG & in_type) && (! (FT_BLOCK & in_type)) &&
+                      (O_RDWR == (fcntl(infd, F_GETFL) & O_ACCMODE));
+        qc.out_async = (FT_SG & out_type) && (! (FT_BLOCK & out_type));
+        if (qc.in_async || qc.out_async) {
+            qc.infd = infd;
+            qc.in_type = in_type;
+            qc.outfd = outfd;
+            qc.out_type = out_type;
+            qc.out2fd = out2f[0] ? out2fd : -1;
+            qc.abp = bpt_auto ? &ab : NULL;
+            ret = qd_copy(&qc, bpt, skip, seek);
+            dio_incomplete_count += qc.dio_incomplete;
+            penult_blocks = qc.sparse_blocks;
+            penult_sparse_skip = (penult_blocks > 0);
+            goto copy_end;
+        }
+        pr2serr("qd=N ignored: needs IFILE or OFILE to be a sg device\n");
+    }
+
     /* <<< main loop that does the copy >>> */
     while (dd_count > 0) {
+        if (jnl_due())
+            jnl_checkpoint(outfd, out_type);
         bytes_read = 0;
         bytes_of = 0;
         bytes_of2 = 0;
         penult_sparse_skip = sparse_skip;
-        penult_blocks = penult_sparse_skip ? blocks : 0;
+        penult_blocks = penult_sparse_skip ? sparse_tail : 0;
         sparse_skip = false;
+        sparse_tail = 0;
         blocks = (dd_count > blocks_per) ? blocks_per : dd_count;
         if (FT_SG & in_type) {
             dio_tmp = iflag.dio;
@@ -2041,50 +3724,22 @@ main(int argc, char * argv[])
             out2_off += res;
         }
 
-        if (oflag.sparse && (dd_count > blocks) &&
-            (! (FT_DEV_NULL & out_type))) {
-            if (NULL == zeros_buff) {
-                zeros_buff = sg_memalign(blocks * blk_sz, 0, &free_zeros_buff,
-                                         false);
-                if (NULL == zeros_buff) {
-                    pr2serr("zeros_buff sg_memalign failed\n");
-                    ret = -1;
-                    break;
-                }
-            }
-            if (0 == memcmp(wrkPos, zeros_buff, blocks * blk_sz))
-                sparse_skip = true;
-        }
-        if (sparse_skip) {
-            if (FT_SG & out_type) {
-                out_sparse_num += blocks;
-                if (verbose > 2)
-                    pr2serr("sparse bypassing sg_write: seek blk=%" PRId64
-                            ", offset blks=%d\n", seek, blocks);
-            } else if (FT_DEV_NULL & out_type)
-                ;
-            else {
-                off64_t offset = blocks * blk_sz;
-                off64_t off_res;
-
-                if (verbose > 2)
-                    pr2serr("sparse bypassing write: seek=%" PRId64 ", rel "
-                            "offset=%" PRId64 "\n", (seek * blk_sz),
-                            (int64_t)offset);
-                off_res = lseek64(outfd, offset, SEEK_CUR);
-                if (off_res < 0) {
-                    pr2serr("sparse tried to bypass write: seek=%" PRId64
-                            ", rel offset=%" PRId64 " but ...\n",
-                            (seek * blk_sz), (int64_t)offset);
-                    perror("lseek64 on output");
-                    ret = SG_LIB_FILE_ERROR;
-                    break;
-                } else if (verbose > 4)
-                    pr2serr("oflag=sparse lseek64 result=%" PRId64 "\n",
-                            (int64_t)off_res);
-                out_sparse_num += blocks;
+        if (oflag.sparse && (! (FT_DEV_NULL & out_type))) {
+            res = sparse_output(outfd, out_type, wrkPos, blocks, seek,
+                                dd_count <= blocks, &sparse_tail);
+            if ((res < 0) || (res > 1)) {
+                ret = res;
+                break;
             }
-        } else if (FT_SG & out_type) {
+            sparse_skip = (0 == res);
+        }
+        if (oflag.cmp && (! (FT_DEV_NULL & out_type))) {
+            ret = cmp_output(outfd, out_type, wrkPos, blocks, seek);
+            if (ret)
+                break;
+        } else if (sparse_skip)
+            ;   /* output done by sparse_output() */
+        else if (FT_SG & out_type) {
             dio_tmp = oflag.dio;
             retries_tmp = oflag.retries;
             first = true;
@@ -2206,31 +3861,44 @@ main(int argc, char * argv[])
             }
         }
 #endif
+        jnl_add(wrkPos, blocks);
+        if (bpt_auto)
+            blocks_per = auto_bpt_done(&ab, blocks, blocks_per);
         if (dd_count > 0)
             dd_count -= blocks;
         skip += blocks;
         seek += blocks;
     } /* end of main loop that does the copy ... */
 
-    if (ret && penult_sparse_skip && (penult_blocks > 0)) {
-        /* if error and skipped last output due to sparse ... */
-        if ((FT_SG & out_type) || (FT_DEV_NULL & out_type))
-            ;
-        else {
-            /* ... try writing to extend ofile to length prior to error */
-            while (((res = write(outfd, zeros_buff, penult_blocks * blk_sz))
-                    < 0) && ((EINTR == errno) || (EAGAIN == errno)))
-                ;
+copy_end:
+    if (ret && penult_sparse_skip && (penult_blocks > 0) &&
+        (! ((FT_SG | FT_BLOCK | FT_DEV_NULL) & out_type))) {
+        /* if error and the last output ended with a hole, extend ofile to
+         * its length prior to the error */
+        struct stat st;
+        off64_t off_res = lseek64(outfd, 0, SEEK_CUR);
+
+        if ((off_res > 0) && (0 == fstat(outfd, &st)) &&
+            (st.st_size < off_res)) {
             if (verbose > 2)
-                pr2serr("write(unix, sparse after error): count=%d, res=%d\n",
-                        penult_blocks * blk_sz, res);
-            if (res < 0) {
-                snprintf(ebuff, EBUFF_SZ, ME "writing(sparse after error), "
-                        "seek=%" PRId64 " ", seek);
+                pr2serr("ftruncate(sparse after error): length=%" PRId64
+                        "\n", (int64_t)off_res);
+            if (ftruncate(outfd, off_res) < 0) {
+                snprintf(ebuff, EBUFF_SZ, ME "extending(sparse after "
+                         "error), seek=%" PRId64 " ", seek);
                 perror(ebuff);
             }
         }
     }
+    if (bpt_auto && verbose)
+        pr2serr("bpt=auto: finished with %d blocks per transfer\n", ab.cur);
+    if (jnl_fname[0]) {
+        if ((0 == ret) && (0 == dd_count)) {
+            if ((unlink(jnl_fname) < 0) && (ENOENT != errno))
+                perror("journal: unlink");
+        } else
+            jnl_checkpoint(outfd, out_type);
+    }
 
     if (do_sync) {
         if (FT_SG & out_type) {
@@ -2251,8 +3919,8 @@ bypass_copy:
         calc_duration_throughput(false);
 
     free(wrkBuff);
-    if (free_zeros_buff)
-        free(free_zeros_buff);
+    if (free_cmp_buff)
+        free(free_cmp_buff);
     if (STDIN_FILENO != infd)
         close(infd);
     if (! ((STDOUT_FILENO == outfd) || (FT_DEV_NULL & out_type)))
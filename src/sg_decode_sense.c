@@ -29,22 +29,36 @@
 #include "sg_pr2serr.h"
 #include "sg_unaligned.h"
 
+#ifndef SG_LIB_WIN32
+#define SG_DS_PTHREADS 1
+#include <pthread.h>
+#endif
+
 
-static const char * version_str = "1.19 20180714";
+static const char * version_str = "1.21 20261016";
 
 #define MAX_SENSE_LEN 1024 /* max descriptor format actually: 255+8 */
 
+#define BULK_BUFF_SZ (1024 * 1024)     /* input bytes per bulk batch */
+#define BULK_REC_OUT_SZ 4096    /* output space reserved per record */
+#define MAX_BULK_THREADS 64
+#define DEF_MAX_BULK_THREADS 16 /* when --threads= not given */
+
 static struct option long_options[] = {
     {"binary", required_argument, 0, 'b'},
+    {"bulk", required_argument, 0, 'B'},
     {"cdb", no_argument, 0, 'c'},
     {"err", required_argument, 0, 'e'},
     {"exit-status", required_argument, 0, 'e'},
     {"exit_status", required_argument, 0, 'e'},
     {"file", required_argument, 0, 'f'},
+    {"framed", no_argument, 0, 'F'},
     {"help", no_argument, 0, 'h'},
     {"hex", no_argument, 0, 'H'},
+    {"histogram", no_argument, 0, 'g'},
     {"nospace", no_argument, 0, 'n'},
     {"status", required_argument, 0, 's'},
+    {"threads", required_argument, 0, 't'},
     {"verbose", no_argument, 0, 'v'},
     {"version", no_argument, 0, 'V'},
     {"write", required_argument, 0, 'w'},
@@ -54,6 +68,8 @@ static struct option long_options[] = {
 struct opts_t {
     bool do_binary;
     bool do_cdb;
+    bool do_framed;
+    bool do_histogram;
     bool do_help;
     bool do_hex;
     bool no_space;
@@ -63,7 +79,9 @@ struct opts_t {
     bool err_given;
     bool file_given;
     const char * fname;
+    const char * bulk_fname;
     int es_val;
+    int num_threads;
     int sense_len;
     int sstatus;
     int verbose;
@@ -78,9 +96,11 @@ static char concat_buff[1024];
 static void
 usage()
 {
-  pr2serr("Usage: sg_decode_sense [--binary=FN] [--cdb] [--err=ES] "
-          "[--file=FN]\n"
-          "                       [--help] [--hex] [--nospace] [--status=SS] "
+  pr2serr("Usage: sg_decode_sense [--binary=FN] [--bulk=FN] [--cdb] "
+          "[--err=ES]\n"
+          "                       [--file=FN] [--framed] [--help] [--hex] "
+          "[--histogram]\n"
+          "                       [--nospace] [--status=SS] [--threads=NT] "
           "[--verbose]\n"
           "                       [--version] [--write=WFN] H1 H2 H3 ...\n"
           "  where:\n"
@@ -88,6 +108,11 @@ usage()
           "data in\n"
           "                          binary from. If FN is '-' then read "
           "from stdin\n"
+          "    --bulk=FN|-B FN       decode many sense records read from "
+          "FN ('-' for\n"
+          "                          stdin), one record per line in ASCII "
+          "hex unless\n"
+          "                          --framed is given\n"
           "    --cdb|-c              decode given hex as cdb rather than "
           "sense data\n"
           "    --err=ES|-e ES        ES is Exit Status from utility in this "
@@ -96,15 +121,26 @@ usage()
           "sense data\n"
           "                          in ASCII hexadecimal. Interpret '-' "
           "as stdin\n"
+          "    --framed|-F           --bulk=FN input is binary, each record "
+          "is a 2 byte\n"
+          "                          big endian length followed by that "
+          "many bytes\n"
           "    --help|-h             print out usage message\n"
           "    --hex|-H              used together with --write=WFN, to "
           "write out\n"
           "                          C language style ASCII hex (instead "
           "of binary)\n"
+          "    --histogram|-g        with --bulk=FN output counts of each "
+          "sense key,\n"
+          "                          asc and ascq rather than decoding each "
+          "record\n"
           "    --nospace|-n          no spaces or other separators between "
           "pairs of\n"
           "                          hex digits (e.g. '3132330A')\n"
           "    --status=SS |-s SS    SCSI status value in hex\n"
+          "    --threads=NT|-t NT    number of threads decoding --bulk=FN "
+          "records\n"
+          "                          (def: number of cpus, at most %d)\n"
           "    --verbose|-v          increase verbosity\n"
           "    --version|-V          print version string then exit\n"
           "    --write=WFN |-w WFN    write sense data in binary to WFN, "
@@ -115,7 +151,7 @@ usage()
           "of\nhexadecimal bytes (H1 H2 H3 ...) . Alternatively the sense "
           "data can\nbe in a binary file or in a file containing ASCII "
           "hexadecimal. If\n'--cdb' is given then interpret hex as SCSI CDB "
-          "rather than sense data.\n"
+          "rather than sense data.\n", DEF_MAX_BULK_THREADS
           );
 }
 
@@ -129,7 +165,8 @@ parse_cmd_line(struct opts_t *op, int argc, char *argv[])
     char *endptr;
 
     while (1) {
-        c = getopt_long(argc, argv, "b:ce:f:hHns:vVw:", long_options, NULL);
+        c = getopt_long(argc, argv, "b:B:ce:f:FghHns:t:vVw:",
+                        long_options, NULL);
         if (c == -1)
             break;
 
@@ -143,6 +180,9 @@ parse_cmd_line(struct opts_t *op, int argc, char *argv[])
             op->do_binary = true;
             op->fname = optarg;
             break;
+        case 'B':
+            op->bulk_fname = optarg;
+            break;
         case 'c':
             op->do_cdb = true;
             break;
@@ -164,6 +204,12 @@ parse_cmd_line(struct opts_t *op, int argc, char *argv[])
             op->file_given = true;
             op->fname = optarg;
             break;
+        case 'F':
+            op->do_framed = true;
+            break;
+        case 'g':
+            op->do_histogram = true;
+            break;
         case 'h':
         case '?':
             op->do_help = true;
@@ -186,6 +232,15 @@ parse_cmd_line(struct opts_t *op, int argc, char *argv[])
             op->do_status = true;
             op->sstatus = ui;
             break;
+        case 't':
+            n = sg_get_num(optarg);
+            if ((n < 1) || (n > MAX_BULK_THREADS)) {
+                pr2serr("--threads= expected number from 1 to %d\n",
+                        MAX_BULK_THREADS);
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            op->num_threads = n;
+            break;
         case 'v':
             op->verbose_given = true;
             ++op->verbose;
@@ -244,154 +299,6 @@ the_end:
     return 0;
 }
 
-/* Read ASCII hex bytes from fname (a file named '-' taken as stdin).
- * There should be either one entry per line or a comma, space or tab
- * separated list of bytes. If no_space is set then a string of ACSII hex
- * digits is expected, 2 per byte. Everything from and including a '#'
- * on a line is ignored.  Returns 0 if ok, sg3_utils code value. */
-static int
-f2hex_arr(const char * fname, bool no_space, uint8_t * mp_arr,
-          int * mp_arr_len, int max_arr_len)
-{
-    bool split_line;
-    int fn_len, in_len, k, j, m, err;
-    int off = 0;
-    unsigned int h;
-    const char * lcp;
-    FILE * fp;
-    char line[512];
-    char carry_over[4];
-
-    if ((NULL == fname) || (NULL == mp_arr) || (NULL == mp_arr_len))
-        return SG_LIB_LOGIC_ERROR;
-    fn_len = strlen(fname);
-    if (0 == fn_len)
-        return SG_LIB_SYNTAX_ERROR;
-    if ((1 == fn_len) && ('-' == fname[0]))        /* read from stdin */
-        fp = stdin;
-    else {
-        fp = fopen(fname, "r");
-        if (NULL == fp) {
-            err = errno;
-            pr2serr("Unable to open %s for reading: %s\n", fname,
-                    safe_strerror(err));
-            return sg_convert_errno(err);
-        }
-    }
-
-    carry_over[0] = 0;
-    for (j = 0; j < 512; ++j) {
-        if (NULL == fgets(line, sizeof(line), fp))
-            break;
-        in_len = strlen(line);
-        if (in_len > 0) {
-            if ('\n' == line[in_len - 1]) {
-                --in_len;
-                line[in_len] = '\0';
-                split_line = false;
-            } else
-                split_line = true;
-        }
-        if (in_len < 1) {
-            carry_over[0] = 0;
-            continue;
-        }
-        if (carry_over[0]) {
-            if (isxdigit(line[0])) {
-                carry_over[1] = line[0];
-                carry_over[2] = '\0';
-                if (1 == sscanf(carry_over, "%x", &h))
-                    mp_arr[off - 1] = h;       /* back up and overwrite */
-                else {
-                    pr2serr("%s: carry_over error ['%s'] around line %d\n",
-                            __func__, carry_over, j + 1);
-                    goto bad;
-                }
-                lcp = line + 1;
-                --in_len;
-            } else
-                lcp = line;
-            carry_over[0] = 0;
-        } else
-            lcp = line;
-
-        m = strspn(lcp, " \t");
-        if (m == in_len)
-            continue;
-        lcp += m;
-        in_len -= m;
-        if ('#' == *lcp)
-            continue;
-        k = strspn(lcp, "0123456789aAbBcCdDeEfF ,\t");
-        if ((k < in_len) && ('#' != lcp[k]) && ('\r' != lcp[k])) {
-            pr2serr("%s: syntax error at line %d, pos %d\n", __func__, j + 1,
-                    m + k + 1);
-            goto bad;
-        }
-        if (no_space) {
-            for (k = 0; isxdigit(*lcp) && isxdigit(*(lcp + 1));
-                 ++k, lcp += 2) {
-                if (1 != sscanf(lcp, "%2x", &h)) {
-                    pr2serr("%s: bad hex number in line %d, pos %d\n",
-                            __func__, j + 1, (int)(lcp - line + 1));
-                    goto bad;
-                }
-                if ((off + k) >= max_arr_len) {
-                    pr2serr("%s: array length exceeded\n", __func__);
-                    goto bad;
-                }
-                mp_arr[off + k] = h;
-            }
-            if (isxdigit(*lcp) && (! isxdigit(*(lcp + 1))))
-                carry_over[0] = *lcp;
-            off += k;
-        } else {
-            for (k = 0; k < 1024; ++k) {
-                if (1 == sscanf(lcp, "%x", &h)) {
-                    if (h > 0xff) {
-                        pr2serr("%s: hex number larger than 0xff in line %d, "
-                                "pos %d\n", __func__, j + 1,
-                                (int)(lcp - line + 1));
-                        goto bad;
-                    }
-                    if (split_line && (1 == strlen(lcp))) {
-                        /* single trailing hex digit might be a split pair */
-                        carry_over[0] = *lcp;
-                    }
-                    if ((off + k) >= max_arr_len) {
-                        pr2serr("%s: array length exceeded\n", __func__);
-                        goto bad;
-                    }
-                    mp_arr[off + k] = h;
-                    lcp = strpbrk(lcp, " ,\t");
-                    if (NULL == lcp)
-                        break;
-                    lcp += strspn(lcp, " ,\t");
-                    if ('\0' == *lcp)
-                        break;
-                } else {
-                    if (('#' == *lcp) || ('\r' == *lcp)) {
-                        --k;
-                        break;
-                    }
-                    pr2serr("%s: error in line %d, at pos %d\n", __func__,
-                            j + 1, (int)(lcp - line + 1));
-                    goto bad;
-                }
-            }
-            off += (k + 1);
-        }
-    }
-    *mp_arr_len = off;
-    if (stdin != fp)
-        fclose(fp);
-    return 0;
-bad:
-    if (stdin != fp)
-        fclose(fp);
-    return SG_LIB_SYNTAX_ERROR;
-}
-
 static void
 write2wfn(FILE * fp, struct opts_t * op)
 {
@@ -427,6 +334,609 @@ write2wfn(FILE * fp, struct opts_t * op)
 }
 
 
+/* Bulk mode (--bulk=FN). The input is read in batches of up to
+ * BULK_BUFF_SZ bytes, each cut at a record boundary (a newline or the end
+ * of a frame). Batches are decoded by worker threads, each worker keeps
+ * its own histogram. In per record mode each batch accumulates its own
+ * output which the reading thread writes out in input order. */
+
+struct bulk_batch_t {
+    bool done;                  /* set by worker, under bulk_ctl_t::mx */
+    int64_t first_num;          /* line (or record if framed) number */
+    int blen;                   /* bytes of input in buff */
+    int out_len;
+    int out_sz;
+    uint8_t * buff;
+    char * out;                 /* decoded records, per record mode */
+};
+
+/* Open addressing hash table, key is (1 << 24) | sk << 16 | asc << 8 |
+ * ascq so 0 marks an empty slot */
+struct bulk_hist_t {
+    int cap;                    /* a power of 2 */
+    int used;
+    uint32_t * keys;
+    uint64_t * counts;
+};
+
+struct bulk_wk_t {              /* per worker thread */
+    int64_t num_recs;
+    int64_t num_bad;            /* could not be parsed from input */
+    int64_t num_unrec;          /* response code not 0x70 to 0x73 */
+    bool oom;
+    struct bulk_hist_t hist;
+    struct sg_scsi_sense_t ss;
+#ifdef SG_DS_PTHREADS
+    pthread_t tid;
+    struct bulk_ctl_t * ctlp;
+#endif
+};
+
+struct bulk_ctl_t {
+    const struct opts_t * op;
+    int nb;                     /* number of elements in ring[] */
+    struct bulk_batch_t * ring; /* batch n is ring[n % nb] */
+#ifdef SG_DS_PTHREADS
+    bool eof;
+    int64_t filled;             /* batches handed to workers */
+    int64_t next;               /* next batch a worker will take */
+    pthread_mutex_t mx;
+    pthread_cond_t work_cv;
+    pthread_cond_t done_cv;
+#endif
+};
+
+struct bulk_rd_t {              /* reader state */
+    bool eof;
+    int fd;
+    int carry_len;              /* partial record from previous read */
+    int64_t num;                /* line or record number of next batch */
+    uint8_t * carry;
+};
+
+struct bulk_hist_ent_t {
+    uint32_t key;
+    uint64_t count;
+};
+
+static int
+bulk_hist_add(struct bulk_hist_t * hp, uint32_t key, uint64_t count)
+{
+    int k, n, mask;
+    uint32_t * nkeys;
+    uint64_t * ncounts;
+    struct bulk_hist_t nh;
+
+    if (2 * (hp->used + 1) > hp->cap) {       /* grow, keep half empty */
+        nh.cap = hp->cap ? (2 * hp->cap) : 256;
+        nh.used = 0;
+        nkeys = (uint32_t *)calloc(nh.cap, sizeof(uint32_t));
+        ncounts = (uint64_t *)calloc(nh.cap, sizeof(uint64_t));
+        if ((NULL == nkeys) || (NULL == ncounts)) {
+            free(nkeys);
+            free(ncounts);
+            return -1;
+        }
+        nh.keys = nkeys;
+        nh.counts = ncounts;
+        for (k = 0; k < hp->cap; ++k) {
+            if (hp->keys[k])
+                bulk_hist_add(&nh, hp->keys[k], hp->counts[k]);
+        }
+        free(hp->keys);
+        free(hp->counts);
+        *hp = nh;
+    }
+    mask = hp->cap - 1;
+    for (n = (key * 0x9e3779b1U) >> 8; ; ++n) {
+        k = n & mask;
+        if (key == hp->keys[k])
+            break;
+        if (0 == hp->keys[k]) {
+            hp->keys[k] = key;
+            ++hp->used;
+            break;
+        }
+    }
+    hp->counts[k] += count;
+    return 0;
+}
+
+static int
+hex_digit_val(int c)
+{
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    c |= 0x20;
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    return -1;
+}
+
+/* Converts one line of ASCII hex in [cp, ep) to binary in 'sp'. Bytes are
+ * separated by space, tab or comma unless no_space is set in which case
+ * pairs of hex digits are taken. '#' starts a comment. Returns the number
+ * of bytes, 0 for a blank or comment line, or -1 for bad input. */
+static int
+bulk_hex_line(const char * cp, const char * ep, bool no_space, uint8_t * sp)
+{
+    int d, v, nd;
+    int n = 0;
+
+    for (v = 0, nd = 0; cp < ep; ++cp) {
+        if ((' ' == *cp) || ('\t' == *cp) || (',' == *cp) ||
+            ('\r' == *cp) || ('#' == *cp)) {
+            if (nd && (! no_space)) {
+                sp[n++] = v;
+                v = 0;
+                nd = 0;
+            }
+            if ('#' == *cp)
+                break;
+            continue;
+        }
+        d = hex_digit_val(*cp);
+        if (d < 0)
+            return -1;
+        v = (v << 4) | d;
+        if (++nd > 2)
+            return -1;
+        if (no_space && (2 == nd)) {
+            sp[n++] = v;
+            v = 0;
+            nd = 0;
+        }
+        if (n >= MAX_SENSE_LEN)
+            return -1;
+    }
+    if (nd) {
+        if (no_space)
+            return -1;          /* odd number of hex digits */
+        sp[n++] = v;
+    }
+    return n;
+}
+
+/* Decodes or counts one sense record. Returns 0, or -1 if out of memory */
+static int
+bulk_one(const struct opts_t * op, struct bulk_wk_t * wp,
+         struct bulk_batch_t * bp, int64_t num, const uint8_t * sp, int slen)
+{
+    int n;
+    char * np;
+
+    ++wp->num_recs;
+    if (op->do_histogram) {
+        if (! sg_scsi_parse_sense(sp, slen, &wp->ss)) {
+            ++wp->num_unrec;
+            return 0;
+        }
+        return bulk_hist_add(&wp->hist, (1 << 24) |
+                             (wp->ss.sense_key << 16) | (wp->ss.asc << 8) |
+                             wp->ss.ascq, 1);
+    }
+    if ((bp->out_sz - bp->out_len) < BULK_REC_OUT_SZ) {
+        n = bp->out_sz ? (2 * bp->out_sz) : (64 * BULK_REC_OUT_SZ);
+        np = (char *)realloc(bp->out, n);
+        if (NULL == np)
+            return -1;
+        bp->out = np;
+        bp->out_sz = n;
+    }
+    n = bp->out_sz - bp->out_len;
+    bp->out_len += snprintf(bp->out + bp->out_len, n, "%s %" PRId64 ":\n",
+                            (op->do_framed ? "Record" : "Line"), num);
+    n = bp->out_sz - bp->out_len;
+    bp->out_len += sg_get_sense_str(NULL, sp, slen, op->verbose, n,
+                                    bp->out + bp->out_len);
+    return 0;
+}
+
+/* Decodes all records in one batch */
+static void
+bulk_batch(const struct opts_t * op, struct bulk_wk_t * wp,
+           struct bulk_batch_t * bp)
+{
+    int slen, off, n;
+    int64_t num;
+    const char * cp;
+    const char * ep;
+    const char * lp;
+    uint8_t sense[MAX_SENSE_LEN + 4];
+
+    bp->out_len = 0;
+    num = bp->first_num;
+    if (op->do_framed) {
+        for (off = 0; off < bp->blen; off += 2 + slen, ++num) {
+            if ((off + 2) > bp->blen)
+                slen = bp->blen;        /* force truncated case */
+            else
+                slen = sg_get_unaligned_be16(bp->buff + off);
+            if ((off + 2 + slen) > bp->blen) {
+                ++wp->num_bad;
+                if (op->verbose)
+                    pr2serr("record %" PRId64 ": truncated\n", num);
+                break;
+            }
+            if (bulk_one(op, wp, bp, num, bp->buff + off + 2, slen))
+                goto oom;
+        }
+        return;
+    }
+    cp = (const char *)bp->buff;
+    ep = cp + bp->blen;
+    for ( ; cp < ep; cp = lp + 1, ++num) {
+        lp = (const char *)memchr(cp, '\n', ep - cp);
+        if (NULL == lp)
+            lp = ep;
+        n = bulk_hex_line(cp, lp, op->no_space, sense);
+        if (0 == n)
+            continue;
+        if (n < 0) {
+            ++wp->num_bad;
+            if (op->verbose)
+                pr2serr("line %" PRId64 ": bad ASCII hex, skipped\n", num);
+            continue;
+        }
+        if (bulk_one(op, wp, bp, num, sense, n))
+            goto oom;
+    }
+    return;
+oom:
+    wp->oom = true;
+}
+
+/* Fills 'bp' with the next batch of whole records. Returns the number of
+ * bytes in the batch (0 at end of input) or a negated errno. */
+static int
+bulk_fill(const struct opts_t * op, struct bulk_rd_t * rp,
+          struct bulk_batch_t * bp)
+{
+    int n, cut, k;
+    int blen = rp->carry_len;
+    int64_t nrecs = 0;
+
+    if (blen > 0)
+        memcpy(bp->buff, rp->carry, blen);
+    rp->carry_len = 0;
+    while ((! rp->eof) && (blen < BULK_BUFF_SZ)) {
+        n = read(rp->fd, bp->buff + blen, BULK_BUFF_SZ - blen);
+        if (n < 0) {
+            if (EINTR == errno)
+                continue;
+            return -errno;
+        } else if (0 == n)
+            rp->eof = true;
+        blen += n;
+    }
+    if (op->do_framed) {
+        for (cut = 0; (cut + 2) <= blen; cut += n, ++nrecs) {
+            n = 2 + sg_get_unaligned_be16(bp->buff + cut);
+            if ((cut + n) > blen)
+                break;
+        }
+        if (rp->eof && (cut < blen)) {
+            cut = blen;         /* worker reports truncated record */
+            ++nrecs;
+        }
+    } else if (rp->eof)
+        cut = blen;
+    else {
+        for (cut = blen; (cut > 0) && ('\n' != bp->buff[cut - 1]); --cut)
+            ;
+        if (0 == cut) {         /* line longer than buffer, split it */
+            cut = blen;
+            if (op->verbose)
+                pr2serr("line %" PRId64 ": too long, split\n", rp->num);
+        }
+    }
+    if (! op->do_framed) {
+        for (k = 0; k < cut; ++k) {
+            if ('\n' == bp->buff[k])
+                ++nrecs;
+        }
+    }
+    if (cut < blen) {
+        rp->carry_len = blen - cut;
+        memcpy(rp->carry, bp->buff + cut, rp->carry_len);
+    }
+    bp->blen = cut;
+    bp->first_num = rp->num;
+    rp->num += nrecs;
+    return cut;
+}
+
+static void
+bulk_flush(struct bulk_batch_t * bp)
+{
+    if (bp->out_len > 0)
+        fwrite(bp->out, 1, bp->out_len, stdout);
+    bp->out_len = 0;
+}
+
+#ifdef SG_DS_PTHREADS
+
+static void *
+bulk_worker(void * v_wp)
+{
+    struct bulk_wk_t * wp = (struct bulk_wk_t *)v_wp;
+    struct bulk_ctl_t * cp = wp->ctlp;
+    struct bulk_batch_t * bp;
+
+    while (true) {
+        pthread_mutex_lock(&cp->mx);
+        while ((cp->next >= cp->filled) && (! cp->eof))
+            pthread_cond_wait(&cp->work_cv, &cp->mx);
+        if (cp->next >= cp->filled) {   /* so eof */
+            pthread_mutex_unlock(&cp->mx);
+            break;
+        }
+        bp = cp->ring + (cp->next % cp->nb);
+        ++cp->next;
+        pthread_mutex_unlock(&cp->mx);
+
+        bulk_batch(cp->op, wp, bp);
+
+        pthread_mutex_lock(&cp->mx);
+        bp->done = true;
+        pthread_cond_broadcast(&cp->done_cv);
+        pthread_mutex_unlock(&cp->mx);
+    }
+    return NULL;
+}
+
+/* Waits for batch 'bp' to be decoded, then writes out its output */
+static void
+bulk_wait_flush(struct bulk_ctl_t * cp, struct bulk_batch_t * bp)
+{
+    pthread_mutex_lock(&cp->mx);
+    while (! bp->done)
+        pthread_cond_wait(&cp->done_cv, &cp->mx);
+    pthread_mutex_unlock(&cp->mx);
+    bulk_flush(bp);
+}
+
+#endif  /* SG_DS_PTHREADS */
+
+static int
+bulk_cmp(const void * ap, const void * bp)
+{
+    const struct bulk_hist_ent_t * a = (const struct bulk_hist_ent_t *)ap;
+    const struct bulk_hist_ent_t * b = (const struct bulk_hist_ent_t *)bp;
+
+    if (a->count != b->count)
+        return (a->count > b->count) ? -1 : 1;
+    return (a->key < b->key) ? -1 : (a->key > b->key);
+}
+
+static int
+bulk_histogram(const struct bulk_hist_t * hp, int64_t num_recs,
+               int64_t num_unrec)
+{
+    int k, n;
+    double pc;
+    const char * cp;
+    struct bulk_hist_ent_t * ents;
+    static const char ads[] = "Additional sense: ";
+    char skb[64];
+    char ab[128];
+
+    ents = (struct bulk_hist_ent_t *)calloc(hp->used + 1, sizeof(*ents));
+    if (NULL == ents)
+        return sg_convert_errno(ENOMEM);
+    for (k = 0, n = 0; k < hp->cap; ++k) {
+        if (hp->keys[k]) {
+            ents[n].key = hp->keys[k];
+            ents[n++].count = hp->counts[k];
+        }
+    }
+    qsort(ents, n, sizeof(*ents), bulk_cmp);
+    printf("Sense key, asc, ascq histogram of %" PRId64 " records:\n",
+           num_recs);
+    printf("       count       %%  sk  asc ascq  description\n");
+    for (k = 0; k < n; ++k) {
+        pc = (100.0 * ents[k].count) / num_recs;
+        sg_get_sense_key_str((ents[k].key >> 16) & 0xf, sizeof(skb), skb);
+        sg_get_asc_ascq_str((ents[k].key >> 8) & 0xff, ents[k].key & 0xff,
+                            sizeof(ab), ab);
+        cp = ab;
+        if (0 == strncmp(cp, ads, sizeof(ads) - 1))
+            cp += sizeof(ads) - 1;
+        printf("%12" PRIu64 " %6.2f%%  %2x  0x%02x 0x%02x  %s: %s\n",
+               ents[k].count, pc, (ents[k].key >> 16) & 0xf,
+               (ents[k].key >> 8) & 0xff, ents[k].key & 0xff, skb, cp);
+    }
+    if (num_unrec > 0)
+        printf("%12" PRId64 " %6.2f%%  unrecognized response code\n",
+               num_unrec, (100.0 * num_unrec) / num_recs);
+    free(ents);
+    return 0;
+}
+
+/* Decodes (or counts) every sense record in op->bulk_fname */
+static int
+do_bulk(const struct opts_t * op)
+{
+    bool oom = false;
+    int k, j, res, nthr, err;
+    int ret = 0;
+    int64_t num_recs, num_bad, num_unrec;
+    struct bulk_wk_t * wp;
+    struct bulk_wk_t * wks = NULL;
+    struct bulk_batch_t * bp;
+    struct bulk_hist_t hist;
+    struct bulk_ctl_t ctl;
+    struct bulk_rd_t rd;
+
+    memset(&ctl, 0, sizeof(ctl));
+    memset(&rd, 0, sizeof(rd));
+    memset(&hist, 0, sizeof(hist));
+    nthr = op->num_threads;
+    if (nthr < 1) {
+#if defined(HAVE_SYSCONF) && defined(_SC_NPROCESSORS_ONLN)
+        nthr = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if (nthr > DEF_MAX_BULK_THREADS)
+            nthr = DEF_MAX_BULK_THREADS;
+        else if (nthr < 1)
+            nthr = 1;
+    }
+#ifndef SG_DS_PTHREADS
+    nthr = 1;
+#endif
+    if (op->verbose > 1)
+        pr2serr("%s: decoding with %d thread%s\n", __func__, nthr,
+                (nthr > 1) ? "s" : "");
+    if (0 == strcmp("-", op->bulk_fname))
+        rd.fd = STDIN_FILENO;
+    else {
+        rd.fd = open(op->bulk_fname, O_RDONLY);
+        if (rd.fd < 0) {
+            err = errno;
+            pr2serr("unable to open file: %s: %s\n", op->bulk_fname,
+                    safe_strerror(err));
+            return sg_convert_errno(err);
+        }
+    }
+    rd.num = 1;
+    ctl.op = op;
+    ctl.nb = (nthr > 1) ? (2 * nthr) : 1;
+    ctl.ring = (struct bulk_batch_t *)calloc(ctl.nb, sizeof(*ctl.ring));
+    wks = (struct bulk_wk_t *)calloc(nthr, sizeof(*wks));
+    rd.carry = (uint8_t *)malloc(BULK_BUFF_SZ);
+    if ((NULL == ctl.ring) || (NULL == wks) || (NULL == rd.carry)) {
+        ret = sg_convert_errno(ENOMEM);
+        goto fini;
+    }
+    for (k = 0; k < ctl.nb; ++k) {
+        ctl.ring[k].buff = (uint8_t *)malloc(BULK_BUFF_SZ);
+        if (NULL == ctl.ring[k].buff) {
+            ret = sg_convert_errno(ENOMEM);
+            goto fini;
+        }
+    }
+
+    if (1 == nthr) {            /* decode in this thread */
+        bp = ctl.ring;
+        while ((res = bulk_fill(op, &rd, bp)) > 0) {
+            bulk_batch(op, wks, bp);
+            if (wks->oom)
+                break;
+            bulk_flush(bp);
+        }
+    }
+#ifdef SG_DS_PTHREADS
+    else {
+        int64_t seq;
+
+        pthread_mutex_init(&ctl.mx, NULL);
+        pthread_cond_init(&ctl.work_cv, NULL);
+        pthread_cond_init(&ctl.done_cv, NULL);
+        for (k = 0; k < nthr; ++k) {
+            wks[k].ctlp = &ctl;
+            err = pthread_create(&wks[k].tid, NULL, bulk_worker, wks + k);
+            if (err) {
+                pr2serr("pthread_create: %s\n", safe_strerror(err));
+                nthr = k;
+                ret = sg_convert_errno(err);
+                break;
+            }
+        }
+        for (seq = 0, res = 0; (0 == ret) && (nthr > 0); ++seq) {
+            bp = ctl.ring + (seq % ctl.nb);
+            if (seq >= ctl.nb)  /* ring full, oldest batch is output next */
+                bulk_wait_flush(&ctl, bp);
+            res = bulk_fill(op, &rd, bp);
+            if (res <= 0)
+                break;
+            pthread_mutex_lock(&ctl.mx);
+            bp->done = false;
+            ctl.filled = seq + 1;
+            pthread_cond_signal(&ctl.work_cv);
+            pthread_mutex_unlock(&ctl.mx);
+        }
+        pthread_mutex_lock(&ctl.mx);
+        ctl.eof = true;
+        pthread_cond_broadcast(&ctl.work_cv);
+        pthread_mutex_unlock(&ctl.mx);
+        /* output what is still in flight, oldest first */
+        for (seq = (seq >= ctl.nb) ? (seq - ctl.nb + 1) : 0;
+             seq < ctl.filled; ++seq)
+            bulk_wait_flush(&ctl, ctl.ring + (seq % ctl.nb));
+        for (k = 0; k < nthr; ++k)
+            pthread_join(wks[k].tid, NULL);
+        pthread_cond_destroy(&ctl.done_cv);
+        pthread_cond_destroy(&ctl.work_cv);
+        pthread_mutex_destroy(&ctl.mx);
+    }
+#endif
+    if (ret)
+        goto fini;
+    if (res < 0) {
+        pr2serr("read error on %s: %s\n", op->bulk_fname,
+                safe_strerror(-res));
+        ret = sg_convert_errno(-res);
+    }
+    num_recs = 0;
+    num_bad = 0;
+    num_unrec = 0;
+    for (k = 0; k < nthr; ++k) {
+        wp = wks + k;
+        num_recs += wp->num_recs;
+        num_bad += wp->num_bad;
+        num_unrec += wp->num_unrec;
+        if (wp->oom)
+            oom = true;
+        if (op->do_histogram) {
+            for (j = 0; j < wp->hist.cap; ++j) {
+                if (wp->hist.keys[j] &&
+                    bulk_hist_add(&hist, wp->hist.keys[j],
+                                  wp->hist.counts[j]))
+                    oom = true;
+            }
+        }
+    }
+    if (oom) {
+        pr2serr("out of memory while decoding\n");
+        ret = sg_convert_errno(ENOMEM);
+        goto fini;
+    }
+    if (op->do_histogram && (num_recs > 0)) {
+        res = bulk_histogram(&hist, num_recs, num_unrec);
+        if (res && (0 == ret))
+            ret = res;
+    }
+    if (num_bad > 0) {
+        pr2serr("%" PRId64 " record%s could not be parsed, skipped\n",
+                num_bad, (1 == num_bad) ? "" : "s");
+        if (0 == ret)
+            ret = SG_LIB_SYNTAX_ERROR;
+    }
+    if (op->verbose)
+        pr2serr("%" PRId64 " records decoded\n", num_recs);
+fini:
+    if (ctl.ring) {
+        for (k = 0; k < ctl.nb; ++k) {
+            free(ctl.ring[k].buff);
+            free(ctl.ring[k].out);
+        }
+        free(ctl.ring);
+    }
+    if (wks) {
+        for (k = 0; k < nthr; ++k) {
+            free(wks[k].hist.keys);
+            free(wks[k].hist.counts);
+        }
+        free(wks);
+    }
+    free(hist.keys);
+    free(hist.counts);
+    free(rd.carry);
+    if (rd.fd > STDIN_FILENO)
+        close(rd.fd);
+    return ret;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -491,6 +1001,20 @@ main(int argc, char *argv[])
         printf("SCSI status: %s\n", b);
     }
 
+    if (op->bulk_fname) {
+        if (op->sense_len || op->no_space_str || op->fname || op->do_cdb ||
+            op->wfname) {
+            pr2serr(">> --bulk=FN contradicts sense data on the command "
+                    "line, --binary=,\n   --cdb, --file= and --write=\n\n");
+            return SG_LIB_CONTRADICT;
+        }
+        return do_bulk(op);
+    } else if (op->do_framed || op->do_histogram || op->num_threads) {
+        pr2serr(">> --framed, --histogram and --threads= need "
+                "--bulk=FN\n\n");
+        return SG_LIB_CONTRADICT;
+    }
+
     if ((0 == op->sense_len) && op->no_space_str) {
         if (op->verbose > 2)
             pr2serr("no_space str: %s\n", op->no_space_str);
@@ -538,8 +1062,8 @@ main(int argc, char *argv[])
         }
         op->sense_len = s;
     } else if (op->file_given) {
-        ret = f2hex_arr(op->fname, op->no_space, op->sense, &op->sense_len,
-                        MAX_SENSE_LEN);
+        ret = sg_f2hex_arr(op->fname, false, op->no_space, op->sense,
+                           &op->sense_len, MAX_SENSE_LEN);
         if (ret) {
             pr2serr("unable to decode ASCII hex from file: %s\n", op->fname);
             return ret;
@@ -51,7 +51,7 @@
 #include "sg_pt_nvme.h"
 #endif
 
-static const char * version_str = "1.98 20180828";    /* SPC-5 rev 19 */
+static const char * version_str = "1.99 20261016";    /* SPC-5 rev 19 */
 
 /* INQUIRY notes:
  * It is recommended that the initial allocation length given to a
@@ -820,190 +820,6 @@ parse_cmd_line(struct opts_t * op, int argc, char * argv[])
 #endif  /* SG_SCSI_STRINGS */
 
 
-/* Read ASCII hex bytes or binary from fname (a file named '-' taken as
- * stdin). If reading ASCII hex then there should be either one entry per
- * line or a comma, space or tab separated list of bytes. If no_space is
- * set then a string of ACSII hex digits is expected, 2 per byte. Everything
- * from and including a '#' on a line is ignored. Returns 0 if ok, or a
- * negated errno or SG_LIB_SYNTAX_ERROR or SG_LIB_FILE_ERROR . */
-static int
-f2hex_arr(const char * fname, int as_binary, int no_space,
-          uint8_t * mp_arr, int * mp_arr_len, int max_arr_len)
-{
-    bool has_stdin;
-    bool split_line;
-    int fn_len, in_len, k, j, m, fd, err;
-    int off = 0;
-    unsigned int h;
-    const char * lcp;
-    FILE * fp;
-    char line[512];
-    char carry_over[4];
-
-    if ((NULL == fname) || (NULL == mp_arr) || (NULL == mp_arr_len))
-        return SG_LIB_LOGIC_ERROR;
-    fn_len = strlen(fname);
-    if (0 == fn_len)
-        return SG_LIB_SYNTAX_ERROR;
-    has_stdin = ((1 == fn_len) && ('-' == fname[0]));  /* read from stdin */
-    if (as_binary) {
-        if (has_stdin) {
-            fd = STDIN_FILENO;
-                if (sg_set_binary_mode(STDIN_FILENO) < 0)
-                    perror("sg_set_binary_mode");
-        } else {
-            fd = open(fname, O_RDONLY);
-            if (fd < 0) {
-                err = errno;
-                pr2serr("unable to open binary file %s: %s\n", fname,
-                         safe_strerror(err));
-                return -err;
-            } else if (sg_set_binary_mode(fd) < 0)
-                perror("sg_set_binary_mode");
-        }
-        k = read(fd, mp_arr, max_arr_len);
-        if (k <= 0) {
-            if (0 == k)
-                pr2serr("read 0 bytes from binary file %s\n", fname);
-            else
-                pr2serr("read from binary file %s: %s\n", fname,
-                        safe_strerror(errno));
-            if (! has_stdin)
-                close(fd);
-            return SG_LIB_SYNTAX_ERROR;
-        }
-        *mp_arr_len = k;
-        if (! has_stdin)
-            close(fd);
-        return 0;
-    } else {    /* So read the file as ASCII hex */
-        if (has_stdin)
-            fp = stdin;
-        else {
-            fp = fopen(fname, "r");
-            if (NULL == fp) {
-                err = errno;
-                pr2serr("Unable to open %s for reading\n", fname);
-                return -err;
-            }
-        }
-    }
-
-    carry_over[0] = 0;
-    for (j = 0; j < 512; ++j) {
-        if (NULL == fgets(line, sizeof(line), fp))
-            break;
-        in_len = strlen(line);
-        if (in_len > 0) {
-            if ('\n' == line[in_len - 1]) {
-                --in_len;
-                line[in_len] = '\0';
-                split_line = false;
-            } else
-                split_line = true;
-        }
-        if (in_len < 1) {
-            carry_over[0] = 0;
-            continue;
-        }
-        if (carry_over[0]) {
-            if (isxdigit(line[0])) {
-                carry_over[1] = line[0];
-                carry_over[2] = '\0';
-                if (1 == sscanf(carry_over, "%x", &h))
-                    mp_arr[off - 1] = h;       /* back up and overwrite */
-                else {
-                    pr2serr("%s: carry_over error ['%s'] around line %d\n",
-                            __func__, carry_over, j + 1);
-                    goto bad;
-                }
-                lcp = line + 1;
-                --in_len;
-            } else
-                lcp = line;
-            carry_over[0] = 0;
-        } else
-            lcp = line;
-
-        m = strspn(lcp, " \t");
-        if (m == in_len)
-            continue;
-        lcp += m;
-        in_len -= m;
-        if ('#' == *lcp)
-            continue;
-        k = strspn(lcp, "0123456789aAbBcCdDeEfF ,\t");
-        if ((k < in_len) && ('#' != lcp[k]) && ('\r' != lcp[k])) {
-            pr2serr("%s: syntax error at line %d, pos %d\n", __func__,
-                    j + 1, m + k + 1);
-            goto bad;
-        }
-        if (no_space) {
-            for (k = 0; isxdigit(*lcp) && isxdigit(*(lcp + 1));
-                 ++k, lcp += 2) {
-                if (1 != sscanf(lcp, "%2x", &h)) {
-                    pr2serr("%s: bad hex number in line %d, pos %d\n",
-                            __func__, j + 1, (int)(lcp - line + 1));
-                    goto bad;
-                }
-                if ((off + k) >= max_arr_len) {
-                    pr2serr("%s: array length exceeded\n", __func__);
-                    goto bad;
-                }
-                mp_arr[off + k] = h;
-            }
-            if (isxdigit(*lcp) && (! isxdigit(*(lcp + 1))))
-                carry_over[0] = *lcp;
-            off += k;
-        } else {
-            for (k = 0; k < 1024; ++k) {
-                if (1 == sscanf(lcp, "%x", &h)) {
-                    if (h > 0xff) {
-                        pr2serr("%s: hex number larger than 0xff in line %d, "
-                                "pos %d\n", __func__, j + 1,
-                                (int)(lcp - line + 1));
-                        goto bad;
-                    }
-                    if (split_line && (1 == strlen(lcp))) {
-                        /* single trailing hex digit might be a split pair */
-                        carry_over[0] = *lcp;
-                    }
-                    if ((off + k) >= max_arr_len) {
-                        pr2serr("%s: array length exceeded\n", __func__);
-                        goto bad;
-                    }
-                    mp_arr[off + k] = h;
-                    lcp = strpbrk(lcp, " ,\t");
-                    if (NULL == lcp)
-                        break;
-                    lcp += strspn(lcp, " ,\t");
-                    if ('\0' == *lcp)
-                        break;
-                } else {
-                    if (('#' == *lcp) || ('\r' == *lcp)) {
-                        --k;
-                        break;
-                    }
-                    pr2serr("%s: error in line %d, at pos %d\n", __func__,
-                            j + 1, (int)(lcp - line + 1));
-                    goto bad;
-                }
-            }
-            off += (k + 1);
-        }
-    }
-    *mp_arr_len = off;
-    err = ferror(fp) ? SG_LIB_FILE_ERROR : 0;
-    if (stdin != fp)
-        fclose(fp);
-    return err;
-bad:
-    err = SG_LIB_SYNTAX_ERROR;
-    if (stdin != fp)
-        fclose(fp);
-    return err;
-}
-
 static const struct svpd_values_name_t *
 sdp_find_vpd_by_acron(const char * ap)
 {
@@ -4363,11 +4179,9 @@ main(int argc, char * argv[])
             ret = SG_LIB_CONTRADICT;
             goto err_out;
         }
-        err = f2hex_arr(op->inhex_fn, op->do_raw, 0, rsp_buff, &inhex_len,
-                        rsp_buff_sz);
+        err = sg_f2hex_arr(op->inhex_fn, op->do_raw, false, rsp_buff,
+                           &inhex_len, rsp_buff_sz);
         if (err) {
-            if (err < 0)
-                err = sg_convert_errno(-err);
             ret = err;
             goto err_out;
         }
@@ -38,7 +38,7 @@
  * commands tailored for SES (enclosure) devices.
  */
 
-static const char * version_str = "2.44 20181010";    /* ses4r02 */
+static const char * version_str = "2.45 20261016";    /* ses4r02 */
 
 #define MX_ALLOC_LEN ((64 * 1024) - 4)  /* max allowable for big enclosures */
 #define MX_ELEM_HDR 1024
@@ -46,7 +46,6 @@ static const char * version_str = "2.44 20181010";    /* ses4r02 */
 #define DATA_IN_OFF 4
 #define MIN_DATA_IN_SZ 8192     /* use max(MIN_DATA_IN_SZ, op->maxlen) for
                                  * the size of data_arr */
-#define MX_DATA_IN_LINES (16 * 1024)
 #define MX_JOIN_ROWS 520        /* element index fields in dpages are only 8
                                  * bit, and index 0xff (255) is sometimes used
                                  * for 'not applicable'. However this limit
@@ -3873,15 +3872,12 @@ static int
 read_hex(const char * inp, uint8_t * arr, int mx_arr_len, int * arr_len,
          bool in_hex, int vb)
 {
-    bool has_stdin, split_line;
-    int in_len, k, j, m, off;
+    bool has_stdin;
+    int in_len, k;
     unsigned int h;
     const char * lcp;
     char * cp;
     char * c2p;
-    char line[512];
-    char carry_over[4];
-    FILE * fp = NULL;
 
     if ((NULL == inp) || (NULL == arr) || (NULL == arr_len))
         return 1;
@@ -3893,159 +3889,25 @@ read_hex(const char * inp, uint8_t * arr, int mx_arr_len, int * arr_len,
     }
     has_stdin = ((1 == in_len) && ('-' == inp[0]));
 
-    if (! in_hex) {     /* binary, assume its not on the command line, */
-        int fd;         /* that leaves stdin or a file (pipe) */
-        struct stat a_stat;
-
-        if (has_stdin)
-            fd = STDIN_FILENO;
-        else {
-            fd = open(inp + 1, O_RDONLY);
-            if (fd < 0) {
-                pr2serr("unable to open binary file %s: %s\n", inp,
-                         safe_strerror(errno));
-                return 1;
-            }
-        }
-        k = read(fd, arr, mx_arr_len);
-        if (k <= 0) {
-            if (0 == k)
-                pr2serr("read 0 bytes from binary file %s\n", inp);
-            else
-                pr2serr("read from binary file %s: %s\n", inp,
-                        safe_strerror(errno));
-            if (! has_stdin)
-                close(fd);
+    if ((! in_hex) || has_stdin || ('@' == inp[0])) {
+        /* binary or ASCII hex from stdin or a file */
+        if (sg_f2hex_arr(has_stdin ? inp : inp + 1, ! in_hex, false, arr,
+                         arr_len, mx_arr_len))
             return 1;
-        }
-        if ((0 == fstat(fd, &a_stat)) && S_ISFIFO(a_stat.st_mode)) {
-            /* pipe; keep reading till error or 0 read */
-            while (k < mx_arr_len) {
-                m = read(fd, arr + k, mx_arr_len - k);
-                if (0 == m)
-                   break;
-                if (m < 0) {
-                    pr2serr("read from binary pipe %s: %s\n", inp,
-                            safe_strerror(errno));
-                    if (! has_stdin)
-                        close(fd);
-                    return 1;
-                }
-                k += m;
-            }
-        }
-        *arr_len = k;
-        if (! has_stdin)
-            close(fd);
-        return 0;
-    }
-    if (has_stdin || ('@' == inp[0])) {    /* read from stdin or file */
-        if (has_stdin)
-            fp = stdin;
-        else {
-            fp = fopen(inp + 1, "r");
-            if (NULL == fp) {
-                pr2serr("%s: unable to open file: %s\n", __func__, inp + 1);
-                return 1;
-            }
-        }
-        carry_over[0] = 0;
-        for (j = 0, off = 0; j < MX_DATA_IN_LINES; ++j) {
-            if (NULL == fgets(line, sizeof(line), fp))
-                break;
-            in_len = strlen(line);
-            if (in_len > 0) {
-                if ('\n' == line[in_len - 1]) {
-                    --in_len;
-                    line[in_len] = '\0';
-                    split_line = false;
-                } else
-                    split_line = true;
-            }
-            if (in_len < 1) {
-                carry_over[0] = 0;
-                continue;
-            }
-            if (carry_over[0]) {
-                if (isxdigit(line[0])) {
-                    carry_over[1] = line[0];
-                    carry_over[2] = '\0';
-                    if (1 == sscanf(carry_over, "%x", &h))
-                        arr[off - 1] = h;       /* back up and overwrite */
-                    else {
-                        pr2serr("%s: carry_over error ['%s'] around line "
-                                "%d\n", __func__, carry_over, j + 1);
-                        goto err_with_fp;
-                    }
-                    lcp = line + 1;
-                    --in_len;
-                } else
-                    lcp = line;
-                carry_over[0] = 0;
-            } else
-                lcp = line;
-            m = strspn(lcp, " \t");
-            if (m == in_len)
-                continue;
-            lcp += m;
-            in_len -= m;
-            if ('#' == *lcp)
-                continue;
-            k = strspn(lcp, "0123456789aAbBcCdDeEfF ,\t");
-            if (in_len != k) {
-                pr2serr("%s: syntax error at line %d, pos %d\n", __func__,
-                        j + 1, m + k + 1);
-                if (vb > 2)
-                    pr2serr("first 40 characters of line: %.40s\n", line);
-                goto err_with_fp;
-            }
-            for (k = 0; k < (mx_arr_len - off); ++k) {
-                if (1 == sscanf(lcp, "%x", &h)) {
-                    if (h > 0xff) {
-                        pr2serr("%s: hex number larger than 0xff in line %d, "
-                                "pos %d\n", __func__, j + 1,
-                                (int)(lcp - line + 1));
-                        if (vb > 2)
-                            pr2serr("first 40 characters of line: %.40s\n",
-                                    line);
-                        goto err_with_fp;
-                    }
-                    if (split_line && (1 == strlen(lcp))) {
-                        /* single trailing hex digit might be a split pair */
-                        carry_over[0] = *lcp;
-                    }
-                    arr[off + k] = h;
-                    lcp = strpbrk(lcp, " ,\t");
-                    if (NULL == lcp)
-                        break;
-                    lcp += strspn(lcp, " ,\t");
-                    if ('\0' == *lcp)
-                        break;
-                } else {
-                    pr2serr("%s: error in line %d, at pos %d\n", __func__,
-                            j + 1, (int)(lcp - line + 1));
-                    if (vb > 2)
-                        pr2serr("first 40 characters of line: %.40s\n", line);
-                    goto err_with_fp;
-                }
-            }
-            off += k + 1;
-            if (off >= mx_arr_len)
-                break;
-        }
-        *arr_len = off;
+        if (! in_hex)
+            return 0;
     } else {        /* hex string on command line */
         k = strspn(inp, "0123456789aAbBcCdDeEfF, ");
         if (in_len != k) {
             pr2serr("%s: error at pos %d\n", __func__, k + 1);
-            goto err_with_fp;
+            return 1;
         }
         for (k = 0; k < mx_arr_len; ++k) {
             if (1 == sscanf(lcp, "%x", &h)) {
                 if (h > 0xff) {
                     pr2serr("%s: hex number larger than 0xff at pos %d\n",
                             __func__, (int)(lcp - inp + 1));
-                    goto err_with_fp;
+                    return 1;
                 }
                 arr[k] = h;
                 cp = (char *)strchr(lcp, ',');
@@ -4060,7 +3922,7 @@ read_hex(const char * inp, uint8_t * arr, int mx_arr_len, int * arr_len,
             } else {
                 pr2serr("%s: error at pos %d\n", __func__,
                         (int)(lcp - inp + 1));
-                goto err_with_fp;
+                return 1;
             }
         }
         *arr_len = k + 1;
@@ -4069,14 +3931,7 @@ read_hex(const char * inp, uint8_t * arr, int mx_arr_len, int * arr_len,
         pr2serr("%s: user provided data:\n", __func__);
         hex2stderr(arr, *arr_len, 0);
     }
-    if (fp && (fp != stdin))
-        fclose(fp);
     return 0;
-
-err_with_fp:
-    if (fp && (fp != stdin))
-        fclose(fp);
-    return 1;
 }
 
 static int
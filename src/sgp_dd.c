@@ -68,7 +68,7 @@
 #include "sg_pr2serr.h"
 
 
-static const char * version_str = "5.71 20181227";
+static const char * version_str = "5.72 20261016";
 
 #define DEF_BLOCK_SIZE 512
 #define DEF_BLOCKS_PER_TRANSFER 128
@@ -144,7 +144,7 @@ typedef struct request_collection
     int bpt;
     int dio_incomplete_count;   /* -\ */
     int sum_of_resids;          /*  | */
-    pthread_mutex_t aux_mutex;  /* -/ (also serializes some printf()s */
+    pthread_mutex_t aux_mutex;  /* -/ */
     int debug;
     int dry_run;
 } Rq_coll;
@@ -181,11 +181,7 @@ static void sg_out_operation(Rq_coll * clp, Rq_elem * rep);
 static bool normal_in_operation(Rq_coll * clp, Rq_elem * rep, int blocks);
 static void normal_out_operation(Rq_coll * clp, Rq_elem * rep, int blocks);
 static int sg_start_io(Rq_elem * rep);
-static int sg_finish_io(bool wr, Rq_elem * rep, pthread_mutex_t * a_mutp);
-
-#define STRERR_BUFF_LEN 128
-
-static pthread_mutex_t strerr_mut = PTHREAD_MUTEX_INITIALIZER;
+static int sg_finish_io(bool wr, Rq_elem * rep);
 
 static bool shutting_down = false;
 static bool do_sync = false;
@@ -289,29 +285,12 @@ thread_exit_handler(int sig)
 }
 #endif
 
-/* Make safe_strerror() thread safe */
-static char *
-tsafe_strerror(int code, char * ebp)
-{
-    char * cp;
-
-    pthread_mutex_lock(&strerr_mut);
-    cp = safe_strerror(code);
-    strncpy(ebp, cp, STRERR_BUFF_LEN);
-    pthread_mutex_unlock(&strerr_mut);
-
-    ebp[STRERR_BUFF_LEN - 1] = '\0';
-    return ebp;
-}
-
-
 /* Following macro from D.R. Butenhof's POSIX threads book:
  * ISBN 0-201-63392-2 . [Highly recommended book.] Changed __FILE__
  * to __func__ */
 #define err_exit(code,text) do { \
-    char strerr_buff[STRERR_BUFF_LEN]; \
     pr2serr("%s at \"%s\":%d: %s\n", \
-        text, __func__, __LINE__, tsafe_strerror(code, strerr_buff)); \
+        text, __func__, __LINE__, safe_strerror(code)); \
     exit(1); \
     } while (0)
 
@@ -653,7 +632,6 @@ normal_in_operation(Rq_coll * clp, Rq_elem * rep, int blocks)
 {
     bool stop_after_write = false;
     int res;
-    char strerr_buff[STRERR_BUFF_LEN];
 
     /* enters holding in_mutex */
     while (((res = read(clp->infd, rep->buffp, blocks * clp->bs)) < 0) &&
@@ -665,12 +643,12 @@ normal_in_operation(Rq_coll * clp, Rq_elem * rep, int blocks)
             pr2serr(">> substituted zeros for in blk=%" PRId64 " for %d "
                     "bytes, %s\n", rep->blk,
                     rep->num_blks * rep->bs,
-                    tsafe_strerror(errno, strerr_buff));
+                    safe_strerror(errno));
             res = rep->num_blks * clp->bs;
         }
         else {
             pr2serr("error in normal read, %s\n",
-                    tsafe_strerror(errno, strerr_buff));
+                    safe_strerror(errno));
             clp->in_stop = true;
             guarded_stop_out(clp);
             return 1;
@@ -699,7 +677,6 @@ static void
 normal_out_operation(Rq_coll * clp, Rq_elem * rep, int blocks)
 {
     int res;
-    char strerr_buff[STRERR_BUFF_LEN];
 
     /* enters holding out_mutex */
     while (((res = write(clp->outfd, rep->buffp, rep->num_blks * clp->bs))
@@ -709,12 +686,12 @@ normal_out_operation(Rq_coll * clp, Rq_elem * rep, int blocks)
         if (clp->out_flags.coe) {
             pr2serr(">> ignored error for out blk=%" PRId64 " for %d bytes, "
                     "%s\n", rep->blk, rep->num_blks * rep->bs,
-                    tsafe_strerror(errno, strerr_buff));
+                    safe_strerror(errno));
             res = rep->num_blks * clp->bs;
         }
         else {
             pr2serr("error normal write, %s\n",
-                    tsafe_strerror(errno, strerr_buff));
+                    safe_strerror(errno));
             guarded_stop_in(clp);
             clp->out_stop = true;
             return;
@@ -824,7 +801,7 @@ sg_in_operation(Rq_coll * clp, Rq_elem * rep)
         status = pthread_mutex_unlock(&clp->in_mutex);
         if (0 != status) err_exit(status, "unlock in_mutex");
 
-        res = sg_finish_io(rep->wr, rep, &clp->aux_mutex);
+        res = sg_finish_io(rep->wr, rep);
         switch (res) {
         case SG_LIB_CAT_ABORTED_COMMAND:
         case SG_LIB_CAT_UNIT_ATTENTION:
@@ -900,7 +877,7 @@ sg_out_operation(Rq_coll * clp, Rq_elem * rep)
         status = pthread_mutex_unlock(&clp->out_mutex);
         if (0 != status) err_exit(status, "unlock out_mutex");
 
-        res = sg_finish_io(rep->wr, rep, &clp->aux_mutex);
+        res = sg_finish_io(rep->wr, rep);
         switch (res) {
         case SG_LIB_CAT_ABORTED_COMMAND:
         case SG_LIB_CAT_UNIT_ATTENTION:
@@ -1004,9 +981,9 @@ sg_start_io(Rq_elem * rep)
    -> try again, SG_LIB_CAT_NOT_READY, SG_LIB_CAT_MEDIUM_HARD,
    -1 other errors */
 static int
-sg_finish_io(bool wr, Rq_elem * rep, pthread_mutex_t * a_mutp)
+sg_finish_io(bool wr, Rq_elem * rep)
 {
-    int res, status;
+    int res;
     struct sg_io_hdr io_hdr;
     struct sg_io_hdr * hp;
 #if 0
@@ -1052,11 +1029,7 @@ sg_finish_io(bool wr, Rq_elem * rep, pthread_mutex_t * a_mutp)
 
                 snprintf(ebuff, EBUFF_SZ, "%s blk=%" PRId64,
                          wr ? "writing": "reading", rep->blk);
-                status = pthread_mutex_lock(a_mutp);
-                if (0 != status) err_exit(status, "lock aux_mutex");
                 sg_chk_n_print3(ebuff, hp, false);
-                status = pthread_mutex_unlock(a_mutp);
-                if (0 != status) err_exit(status, "unlock aux_mutex");
                 return res;
             }
     }
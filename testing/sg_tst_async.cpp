@@ -77,12 +77,13 @@
 #include "uapi_sg.h"    /* local copy of include/uapi/scsi/sg.h */
 
 #include "sg_lib.h"
+#include "sg_cdb.hpp"
 #include "sg_io_linux.h"
 #include "sg_unaligned.h"
 #include "sg_pt.h"
 #include "sg_cmds.h"
 
-static const char * version_str = "1.23 20181216";
+static const char * version_str = "1.25 20261016";
 static const char * util_name = "sg_tst_async";
 
 /* This is a test program for checking the async usage of the Linux sg
@@ -409,11 +410,8 @@ get_urandom_uint(void)
     return res;
 }
 
-#define TUR_CMD_LEN 6
 #define READ16_REPLY_LEN 512
-#define READ16_CMD_LEN 16
 #define WRITE16_REPLY_LEN 512
-#define WRITE16_CMD_LEN 16
 
 /* Returns 0 if command injected okay, return -1 for error and 2 for
  * not done due to queue data size limit struck. */
@@ -425,11 +423,8 @@ start_sg3_cmd(int sg_fd, command2execute cmd2exe, int pack_id, uint64_t lba,
 {
     struct sg_io_hdr pt;
     struct sg_io_v4 p4t;
-    uint8_t turCmdBlk[TUR_CMD_LEN] = {0, 0, 0, 0, 0, 0};
-    uint8_t r16CmdBlk[READ16_CMD_LEN] =
-                {0x88, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0};
-    uint8_t w16CmdBlk[WRITE16_CMD_LEN] =
-                {0x8a, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0};
+    sg_cdb::cdb6_t turCmdBlk = sg_cdb::test_unit_ready();
+    sg_cdb::cdb16_t rw16CmdBlk;
     uint8_t sense_buffer[64];
     const char * np = NULL;
     struct sg_io_hdr * ptp;
@@ -444,28 +439,24 @@ start_sg3_cmd(int sg_fd, command2execute cmd2exe, int pack_id, uint64_t lba,
     switch (cmd2exe) {
     case SCSI_TUR:
         np = "TEST UNIT READY";
-        ptp->cmdp = turCmdBlk;
-        ptp->cmd_len = sizeof(turCmdBlk);
+        ptp->cmdp = turCmdBlk.data();
+        ptp->cmd_len = turCmdBlk.size();
         ptp->dxfer_direction = SG_DXFER_NONE;
         break;
     case SCSI_READ16:
         np = "READ(16)";
-        if (lba > 0xffffffff)
-            sg_put_unaligned_be32(lba >> 32, &r16CmdBlk[2]);
-        sg_put_unaligned_be32(lba & 0xffffffff, &r16CmdBlk[6]);
-        ptp->cmdp = r16CmdBlk;
-        ptp->cmd_len = sizeof(r16CmdBlk);
+        rw16CmdBlk = sg_cdb::read16(lba, 1);
+        ptp->cmdp = rw16CmdBlk.data();
+        ptp->cmd_len = rw16CmdBlk.size();
         ptp->dxfer_direction = SG_DXFER_FROM_DEV;
         ptp->dxferp = lbp;
         ptp->dxfer_len = xfer_bytes;
         break;
     case SCSI_WRITE16:
         np = "WRITE(16)";
-        if (lba > 0xffffffff)
-            sg_put_unaligned_be32(lba >> 32, &w16CmdBlk[2]);
-        sg_put_unaligned_be32(lba & 0xffffffff, &w16CmdBlk[6]);
-        ptp->cmdp = w16CmdBlk;
-        ptp->cmd_len = sizeof(w16CmdBlk);
+        rw16CmdBlk = sg_cdb::write16(lba, 1);
+        ptp->cmdp = rw16CmdBlk.data();
+        ptp->cmd_len = rw16CmdBlk.size();
         ptp->dxfer_direction = SG_DXFER_TO_DEV;
         ptp->dxferp = lbp;
         ptp->dxfer_len = xfer_bytes;
@@ -601,11 +592,8 @@ start_sg4_cmd(int sg_fd, command2execute cmd2exe, int pack_id, uint64_t lba,
               unsigned int & e2big, unsigned int & edom)
 {
     struct sg_io_v4 p4t;
-    uint8_t turCmdBlk[TUR_CMD_LEN] = {0, 0, 0, 0, 0, 0};
-    uint8_t r16CmdBlk[READ16_CMD_LEN] =
-                {0x88, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0};
-    uint8_t w16CmdBlk[WRITE16_CMD_LEN] =
-                {0x8a, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0};
+    sg_cdb::cdb6_t turCmdBlk = sg_cdb::test_unit_ready();
+    sg_cdb::cdb16_t rw16CmdBlk;
     uint8_t sense_buffer[64];
     const char * np = NULL;
     struct sg_io_v4 * ptp;
@@ -619,26 +607,22 @@ start_sg4_cmd(int sg_fd, command2execute cmd2exe, int pack_id, uint64_t lba,
     switch (cmd2exe) {
     case SCSI_TUR:
         np = "TEST UNIT READY";
-        ptp->request = (uint64_t)turCmdBlk;
-        ptp->request_len = sizeof(turCmdBlk);
+        ptp->request = (uint64_t)turCmdBlk.data();
+        ptp->request_len = turCmdBlk.size();
         break;
     case SCSI_READ16:
         np = "READ(16)";
-        if (lba > 0xffffffff)
-            sg_put_unaligned_be32(lba >> 32, &r16CmdBlk[2]);
-        sg_put_unaligned_be32(lba & 0xffffffff, &r16CmdBlk[6]);
-        ptp->request = (uint64_t)r16CmdBlk;
-        ptp->request_len = sizeof(r16CmdBlk);
+        rw16CmdBlk = sg_cdb::read16(lba, 1);
+        ptp->request = (uint64_t)rw16CmdBlk.data();
+        ptp->request_len = rw16CmdBlk.size();
         ptp->din_xferp = (uint64_t)lbp;
         ptp->din_xfer_len = xfer_bytes;
         break;
     case SCSI_WRITE16:
         np = "WRITE(16)";
-        if (lba > 0xffffffff)
-            sg_put_unaligned_be32(lba >> 32, &w16CmdBlk[2]);
-        sg_put_unaligned_be32(lba & 0xffffffff, &w16CmdBlk[6]);
-        ptp->request = (uint64_t)w16CmdBlk;
-        ptp->request_len = sizeof(w16CmdBlk);
+        rw16CmdBlk = sg_cdb::write16(lba, 1);
+        ptp->request = (uint64_t)rw16CmdBlk.data();
+        ptp->request_len = rw16CmdBlk.size();
         ptp->dout_xferp = (uint64_t)lbp;
         ptp->dout_xfer_len = xfer_bytes;
         break;
@@ -765,6 +749,107 @@ finish_sg4_cmd(int sg_fd, command2execute cmd2exe, bool pack_id_force,
     return ok ? 0 : -1;
 }
 
+#define MAX_BURST 64
+
+/* Completions fetched by finish_sg4_burst() */
+struct burst_t {
+    int num;
+    int pack_id[MAX_BURST];
+    int cat[MAX_BURST];
+    unsigned int nanosecs[MAX_BURST];
+    struct sg_io_v4 p4t[MAX_BURST];
+    struct sg_err_cat_t ec[MAX_BURST];
+    uint8_t sense_buffer[MAX_BURST][64];
+};
+
+/* Fetches up to num (at most MAX_BURST) completions with SG_IORECEIVE,
+ * only waiting for the first, then categorizes them with a single
+ * sg_err_category_batch() call. The number fetched is placed in bp->num.
+ * Returns 0 if all were clean (or recovered), else -1 . */
+static int
+finish_sg4_burst(int sg_fd, command2execute cmd2exe, int num, int wait_ms,
+                 unsigned int & eagains, struct burst_t * bp)
+{
+    int k, res;
+    int ret = 0;
+    const char * np = NULL;
+    struct sg_io_v4 * ptp;
+    struct sg_err_cat_t * ecp;
+
+    switch (cmd2exe) {
+    case SCSI_TUR:
+        np = "TEST UNIT READY";
+        break;
+    case SCSI_READ16:
+        np = "READ(16)";
+        break;
+    case SCSI_WRITE16:
+        np = "WRITE(16)";
+        break;
+    }
+    if (num > MAX_BURST)
+        num = MAX_BURST;
+    for (k = 0; k < num; ++k) {
+        ptp = bp->p4t + k;
+        memset(ptp, 0, sizeof(*ptp));
+        ptp->guard = 'S';
+        ptp->max_response_len = sizeof(bp->sense_buffer[k]);
+        ptp->response = (uint64_t)bp->sense_buffer[k];
+        ptp->timeout = DEF_TIMEOUT_MS;
+        ptp->request_extra = -1;
+        while (((res = ioctl(sg_fd, SG_IORECEIVE, ptp)) < 0) &&
+               (EAGAIN == errno) && (0 == k)) {
+            ++eagains;
+            if (wait_ms > 0)
+                this_thread::sleep_for(milliseconds{wait_ms});
+            else if (0 == wait_ms)
+                this_thread::yield();
+            else if (-2 == wait_ms)
+                sleep(0);                   // process yield ??
+        }
+        if (res < 0) {
+            if (EAGAIN == errno)
+                break;          /* fewer waiting than expected */
+            pr_errno_lk(errno, "%s: %s", __func__, np);
+            ret = -1;
+            break;
+        }
+        ecp = bp->ec + k;
+        ecp->scsi_status = ptp->device_status;
+        ecp->host_status = ptp->transport_status;
+        ecp->driver_status = ptp->driver_status;
+        ecp->sb_len = ptp->response_len;
+        ecp->sbp = bp->sense_buffer[k];
+        bp->pack_id[k] = ptp->request_extra;
+        bp->nanosecs[k] = ptp->duration;
+    }
+    bp->num = k;
+    if (0 == sg_err_category_batch(bp->ec, k, bp->cat))
+        return ret;     /* fast path: whole burst clean */
+    for (k = 0; k < bp->num; ++k) {
+        switch (bp->cat[k]) {
+        case SG_LIB_CAT_CLEAN:
+            break;
+        case SG_LIB_CAT_RECOVERED:
+            pr2serr_lk("%s: Recovered error on %s, continuing\n", __func__,
+                       np);
+            break;
+        default: /* won't bother decoding other categories */
+            {
+                lock_guard<mutex> lg(console_mutex);
+
+                ecp = bp->ec + k;
+                sg_linux_sense_print(np, ecp->scsi_status, ecp->host_status,
+                                     ecp->driver_status, ecp->sbp,
+                                     ecp->sb_len, true);
+            }
+            ret = -1;
+            break;
+        }
+    }
+    return ret;
+}
+
 static void
 work_sync_thread(int id, const char * dev_name, unsigned int /* hi_lba */,
                  struct opts_t * op)
@@ -859,7 +944,7 @@ work_thread(int id, struct opts_t * op)
     int vb = op->verbose;
     int k, n, res, sg_fd, num_outstanding, do_inc, npt, pack_id, sg_flags;
     int num_waiting_read, num_to_read, sz, ern, encore_pack_id, ask, j;
-    int prev_pack_id;
+    int prev_pack_id, bk, burst_res;
     unsigned int thr_start_eagain_count = 0;
     unsigned int thr_start_ebusy_count = 0;
     unsigned int thr_start_e2big_count = 0;
@@ -883,6 +968,7 @@ work_thread(int id, struct opts_t * op)
     map<int, pair<uint8_t *, uint8_t *> > pi2buff;/* pack_id -> lb buffer */
     map<int, uint64_t> pi_2_lba;            /* pack_id -> LBA */
     pair<uint8_t *, uint8_t *> encore_lbps;
+    struct burst_t burst;
 
     /* device name and hi_lba may depend on id */
     n = op->dev_names.size();
@@ -1186,23 +1272,43 @@ work_thread(int id, struct opts_t * op)
             }
         }
 
+        /* with sg v4 fetch several completions then categorize them
+         * together, unless each must be matched to a pack_id */
+        burst.num = 0;
+        burst_res = 0;
+        bk = 0;
+        if (op->v4 && op->submit && (! op->pack_id_force) &&
+            (num_to_read > 1)) {
+            burst_res = finish_sg4_burst(sg_fd, op->c2e, num_to_read,
+                                         op->wait_ms, thr_fin_eagain_count,
+                                         &burst);
+            num_to_read = burst.num;
+        }
         while (num_to_read-- > 0) {
-            if (op->pack_id_force) {
-                j = pi2buff.size();
-                if (j > 0)
-                    pack_id = pi2buff.begin()->first;
-                else
+            if (burst.num > 0) {
+                pack_id = burst.pack_id[bk];
+                nanosecs = burst.nanosecs[bk];
+                ++bk;
+                ask = -1;
+                res = 0;
+            } else {
+                if (op->pack_id_force) {
+                    j = pi2buff.size();
+                    if (j > 0)
+                        pack_id = pi2buff.begin()->first;
+                    else
+                        pack_id = -1;
+                } else
                     pack_id = -1;
-            } else
-                pack_id = -1;
-            ask = pack_id;
-            res = (op->v4) ?
+                ask = pack_id;
+                res = (op->v4) ?
                     finish_sg4_cmd(sg_fd, op->c2e, op->pack_id_force, pack_id,
                                    op->submit, op->wait_ms,
                                    thr_fin_eagain_count, nanosecs)           :
                     finish_sg3_cmd(sg_fd, op->c2e, op->pack_id_force, pack_id,
                                    op->submit, op->wait_ms,
                                    thr_fin_eagain_count, nanosecs);
+            }
             if (res) {
                 err = "finish_sg3_cmd()";
                 if (ruip && (pack_id > 0)) {
@@ -1250,6 +1356,8 @@ work_thread(int id, struct opts_t * op)
             if (err)
                 break;
         }       /* end of while loop counting down num_to_read */
+        if (burst_res && (! err))
+            err = "finish_sg4_burst()";
         if (err)
             break;
     }           /* end of for loop over npt (number per thread) */
@@ -1298,7 +1406,6 @@ work_thread(int id, struct opts_t * op)
 }
 
 #define INQ_REPLY_LEN 96
-#define INQ_CMD_LEN 6
 
 /* Send INQUIRY and fetches response. If okay puts PRODUCT ID field
  * in b (up to m_blen bytes). Does not use O_EXCL flag. Returns 0 on success,
@@ -1309,8 +1416,7 @@ do_inquiry_prod_id(const char * dev_name, int block, int & sg_ver_num,
 {
     int sg_fd, ok, ret;
     struct sg_io_hdr pt;
-    uint8_t inqCmdBlk [INQ_CMD_LEN] =
-                                {0x12, 0, 0, 0, INQ_REPLY_LEN, 0};
+    sg_cdb::cdb6_t inqCmdBlk = sg_cdb::inquiry(INQ_REPLY_LEN);
     uint8_t inqBuff[INQ_REPLY_LEN];
     uint8_t sense_buffer[64];
     int open_flags = O_RDWR;    /* O_EXCL | O_RDONLY fails with EPERM */
@@ -1327,13 +1433,13 @@ do_inquiry_prod_id(const char * dev_name, int block, int & sg_ver_num,
     /* Prepare INQUIRY command */
     memset(&pt, 0, sizeof(pt));
     pt.interface_id = 'S';
-    pt.cmd_len = sizeof(inqCmdBlk);
+    pt.cmd_len = inqCmdBlk.size();
     /* pt.iovec_count = 0; */  /* memset takes care of this */
     pt.mx_sb_len = sizeof(sense_buffer);
     pt.dxfer_direction = SG_DXFER_FROM_DEV;
     pt.dxfer_len = INQ_REPLY_LEN;
     pt.dxferp = inqBuff;
-    pt.cmdp = inqCmdBlk;
+    pt.cmdp = inqCmdBlk.data();
     pt.sbp = sense_buffer;
     pt.timeout = 20000;     /* 20000 millisecs == 20 seconds */
     /* pt.flags = 0; */     /* take defaults: indirect IO, etc */
@@ -1388,7 +1494,7 @@ do_read_capacity(const char * dev_name, int block, unsigned int * last_lba,
                  unsigned int * blk_sz)
 {
     int res, sg_fd;
-    uint8_t rcCmdBlk [10] = {0x25, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    sg_cdb::cdb10_t rcCmdBlk = sg_cdb::read_capacity10();
     uint8_t rcBuff[64];
     uint8_t sense_b[64];
     sg_io_hdr_t io_hdr;
@@ -1404,12 +1510,12 @@ do_read_capacity(const char * dev_name, int block, unsigned int * last_lba,
     /* Prepare READ CAPACITY(10) command */
     memset(&io_hdr, 0, sizeof(sg_io_hdr_t));
     io_hdr.interface_id = 'S';
-    io_hdr.cmd_len = sizeof(rcCmdBlk);
+    io_hdr.cmd_len = rcCmdBlk.size();
     io_hdr.mx_sb_len = sizeof(sense_b);
     io_hdr.dxfer_direction = SG_DXFER_FROM_DEV;
     io_hdr.dxfer_len = sizeof(rcBuff);
     io_hdr.dxferp = rcBuff;
-    io_hdr.cmdp = rcCmdBlk;
+    io_hdr.cmdp = rcCmdBlk.data();
     io_hdr.sbp = sense_b;
     io_hdr.timeout = 20000;     /* 20000 millisecs == 20 seconds */;
 
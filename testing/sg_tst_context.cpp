@@ -44,9 +44,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include "sg_lib.h"
+#include "sg_cdb.hpp"
 #include "sg_pt.h"
 
-static const char * version_str = "1.04 20181207";
+static const char * version_str = "1.05 20261016";
 static const char * util_name = "sg_tst_context";
 
 /* This is a test program for checking that file handles keep their
@@ -174,8 +175,6 @@ pt_cat_no_good(int cat, struct sg_pt_base * ptp, const unsigned char * sbp)
     return -EIO /* -5 */;
 }
 
-#define TUR_CMD_LEN 6
-#define SSU_CMD_LEN 6
 #define NOT_READY SG_LIB_CAT_NOT_READY
 
 /* Returns 0 for good, 1024 for a sense key of NOT_READY, or a negative
@@ -184,11 +183,11 @@ static int
 do_tur(struct sg_pt_base * ptp, int id)
 {
     int slen, res, cat;
-    unsigned char turCmdBlk [TUR_CMD_LEN] = {0x0, 0x0, 0x0, 0x0, 0x0, 0x0};
+    sg_cdb::cdb6_t turCmdBlk = sg_cdb::test_unit_ready();
     unsigned char sense_buffer[64];
 
     clear_scsi_pt_obj(ptp);
-    set_scsi_pt_cdb(ptp, turCmdBlk, sizeof(turCmdBlk));
+    set_scsi_pt_cdb(ptp, turCmdBlk.data(), turCmdBlk.size());
     set_scsi_pt_sense(ptp, sense_buffer, sizeof(sense_buffer));
     res = do_scsi_pt(ptp, -1, 20 /* secs timeout */, verbose);
     if (res) {
@@ -229,13 +228,11 @@ static int
 do_ssu(struct sg_pt_base * ptp, int id, bool start)
 {
     int slen, res, cat;
-    unsigned char ssuCmdBlk [SSU_CMD_LEN] = {0x1b, 0x0, 0x0, 0x0, 0x0, 0x0};
+    sg_cdb::cdb6_t ssuCmdBlk = sg_cdb::start_stop_unit(start);
     unsigned char sense_buffer[64];
 
-    if (start)
-        ssuCmdBlk[4] |= 0x1;
     clear_scsi_pt_obj(ptp);
-    set_scsi_pt_cdb(ptp, ssuCmdBlk, sizeof(ssuCmdBlk));
+    set_scsi_pt_cdb(ptp, ssuCmdBlk.data(), ssuCmdBlk.size());
     set_scsi_pt_sense(ptp, sense_buffer, sizeof(sense_buffer));
     res = do_scsi_pt(ptp, -1, 40 /* secs timeout */, verbose);
     if (res) {
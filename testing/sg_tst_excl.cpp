@@ -44,9 +44,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include "sg_lib.h"
+#include "sg_cdb.hpp"
 #include "sg_io_linux.h"
 
-static const char * version_str = "1.10 20181207";
+static const char * version_str = "1.11 20261016";
 static const char * util_name = "sg_tst_excl";
 
 /* This is a test program for checking O_EXCL on open() works. It uses
@@ -142,9 +143,7 @@ usage(void)
 
 
 #define READ16_REPLY_LEN 512
-#define READ16_CMD_LEN 16
 #define WRITE16_REPLY_LEN 512
-#define WRITE16_CMD_LEN 16
 
 /* Opens dev_name and spins if busy (i.e. gets EBUSY), sleeping for
  * wait_ms milliseconds if wait_ms is positive.
@@ -161,19 +160,13 @@ do_rd_inc_wr_twice(const char * dev_name, unsigned int lba, int block,
     int odd = 0;
     unsigned int u = 0;
     struct sg_io_hdr pt, pt2;
-    unsigned char r16CmdBlk [READ16_CMD_LEN] =
-                {0x88, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0};
-    unsigned char w16CmdBlk [WRITE16_CMD_LEN] =
-                {0x8a, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0};
+    sg_cdb::cdb16_t r16CmdBlk = sg_cdb::read16(lba, 1);
+    sg_cdb::cdb16_t w16CmdBlk = sg_cdb::write16(lba, 1);
     unsigned char sense_buffer[64];
     unsigned char lb[READ16_REPLY_LEN];
     char ebuff[EBUFF_SZ];
     int open_flags = O_RDWR;
 
-    r16CmdBlk[6] = w16CmdBlk[6] = (lba >> 24) & 0xff;
-    r16CmdBlk[7] = w16CmdBlk[7] = (lba >> 16) & 0xff;
-    r16CmdBlk[8] = w16CmdBlk[8] = (lba >> 8) & 0xff;
-    r16CmdBlk[9] = w16CmdBlk[9] = lba & 0xff;
     if (! block)
         open_flags |= O_NONBLOCK;
     if (excl)
@@ -200,12 +193,12 @@ do_rd_inc_wr_twice(const char * dev_name, unsigned int lba, int block,
         /* Prepare READ_16 command */
         memset(&pt, 0, sizeof(pt));
         pt.interface_id = 'S';
-        pt.cmd_len = sizeof(r16CmdBlk);
+        pt.cmd_len = r16CmdBlk.size();
         pt.mx_sb_len = sizeof(sense_buffer);
         pt.dxfer_direction = SG_DXFER_FROM_DEV;
         pt.dxfer_len = READ16_REPLY_LEN;
         pt.dxferp = lb;
-        pt.cmdp = r16CmdBlk;
+        pt.cmdp = r16CmdBlk.data();
         pt.sbp = sense_buffer;
         pt.timeout = 20000;     /* 20000 millisecs == 20 seconds */
         pt.pack_id = id;
@@ -341,12 +334,12 @@ do_rd_inc_wr_twice(const char * dev_name, unsigned int lba, int block,
         /* Prepare WRITE_16 command */
         memset(&pt, 0, sizeof(pt));
         pt.interface_id = 'S';
-        pt.cmd_len = sizeof(w16CmdBlk);
+        pt.cmd_len = w16CmdBlk.size();
         pt.mx_sb_len = sizeof(sense_buffer);
         pt.dxfer_direction = SG_DXFER_TO_DEV;
         pt.dxfer_len = WRITE16_REPLY_LEN;
         pt.dxferp = lb;
-        pt.cmdp = w16CmdBlk;
+        pt.cmdp = w16CmdBlk.data();
         pt.sbp = sense_buffer;
         pt.timeout = 20000;     /* 20000 millisecs == 20 seconds */
         pt.pack_id = id;
@@ -394,7 +387,6 @@ do_rd_inc_wr_twice(const char * dev_name, unsigned int lba, int block,
 
 
 #define INQ_REPLY_LEN 96
-#define INQ_CMD_LEN 6
 
 /* Send INQUIRY and fetches response. If okay puts PRODUCT ID field
  * in b (up to m_blen bytes). Does not use O_EXCL flag. Returns 0 on success,
@@ -405,8 +397,7 @@ do_inquiry_prod_id(const char * dev_name, int block, int wait_ms,
 {
     int sg_fd, ok, ret;
     struct sg_io_hdr pt;
-    unsigned char inqCmdBlk [INQ_CMD_LEN] =
-                                {0x12, 0, 0, 0, INQ_REPLY_LEN, 0};
+    sg_cdb::cdb6_t inqCmdBlk = sg_cdb::inquiry(INQ_REPLY_LEN);
     unsigned char inqBuff[INQ_REPLY_LEN];
     unsigned char sense_buffer[64];
     char ebuff[EBUFF_SZ];
@@ -433,13 +424,13 @@ do_inquiry_prod_id(const char * dev_name, int block, int wait_ms,
     /* Prepare INQUIRY command */
     memset(&pt, 0, sizeof(pt));
     pt.interface_id = 'S';
-    pt.cmd_len = sizeof(inqCmdBlk);
+    pt.cmd_len = inqCmdBlk.size();
     /* pt.iovec_count = 0; */  /* memset takes care of this */
     pt.mx_sb_len = sizeof(sense_buffer);
     pt.dxfer_direction = SG_DXFER_FROM_DEV;
     pt.dxfer_len = INQ_REPLY_LEN;
     pt.dxferp = inqBuff;
-    pt.cmdp = inqCmdBlk;
+    pt.cmdp = inqCmdBlk.data();
     pt.sbp = sense_buffer;
     pt.timeout = 20000;     /* 20000 millisecs == 20 seconds */
     /* pt.flags = 0; */     /* take defaults: indirect IO, etc */
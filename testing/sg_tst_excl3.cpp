@@ -44,9 +44,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include "sg_lib.h"
+#include "sg_cdb.hpp"
 #include "sg_pt.h"
 
-static const char * version_str = "1.06 20181207";
+static const char * version_str = "1.07 20261016";
 static const char * util_name = "sg_tst_excl3";
 
 /* This is a test program for checking O_EXCL on open() works. It uses
@@ -189,9 +190,7 @@ pt_cat_no_good(int cat, struct sg_pt_base * ptp, const unsigned char * sbp)
 }
 
 #define READ16_REPLY_LEN 512
-#define READ16_CMD_LEN 16
 #define WRITE16_REPLY_LEN 512
-#define WRITE16_CMD_LEN 16
 
 /* Opens dev_name and spins if busy (i.e. gets EBUSY), sleeping for
  * wait_ms milliseconds if wait_ms is positive. Reads lba and treats the
@@ -206,19 +205,13 @@ do_rd_inc_wr_twice(const char * dev_name, int read_only, unsigned int lba,
     int odd = 0;
     unsigned int u = 0;
     struct sg_pt_base * ptp = NULL;
-    unsigned char r16CmdBlk [READ16_CMD_LEN] =
-                {0x88, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0};
-    unsigned char w16CmdBlk [WRITE16_CMD_LEN] =
-                {0x8a, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0};
+    sg_cdb::cdb16_t r16CmdBlk = sg_cdb::read16(lba, 1);
+    sg_cdb::cdb16_t w16CmdBlk = sg_cdb::write16(lba, 1);
     unsigned char sense_buffer[64];
     unsigned char lb[READ16_REPLY_LEN];
     char ebuff[EBUFF_SZ];
     int open_flags = O_RDWR;
 
-    r16CmdBlk[6] = w16CmdBlk[6] = (lba >> 24) & 0xff;
-    r16CmdBlk[7] = w16CmdBlk[7] = (lba >> 16) & 0xff;
-    r16CmdBlk[8] = w16CmdBlk[8] = (lba >> 8) & 0xff;
-    r16CmdBlk[9] = w16CmdBlk[9] = lba & 0xff;
     if (! block)
         open_flags |= O_NONBLOCK;
     if (excl)
@@ -249,7 +242,7 @@ do_rd_inc_wr_twice(const char * dev_name, int read_only, unsigned int lba,
     for (k = 0; k < 2; ++k) {
         /* Prepare READ_16 command */
         clear_scsi_pt_obj(ptp);
-        set_scsi_pt_cdb(ptp, r16CmdBlk, sizeof(r16CmdBlk));
+        set_scsi_pt_cdb(ptp, r16CmdBlk.data(), r16CmdBlk.size());
         set_scsi_pt_sense(ptp, sense_buffer, sizeof(sense_buffer));
         set_scsi_pt_data_in(ptp, lb, READ16_REPLY_LEN);
         res = do_scsi_pt(ptp, sg_fd, 20 /* secs timeout */, 1);
@@ -295,7 +288,7 @@ do_rd_inc_wr_twice(const char * dev_name, int read_only, unsigned int lba,
 
         /* Prepare WRITE_16 command */
         clear_scsi_pt_obj(ptp);
-        set_scsi_pt_cdb(ptp, w16CmdBlk, sizeof(w16CmdBlk));
+        set_scsi_pt_cdb(ptp, w16CmdBlk.data(), w16CmdBlk.size());
         set_scsi_pt_sense(ptp, sense_buffer, sizeof(sense_buffer));
         set_scsi_pt_data_out(ptp, lb, WRITE16_REPLY_LEN);
         res = do_scsi_pt(ptp, sg_fd, 20 /* secs timeout */, 1);
@@ -328,7 +321,6 @@ err:
 
 
 #define INQ_REPLY_LEN 96
-#define INQ_CMD_LEN 6
 
 /* Send INQUIRY and fetches response. If okay puts PRODUCT ID field
  * in b (up to m_blen bytes). Does not use O_EXCL flag. Returns 0 on success,
@@ -339,8 +331,7 @@ do_inquiry_prod_id(const char * dev_name, int block, int wait_ms,
 {
     int sg_fd, res, cat;
     struct sg_pt_base * ptp = NULL;
-    unsigned char inqCmdBlk [INQ_CMD_LEN] =
-                                {0x12, 0, 0, 0, INQ_REPLY_LEN, 0};
+    sg_cdb::cdb6_t inqCmdBlk = sg_cdb::inquiry(INQ_REPLY_LEN);
     unsigned char inqBuff[INQ_REPLY_LEN];
     unsigned char sense_buffer[64];
     char ebuff[EBUFF_SZ];
@@ -367,7 +358,7 @@ do_inquiry_prod_id(const char * dev_name, int block, int wait_ms,
     /* Prepare INQUIRY command */
     ptp = construct_scsi_pt_obj();
     clear_scsi_pt_obj(ptp);
-    set_scsi_pt_cdb(ptp, inqCmdBlk, sizeof(inqCmdBlk));
+    set_scsi_pt_cdb(ptp, inqCmdBlk.data(), inqCmdBlk.size());
     set_scsi_pt_sense(ptp, sense_buffer, sizeof(sense_buffer));
     set_scsi_pt_data_in(ptp, inqBuff, INQ_REPLY_LEN);
     res = do_scsi_pt(ptp, sg_fd, 20 /* secs timeout */, 1);
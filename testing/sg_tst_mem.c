@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2026 Douglas Gilbert
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the BSD_LICENSE file.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * This program checks the memory backed pseudo disk ("mem:" device names)
+ * of this package's sg_utils library. It needs no SCSI devices. It opens
+ * pseudo disks with scsi_pt_open_device() and checks the responses to
+ * INQUIRY, READ CAPACITY(16), WRITE(16), READ(16) and UNMAP, then that
+ * err_lba= and ro inject the errors they should. The exit status is 0 if
+ * all checks pass, else 1 (or SG_LIB_SYNTAX_ERROR).
+ *
+ * Only Linux has the "mem:" backend.
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#define __STDC_FORMAT_MACROS 1
+#include <inttypes.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sg_lib.h"
+#include "sg_pt.h"
+#include "sg_cmds_basic.h"
+#include "sg_unaligned.h"
+#include "sg_pr2serr.h"
+
+static const char * version_str = "1.00 20261016";
+
+#define ME "sg_tst_mem: "
+
+#define DEF_BS 4096
+#define DEF_NUM_LBS 16384       /* 64 MiB at DEF_BS */
+#define TST_LBA 100
+#define TST_NUM 8
+#define TST_ERR_LBA 5
+
+#define SENSE_BUFF_LEN 64
+#define DEF_TIMEOUT_SECS 20
+
+static int num_fails = 0;
+static int verbose = 0;
+
+
+static struct option long_options[] = {
+    {"help", no_argument, 0, 'h'},
+    {"verbose", no_argument, 0, 'v'},
+    {"version", no_argument, 0, 'V'},
+    {0, 0, 0, 0},
+};
+
+static void
+usage()
+{
+    pr2serr("Usage: sg_tst_mem [--help] [--verbose] [--version]\n"
+            "  where:\n"
+            "    --help|-h       print out usage message\n"
+            "    --verbose|-v    increase verbosity\n"
+            "    --version|-V    print version string and exit\n\n"
+            "Checks the memory backed pseudo disk (e.g. device name "
+            "\"mem:size=64m\")\nwithout needing a SCSI device. Exit status "
+            "is 0 if all checks pass.\n");
+}
+
+static void
+check(bool ok, const char * what)
+{
+    if (ok) {
+        if (verbose)
+            printf("  pass: %s\n", what);
+    } else {
+        printf("  FAIL: %s\n", what);
+        ++num_fails;
+    }
+}
+
+/* Sends cdb to fd. Data goes in (if din) or out of buff. Returns the
+ * sense key (0 for GOOD status) or -1 for an OS error. */
+static int
+do_cmd(int fd, const uint8_t * cdb, int cdb_len, uint8_t * buff, int len,
+       bool din)
+{
+    int res, cat, sk;
+    struct sg_pt_base * ptp;
+    uint8_t sense_b[SENSE_BUFF_LEN];
+
+    ptp = construct_scsi_pt_obj_with_fd(fd, verbose);
+    if (NULL == ptp) {
+        pr2serr(ME "out of memory\n");
+        return -1;
+    }
+    memset(sense_b, 0, sizeof(sense_b));
+    set_scsi_pt_cdb(ptp, cdb, cdb_len);
+    set_scsi_pt_sense(ptp, sense_b, sizeof(sense_b));
+    if (len > 0) {
+        if (din)
+            set_scsi_pt_data_in(ptp, buff, len);
+        else
+            set_scsi_pt_data_out(ptp, buff, len);
+    }
+    res = do_scsi_pt(ptp, -1, DEF_TIMEOUT_SECS, verbose);
+    if (res) {
+        pr2serr(ME "do_scsi_pt() failed, res=%d\n", res);
+        destruct_scsi_pt_obj(ptp);
+        return -1;
+    }
+    cat = get_scsi_pt_result_category(ptp);
+    if (SCSI_PT_RESULT_GOOD == cat)
+        sk = 0;
+    else if (SCSI_PT_RESULT_SENSE == cat)
+        sk = sg_get_sense_key(sense_b, get_scsi_pt_sense_len(ptp));
+    else
+        sk = -1;
+    destruct_scsi_pt_obj(ptp);
+    return sk;
+}
+
+static int
+do_rw16(int fd, bool is_read, uint64_t lba, uint32_t num, uint8_t * buff,
+        int bs)
+{
+    uint8_t cdb[16];
+
+    memset(cdb, 0, sizeof(cdb));
+    cdb[0] = is_read ? 0x88 : 0x8a;
+    sg_put_unaligned_be64(lba, cdb + 2);
+    sg_put_unaligned_be32(num, cdb + 10);
+    return do_cmd(fd, cdb, sizeof(cdb), buff, num * bs, is_read);
+}
+
+static int
+do_unmap(int fd, uint64_t lba, uint32_t num)
+{
+    uint8_t cdb[10];
+    uint8_t param[24];
+
+    memset(cdb, 0, sizeof(cdb));
+    cdb[0] = 0x42;
+    sg_put_unaligned_be16(sizeof(param), cdb + 7);
+    memset(param, 0, sizeof(param));
+    sg_put_unaligned_be16(sizeof(param) - 2, param + 0);
+    sg_put_unaligned_be16(16, param + 2);
+    sg_put_unaligned_be64(lba, param + 8);
+    sg_put_unaligned_be32(num, param + 16);
+    return do_cmd(fd, cdb, sizeof(cdb), param, sizeof(param), false);
+}
+
+static void
+tst_basic(uint8_t * buff, uint8_t * buff2)
+{
+    int fd, k;
+    char b[80];
+    uint8_t resp[64];
+
+    snprintf(b, sizeof(b), "mem:size=%dk,bs=%d",
+             (DEF_NUM_LBS * DEF_BS) / 1024, DEF_BS);
+    printf("%s\n", b);
+    fd = scsi_pt_open_device(b, false, verbose);
+    if (fd < 0) {
+        pr2serr(ME "open of %s failed: %s\n", b, safe_strerror(-fd));
+        ++num_fails;
+        return;
+    }
+    memset(resp, 0, sizeof(resp));
+    check((0 == sg_ll_inquiry(fd, false, false, 0, resp, 36, true,
+                              verbose)) &&
+          (0 == (0x1f & resp[0])) &&
+          (0 == memcmp(resp + 16, "sg3_utils mem", 13)),
+          "INQUIRY: disk, product \"sg3_utils mem\"");
+    memset(resp, 0, sizeof(resp));
+    check((0 == sg_ll_readcap_16(fd, false, 0, resp, 32, true, verbose)) &&
+          ((DEF_NUM_LBS - 1) == sg_get_unaligned_be64(resp + 0)) &&
+          (DEF_BS == sg_get_unaligned_be32(resp + 8)),
+          "READ CAPACITY(16): size and block length");
+
+    for (k = 0; k < (TST_NUM * DEF_BS); ++k)
+        buff[k] = (uint8_t)(k + (k / DEF_BS));
+    check(0 == do_rw16(fd, false, TST_LBA, TST_NUM, buff, DEF_BS),
+          "WRITE(16)");
+    memset(buff2, 0xff, TST_NUM * DEF_BS);
+    check((0 == do_rw16(fd, true, TST_LBA, TST_NUM, buff2, DEF_BS)) &&
+          (0 == memcmp(buff, buff2, TST_NUM * DEF_BS)),
+          "READ(16) returns what was written");
+    check(0 == do_rw16(fd, true, DEF_NUM_LBS - 1, 1, buff2, DEF_BS),
+          "READ(16) of last LBA");
+    check(5 == do_rw16(fd, true, DEF_NUM_LBS, 1, buff2, DEF_BS),
+          "READ(16) past last LBA: ILLEGAL REQUEST");
+
+    check(0 == do_unmap(fd, TST_LBA, TST_NUM), "UNMAP");
+    memset(buff, 0, TST_NUM * DEF_BS);
+    memset(buff2, 0xff, TST_NUM * DEF_BS);
+    check((0 == do_rw16(fd, true, TST_LBA, TST_NUM, buff2, DEF_BS)) &&
+          (0 == memcmp(buff, buff2, TST_NUM * DEF_BS)),
+          "READ(16) after UNMAP returns zeros");
+    scsi_pt_close_device(fd);
+}
+
+static void
+tst_errors(uint8_t * buff)
+{
+    int fd;
+    char b[80];
+
+    snprintf(b, sizeof(b), "mem:size=1m,err_lba=%d", TST_ERR_LBA);
+    printf("%s\n", b);
+    fd = scsi_pt_open_device(b, false, verbose);
+    if (fd < 0) {
+        pr2serr(ME "open of %s failed: %s\n", b, safe_strerror(-fd));
+        ++num_fails;
+        return;
+    }
+    check(0 == do_rw16(fd, true, 0, TST_ERR_LBA, buff, 512),
+          "READ(16) before err_lba");
+    check(3 == do_rw16(fd, true, 0, TST_ERR_LBA + 1, buff, 512),
+          "READ(16) including err_lba: MEDIUM ERROR");
+    scsi_pt_close_device(fd);
+
+    snprintf(b, sizeof(b), "mem:size=1m,ro");
+    printf("%s\n", b);
+    fd = scsi_pt_open_device(b, false, verbose);
+    if (fd < 0) {
+        pr2serr(ME "open of %s failed: %s\n", b, safe_strerror(-fd));
+        ++num_fails;
+        return;
+    }
+    check(0 == do_rw16(fd, true, 0, 1, buff, 512), "READ(16) when ro");
+    check(7 == do_rw16(fd, false, 0, 1, buff, 512),
+          "WRITE(16) when ro: DATA PROTECT");
+    scsi_pt_close_device(fd);
+}
+
+
+int
+main(int argc, char * argv[])
+{
+    int c;
+    uint8_t * buff;
+    uint8_t * buff2;
+
+    while (1) {
+        int option_index = 0;
+
+        c = getopt_long(argc, argv, "hvV", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+        case 'h':
+        case '?':
+            usage();
+            return 0;
+        case 'v':
+            ++verbose;
+            break;
+        case 'V':
+            pr2serr(ME "version: %s\n", version_str);
+            return 0;
+        default:
+            pr2serr(ME "unrecognised option code 0x%x ??\n", c);
+            usage();
+            return SG_LIB_SYNTAX_ERROR;
+        }
+    }
+    if (optind < argc) {
+        pr2serr(ME "unexpected extra argument: %s\n", argv[optind]);
+        usage();
+        return SG_LIB_SYNTAX_ERROR;
+    }
+    buff = (uint8_t *)malloc(TST_NUM * DEF_BS);
+    buff2 = (uint8_t *)malloc(TST_NUM * DEF_BS);
+    if ((NULL == buff) || (NULL == buff2)) {
+        pr2serr(ME "out of memory\n");
+        return 1;
+    }
+    tst_basic(buff, buff2);
+    tst_errors(buff);
+    free(buff);
+    free(buff2);
+    if (num_fails)
+        printf("%d check%s failed\n", num_fails, (1 == num_fails) ? "" : "s");
+    else
+        printf("all checks passed\n");
+    return num_fails ? 1 : 0;
+}
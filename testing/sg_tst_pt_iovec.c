@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2026 Douglas Gilbert
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the BSD_LICENSE file.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * This program checks set_scsi_pt_data_in_iov() in this package's sg_utils
+ * library. It issues an INQUIRY into a flat buffer then the same INQUIRY
+ * into a 2 element scatter gather list (split at an odd offset) and
+ * compares the two responses and their residual counts. In Linux DEVICE
+ * may be a "mem:" pseudo disk. The exit status is 0 if they match, 1 if
+ * they differ, else a SG_LIB_* value (e.g. a pass-through that does not
+ * support scatter gather lists fails with SG_LIB_CAT_OTHER).
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sg_lib.h"
+#include "sg_pt.h"
+#include "sg_unaligned.h"
+#include "sg_pr2serr.h"
+
+static const char * version_str = "1.00 20261016";
+
+#define ME "sg_tst_pt_iovec: "
+
+#define DEF_ALLOC_LEN 96
+#define DEF_SPLIT 13
+#define MAX_ALLOC_LEN 0xfffc
+#define SENSE_BUFF_LEN 64
+#define DEF_TIMEOUT_SECS 20
+
+
+static struct option long_options[] = {
+    {"help", no_argument, 0, 'h'},
+    {"maxlen", required_argument, 0, 'm'},
+    {"page", required_argument, 0, 'p'},
+    {"split", required_argument, 0, 's'},
+    {"verbose", no_argument, 0, 'v'},
+    {"version", no_argument, 0, 'V'},
+    {0, 0, 0, 0},
+};
+
+static void
+usage()
+{
+    pr2serr("Usage: sg_tst_pt_iovec [--help] [--maxlen=LEN] [--page=PG] "
+            "[--split=SP]\n"
+            "                       [--verbose] [--version] DEVICE\n"
+            "  where:\n"
+            "    --help|-h            print out usage message\n"
+            "    --maxlen=LEN|-m LEN    INQUIRY allocation length (def: "
+            "%d)\n"
+            "    --page=PG|-p PG      VPD page number (def: standard "
+            "INQUIRY)\n"
+            "    --split=SP|-s SP     length of the first iovec element "
+            "(def: %d)\n"
+            "    --verbose|-v         increase verbosity\n"
+            "    --version|-V         print version string and exit\n\n"
+            "Compares an INQUIRY response read into a flat buffer with one "
+            "read into\na 2 element scatter gather list.\n", DEF_ALLOC_LEN,
+            DEF_SPLIT);
+}
+
+/* Issues INQUIRY on fd into buff (if iov_count is 0) or into iovp. Places
+ * the residual count in *residp. Returns 0 on success else a SG_LIB_*
+ * value. */
+static int
+do_inq(int fd, int pg, uint8_t * buff, int len,
+       const struct sg_pt_iovec * iovp, int iov_count, int * residp, int vb)
+{
+    int res, cat, ret;
+    struct sg_pt_base * ptp;
+    uint8_t cdb[6];
+    uint8_t sense_b[SENSE_BUFF_LEN];
+
+    memset(cdb, 0, sizeof(cdb));
+    cdb[0] = 0x12;
+    if (pg >= 0) {
+        cdb[1] = 0x1;           /* EVPD */
+        cdb[2] = (uint8_t)pg;
+    }
+    cdb[3] = (uint8_t)(len >> 8);
+    cdb[4] = (uint8_t)len;
+    ptp = construct_scsi_pt_obj_with_fd(fd, vb);
+    if (NULL == ptp) {
+        pr2serr(ME "out of memory\n");
+        return SG_LIB_CAT_OTHER;
+    }
+    memset(sense_b, 0, sizeof(sense_b));
+    set_scsi_pt_cdb(ptp, cdb, sizeof(cdb));
+    set_scsi_pt_sense(ptp, sense_b, sizeof(sense_b));
+    if (iov_count > 0)
+        set_scsi_pt_data_in_iov(ptp, iovp, iov_count);
+    else
+        set_scsi_pt_data_in(ptp, buff, len);
+    res = do_scsi_pt(ptp, -1, DEF_TIMEOUT_SECS, vb);
+    if (res) {
+        if (SCSI_PT_DO_BAD_PARAMS == res)
+            pr2serr(ME "pass-through rejected the request (scatter gather "
+                    "lists not supported?)\n");
+        else
+            pr2serr(ME "do_scsi_pt() failed, res=%d\n", res);
+        ret = SG_LIB_CAT_OTHER;
+        goto fini;
+    }
+    cat = get_scsi_pt_result_category(ptp);
+    if (SCSI_PT_RESULT_GOOD == cat) {
+        *residp = get_scsi_pt_resid(ptp);
+        ret = 0;
+    } else {
+        if (SCSI_PT_RESULT_SENSE == cat)
+            sg_print_sense(ME "INQUIRY", sense_b,
+                           get_scsi_pt_sense_len(ptp), vb > 1);
+        else
+            pr2serr(ME "INQUIRY failed, result category %d\n", cat);
+        ret = SG_LIB_CAT_OTHER;
+    }
+fini:
+    destruct_scsi_pt_obj(ptp);
+    return ret;
+}
+
+
+int
+main(int argc, char * argv[])
+{
+    int c, fd, res, flat_resid, iov_resid, n;
+    int alloc_len = DEF_ALLOC_LEN;
+    int split = DEF_SPLIT;
+    int pg = -1;
+    int vb = 0;
+    int ret = 0;
+    const char * device_name = NULL;
+    uint8_t * flat_b = NULL;
+    uint8_t * iov_b = NULL;
+    struct sg_pt_iovec iov[2];
+
+    while (1) {
+        int option_index = 0;
+
+        c = getopt_long(argc, argv, "hm:p:s:vV", long_options,
+                        &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+        case 'h':
+        case '?':
+            usage();
+            return 0;
+        case 'm':
+            alloc_len = sg_get_num(optarg);
+            if ((alloc_len < 8) || (alloc_len > MAX_ALLOC_LEN)) {
+                pr2serr(ME "--maxlen= expects 8 to %d\n", MAX_ALLOC_LEN);
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            break;
+        case 'p':
+            pg = sg_get_num(optarg);
+            if ((pg < 0) || (pg > 255)) {
+                pr2serr(ME "--page= expects 0 to 255\n");
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            break;
+        case 's':
+            split = sg_get_num(optarg);
+            if (split < 1) {
+                pr2serr(ME "--split= expects a positive number\n");
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            break;
+        case 'v':
+            ++vb;
+            break;
+        case 'V':
+            pr2serr(ME "version: %s\n", version_str);
+            return 0;
+        default:
+            pr2serr(ME "unrecognised option code 0x%x ??\n", c);
+            usage();
+            return SG_LIB_SYNTAX_ERROR;
+        }
+    }
+    if (optind < argc) {
+        device_name = argv[optind];
+        if (++optind < argc) {
+            pr2serr(ME "unexpected extra argument: %s\n", argv[optind]);
+            usage();
+            return SG_LIB_SYNTAX_ERROR;
+        }
+    }
+    if (NULL == device_name) {
+        pr2serr(ME "missing DEVICE name\n\n");
+        usage();
+        return SG_LIB_SYNTAX_ERROR;
+    }
+    if (split >= alloc_len) {
+        pr2serr(ME "--split= must be less than --maxlen= (%d)\n", alloc_len);
+        return SG_LIB_SYNTAX_ERROR;
+    }
+    fd = scsi_pt_open_device(device_name, true, vb);
+    if (fd < 0) {
+        pr2serr(ME "open of %s failed: %s\n", device_name,
+                safe_strerror(-fd));
+        return sg_convert_errno(-fd);
+    }
+    flat_b = (uint8_t *)calloc(alloc_len, 1);
+    iov_b = (uint8_t *)calloc(alloc_len, 1);
+    if ((NULL == flat_b) || (NULL == iov_b)) {
+        pr2serr(ME "out of memory\n");
+        ret = sg_convert_errno(ENOMEM);
+        goto fini;
+    }
+    /* fill so parts not written by the device differ in the two buffers */
+    memset(iov_b, 0xa5, alloc_len);
+    iov[0].iov_base = iov_b;
+    iov[0].iov_len = split;
+    iov[1].iov_base = iov_b + split;
+    iov[1].iov_len = alloc_len - split;
+
+    res = do_inq(fd, pg, flat_b, alloc_len, NULL, 0, &flat_resid, vb);
+    if (res) {
+        ret = res;
+        goto fini;
+    }
+    res = do_inq(fd, pg, NULL, alloc_len, iov, 2, &iov_resid, vb);
+    if (res) {
+        ret = res;
+        goto fini;
+    }
+    /* some transports do not report a residual count, so only compare up
+     * to the response length the device gives */
+    n = (pg < 0) ? (flat_b[4] + 5) : (sg_get_unaligned_be16(flat_b + 2) + 4);
+    if (n > (alloc_len - flat_resid))
+        n = alloc_len - flat_resid;
+    if (vb) {
+        pr2serr("flat buffer response, resid=%d:\n", flat_resid);
+        hex2stderr(flat_b, alloc_len - flat_resid, 0);
+        pr2serr("2 element iovec (%d+%d) response, resid=%d:\n", split,
+                alloc_len - split, iov_resid);
+        hex2stderr(iov_b, alloc_len - iov_resid, 0);
+    }
+    if (flat_resid != iov_resid) {
+        printf("residual counts differ: flat=%d, iovec=%d\n", flat_resid,
+               iov_resid);
+        ret = 1;
+    } else if (memcmp(flat_b, iov_b, n)) {
+        printf("responses differ\n");
+        ret = 1;
+    } else
+        printf("flat buffer and 2 element iovec responses match (%d "
+               "bytes)\n", n);
+fini:
+    free(flat_b);
+    free(iov_b);
+    scsi_pt_close_device(fd);
+    return ret;
+}
@@ -44,7 +44,7 @@
  * related to snprintf().
  */
 
-static const char * version_str = "1.12 20181207";
+static const char * version_str = "1.13 20261015";
 
 
 #define MAX_LINE_LEN 1024
@@ -62,6 +62,7 @@ static struct option long_options[] = {
         {"unaligned", no_argument, 0, 'u'},
         {"verbose", no_argument, 0, 'v'},
         {"version", no_argument, 0, 'V'},
+        {"zeros", required_argument, 0, 'z'},
         {0, 0, 0, 0},   /* sentinel */
 };
 
@@ -162,6 +163,7 @@ usage()
             "[--printf]\n"
             "                  [--sense] [--unaligned] [--verbose] "
             "[--version]\n"
+            "                  [--zeros=SZ]\n"
             "  where:\n"
 #if defined(__GNUC__) && ! defined(SG_LIB_FREEBSD)
             "    --byteswap=B|-b B    B is 16, 32 or 64; tests NUM "
@@ -182,7 +184,12 @@ usage()
             "    --sense|-s         test sense data handling\n"
             "    --unaligned|-u     test unaligned data handling\n"
             "    --verbose|-v       increase verbosity\n"
-            "    --version|-V       print version string and exit\n\n"
+            "    --version|-V       print version string and exit\n"
+            "    --zeros=SZ|-z SZ    times NUM scans of a SZ byte buffer "
+            "by\n"
+            "                        sg_all_zeros() and sg_first_non_zero() "
+            "against\n"
+            "                        a byte loop and memcmp()\n\n"
             "Test various parts of sg_lib, see options. Sense data tests "
             "overlap\nsomewhat with examples/sg_sense_test .\n"
            );
@@ -210,6 +217,82 @@ get_exit_status_str(int exit_status, bool longer, int b_len, char * b)
 
 static uint8_t arr[64];
 
+static uint32_t
+elapsed_usecs(const struct timespec * start_tmp)
+{
+    struct timespec end_tm;
+
+    if (0 != clock_gettime(CLOCK_MONOTONIC, &end_tm))
+        return 0;
+    return ((end_tm.tv_sec - start_tmp->tv_sec) * 1000000) +
+           ((end_tm.tv_nsec - start_tmp->tv_nsec) / 1000);
+}
+
+static void
+zeros_report(const char * name, int count, int num, int sz, uint32_t usecs)
+{
+    double mbps = 0.0;
+
+    if (usecs > 0)
+        mbps = ((double)num * (double)sz) / (double)usecs;
+    printf("  %-22s count=%d  elapsed usecs=%u  [%.1f MB/s]\n", name, count,
+           usecs, mbps);
+}
+
+/* Compare scanning for zeros as done by sg_all_zeros() and
+ * sg_first_non_zero() with a byte by byte loop and memcmp() against a
+ * zeroed buffer (as sg_dd's oflag=sparse used to). Last byte is set for the
+ * sg_first_non_zero() runs. */
+static int
+zeros_bench(int sz, int num)
+{
+    int k, j, count;
+    uint8_t * bp;
+    uint8_t * zp;
+    uint8_t * free_bp;
+    uint8_t * free_zp;
+    struct timespec start_tm;
+
+    bp = sg_memalign(sz, 0, &free_bp, false);
+    zp = sg_memalign(sz, 0, &free_zp, false);
+    if ((NULL == bp) || (NULL == zp)) {
+        fprintf(stderr, "%s: out of memory\n", __func__);
+        return 1;
+    }
+    printf("Scanning %d bytes, %d times:\n", sz, num);
+    clock_gettime(CLOCK_MONOTONIC, &start_tm);
+    for (count = 0, k = 0; k < num; ++k) {
+        for (j = 0; j < sz; ++j) {
+            if (*(volatile uint8_t *)(bp + j))
+                break;
+        }
+        count += (j == sz);
+    }
+    zeros_report("byte loop", count, num, sz, elapsed_usecs(&start_tm));
+    clock_gettime(CLOCK_MONOTONIC, &start_tm);
+    for (count = 0, k = 0; k < num; ++k)
+        count += (0 == memcmp(bp, zp, sz));
+    zeros_report("memcmp", count, num, sz, elapsed_usecs(&start_tm));
+    clock_gettime(CLOCK_MONOTONIC, &start_tm);
+    for (count = 0, k = 0; k < num; ++k)
+        count += sg_all_zeros(bp, sz);
+    zeros_report("sg_all_zeros", count, num, sz, elapsed_usecs(&start_tm));
+    bp[sz - 1] = 0x1;
+    clock_gettime(CLOCK_MONOTONIC, &start_tm);
+    for (count = 0, k = 0; k < num; ++k)
+        count += (sg_first_non_zero(bp, sz) == (sz - 1));
+    zeros_report("sg_first_non_zero", count, num, sz,
+                 elapsed_usecs(&start_tm));
+    memset(bp, 0xff, sz);
+    clock_gettime(CLOCK_MONOTONIC, &start_tm);
+    for (count = 0, k = 0; k < num; ++k)
+        count += sg_all_ffs(bp, sz);
+    zeros_report("sg_all_ffs", count, num, sz, elapsed_usecs(&start_tm));
+    free(free_bp);
+    free(free_zp);
+    return 0;
+}
+
 #define OFF 7   /* in byteswap mode, can test different alignments (def: 8) */
 
 int
@@ -224,6 +307,7 @@ main(int argc, char * argv[])
     int do_printf = 0;
     int do_sense = 0;
     int do_unaligned = 0;
+    int zeros_sz = 0;
     int did_something = 0;
     int vb = 0;
     int ret = 0;
@@ -234,7 +318,7 @@ main(int argc, char * argv[])
     while (1) {
         int option_index = 0;
 
-        c = getopt_long(argc, argv, "b:ehHl:n:psuvV", long_options,
+        c = getopt_long(argc, argv, "b:ehHl:n:psuvVz:", long_options,
                         &option_index);
         if (c == -1)
             break;
@@ -283,6 +367,13 @@ main(int argc, char * argv[])
         case 'V':
             fprintf(stderr, "version: %s\n", version_str);
             return 0;
+        case 'z':
+            zeros_sz = sg_get_num(optarg);
+            if (zeros_sz < 1) {
+                fprintf(stderr, "--zeros= expects a positive number\n");
+                return 1;
+            }
+            break;
         default:
             fprintf(stderr, "unrecognised switch code 0x%x ??\n", c);
             usage();
@@ -652,6 +743,12 @@ main(int argc, char * argv[])
     }
 #endif
 
+    if (zeros_sz > 0) {
+        ++did_something;
+        if (zeros_bench(zeros_sz, do_num))
+            ret = 1;
+    }
+
     if (0 == did_something)
         printf("Looks like no tests done, check usage with '-h'\n");
     return ret;
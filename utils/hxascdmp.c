@@ -19,7 +19,7 @@
 
 static int bytes_per_line = DEF_BYTES_PER_LINE;
 
-static const char * version_str = "1.15 20181207";
+static const char * version_str = "1.16 20261015";
 
 #define CHARS_PER_HEX_BYTE 3
 #define BINARY_START_COL 6
@@ -59,6 +59,50 @@ sg_set_binary_mode(int fd)
 }
 #endif
 
+/* Lines are rendered with a hex digit table (rather than sprintf()) and
+ * collected in out_buff which is written with one fwrite() per block. */
+static const char hex_digits[] = "0123456789abcdef";
+
+#define OUT_BUFF_LEN 65536
+
+static char out_buff[OUT_BUFF_LEN];
+static int out_len = 0;
+
+static void
+out_flush(void)
+{
+    if (out_len > 0)
+        fwrite(out_buff, 1, out_len, stdout);
+    out_len = 0;
+}
+
+/* Line length is less than MAX_LINE_LENGTH */
+static void
+out_line(const char * lp, int len)
+{
+    if ((out_len + len + 1) > OUT_BUFF_LEN)
+        out_flush();
+    memcpy(out_buff + out_len, lp, len);
+    out_len += len;
+    out_buff[out_len++] = '\n';
+}
+
+/* Same as sprintf(cp, "%.2lx", a) but without the trailing '\0'. Returns
+ * number of characters written. */
+static int
+addr_put(char * cp, long a)
+{
+    int k, n;
+    unsigned long u = (unsigned long)a;
+    char t[2 * sizeof(long)];
+
+    for (n = 0; (u > 0) || (n < 2); ++n, u >>= 4)
+        t[n] = hex_digits[u & 0xf];
+    for (k = 0; k < n; ++k)
+        cp[k] = t[n - 1 - k];
+    return n;
+}
+
 /* Returns the number of times 'ch' is found in string 's' given the
  * string's length. */
 static int
@@ -107,20 +151,20 @@ dStrHex(const char* str, int len, long start, int noAddr)
     memset(buff, ' ', line_length);
     buff[line_length] = '\0';
     if (0 == noAddr) {
-        k = sprintf(buff + 1, "%.2lx", a);
+        k = addr_put(buff + 1, a);
         buff[k + 1] = ' ';
     }
 
     for(j = 0; j < len; j++) {
         nl = (0 == (j % bytes_per_line));
         if ((j > 0) && nl) {
-            printf("%s\n", buff);
+            out_line(buff, line_length);
             bpos = bpstart;
             cpos = cpstart;
             a += bytes_per_line;
             memset(buff,' ', line_length);
             if (0 == noAddr) {
-                k = sprintf(buff + 1, "%.2lx", a);
+                k = addr_put(buff + 1, a);
                 buff[k + 1] = ' ';
             }
         }
@@ -128,14 +172,16 @@ dStrHex(const char* str, int len, long start, int noAddr)
         bpos += (nl && noAddr) ?  0 : CHARS_PER_HEX_BYTE;
         if ((bytes_per_line > 4) && ((j % bytes_per_line) == midline_space))
             bpos++;
-        sprintf(&buff[bpos], "%.2x", (int)(unsigned char)c);
+        buff[bpos] = hex_digits[c >> 4];
+        buff[bpos + 1] = hex_digits[c & 0xf];
         buff[bpos + 2] = ' ';
         if ((c < ' ') || (c >= 0x7f))
             c='.';
         buff[cpos++] = c;
     }
     if (cpos > cpstart)
-        printf("%s\n", buff);
+        out_line(buff, line_length);
+    out_flush();
 }
 
 static void
@@ -163,19 +209,19 @@ dStrHexOnly(const char* str, int len, long start, int noAddr)
     memset(buff, ' ', line_length);
     buff[line_length] = '\0';
     if (0 == noAddr) {
-        k = sprintf(buff + 1, "%.2lx", a);
+        k = addr_put(buff + 1, a);
         buff[k + 1] = ' ';
     }
 
     for(j = 0; j < len; j++) {
         nl = (0 == (j % bytes_per_line));
         if ((j > 0) && nl) {
-            printf("%s\n", buff);
+            out_line(buff, line_length);
             bpos = bpstart;
             a += bytes_per_line;
             memset(buff,' ', line_length);
             if (0 == noAddr) {
-                k = sprintf(buff + 1, "%.2lx", a);
+                k = addr_put(buff + 1, a);
                 buff[k + 1] = ' ';
             }
         }
@@ -183,11 +229,13 @@ dStrHexOnly(const char* str, int len, long start, int noAddr)
         bpos += (nl && noAddr) ? 0 : CHARS_PER_HEX_BYTE;
         if ((bytes_per_line > 4) && ((j % bytes_per_line) == midline_space))
             bpos++;
-        sprintf(&buff[bpos], "%.2x", (int)(unsigned char)c);
+        buff[bpos] = hex_digits[c >> 4];
+        buff[bpos + 1] = hex_digits[c & 0xf];
         buff[bpos + 2] = ' ';
     }
     if (bpos > bpstart)
-        printf("%s\n", buff);
+        out_line(buff, line_length);
+    out_flush();
 }
 
 static void